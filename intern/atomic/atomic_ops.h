@@ -87,6 +87,12 @@ atomic_sub_uint64(uint64_t *p, uint64_t x)
 {
 	return (__sync_sub_and_fetch(p, x));
 }
+
+ATOMIC_INLINE uint64_t
+atomic_cas_uint64(uint64_t *v, uint64_t old, uint64_t _new)
+{
+	return (__sync_val_compare_and_swap(v, old, _new));
+}
 #elif (defined(_MSC_VER))
 ATOMIC_INLINE uint64_t
 atomic_add_uint64(uint64_t *p, uint64_t x)
@@ -99,6 +105,12 @@ atomic_sub_uint64(uint64_t *p, uint64_t x)
 {
 	return (InterlockedExchangeAdd64(p, -((int64_t)x)));
 }
+
+ATOMIC_INLINE uint64_t
+atomic_cas_uint64(uint64_t *v, uint64_t old, uint64_t _new)
+{
+	return (uint64_t)(InterlockedCompareExchange64((int64_t *)v, _new, old));
+}
 #elif (defined(__APPLE__))
 ATOMIC_INLINE uint64_t
 atomic_add_uint64(uint64_t *p, uint64_t x)
@@ -111,6 +123,15 @@ atomic_sub_uint64(uint64_t *p, uint64_t x)
 {
 	return (uint64_t)(OSAtomicAdd64(-((int64_t)x), (int64_t *)p));
 }
+
+ATOMIC_INLINE uint64_t
+atomic_cas_uint64(uint64_t *v, uint64_t old, uint64_t _new)
+{
+	if (OSAtomicCompareAndSwap64Barrier((int64_t)old, (int64_t)_new, (int64_t *)v))
+		return (old);
+	else
+		return (*v);
+}
 #  elif (defined(__amd64__) || defined(__x86_64__))
 ATOMIC_INLINE uint64_t
 atomic_add_uint64(uint64_t *p, uint64_t x)
@@ -134,6 +155,18 @@ atomic_sub_uint64(uint64_t *p, uint64_t x)
 	    );
 	return (x);
 }
+
+ATOMIC_INLINE uint64_t
+atomic_cas_uint64(uint64_t *v, uint64_t old, uint64_t _new)
+{
+	uint64_t ret;
+	asm volatile (
+	    "lock; cmpxchgq %2,%1"
+	    : "=a" (ret), "+m" (*v) /* Outputs. */
+	    : "r" (_new), "0" (old) /* Inputs. */
+	    : "memory");
+	return (ret);
+}
 #  elif (defined(JEMALLOC_ATOMIC9))
 ATOMIC_INLINE uint64_t
 atomic_add_uint64(uint64_t *p, uint64_t x)
@@ -154,6 +187,15 @@ atomic_sub_uint64(uint64_t *p, uint64_t x)
 
 	return (atomic_fetchadd_long(p, (unsigned long)(-(long)x)) - x);
 }
+
+ATOMIC_INLINE uint64_t
+atomic_cas_uint64(uint64_t *v, uint64_t old, uint64_t _new)
+{
+	if (atomic_cmpset_long((unsigned long *)v, old, _new))
+		return (old);
+	else
+		return (*v);
+}
 #  elif (defined(JE_FORCE_SYNC_COMPARE_AND_SWAP_8))
 ATOMIC_INLINE uint64_t
 atomic_add_uint64(uint64_t *p, uint64_t x)
@@ -166,6 +208,12 @@ atomic_sub_uint64(uint64_t *p, uint64_t x)
 {
 	return (__sync_sub_and_fetch(p, x));
 }
+
+ATOMIC_INLINE uint64_t
+atomic_cas_uint64(uint64_t *v, uint64_t old, uint64_t _new)
+{
+	return (__sync_val_compare_and_swap(v, old, _new));
+}
 #  else
 #    error "Missing implementation for 64-bit atomic operations"
 #  endif
@@ -185,6 +233,12 @@ atomic_sub_uint32(uint32_t *p, uint32_t x)
 {
 	return (__sync_sub_and_fetch(p, x));
 }
+
+ATOMIC_INLINE uint32_t
+atomic_cas_uint32(uint32_t *v, uint32_t old, uint32_t _new)
+{
+	return (__sync_val_compare_and_swap(v, old, _new));
+}
 #elif (defined(_MSC_VER))
 ATOMIC_INLINE uint32_t
 atomic_add_uint32(uint32_t *p, uint32_t x)
@@ -197,6 +251,12 @@ atomic_sub_uint32(uint32_t *p, uint32_t x)
 {
 	return (InterlockedExchangeAdd(p, -((int32_t)x)));
 }
+
+ATOMIC_INLINE uint32_t
+atomic_cas_uint32(uint32_t *v, uint32_t old, uint32_t _new)
+{
+	return (uint32_t)(InterlockedCompareExchange((long *)v, _new, old));
+}
 #elif (defined(__APPLE__))
 ATOMIC_INLINE uint32_t
 atomic_add_uint32(uint32_t *p, uint32_t x)
@@ -209,6 +269,15 @@ atomic_sub_uint32(uint32_t *p, uint32_t x)
 {
 	return (uint32_t)(OSAtomicAdd32(-((int32_t)x), (int32_t *)p));
 }
+
+ATOMIC_INLINE uint32_t
+atomic_cas_uint32(uint32_t *v, uint32_t old, uint32_t _new)
+{
+	if (OSAtomicCompareAndSwap32Barrier((int32_t)old, (int32_t)_new, (int32_t *)v))
+		return (old);
+	else
+		return (*v);
+}
 #elif (defined(__i386__) || defined(__amd64__) || defined(__x86_64__))
 ATOMIC_INLINE uint32_t
 atomic_add_uint32(uint32_t *p, uint32_t x)
@@ -232,6 +301,18 @@ atomic_sub_uint32(uint32_t *p, uint32_t x)
 	    );
 	return (x);
 }
+
+ATOMIC_INLINE uint32_t
+atomic_cas_uint32(uint32_t *v, uint32_t old, uint32_t _new)
+{
+	uint32_t ret;
+	asm volatile (
+	    "lock; cmpxchgl %2,%1"
+	    : "=a" (ret), "+m" (*v) /* Outputs. */
+	    : "r" (_new), "0" (old) /* Inputs. */
+	    : "memory");
+	return (ret);
+}
 #elif (defined(JEMALLOC_ATOMIC9))
 ATOMIC_INLINE uint32_t
 atomic_add_uint32(uint32_t *p, uint32_t x)
@@ -244,6 +325,15 @@ atomic_sub_uint32(uint32_t *p, uint32_t x)
 {
 	return (atomic_fetchadd_32(p, (uint32_t)(-(int32_t)x)) - x);
 }
+
+ATOMIC_INLINE uint32_t
+atomic_cas_uint32(uint32_t *v, uint32_t old, uint32_t _new)
+{
+	if (atomic_cmpset_32(v, old, _new))
+		return (old);
+	else
+		return (*v);
+}
 #elif (defined(JE_FORCE_SYNC_COMPARE_AND_SWAP_4))
 ATOMIC_INLINE uint32_t
 atomic_add_uint32(uint32_t *p, uint32_t x)
@@ -256,6 +346,12 @@ atomic_sub_uint32(uint32_t *p, uint32_t x)
 {
 	return (__sync_sub_and_fetch(p, x));
 }
+
+ATOMIC_INLINE uint32_t
+atomic_cas_uint32(uint32_t *v, uint32_t old, uint32_t _new)
+{
+	return (__sync_val_compare_and_swap(v, old, _new));
+}
 #else
 #  error "Missing implementation for 32-bit atomic operations"
 #endif
@@ -288,6 +384,18 @@ atomic_sub_z(size_t *p, size_t x)
 #endif
 }
 
+ATOMIC_INLINE size_t
+atomic_cas_z(size_t *v, size_t old, size_t _new)
+{
+	assert(sizeof(size_t) == 1 << LG_SIZEOF_PTR);
+
+#if (LG_SIZEOF_PTR == 3)
+	return ((size_t)atomic_cas_uint64((uint64_t *)v, (uint64_t)old, (uint64_t)_new));
+#elif (LG_SIZEOF_PTR == 2)
+	return ((size_t)atomic_cas_uint32((uint32_t *)v, (uint32_t)old, (uint32_t)_new));
+#endif
+}
+
 /******************************************************************************/
 /* unsigned operations. */
 ATOMIC_INLINE unsigned
@@ -316,4 +424,61 @@ atomic_sub_u(unsigned *p, unsigned x)
 #endif
 }
 
+ATOMIC_INLINE unsigned
+atomic_cas_u(unsigned *v, unsigned old, unsigned _new)
+{
+	assert(sizeof(unsigned) == 1 << LG_SIZEOF_INT);
+
+#if (LG_SIZEOF_INT == 3)
+	return ((unsigned)atomic_cas_uint64((uint64_t *)v, (uint64_t)old, (uint64_t)_new));
+#elif (LG_SIZEOF_INT == 2)
+	return ((unsigned)atomic_cas_uint32((uint32_t *)v, (uint32_t)old, (uint32_t)_new));
+#endif
+}
+
+/******************************************************************************/
+/* pointer operations. */
+ATOMIC_INLINE void *
+atomic_cas_ptr(void **v, void *old, void *_new)
+{
+	return ((void *)atomic_cas_z((size_t *)v, (size_t)old, (size_t)_new));
+}
+
+/******************************************************************************/
+/* float operations. */
+ATOMIC_INLINE float
+atomic_add_fl(float *p, const float x)
+{
+	union { float f; uint32_t u; } oldval, newval;
+	uint32_t prevval;
+
+	assert(sizeof(float) == sizeof(uint32_t));
+
+	/* collisions are rare, so this nearly always runs once */
+	do {
+		oldval.f = *p;
+		newval.f = oldval.f + x;
+		prevval = atomic_cas_uint32((uint32_t *)p, oldval.u, newval.u);
+	} while (prevval != oldval.u);
+
+	return (newval.f);
+}
+
+/******************************************************************************/
+/* spin loops. */
+
+/* hint for a loop waiting on an atomic written by another thread, lets the
+ * other hyper-thread of the core run and saves power while spinning */
+ATOMIC_INLINE void
+atomic_spin_pause(void)
+{
+#if defined(_MSC_VER)
+	YieldProcessor();
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	__asm__ __volatile__ ("pause" ::: "memory");
+#elif defined(__GNUC__)
+	__asm__ __volatile__ ("" ::: "memory");
+#endif
+}
+
 #endif /* __ATOMIC_OPS_H__ */
@@ -190,6 +190,13 @@ extern const char *(*MEM_name_ptr)(void *vmemh);
 /* Switch allocator to slower but fully guarded mode. */
 void MEM_use_guarded_allocator(void);
 
+/* Give memory kept around for reuse by the calling thread back to the system,
+ * call when a thread that allocated memory ends. */
+void MEM_thread_exit(void);
+
+/* Give all memory kept around for reuse back to the system, call on exit. */
+void MEM_exit(void);
+
 #ifdef __cplusplus
 /* alloc funcs for C++ only */
 #define MEM_CXX_CLASS_ALLOC_FUNCS(_id)                                        \
@@ -126,3 +126,16 @@ void MEM_use_guarded_allocator(void)
 	MEM_name_ptr = MEM_guarded_name_ptr;
 #endif
 }
+
+/* The lockfree allocator may have cached blocks even after switching to
+ * the guarded allocator, which doesn't keep any. */
+
+void MEM_thread_exit(void)
+{
+	MEM_lockfree_thread_exit();
+}
+
+void MEM_exit(void)
+{
+	MEM_lockfree_exit();
+}
@@ -51,8 +51,7 @@ typedef struct MemHeadAligned {
 	size_t len;
 } MemHeadAligned;
 
-static unsigned int totblock = 0;
-static size_t mem_in_use = 0, mmap_in_use = 0, peak_mem = 0;
+static size_t peak_mem = 0;
 static bool malloc_debug_memset = false;
 
 static void (*error_callback)(const char *) = NULL;
@@ -70,6 +69,65 @@ enum {
 #define MEMHEAD_IS_MMAP(memhead) ((memhead)->len & (size_t) MEMHEAD_MMAP_FLAG)
 #define MEMHEAD_IS_ALIGNED(memhead) ((memhead)->len & (size_t) MEMHEAD_ALIGN_FLAG)
 
+/* Counters and caches of small blocks are kept per thread, so threads allocating
+ * at the same time don't fight over the same cache lines. Threads are assigned
+ * one of MEM_THREAD_SLOTS slots, slots are locked since more threads than slots
+ * may exist, but in practice the lock is only ever taken by one thread.
+ *
+ * Counters of a single slot may wrap around when blocks get freed by another
+ * thread than the one allocating them, only their sum is meaningful.
+ *
+ * Cached blocks are free, so they don't count as memory in use. They are given
+ * back to the system by MEM_thread_exit() when a thread ends, and MEM_exit(). */
+
+#define MEM_THREAD_SLOTS 64
+
+/* blocks up to this size are recycled through per thread caches,
+ * rounded up to a multiple of MEM_CACHE_CLASS_SIZE */
+#define MEM_CACHE_MAX_SIZE 256
+#define MEM_CACHE_CLASS_SIZE 16
+#define MEM_CACHE_CLASSES (MEM_CACHE_MAX_SIZE / MEM_CACHE_CLASS_SIZE + 1)
+/* maximum number of free blocks kept per size class and slot */
+#define MEM_CACHE_MAX_BLOCKS 64
+
+#define MEM_CACHE_CLASS(len) (((len) + (MEM_CACHE_CLASS_SIZE - 1)) / MEM_CACHE_CLASS_SIZE)
+
+/* recompute peak memory each time a thread allocated this much more */
+#define MEM_PEAK_STEP (1024 * 1024)
+
+typedef struct MemThreadSlot {
+	unsigned int lock;
+
+	unsigned int totblock;
+	size_t mem_in_use;
+	size_t mmap_in_use;
+	/* lowest 'mem_in_use' since peak memory was last updated */
+	size_t mem_peak_check;
+
+	/* single linked lists of free blocks, linked through their MemHead */
+	void *cache[MEM_CACHE_CLASSES];
+	unsigned int cache_len[MEM_CACHE_CLASSES];
+	/* size of the cached blocks, not part of 'mem_in_use' */
+	size_t cache_in_use;
+
+	/* avoid false sharing between slots */
+	char _pad[64];
+} MemThreadSlot;
+
+static MemThreadSlot mem_thread_slots[MEM_THREAD_SLOTS];
+static unsigned int mem_thread_slot_next = 0;
+
+#if defined(_MSC_VER)
+#  define MEM_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) && !defined(__APPLE__)
+#  define MEM_THREAD_LOCAL __thread
+#endif
+
+#ifdef MEM_THREAD_LOCAL
+/* slot index + 1, zero when not assigned yet */
+static MEM_THREAD_LOCAL unsigned int mem_thread_slot_id = 0;
+#endif
+
 #ifdef __GNUC__
 __attribute__ ((format(printf, 1, 2)))
 #endif
@@ -102,6 +160,225 @@ static void mem_unlock_thread(void)
 }
 #endif
 
+static void mem_slot_lock(MemThreadSlot *slot)
+{
+	while (atomic_cas_uint32(&slot->lock, 0, 1) != 0) {
+		while (*(volatile unsigned int *)&slot->lock) {
+			atomic_spin_pause();
+		}
+	}
+}
+
+static MemThreadSlot *mem_thread_slot_lock(void)
+{
+	MemThreadSlot *slot;
+
+#ifdef MEM_THREAD_LOCAL
+	if (UNLIKELY(mem_thread_slot_id == 0)) {
+		/* slots are handed out round robin, atomic_add_u returns the value before the
+		 * addition with MSVC and after it elsewhere, both give each thread its own id */
+		const unsigned int id = atomic_add_u(&mem_thread_slot_next, 1);
+		mem_thread_slot_id = (id % MEM_THREAD_SLOTS) + 1;
+	}
+	slot = &mem_thread_slots[mem_thread_slot_id - 1];
+#else
+	/* no thread local storage, stacks of different threads are far apart */
+	{
+		int stack_var;
+		slot = &mem_thread_slots[((uintptr_t)&stack_var >> 20) % MEM_THREAD_SLOTS];
+	}
+#endif
+
+	mem_slot_lock(slot);
+
+	return slot;
+}
+
+static void mem_thread_slot_unlock(MemThreadSlot *slot)
+{
+	atomic_cas_uint32(&slot->lock, 1, 0);
+}
+
+static size_t mem_sum_in_use(void)
+{
+	size_t tot = 0;
+	int i;
+
+	for (i = 0; i < MEM_THREAD_SLOTS; i++) {
+		tot += mem_thread_slots[i].mem_in_use;
+	}
+
+	return tot;
+}
+
+static size_t mem_sum_cache_in_use(void)
+{
+	size_t tot = 0;
+	int i;
+
+	for (i = 0; i < MEM_THREAD_SLOTS; i++) {
+		tot += mem_thread_slots[i].cache_in_use;
+	}
+
+	return tot;
+}
+
+static void mem_update_peak(void)
+{
+	const size_t tot = mem_sum_in_use();
+	size_t peak = peak_mem;
+
+	while (tot > peak) {
+		const size_t peak_prev = atomic_cas_z(&peak_mem, peak, tot);
+		if (peak_prev == peak) {
+			break;
+		}
+		peak = peak_prev;
+	}
+}
+
+/* account for a new block, called with the slot locked */
+static void mem_slot_add_block(MemThreadSlot *slot, size_t len)
+{
+	slot->totblock++;
+	slot->mem_in_use += len;
+
+	/* summing all slots is too slow to do on every allocation */
+	if ((ptrdiff_t)(slot->mem_in_use - slot->mem_peak_check) > MEM_PEAK_STEP) {
+		slot->mem_peak_check = slot->mem_in_use;
+		mem_update_peak();
+	}
+}
+
+/* account for a freed block, called with the slot locked */
+static void mem_slot_remove_block(MemThreadSlot *slot, size_t len)
+{
+	slot->totblock--;
+	slot->mem_in_use -= len;
+
+	if ((ptrdiff_t)(slot->mem_in_use - slot->mem_peak_check) < 0) {
+		slot->mem_peak_check = slot->mem_in_use;
+	}
+}
+
+/* Allocate a block with room for 'len' bytes. Small blocks are taken from the
+ * thread cache and are always allocated with the full size of their class,
+ * so they can be reused for any length in that class. */
+static MemHead *mem_block_alloc(size_t len, const bool use_calloc)
+{
+	MemThreadSlot *slot;
+	MemHead *memh;
+	size_t alloc_len = len;
+
+	if (len <= MEM_CACHE_MAX_SIZE) {
+		const size_t cache_class = MEM_CACHE_CLASS(len);
+
+		slot = mem_thread_slot_lock();
+		memh = slot->cache[cache_class];
+		if (memh) {
+			slot->cache[cache_class] = *(void **)memh;
+			slot->cache_len[cache_class]--;
+			slot->cache_in_use -= cache_class * MEM_CACHE_CLASS_SIZE;
+			mem_slot_add_block(slot, len);
+		}
+		mem_thread_slot_unlock(slot);
+
+		if (memh) {
+			if (use_calloc) {
+				memset(memh + 1, 0, len);
+			}
+			return memh;
+		}
+
+		alloc_len = cache_class * MEM_CACHE_CLASS_SIZE;
+	}
+
+	if (use_calloc) {
+		memh = (MemHead *)calloc(1, alloc_len + sizeof(MemHead));
+	}
+	else {
+		memh = (MemHead *)malloc(alloc_len + sizeof(MemHead));
+	}
+
+	if (LIKELY(memh)) {
+		slot = mem_thread_slot_lock();
+		mem_slot_add_block(slot, len);
+		mem_thread_slot_unlock(slot);
+	}
+
+	return memh;
+}
+
+/* Free a block allocated by #mem_block_alloc, small blocks go to the thread cache
+ * unless it is full for their class. */
+static void mem_block_free(MemHead *memh, size_t len)
+{
+	MemThreadSlot *slot = mem_thread_slot_lock();
+
+	mem_slot_remove_block(slot, len);
+
+	if (len <= MEM_CACHE_MAX_SIZE) {
+		const size_t cache_class = MEM_CACHE_CLASS(len);
+		if (slot->cache_len[cache_class] < MEM_CACHE_MAX_BLOCKS) {
+			*(void **)memh = slot->cache[cache_class];
+			slot->cache[cache_class] = memh;
+			slot->cache_len[cache_class]++;
+			slot->cache_in_use += cache_class * MEM_CACHE_CLASS_SIZE;
+			memh = NULL;
+		}
+	}
+
+	mem_thread_slot_unlock(slot);
+
+	if (memh) {
+		free(memh);
+	}
+}
+
+/* Give the cached blocks of a locked slot back to the system. The lists are
+ * taken from the slot first, so the lock isn't held while freeing. */
+static void mem_slot_cache_flush(MemThreadSlot *slot)
+{
+	void *cache[MEM_CACHE_CLASSES];
+	int i;
+
+	memcpy(cache, slot->cache, sizeof(cache));
+	memset(slot->cache, 0, sizeof(slot->cache));
+	memset(slot->cache_len, 0, sizeof(slot->cache_len));
+	slot->cache_in_use = 0;
+	mem_thread_slot_unlock(slot);
+
+	for (i = 0; i < MEM_CACHE_CLASSES; i++) {
+		void *memh = cache[i];
+		while (memh) {
+			void *next = *(void **)memh;
+			free(memh);
+			memh = next;
+		}
+	}
+}
+
+/* account for blocks not allocated through #mem_block_alloc */
+static void mem_count_alloc(size_t len, const bool is_mmap)
+{
+	MemThreadSlot *slot = mem_thread_slot_lock();
+	mem_slot_add_block(slot, len);
+	if (is_mmap) {
+		slot->mmap_in_use += len;
+	}
+	mem_thread_slot_unlock(slot);
+}
+
+static void mem_count_free(size_t len, const bool is_mmap)
+{
+	MemThreadSlot *slot = mem_thread_slot_lock();
+	mem_slot_remove_block(slot, len);
+	if (is_mmap) {
+		slot->mmap_in_use -= len;
+	}
+	mem_thread_slot_unlock(slot);
+}
+
 size_t MEM_lockfree_allocN_len(const void *vmemh)
 {
 	if (vmemh) {
@@ -117,11 +394,8 @@ void MEM_lockfree_freeN(void *vmemh)
 	MemHead *memh = MEMHEAD_FROM_PTR(vmemh);
 	size_t len = MEM_lockfree_allocN_len(vmemh);
 
-	atomic_sub_u(&totblock, 1);
-	atomic_sub_z(&mem_in_use, len);
-
 	if (MEMHEAD_IS_MMAP(memh)) {
-		atomic_sub_z(&mmap_in_use, len);
+		mem_count_free(len, true);
 #if defined(WIN32)
 		/* our windows mmap implementation is not thread safe */
 		mem_lock_thread();
@@ -138,10 +412,11 @@ void MEM_lockfree_freeN(void *vmemh)
 		}
 		if (UNLIKELY(MEMHEAD_IS_ALIGNED(memh))) {
 			MemHeadAligned *memh_aligned = MEMHEAD_ALIGNED_FROM_PTR(vmemh);
+			mem_count_free(len, false);
 			aligned_free(MEMHEAD_REAL_PTR(memh_aligned));
 		}
 		else {
-			free(memh);
+			mem_block_free(memh, len);
 		}
 	}
 }
@@ -258,20 +533,14 @@ void *MEM_lockfree_callocN(size_t len, const char *str)
 
 	len = SIZET_ALIGN_4(len);
 
-	memh = (MemHead *)calloc(1, len + sizeof(MemHead));
+	memh = mem_block_alloc(len, true);
 
 	if (LIKELY(memh)) {
 		memh->len = len;
-		atomic_add_u(&totblock, 1);
-		atomic_add_z(&mem_in_use, len);
-
-		/* TODO(sergey): Not strictly speaking thread-safe. */
-		peak_mem = mem_in_use > peak_mem ? mem_in_use : peak_mem;
-
 		return PTR_FROM_MEMHEAD(memh);
 	}
 	print_error("Calloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
-	            SIZET_ARG(len), str, (unsigned int) mem_in_use);
+	            SIZET_ARG(len), str, (unsigned int) mem_sum_in_use());
 	return NULL;
 }
 
@@ -281,7 +550,7 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
 
 	len = SIZET_ALIGN_4(len);
 
-	memh = (MemHead *)malloc(len + sizeof(MemHead));
+	memh = mem_block_alloc(len, false);
 
 	if (LIKELY(memh)) {
 		if (UNLIKELY(malloc_debug_memset && len)) {
@@ -289,16 +558,10 @@ void *MEM_lockfree_mallocN(size_t len, const char *str)
 		}
 
 		memh->len = len;
-		atomic_add_u(&totblock, 1);
-		atomic_add_z(&mem_in_use, len);
-
-		/* TODO(sergey): Not strictly speaking thread-safe. */
-		peak_mem = mem_in_use > peak_mem ? mem_in_use : peak_mem;
-
 		return PTR_FROM_MEMHEAD(memh);
 	}
 	print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
-	            SIZET_ARG(len), str, (unsigned int) mem_in_use);
+	            SIZET_ARG(len), str, (unsigned int) mem_sum_in_use());
 	return NULL;
 }
 
@@ -340,16 +603,12 @@ void *MEM_lockfree_mallocN_aligned(size_t len, size_t alignment, const char *str
 
 		memh->len = len | (size_t) MEMHEAD_ALIGN_FLAG;
 		memh->alignment = (short) alignment;
-		atomic_add_u(&totblock, 1);
-		atomic_add_z(&mem_in_use, len);
-
-		/* TODO(sergey): Not strictly speaking thread-safe. */
-		peak_mem = mem_in_use > peak_mem ? mem_in_use : peak_mem;
+		mem_count_alloc(len, false);
 
 		return PTR_FROM_MEMHEAD(memh);
 	}
 	print_error("Malloc returns null: len=" SIZET_FORMAT " in %s, total %u\n",
-	            SIZET_ARG(len), str, (unsigned int) mem_in_use);
+	            SIZET_ARG(len), str, (unsigned int) mem_sum_in_use());
 	return NULL;
 }
 
@@ -377,19 +636,13 @@ void *MEM_lockfree_mapallocN(size_t len, const char *str)
 
 	if (memh != (MemHead *)-1) {
 		memh->len = len | (size_t) MEMHEAD_MMAP_FLAG;
-		atomic_add_u(&totblock, 1);
-		atomic_add_z(&mem_in_use, len);
-		atomic_add_z(&mmap_in_use, len);
-
-		/* TODO(sergey): Not strictly speaking thread-safe. */
-		peak_mem = mem_in_use > peak_mem ? mem_in_use : peak_mem;
-		peak_mem = mmap_in_use > peak_mem ? mmap_in_use : peak_mem;
+		mem_count_alloc(len, true);
 
 		return PTR_FROM_MEMHEAD(memh);
 	}
 	print_error("Mapalloc returns null, fallback to regular malloc: "
 	            "len=" SIZET_FORMAT " in %s, total %u\n",
-	            SIZET_ARG(len), str, (unsigned int) mmap_in_use);
+	            SIZET_ARG(len), str, (unsigned int) MEM_lockfree_get_mapped_memory_in_use());
 	return MEM_lockfree_callocN(len, str);
 }
 
@@ -410,9 +663,11 @@ void MEM_lockfree_callbackmemlist(void (*func)(void *))
 void MEM_lockfree_printmemlist_stats(void)
 {
 	printf("\ntotal memory len: %.3f MB\n",
-	       (double)mem_in_use / (double)(1024 * 1024));
+	       (double)mem_sum_in_use() / (double)(1024 * 1024));
 	printf("peak memory len: %.3f MB\n",
-	       (double)peak_mem / (double)(1024 * 1024));
+	       (double)MEM_lockfree_get_peak_memory() / (double)(1024 * 1024));
+	printf("cached memory len: %.3f MB\n",
+	       (double)mem_sum_cache_in_use() / (double)(1024 * 1024));
 	printf("\nFor more detailed per-block statistics run Blender with memory debugging command line argument.\n");
 
 #ifdef HAVE_MALLOC_STATS
@@ -442,22 +697,37 @@ void MEM_lockfree_set_memory_debug(void)
 	malloc_debug_memset = true;
 }
 
+/* Counters are combined when read, while other threads allocate the result is approximate. */
+
 uintptr_t MEM_lockfree_get_memory_in_use(void)
 {
-	return mem_in_use;
+	return mem_sum_in_use();
 }
 
 uintptr_t MEM_lockfree_get_mapped_memory_in_use(void)
 {
-	return mmap_in_use;
+	size_t tot = 0;
+	int i;
+
+	for (i = 0; i < MEM_THREAD_SLOTS; i++) {
+		tot += mem_thread_slots[i].mmap_in_use;
+	}
+
+	return tot;
 }
 
 unsigned int MEM_lockfree_get_memory_blocks_in_use(void)
 {
-	return totblock;
+	unsigned int tot = 0;
+	int i;
+
+	for (i = 0; i < MEM_THREAD_SLOTS; i++) {
+		tot += mem_thread_slots[i].totblock;
+	}
+
+	return tot;
 }
 
-/* dummy */
 void MEM_lockfree_reset_peak_memory(void)
 {
 	peak_mem = 0;
@@ -465,9 +735,26 @@ void MEM_lockfree_reset_peak_memory(void)
 
 uintptr_t MEM_lockfree_get_peak_memory(void)
 {
+	/* peak is only updated in steps of MEM_PEAK_STEP per thread */
+	mem_update_peak();
 	return peak_mem;
 }
 
+void MEM_lockfree_thread_exit(void)
+{
+	mem_slot_cache_flush(mem_thread_slot_lock());
+}
+
+void MEM_lockfree_exit(void)
+{
+	int i;
+
+	for (i = 0; i < MEM_THREAD_SLOTS; i++) {
+		mem_slot_lock(&mem_thread_slots[i]);
+		mem_slot_cache_flush(&mem_thread_slots[i]);
+	}
+}
+
 #ifndef NDEBUG
 const char *MEM_lockfree_name_ptr(void *vmemh)
 {
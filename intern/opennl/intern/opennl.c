@@ -1133,21 +1133,35 @@ static NLboolean __nlFactorize_SUPERLU(__NLContext *context, NLint *permutation)
 	return (info == 0);
 }
 
+/* below this many variables solving the right hand sides in parallel isn't worth it */
+#define __NL_PARALLEL_SOLVE_MIN 10000
+
 static NLboolean __nlInvert_SUPERLU(__NLContext *context) {
 
 	/* OpenNL Context */
 	NLfloat* b = (context->least_squares)? context->Mtb: context->b;
 	NLfloat* x = context->x;
-	NLuint n = context->n, j;
+	NLuint n = context->n;
+	NLint j, nb_rhs = (NLint)context->nb_rhs;
+
+	/* only ever set to true, so any thread finding an error can write it */
+	NLboolean failed = NL_FALSE;
+
+	/* The right hand sides only share the factorization, which is read only here, so
+	 * they are solved independently. sgstrs writes its statistics, so every right hand
+	 * side gets its own. */
+#pragma omp parallel for if (nb_rhs > 1 && n > __NL_PARALLEL_SOLVE_MIN)
+	for(j=0; j<nb_rhs; j++) {
+		/* SuperLU variables */
+		SuperMatrix B;
+		SuperLUStat_t stat;
+		NLint info = 0;
 
-	/* SuperLU variables */
-	SuperMatrix B;
-	NLint info = 0;
+		StatInit(&stat);
 
-	for(j=0; j<context->nb_rhs; j++, b+=n, x+=n) {
 		/* Create superlu array for B */
 		sCreate_Dense_Matrix(
-			&B, n, 1, b, n, 
+			&B, n, 1, b + n*j, n, 
 			SLU_DN, /* Fortran-type column-wise storage */
 			SLU_S,  /* floats						  */
 			SLU_GE  /* general						  */
@@ -1156,15 +1170,18 @@ static NLboolean __nlInvert_SUPERLU(__NLContext *context) {
 		/* Forward/Back substitution to compute x */
 		sgstrs(TRANS, &(context->slu.L), &(context->slu.U),
 			context->slu.perm_c, context->slu.perm_r, &B,
-			&(context->slu.stat), &info);
+			&stat, &info);
 
 		if(info == 0)
-			memcpy(x, ((DNformat*)B.Store)->nzval, sizeof(*x)*n);
+			memcpy(x + n*j, ((DNformat*)B.Store)->nzval, sizeof(*x)*n);
+		else
+			failed = NL_TRUE;
 
 		Destroy_SuperMatrix_Store(&B);
+		StatFree(&stat);
 	}
 
-	return (info == 0);
+	return !failed;
 }
 
 static void __nlFree_SUPERLU(__NLContext *context) {
@@ -698,6 +698,9 @@ float (*editbmesh_get_vertex_cos(struct BMEditMesh *em, int *r_numVerts))[3];
 bool editbmesh_modifier_is_enabled(struct Scene *scene, struct ModifierData *md, DerivedMesh *dm);
 void makeDerivedMesh(struct Scene *scene, struct Object *ob, struct BMEditMesh *em, 
                      CustomDataMask dataMask, int build_shapekey_layers);
+/* free the modifier results kept between evaluations of the object */
+void mesh_modifier_cache_free(struct Object *ob);
+void mesh_modifier_cache_limit_set(const size_t limit);
 
 /** returns an array of deform matrices for crazyspace correction, and the
  * number of modifiers left */
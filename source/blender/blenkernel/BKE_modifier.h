@@ -313,6 +313,12 @@ void BKE_modifier_init(void);
 
 ModifierTypeInfo *modifierType_getInfo(ModifierType type);
 
+typedef struct ModifierSettingsRange {
+	unsigned short offset, size;
+} ModifierSettingsRange;
+
+int modifier_settingsRanges(const struct ModifierData *md, const ModifierSettingsRange **r_ranges);
+
 /* Modifier utility calls, do call through type pointer and return
  * default values if pointer is optional.
  */
@@ -395,8 +401,20 @@ struct ModifierData  *modifiers_getVirtualModifierList(struct Object *ob, struct
 /* ensure modifier correctness when changing ob->data */
 void test_object_modifiers(struct Object *ob);
 
+/* Mesh Deform influences of a cage vertex with a smaller weight are ignored */
+#define MESHDEFORM_MIN_INFLUENCE 0.00001f
+
+/* influence of a cage vertex found while binding, in a list per vertex */
+typedef struct MDefBindInfluence {
+	struct MDefBindInfluence *next;
+	float weight;
+	int vertex;
+} MDefBindInfluence;
+
 /* here for do_versions */
 void modifier_mdef_compact_influences(struct ModifierData *md);
+/* result of binding */
+void modifier_mdef_compact_bind_influences(struct ModifierData *md, struct MDefBindInfluence **bindinfs, int totvert);
 
 void        modifier_path_init(char *path, int path_maxlen, const char *name);
 const char *modifier_path_relbase(struct Object *ob);
@@ -134,6 +134,9 @@ struct OceanTex *BKE_copy_oceantex(struct OceanTex *ot);
 bool    BKE_texture_dependsOnTime(const struct Tex *texture);
 
 void BKE_texture_get_value(struct Scene *scene, struct Tex *texture, float *tex_co, struct TexResult *texres, bool use_color_management);
+void BKE_texture_get_values(
+        struct Scene *scene, struct Tex *texture, float (*tex_co)[3], struct TexResult *r_texres, const int num,
+        bool use_color_management);
 
 #ifdef __cplusplus
 }
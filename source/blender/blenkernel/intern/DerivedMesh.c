@@ -35,6 +35,8 @@
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "DNA_cloth_types.h"
 #include "DNA_key_types.h"
 #include "DNA_material_types.h"
@@ -1461,6 +1463,359 @@ static void dm_ensure_display_normals(DerivedMesh *dm)
 		CDDM_calc_normals_mapping_ex(dm, (dm->dirty & DM_DIRTY_NORMALS) ? false : true);
 	}
 }
+/* -------------------------------------------------------------------- */
+/* Modifier stack result cache
+ *
+ * The outputs of constructive modifiers are kept between evaluations of the object,
+ * keyed on a hash of the modifier settings chained with the key of its input, so the
+ * stack can restart after the last modifier whose input didn't change (an animated
+ * displace after a subsurf doesn't redo the subdivision).
+ *
+ * Only modifiers whose result depends on nothing but their own settings, the layers
+ * the stack asks them to keep and the mesh are cached, anything referencing other ID's,
+ * depending on time or simulating is not. An output is only copied once the same key
+ * was seen on two evaluations in a row, so a stack with animated input doesn't pay for
+ * copies that are never used, and the copies of all objects together stay below
+ * a memory limit (see #mesh_modifier_cache_limit_set). */
+
+typedef struct ModifierStackCacheEntry {
+	uint64_t key;
+	DerivedMesh *dm;
+	size_t size;
+	bool is_cddm;  /* type of the original result, the copy is always a CDDM */
+} ModifierStackCacheEntry;
+
+typedef struct ModifierStackCache {
+	ModifierStackCacheEntry *entries;
+	int totentry;
+} ModifierStackCache;
+
+#define MOD_CACHE_HASH_INIT 0xcbf29ce484222325ULL
+#define MOD_CACHE_HASH_PRIME 0x100000001b3ULL
+
+/* memory used by the cached results of all objects, and its limit */
+static size_t modifier_cache_mem_in_use = 0;
+static size_t modifier_cache_mem_limit = (size_t)256 << 20;
+
+/* FNV-1a taking 8 bytes per step, folding the high bits back so they reach the low ones */
+static uint64_t modifier_cache_hash(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t), p += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, p, sizeof(word));
+		hash = (hash ^ word) * MOD_CACHE_HASH_PRIME;
+		hash ^= hash >> 32;
+	}
+	for (; len; len--, p++) {
+		hash = (hash ^ *p) * MOD_CACHE_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+static uint64_t modifier_cache_hash_customdata(uint64_t hash, const CustomData *data, const int totelem)
+{
+	int i, j;
+
+	hash = modifier_cache_hash(hash, &totelem, sizeof(totelem));
+
+	for (i = 0; i < data->totlayer; i++) {
+		const CustomDataLayer *layer = &data->layers[i];
+
+		hash = modifier_cache_hash(hash, &layer->type, sizeof(layer->type));
+		hash = modifier_cache_hash(hash, &layer->flag, sizeof(layer->flag));
+		hash = modifier_cache_hash(hash, &layer->active, sizeof(layer->active));
+		hash = modifier_cache_hash(hash, &layer->active_rnd, sizeof(layer->active_rnd));
+		hash = modifier_cache_hash(hash, layer->name, strlen(layer->name));
+
+		if (layer->data) {
+			hash = modifier_cache_hash(hash, layer->data, (size_t)CustomData_sizeof(layer->type) * (size_t)totelem);
+
+			/* the weights are stored outside of the layer */
+			if (layer->type == CD_MDEFORMVERT) {
+				const MDeformVert *dvert = layer->data;
+
+				for (j = 0; j < totelem; j++) {
+					if (dvert[j].dw) {
+						hash = modifier_cache_hash(hash, dvert[j].dw, sizeof(*dvert[j].dw) * (size_t)dvert[j].totweight);
+					}
+				}
+			}
+		}
+	}
+
+	return hash;
+}
+
+/* key of the input of the first modifier after the leading deform modifiers */
+static uint64_t modifier_cache_input_key(Scene *scene, Object *ob, Mesh *me,
+                                         float (*deformedVerts)[3], const int numVerts)
+{
+	uint64_t hash = MOD_CACHE_HASH_INIT;
+	const int simplify = (scene->r.mode & R_SIMPLIFY) ? scene->r.simplify_subsurf : -1;
+	bDeformGroup *dg;
+
+	hash = modifier_cache_hash_customdata(hash, &me->vdata, me->totvert);
+	hash = modifier_cache_hash_customdata(hash, &me->edata, me->totedge);
+	hash = modifier_cache_hash_customdata(hash, &me->fdata, me->totface);
+	hash = modifier_cache_hash_customdata(hash, &me->pdata, me->totpoly);
+	hash = modifier_cache_hash_customdata(hash, &me->ldata, me->totloop);
+
+	if (deformedVerts) {
+		hash = modifier_cache_hash(hash, deformedVerts, sizeof(*deformedVerts) * (size_t)numVerts);
+	}
+
+	/* modifiers look up vertex groups by name and material slots by index */
+	for (dg = ob->defbase.first; dg; dg = dg->next) {
+		hash = modifier_cache_hash(hash, dg->name, strlen(dg->name));
+	}
+	hash = modifier_cache_hash(hash, &ob->totcol, sizeof(ob->totcol));
+
+	/* subsurf levels are limited by the scene simplify settings */
+	hash = modifier_cache_hash(hash, &simplify, sizeof(simplify));
+
+	return hash;
+}
+
+/* \a mask is the data the modifier gets and \a nextmask the data the following ones need */
+static uint64_t modifier_cache_modifier_key(uint64_t hash, ModifierData *md,
+                                            const CustomDataMask mask, const CustomDataMask nextmask)
+{
+	const ModifierSettingsRange *ranges;
+	const int totrange = modifier_settingsRanges(md, &ranges);
+	int i;
+
+	hash = modifier_cache_hash(hash, &md->type, sizeof(md->type));
+	hash = modifier_cache_hash(hash, &md->mode, sizeof(md->mode));
+	hash = modifier_cache_hash(hash, &mask, sizeof(mask));
+	hash = modifier_cache_hash(hash, &nextmask, sizeof(nextmask));
+
+	for (i = 0; i < totrange; i++) {
+		hash = modifier_cache_hash(hash, (const char *)md + ranges[i].offset, ranges[i].size);
+	}
+
+	return hash;
+}
+
+static void modifier_cache_id_walk(void *userData, Object *UNUSED(ob), ID **idpoin)
+{
+	if (*idpoin) {
+		*((bool *)userData) = true;
+	}
+}
+
+static void modifier_cache_object_walk(void *userData, Object *UNUSED(ob), Object **obpoin)
+{
+	if (*obpoin) {
+		*((bool *)userData) = true;
+	}
+}
+
+static bool modifier_cache_is_supported(Object *ob, ModifierData *md)
+{
+	ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+	const ModifierSettingsRange *ranges;
+	bool has_links = false;
+
+	if (mti->flags & (eModifierTypeFlag_RequiresOriginalData | eModifierTypeFlag_UsesPointCache))
+		return false;
+	if (mti->dependsOnTime && mti->dependsOnTime(md))
+		return false;
+	if (modifier_settingsRanges(md, &ranges) == -1)
+		return false;
+
+	/* results depend on data outside of the settings and the mesh */
+	if (ELEM(md->type, eModifierType_ShapeKey, eModifierType_Multires, eModifierType_ParticleSystem,
+	         eModifierType_Explode, eModifierType_Collision, eModifierType_Surface, eModifierType_Fluidsim,
+	         eModifierType_Smoke, eModifierType_DynamicPaint, eModifierType_MeshCache, eModifierType_Ocean,
+	         eModifierType_Warp, eModifierType_WeightVGEdit, eModifierType_LaplacianDeform,
+	         eModifierType_Hook, eModifierType_MeshDeform))
+	{
+		return false;
+	}
+
+	if (mti->foreachIDLink)
+		mti->foreachIDLink(md, ob, modifier_cache_id_walk, &has_links);
+	else if (mti->foreachObjectLink)
+		mti->foreachObjectLink(md, ob, modifier_cache_object_walk, &has_links);
+
+	return !has_links;
+}
+
+static size_t modifier_cache_customdata_size(const CustomData *data, const int totelem)
+{
+	size_t size = 0;
+	int i;
+
+	for (i = 0; i < data->totlayer; i++) {
+		if (data->layers[i].data) {
+			size += (size_t)CustomData_sizeof(data->layers[i].type) * (size_t)totelem;
+		}
+	}
+
+	return size;
+}
+
+static size_t modifier_cache_dm_size(DerivedMesh *dm)
+{
+	return (modifier_cache_customdata_size(&dm->vertData, dm->numVertData) +
+	        modifier_cache_customdata_size(&dm->edgeData, dm->numEdgeData) +
+	        modifier_cache_customdata_size(&dm->faceData, dm->numTessFaceData) +
+	        modifier_cache_customdata_size(&dm->loopData, dm->numLoopData) +
+	        modifier_cache_customdata_size(&dm->polyData, dm->numPolyData));
+}
+
+static void modifier_cache_entry_clear(ModifierStackCacheEntry *entry)
+{
+	if (entry->dm) {
+		entry->dm->needsFree = 1;
+		entry->dm->release(entry->dm);
+		entry->dm = NULL;
+
+		atomic_sub_z(&modifier_cache_mem_in_use, entry->size);
+		entry->size = 0;
+	}
+}
+
+static void modifier_cache_resize(Object *ob, const int totentry)
+{
+	ModifierStackCache *cache = ob->modifier_cache;
+	int i;
+
+	if (cache == NULL) {
+		cache = ob->modifier_cache = MEM_callocN(sizeof(*cache), "ModifierStackCache");
+	}
+
+	for (i = totentry; i < cache->totentry; i++) {
+		modifier_cache_entry_clear(&cache->entries[i]);
+	}
+
+	if (totentry == 0) {
+		MEM_SAFE_FREE(cache->entries);
+	}
+	else if (totentry != cache->totentry) {
+		cache->entries = MEM_recallocN(cache->entries, sizeof(*cache->entries) * (size_t)totentry);
+	}
+	cache->totentry = totentry;
+}
+
+/* called with the output of a cached modifier */
+static void modifier_cache_update(ModifierStackCacheEntry *entry, const uint64_t key, DerivedMesh *dm,
+                                  const bool do_store)
+{
+	if (entry->key != key) {
+		modifier_cache_entry_clear(entry);
+		entry->key = key;
+	}
+	else if (do_store && entry->dm == NULL) {
+		const size_t size = modifier_cache_dm_size(dm);
+
+		/* other threads may add results meanwhile, the limit is only approximate */
+		if (modifier_cache_mem_in_use + size <= modifier_cache_mem_limit) {
+			entry->dm = CDDM_copy(dm);
+			entry->size = size;
+			entry->is_cddm = (dm->type == DM_TYPE_CDDM);
+			atomic_add_z(&modifier_cache_mem_in_use, size);
+		}
+	}
+}
+
+/**
+ * Compute the keys of the cached modifiers in the stack starting at \a md, relative to the
+ * key of their input. Modifiers after the first one that can't be cached get no key.
+ *
+ * \param curr: The data masks of the modifiers, matching \a md.
+ * \return the number of keys.
+ */
+static int modifier_cache_keys(Scene *scene, Object *ob, ModifierData *md, CDMaskLink *curr,
+                               const CustomDataMask dataMask, const CustomDataMask append_mask,
+                               const int required_mode, const int needMapping,
+                               ModifierData **r_mds, uint64_t *r_keys)
+{
+	ModifierData *lastmd = NULL;
+	uint64_t key = MOD_CACHE_HASH_INIT;
+	bool is_cacheable = true;
+	int totkey = 0;
+
+	for (; md; md = md->next, curr = curr->next) {
+		ModifierTypeInfo *mti = modifierType_getInfo(md->type);
+
+		/* same as the checks skipping modifiers in mesh_calc_modifiers */
+		md->scene = scene;
+		if (!modifier_isEnabled(scene, md, required_mode)) continue;
+		if (needMapping && !modifier_supportsMapping(md)) continue;
+
+		lastmd = md;
+
+		if (is_cacheable && !modifier_cache_is_supported(ob, md))
+			is_cacheable = false;
+
+		if (is_cacheable) {
+			const CustomDataMask mask = curr->mask | append_mask | (needMapping ? CD_MASK_ORIGINDEX : 0);
+			const CustomDataMask nextmask = curr->next ? curr->next->mask : dataMask;
+
+			key = modifier_cache_modifier_key(key, md, mask, nextmask);
+
+			if (mti->type != eModifierTypeType_OnlyDeform) {
+				r_mds[totkey] = md;
+				r_keys[totkey] = key;
+				totkey++;
+			}
+		}
+	}
+
+	/* the final result is kept by the object already */
+	if (totkey && r_mds[totkey - 1] == lastmd)
+		totkey--;
+
+	return totkey;
+}
+
+/**
+ * Chain the keys from #modifier_cache_keys to the key of the input \a input_key.
+ *
+ * \return the last key with a stored result or -1.
+ */
+static int modifier_cache_begin(Object *ob, const uint64_t input_key, uint64_t *keys, const int totkey)
+{
+	ModifierStackCache *cache;
+	int i, resume = -1;
+
+	modifier_cache_resize(ob, totkey);
+	cache = ob->modifier_cache;
+
+	for (i = 0; i < totkey; i++) {
+		keys[i] = modifier_cache_hash(input_key, &keys[i], sizeof(keys[i]));
+
+		if (cache->entries[i].dm && cache->entries[i].key == keys[i])
+			resume = i;
+	}
+
+	return resume;
+}
+
+void mesh_modifier_cache_free(Object *ob)
+{
+	ModifierStackCache *cache = ob->modifier_cache;
+
+	if (cache) {
+		modifier_cache_resize(ob, 0);
+		MEM_freeN(cache);
+		ob->modifier_cache = NULL;
+	}
+}
+
+/**
+ * Limit the memory used by the cached modifier results of all objects together,
+ * zero disables the cache. Results cached already are kept.
+ */
+void mesh_modifier_cache_limit_set(const size_t limit)
+{
+	modifier_cache_mem_limit = limit;
+}
+
 /* new value for useDeform -1  (hack for the gameengine):
  * - apply only the modifier stack of the object, skipping the virtual modifiers,
  * - don't apply the key
@@ -1482,6 +1837,9 @@ static void mesh_calc_modifiers(Scene *scene, Object *ob, float (*inputVertexCos
 	int numVerts = me->totvert;
 	int required_mode;
 	bool isPrevDeform = false;
+	ModifierData **cache_mds = NULL;
+	uint64_t *cache_keys = NULL;
+	int cache_totkey = 0, cache_index = 0;
 	const bool skipVirtualArmature = (useDeform < 0);
 	MultiresModifierData *mmd = get_multires_modifier(scene, ob, 0);
 	const bool has_multires = (mmd && mmd->sculptlvl != 0);
@@ -1609,6 +1967,70 @@ static void mesh_calc_modifiers(Scene *scene, Object *ob, float (*inputVertexCos
 	orcodm = NULL;
 	clothorcodm = NULL;
 
+	/* Restart after the last modifier with a cached result. The orco meshes built in
+	 * parallel, sculpting and weight previews aren't cached, neither are the special
+	 * evaluations (render, index, game engine, input coordinates). */
+	if (useCache) {
+		bool use_modifier_cache = ((useDeform > 0) && !useRenderParams && (index < 0) &&
+		                           !inputVertexCos && !build_shapekey_layers &&
+		                           !sculpt_mode && !do_init_wmcol && (modifier_cache_mem_limit != 0));
+
+		if (use_modifier_cache) {
+			CustomDataMask orco_mask = dataMask;
+			CDMaskLink *link;
+
+			for (link = curr; link; link = link->next)
+				orco_mask |= link->mask;
+			use_modifier_cache = (orco_mask & (CD_MASK_ORCO | CD_MASK_CLOTH_ORCO)) == 0;
+		}
+
+		if (use_modifier_cache && md) {
+			ModifierData *md_iter;
+			int totmodifier = 0;
+
+			for (md_iter = md; md_iter; md_iter = md_iter->next)
+				totmodifier++;
+
+			cache_mds = MEM_mallocN(sizeof(*cache_mds) * (size_t)totmodifier, __func__);
+			cache_keys = MEM_mallocN(sizeof(*cache_keys) * (size_t)totmodifier, __func__);
+			cache_totkey = modifier_cache_keys(scene, ob, md, curr, dataMask, append_mask,
+			                                   required_mode, needMapping, cache_mds, cache_keys);
+			use_modifier_cache = (cache_totkey != 0);
+		}
+
+		/* only hash the mesh when there is something to cache */
+		if (use_modifier_cache && md) {
+			const int resume = modifier_cache_begin(
+			        ob, modifier_cache_input_key(scene, ob, me, deformedVerts, numVerts),
+			        cache_keys, cache_totkey);
+
+			if (resume != -1) {
+				for (; md != cache_mds[resume]; md = md->next, curr = curr->next) {
+					/* pass */
+				}
+				md = md->next;
+				curr = curr->next;
+
+				dm = CDDM_copy(ob->modifier_cache->entries[resume].dm);
+				cache_index = resume + 1;
+
+				/* deform modifiers recalculate the normals of other types (see get_cddm),
+				 * which the copy has to match */
+				if (!ob->modifier_cache->entries[resume].is_cddm)
+					dm->dirty |= DM_DIRTY_NORMALS;
+
+				if (deformedVerts) {
+					if (deformedVerts != inputVertexCos)
+						MEM_freeN(deformedVerts);
+					deformedVerts = NULL;
+				}
+			}
+		}
+		else {
+			mesh_modifier_cache_free(ob);
+		}
+	}
+
 	for (; md; md = md->next, curr = curr->next) {
 		ModifierTypeInfo *mti = modifierType_getInfo(md->type);
 
@@ -1838,6 +2260,12 @@ static void mesh_calc_modifiers(Scene *scene, Object *ob, float (*inputVertexCos
 				DM_update_weight_mcol(ob, dm, draw_flag, NULL, 0, NULL);
 				append_mask |= CD_MASK_PREVIEW_MLOOPCOL;
 			}
+
+			if ((cache_index < cache_totkey) && (md == cache_mds[cache_index])) {
+				modifier_cache_update(&ob->modifier_cache->entries[cache_index], cache_keys[cache_index],
+				                      dm, deformedVerts == NULL);
+				cache_index++;
+			}
 		}
 
 		isPrevDeform = (mti->type == eModifierTypeType_OnlyDeform);
@@ -1948,6 +2376,11 @@ static void mesh_calc_modifiers(Scene *scene, Object *ob, float (*inputVertexCos
 	if (deformedVerts && deformedVerts != inputVertexCos)
 		MEM_freeN(deformedVerts);
 
+	if (cache_mds) {
+		MEM_freeN(cache_mds);
+		MEM_freeN(cache_keys);
+	}
+
 	BLI_linklist_free((LinkNode *)datamasks, NULL);
 }
 
@@ -39,6 +39,7 @@
 
 #include "BLI_math.h"
 #include "BLI_blenlib.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "DNA_anim_types.h"
@@ -71,6 +72,13 @@
 #include "BIK_api.h"
 #include "BKE_sketch.h"
 
+#ifdef __SSE__
+#  include <xmmintrin.h>
+#endif
+
+/* deform vertices in parallel above this number */
+#define ARMATURE_DEFORM_THREAD_MIN 1000
+
 /* **************** Generic Functions, data level *************** */
 
 bArmature *BKE_armature_add(Main *bmain, const char *name)
@@ -629,7 +637,7 @@ static void pchan_b_bone_defmats(bPoseChannel *pchan, bPoseChanDeform *pdef_info
 	}
 }
 
-static void b_bone_deform(bPoseChanDeform *pdef_info, Bone *bone, float co[3], DualQuat *dq, float defmat[3][3])
+static void b_bone_deform(bPoseChanDeform *pdef_info, Bone *bone, const float co[3], DualQuat **r_dq, float (**r_mat)[4])
 {
 	Mat4 *b_bone = pdef_info->b_bone_mats;
 	float (*mat)[4] = b_bone[0].mat;
@@ -647,15 +655,11 @@ static void b_bone_deform(bPoseChanDeform *pdef_info, Bone *bone, float co[3], D
 	 * straight joints in restpos. */
 	CLAMP(a, 0, bone->segments - 1);
 
-	if (dq) {
-		copy_dq_dq(dq, &(pdef_info->b_bone_dual_quats)[a]);
+	if (r_dq) {
+		*r_dq = &(pdef_info->b_bone_dual_quats)[a];
 	}
 	else {
-		mul_m4_v3(b_bone[a + 1].mat, co);
-
-		if (defmat) {
-			copy_m3_m4(defmat, b_bone[a + 1].mat);
-		}
+		*r_mat = b_bone[a + 1].mat;
 	}
 }
 
@@ -711,107 +715,287 @@ float distfactor_to_bone(const float vec[3], const float b1[3], const float b2[3
 	}
 }
 
-static void pchan_deform_mat_add(bPoseChannel *pchan, float weight, float bbonemat[3][3], float mat[3][3])
+/* Blending of bone transforms.
+ *
+ * Instead of transforming the vertex by every bone and summing the weighted
+ * offsets, linear blending sums the weighted bone matrices and transforms the
+ * vertex once at the end. The 3x3 part of the sum is the deform matrix. */
+
+/* r += m * weight */
+BLI_INLINE void deform_madd_m4(float r[4][4], float m[4][4], const float weight)
 {
-	float wmat[3][3];
+#ifdef __SSE__
+	const __m128 w = _mm_set1_ps(weight);
+	_mm_storeu_ps(r[0], _mm_add_ps(_mm_loadu_ps(r[0]), _mm_mul_ps(_mm_loadu_ps(m[0]), w)));
+	_mm_storeu_ps(r[1], _mm_add_ps(_mm_loadu_ps(r[1]), _mm_mul_ps(_mm_loadu_ps(m[1]), w)));
+	_mm_storeu_ps(r[2], _mm_add_ps(_mm_loadu_ps(r[2]), _mm_mul_ps(_mm_loadu_ps(m[2]), w)));
+	_mm_storeu_ps(r[3], _mm_add_ps(_mm_loadu_ps(r[3]), _mm_mul_ps(_mm_loadu_ps(m[3]), w)));
+#else
+	int i, j;
 
-	if (pchan->bone->segments > 1)
-		copy_m3_m3(wmat, bbonemat);
-	else
-		copy_m3_m4(wmat, pchan->chan_mat);
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 4; j++) {
+			r[i][j] += m[i][j] * weight;
+		}
+	}
+#endif
+}
+
+/* same as add_weighted_dq_dq */
+BLI_INLINE void deform_madd_dq(DualQuat *dqsum, const DualQuat *dq, const float weight)
+{
+	/* make sure we interpolate quats in the right direction */
+	const float weight_signed = (dot_qtqt(dq->quat, dqsum->quat) < 0.0f) ? -weight : weight;
+
+#ifdef __SSE__
+	const __m128 w = _mm_set1_ps(weight_signed);
+	_mm_storeu_ps(dqsum->quat, _mm_add_ps(_mm_loadu_ps(dqsum->quat), _mm_mul_ps(_mm_loadu_ps(dq->quat), w)));
+	_mm_storeu_ps(dqsum->trans, _mm_add_ps(_mm_loadu_ps(dqsum->trans), _mm_mul_ps(_mm_loadu_ps(dq->trans), w)));
+#else
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		dqsum->quat[i] += dq->quat[i] * weight_signed;
+		dqsum->trans[i] += dq->trans[i] * weight_signed;
+	}
+#endif
+
+	/* interpolate scale - but only if needed,
+	 * we don't want negative weights for scaling */
+	if (dq->scale_weight) {
+		deform_madd_m4(dqsum->scale, (float (*)[4])dq->scale, weight);
+		dqsum->scale_weight += weight;
+	}
+}
+
+/* Accumulated deformation of a single vertex. */
+typedef struct ArmatureDeformSum {
+	float mat[4][4];  /* linear blending */
+	DualQuat dq;      /* dual quaternion blending */
+	float contrib;
+} ArmatureDeformSum;
+
+static void pchan_bone_deform(bPoseChannel *pchan, bPoseChanDeform *pdef_info, float weight,
+                              const bool use_quaternion, const float co[3], ArmatureDeformSum *sum)
+{
+	if (!weight)
+		return;
+
+	if (use_quaternion) {
+		DualQuat *dq;
+
+		if (pchan->bone->segments > 1)
+			b_bone_deform(pdef_info, pchan->bone, co, &dq, NULL);
+		else
+			dq = pdef_info->dual_quat;
+
+		deform_madd_dq(&sum->dq, dq, weight);
+	}
+	else {
+		float (*mat)[4];
+
+		if (pchan->bone->segments > 1)
+			b_bone_deform(pdef_info, pchan->bone, co, NULL, &mat);
+		else
+			mat = pchan->chan_mat;
 
-	mul_m3_fl(wmat, weight);
-	add_m3_m3m3(mat, mat, wmat);
+		deform_madd_m4(sum->mat, mat, weight);
+	}
+
+	sum->contrib += weight;
 }
 
-static float dist_bone_deform(bPoseChannel *pchan, bPoseChanDeform *pdef_info, float vec[3], DualQuat *dq,
-                              float mat[3][3], const float co[3])
+static void dist_bone_deform(bPoseChannel *pchan, bPoseChanDeform *pdef_info,
+                             const bool use_quaternion, const float co[3], ArmatureDeformSum *sum)
 {
 	Bone *bone = pchan->bone;
-	float fac, contrib = 0.0;
-	float cop[3], bbonemat[3][3];
-	DualQuat bbonedq;
+	float fac;
 
 	if (bone == NULL)
-		return 0.0f;
-
-	copy_v3_v3(cop, co);
+		return;
 
-	fac = distfactor_to_bone(cop, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
+	fac = distfactor_to_bone(co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
 
 	if (fac > 0.0f) {
 		fac *= bone->weight;
-		contrib = fac;
-		if (contrib > 0.0f) {
-			if (vec) {
-				if (bone->segments > 1)
-					/* applies on cop and bbonemat */
-					b_bone_deform(pdef_info, bone, cop, NULL, (mat) ? bbonemat : NULL);
-				else
-					mul_m4_v3(pchan->chan_mat, cop);
-
-				/* Make this a delta from the base position */
-				sub_v3_v3(cop, co);
-				madd_v3_v3fl(vec, cop, fac);
-
-				if (mat)
-					pchan_deform_mat_add(pchan, fac, bbonemat, mat);
-			}
-			else {
-				if (bone->segments > 1) {
-					b_bone_deform(pdef_info, bone, cop, &bbonedq, NULL);
-					add_weighted_dq_dq(dq, &bbonedq, fac);
-				}
-				else
-					add_weighted_dq_dq(dq, pdef_info->dual_quat, fac);
-			}
+		if (fac > 0.0f) {
+			pchan_bone_deform(pchan, pdef_info, fac, use_quaternion, co, sum);
 		}
 	}
-
-	return contrib;
 }
 
-static void pchan_bone_deform(bPoseChannel *pchan, bPoseChanDeform *pdef_info, float weight, float vec[3], DualQuat *dq,
-                              float mat[3][3], const float co[3], float *contrib)
+typedef struct ArmatureDeformData {
+	bPoseChanDeform *pdef_info_array;
+	/* all channels in pose order, NULL for ones that don't deform */
+	bPoseChannel **pchan_array;
+	int pchan_tot;
+
+	/* vertex group index to channel */
+	bPoseChannel **defnrToPC;
+	int *defnrToPCIndex;
+	int defbase_tot;
+
+	MDeformVert *dverts;
+	int dverts_tot;
+
+	float (*vertexCos)[3];
+	float (*defMats)[3][3];
+	float (*prevCos)[3];
+
+	float premat[4][4], postmat[4][4];
+	float premat3[3][3], postmat3[3][3];
+
+	bool use_envelope;
+	bool use_quaternion;
+	bool invert_vgroup;
+	bool use_dverts;
+	int armature_def_nr;
+} ArmatureDeformData;
+
+static void armature_vert_task(void *userdata, const int i)
 {
-	float cop[3], bbonemat[3][3];
-	DualQuat bbonedq;
+	ArmatureDeformData *data = userdata;
+	const bool use_quaternion = data->use_quaternion;
+	MDeformVert *dvert;
+	ArmatureDeformSum sum;
+	float *co, dco[3];
+	float armature_weight = 1.0f; /* default to 1 if no overall def group */
+	float prevco_weight = 1.0f;   /* weight for optional cached vertexcos */
+
+	if ((data->use_dverts || data->armature_def_nr != -1) && data->dverts && i < data->dverts_tot)
+		dvert = data->dverts + i;
+	else
+		dvert = NULL;
 
-	if (!weight)
+	if (data->armature_def_nr != -1 && dvert) {
+		armature_weight = defvert_find_weight(dvert, data->armature_def_nr);
+
+		if (data->invert_vgroup)
+			armature_weight = 1.0f - armature_weight;
+
+		/* hackish: the blending factor can be used for blending with prevCos too */
+		if (data->prevCos) {
+			prevco_weight = armature_weight;
+			armature_weight = 1.0f;
+		}
+	}
+
+	/* check if there's any  point in calculating for this vert */
+	if (armature_weight == 0.0f)
 		return;
 
-	copy_v3_v3(cop, co);
+	if (use_quaternion)
+		memset(&sum.dq, 0, sizeof(sum.dq));
+	else
+		zero_m4(sum.mat);
+	sum.contrib = 0.0f;
 
-	if (vec) {
-		if (pchan->bone->segments > 1)
-			/* applies on cop and bbonemat */
-			b_bone_deform(pdef_info, pchan->bone, cop, NULL, (mat) ? bbonemat : NULL);
-		else
-			mul_m4_v3(pchan->chan_mat, cop);
+	/* get the coord we work on */
+	co = data->prevCos ? data->prevCos[i] : data->vertexCos[i];
+
+	/* Apply the object's matrix */
+	mul_m4_v3(data->premat, co);
+
+	if (data->use_dverts && dvert && dvert->totweight) { /* use weight groups ? */
+		MDeformWeight *dw = dvert->dw;
+		int deformed = 0;
+		unsigned int j;
 
-		vec[0] += (cop[0] - co[0]) * weight;
-		vec[1] += (cop[1] - co[1]) * weight;
-		vec[2] += (cop[2] - co[2]) * weight;
+		for (j = dvert->totweight; j != 0; j--, dw++) {
+			const int index = dw->def_nr;
+			bPoseChannel *pchan;
 
-		if (mat)
-			pchan_deform_mat_add(pchan, weight, bbonemat, mat);
+			if (index >= 0 && index < data->defbase_tot && (pchan = data->defnrToPC[index])) {
+				float weight = dw->weight;
+				Bone *bone = pchan->bone;
+
+				deformed = 1;
+
+				if (bone && bone->flag & BONE_MULT_VG_ENV) {
+					weight *= distfactor_to_bone(co, bone->arm_head, bone->arm_tail,
+					                             bone->rad_head, bone->rad_tail, bone->dist);
+				}
+				pchan_bone_deform(pchan, data->pdef_info_array + data->defnrToPCIndex[index], weight,
+				                  use_quaternion, co, &sum);
+			}
+		}
+		/* if there are vertexgroups but not groups with bones
+		 * (like for softbody groups) */
+		if (deformed == 0 && data->use_envelope) {
+			int a;
+			for (a = 0; a < data->pchan_tot; a++) {
+				bPoseChannel *pchan = data->pchan_array[a];
+				if (pchan)
+					dist_bone_deform(pchan, data->pdef_info_array + a, use_quaternion, co, &sum);
+			}
+		}
 	}
-	else {
-		if (pchan->bone->segments > 1) {
-			b_bone_deform(pdef_info, pchan->bone, cop, &bbonedq, NULL);
-			add_weighted_dq_dq(dq, &bbonedq, weight);
+	else if (data->use_envelope) {
+		int a;
+		for (a = 0; a < data->pchan_tot; a++) {
+			bPoseChannel *pchan = data->pchan_array[a];
+			if (pchan)
+				dist_bone_deform(pchan, data->pdef_info_array + a, use_quaternion, co, &sum);
 		}
-		else
-			add_weighted_dq_dq(dq, pdef_info->dual_quat, weight);
 	}
 
-	(*contrib) += weight;
+	/* actually should be EPSILON? weight values and contrib can be like 10e-39 small */
+	if (sum.contrib > 0.0001f) {
+		float smat[3][3];
+
+		if (use_quaternion) {
+			normalize_dq(&sum.dq, sum.contrib);
+
+			if (armature_weight != 1.0f) {
+				copy_v3_v3(dco, co);
+				mul_v3m3_dq(dco, (data->defMats) ? smat : NULL, &sum.dq);
+				sub_v3_v3(dco, co);
+				mul_v3_fl(dco, armature_weight);
+				add_v3_v3(co, dco);
+			}
+			else
+				mul_v3m3_dq(co, (data->defMats) ? smat : NULL, &sum.dq);
+		}
+		else {
+			/* offset from the weighted sum of the bone transforms */
+			mul_v3_m4v3(dco, sum.mat, co);
+			madd_v3_v3fl(dco, co, -sum.contrib);
+
+			madd_v3_v3fl(co, dco, armature_weight / sum.contrib);
+
+			if (data->defMats) {
+				copy_m3_m4(smat, sum.mat);
+				/* quaternion already is scale corrected */
+				mul_m3_fl(smat, armature_weight / sum.contrib);
+			}
+		}
+
+		if (data->defMats) {
+			float tmpmat[3][3];
+
+			copy_m3_m3(tmpmat, data->defMats[i]);
+			mul_m3_series(data->defMats[i], data->postmat3, smat, data->premat3, tmpmat);
+		}
+	}
+
+	/* always, check above code */
+	mul_m4_v3(data->postmat, co);
+
+	/* interpolate with previous modifier position using weight group */
+	if (data->prevCos) {
+		float *vco = data->vertexCos[i];
+		float mw = 1.0f - prevco_weight;
+		vco[0] = prevco_weight * vco[0] + mw * co[0];
+		vco[1] = prevco_weight * vco[1] + mw * co[1];
+		vco[2] = prevco_weight * vco[2] + mw * co[2];
+	}
 }
 
 void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float (*vertexCos)[3],
                            float (*defMats)[3][3], int numVerts, int deformflag,
                            float (*prevCos)[3], const char *defgrp_name)
 {
+	ArmatureDeformData data;
 	bPoseChanDeform *pdef_info_array;
 	bPoseChanDeform *pdef_info = NULL;
 	bArmature *arm = armOb->data;
@@ -847,10 +1031,13 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 	}
 
 	pdef_info_array = MEM_callocN(sizeof(bPoseChanDeform) * totchan, "bPoseChanDeform");
+	data.pchan_array = MEM_mallocN(sizeof(*data.pchan_array) * totchan, "bPoseChannel array");
 
 	totchan = 0;
 	pdef_info = pdef_info_array;
-	for (pchan = armOb->pose->chanbase.first; pchan; pchan = pchan->next, pdef_info++) {
+	for (pchan = armOb->pose->chanbase.first, i = 0; pchan; pchan = pchan->next, pdef_info++, i++) {
+		data.pchan_array[i] = (pchan->bone->flag & BONE_NO_DEFORM) ? NULL : pchan;
+
 		if (!(pchan->bone->flag & BONE_NO_DEFORM)) {
 			if (pchan->bone->segments > 1)
 				pchan_b_bone_defmats(pchan, pdef_info, use_quaternion);
@@ -861,6 +1048,7 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 			}
 		}
 	}
+	data.pchan_tot = i;
 
 	/* get the def_nr for the overall armature vertex group if present */
 	armature_def_nr = defgroup_name_index(target, defgrp_name);
@@ -912,150 +1100,36 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 		}
 	}
 
-	for (i = 0; i < numVerts; i++) {
-		MDeformVert *dvert;
-		DualQuat sumdq, *dq = NULL;
-		float *co, dco[3];
-		float sumvec[3], summat[3][3];
-		float *vec = NULL, (*smat)[3] = NULL;
-		float contrib = 0.0f;
-		float armature_weight = 1.0f; /* default to 1 if no overall def group */
-		float prevco_weight = 1.0f;   /* weight for optional cached vertexcos */
-
-		if (use_quaternion) {
-			memset(&sumdq, 0, sizeof(DualQuat));
-			dq = &sumdq;
-		}
-		else {
-			sumvec[0] = sumvec[1] = sumvec[2] = 0.0f;
-			vec = sumvec;
-
-			if (defMats) {
-				zero_m3(summat);
-				smat = summat;
-			}
-		}
-
-		if (use_dverts || armature_def_nr != -1) {
-			if (dm)
-				dvert = dm->getVertData(dm, i, CD_MDEFORMVERT);
-			else if (dverts && i < target_totvert)
-				dvert = dverts + i;
-			else
-				dvert = NULL;
-		}
-		else
-			dvert = NULL;
-
-		if (armature_def_nr != -1 && dvert) {
-			armature_weight = defvert_find_weight(dvert, armature_def_nr);
-
-			if (invert_vgroup)
-				armature_weight = 1.0f - armature_weight;
-
-			/* hackish: the blending factor can be used for blending with prevCos too */
-			if (prevCos) {
-				prevco_weight = armature_weight;
-				armature_weight = 1.0f;
-			}
-		}
-
-		/* check if there's any  point in calculating for this vert */
-		if (armature_weight == 0.0f)
-			continue;
-
-		/* get the coord we work on */
-		co = prevCos ? prevCos[i] : vertexCos[i];
-
-		/* Apply the object's matrix */
-		mul_m4_v3(premat, co);
-
-		if (use_dverts && dvert && dvert->totweight) { /* use weight groups ? */
-			MDeformWeight *dw = dvert->dw;
-			int deformed = 0;
-			unsigned int j;
-
-			for (j = dvert->totweight; j != 0; j--, dw++) {
-				const int index = dw->def_nr;
-				if (index >= 0 && index < defbase_tot && (pchan = defnrToPC[index])) {
-					float weight = dw->weight;
-					Bone *bone = pchan->bone;
-					pdef_info = pdef_info_array + defnrToPCIndex[index];
-
-					deformed = 1;
-
-					if (bone && bone->flag & BONE_MULT_VG_ENV) {
-						weight *= distfactor_to_bone(co, bone->arm_head, bone->arm_tail,
-						                             bone->rad_head, bone->rad_tail, bone->dist);
-					}
-					pchan_bone_deform(pchan, pdef_info, weight, vec, dq, smat, co, &contrib);
-				}
-			}
-			/* if there are vertexgroups but not groups with bones
-			 * (like for softbody groups) */
-			if (deformed == 0 && use_envelope) {
-				pdef_info = pdef_info_array;
-				for (pchan = armOb->pose->chanbase.first; pchan; pchan = pchan->next, pdef_info++) {
-					if (!(pchan->bone->flag & BONE_NO_DEFORM))
-						contrib += dist_bone_deform(pchan, pdef_info, vec, dq, smat, co);
-				}
-			}
-		}
-		else if (use_envelope) {
-			pdef_info = pdef_info_array;
-			for (pchan = armOb->pose->chanbase.first; pchan; pchan = pchan->next, pdef_info++) {
-				if (!(pchan->bone->flag & BONE_NO_DEFORM))
-					contrib += dist_bone_deform(pchan, pdef_info, vec, dq, smat, co);
-			}
-		}
-
-		/* actually should be EPSILON? weight values and contrib can be like 10e-39 small */
-		if (contrib > 0.0001f) {
-			if (use_quaternion) {
-				normalize_dq(dq, contrib);
-
-				if (armature_weight != 1.0f) {
-					copy_v3_v3(dco, co);
-					mul_v3m3_dq(dco, (defMats) ? summat : NULL, dq);
-					sub_v3_v3(dco, co);
-					mul_v3_fl(dco, armature_weight);
-					add_v3_v3(co, dco);
-				}
-				else
-					mul_v3m3_dq(co, (defMats) ? summat : NULL, dq);
-
-				smat = summat;
-			}
-			else {
-				mul_v3_fl(vec, armature_weight / contrib);
-				add_v3_v3v3(co, vec, co);
-			}
-
-			if (defMats) {
-				float pre[3][3], post[3][3], tmpmat[3][3];
-
-				copy_m3_m4(pre, premat);
-				copy_m3_m4(post, postmat);
-				copy_m3_m3(tmpmat, defMats[i]);
-
-				if (!use_quaternion) /* quaternion already is scale corrected */
-					mul_m3_fl(smat, armature_weight / contrib);
-
-				mul_m3_series(defMats[i], post, smat, pre, tmpmat);
-			}
-		}
-
-		/* always, check above code */
-		mul_m4_v3(postmat, co);
-
-		/* interpolate with previous modifier position using weight group */
-		if (prevCos) {
-			float mw = 1.0f - prevco_weight;
-			vertexCos[i][0] = prevco_weight * vertexCos[i][0] + mw * co[0];
-			vertexCos[i][1] = prevco_weight * vertexCos[i][1] + mw * co[1];
-			vertexCos[i][2] = prevco_weight * vertexCos[i][2] + mw * co[2];
-		}
+	/* the derived mesh deform verts are used instead of the original ones,
+	 * fetched once here so the vertex loop doesn't call into the DerivedMesh */
+	if (dm) {
+		data.dverts = dm->getVertDataArray(dm, CD_MDEFORMVERT);
+		data.dverts_tot = data.dverts ? dm->getNumVerts(dm) : 0;
 	}
+	else {
+		data.dverts = dverts;
+		data.dverts_tot = target_totvert;
+	}
+
+	data.pdef_info_array = pdef_info_array;
+	data.defnrToPC = defnrToPC;
+	data.defnrToPCIndex = defnrToPCIndex;
+	data.defbase_tot = defbase_tot;
+	data.vertexCos = vertexCos;
+	data.defMats = defMats;
+	data.prevCos = prevCos;
+	copy_m4_m4(data.premat, premat);
+	copy_m4_m4(data.postmat, postmat);
+	copy_m3_m4(data.premat3, premat);
+	copy_m3_m4(data.postmat3, postmat);
+	data.use_envelope = use_envelope != 0;
+	data.use_quaternion = use_quaternion != 0;
+	data.invert_vgroup = invert_vgroup != 0;
+	data.use_dverts = use_dverts;
+	data.armature_def_nr = armature_def_nr;
+
+	/* vertices are independent, every vertex only writes its own coordinate and matrix */
+	BLI_task_parallel_range(0, numVerts, &data, armature_vert_task, numVerts > ARMATURE_DEFORM_THREAD_MIN);
 
 	if (dualquats)
 		MEM_freeN(dualquats);
@@ -1063,6 +1137,7 @@ void armature_deform_verts(Object *armOb, Object *target, DerivedMesh *dm, float
 		MEM_freeN(defnrToPC);
 	if (defnrToPCIndex)
 		MEM_freeN(defnrToPCIndex);
+	MEM_freeN(data.pchan_array);
 
 	/* free B_bone matrices */
 	pdef_info = pdef_info_array;
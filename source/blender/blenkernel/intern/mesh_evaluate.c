@@ -46,12 +46,16 @@
 #include "BLI_linklist.h"
 #include "BLI_linklist_stack.h"
 #include "BLI_alloca.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
 
 #include "BKE_customdata.h"
 #include "BKE_mesh.h"
 #include "BKE_multires.h"
 #include "BKE_report.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_strict_flags.h"
 
 #include "mikktspace.h"
@@ -161,9 +165,35 @@ void BKE_mesh_calc_normals_mapping_ex(
 	
 }
 
-static void mesh_calc_normals_poly_accum(MPoly *mp, MLoop *ml,
-                                         MVert *mvert, float polyno[3], float (*tnorms)[3])
+typedef struct MeshCalcNormalsData {
+	MPoly *mpolys;
+	MLoop *mloop;
+	MVert *mverts;
+	float (*pnors)[3];
+	float (*vnors)[3];
+	/* polys sharing a vertex may be handled by different threads */
+	bool use_atomic;
+} MeshCalcNormalsData;
+
+static void mesh_calc_normals_poly_task(void *userdata, const int pidx)
 {
+	MeshCalcNormalsData *data = userdata;
+	MPoly *mp = &data->mpolys[pidx];
+
+	BKE_mesh_calc_poly_normal(mp, data->mloop + mp->loopstart, data->mverts, data->pnors[pidx]);
+}
+
+static void mesh_calc_normals_poly_accum_task(void *userdata, const int pidx)
+{
+	MeshCalcNormalsData *data = userdata;
+	const MPoly *mp = &data->mpolys[pidx];
+	const MLoop *ml = &data->mloop[mp->loopstart];
+	const MVert *mverts = data->mverts;
+	float (*vnors)[3] = data->vnors;
+
+	float pnor_temp[3];
+	float *pnor = data->pnors ? data->pnors[pidx] : pnor_temp;
+
 	const int nverts = mp->totloop;
 	float (*edgevecbuf)[3] = BLI_array_alloca(edgevecbuf, (size_t)nverts);
 	int i;
@@ -172,14 +202,14 @@ static void mesh_calc_normals_poly_accum(MPoly *mp, MLoop *ml,
 	/* inline version of #BKE_mesh_calc_poly_normal, also does edge-vectors */
 	{
 		int i_prev = nverts - 1;
-		const float *v_prev = mvert[ml[i_prev].v].co;
+		const float *v_prev = mverts[ml[i_prev].v].co;
 		const float *v_curr;
 
-		zero_v3(polyno);
+		zero_v3(pnor);
 		/* Newell's Method */
 		for (i = 0; i < nverts; i++) {
-			v_curr = mvert[ml[i].v].co;
-			add_newell_cross_v3_v3v3(polyno, v_prev, v_curr);
+			v_curr = mverts[ml[i].v].co;
+			add_newell_cross_v3_v3v3(pnor, v_prev, v_curr);
 
 			/* Unrelated to normalize, calculate edge-vector */
 			sub_v3_v3v3(edgevecbuf[i_prev], v_prev, v_curr);
@@ -188,8 +218,8 @@ static void mesh_calc_normals_poly_accum(MPoly *mp, MLoop *ml,
 
 			v_prev = v_curr;
 		}
-		if (UNLIKELY(normalize_v3(polyno) == 0.0f)) {
-			polyno[2] = 1.0f; /* other axis set to 0.0 */
+		if (UNLIKELY(normalize_v3(pnor) == 0.0f)) {
+			pnor[2] = 1.0f; /* other axis set to 0.0 */
 		}
 	}
 
@@ -199,6 +229,7 @@ static void mesh_calc_normals_poly_accum(MPoly *mp, MLoop *ml,
 		const float *prev_edge = edgevecbuf[nverts - 1];
 
 		for (i = 0; i < nverts; i++) {
+			const int vidx = (int)ml[i].v;
 			const float *cur_edge = edgevecbuf[i];
 
 			/* calculate angle between the two poly edges incident on
@@ -206,62 +237,63 @@ static void mesh_calc_normals_poly_accum(MPoly *mp, MLoop *ml,
 			const float fac = saacos(-dot_v3v3(cur_edge, prev_edge));
 
 			/* accumulate */
-			madd_v3_v3fl(tnorms[ml[i].v], polyno, fac);
+			if (data->use_atomic) {
+				atomic_add_fl(&vnors[vidx][0], pnor[0] * fac);
+				atomic_add_fl(&vnors[vidx][1], pnor[1] * fac);
+				atomic_add_fl(&vnors[vidx][2], pnor[2] * fac);
+			}
+			else {
+				madd_v3_v3fl(vnors[vidx], pnor, fac);
+			}
 			prev_edge = cur_edge;
 		}
 	}
+}
+
+static void mesh_calc_normals_poly_finalize_task(void *userdata, const int vidx)
+{
+	MeshCalcNormalsData *data = userdata;
+	MVert *mv = &data->mverts[vidx];
+	float *no = data->vnors[vidx];
+
+	/* following Mesh convention; we use vertex coordinate itself for normal in this case */
+	if (UNLIKELY(normalize_v3(no) == 0.0f)) {
+		normalize_v3_v3(no, mv->co);
+	}
 
+	normal_float_to_short_v3(mv->no, no);
 }
 
 void BKE_mesh_calc_normals_poly(MVert *mverts, int numVerts, MLoop *mloop, MPoly *mpolys,
                                 int UNUSED(numLoops), int numPolys, float (*r_polynors)[3],
                                 const bool only_face_normals)
 {
-	float (*pnors)[3] = r_polynors;
-	float (*tnorms)[3];
-	int i;
-	MPoly *mp;
+	MeshCalcNormalsData data;
+	const bool use_threading = (numPolys > BKE_MESH_OMP_LIMIT);
+
+	data.mpolys = mpolys;
+	data.mloop = mloop;
+	data.mverts = mverts;
+	data.pnors = r_polynors;
 
 	if (only_face_normals) {
-		BLI_assert(pnors != NULL);
+		BLI_assert(r_polynors != NULL);
 
-#pragma omp parallel for if (numPolys > BKE_MESH_OMP_LIMIT)
-		for (i = 0; i < numPolys; i++) {
-			BKE_mesh_calc_poly_normal(&mpolys[i], mloop + mpolys[i].loopstart, mverts, pnors[i]);
-		}
+		BLI_task_parallel_range(0, numPolys, &data, mesh_calc_normals_poly_task, use_threading);
 		return;
 	}
 
-	/* first go through and calculate normals for all the polys */
-	tnorms = MEM_callocN(sizeof(*tnorms) * (size_t)numVerts, __func__);
+	/* first go through and calculate normals for all the polys, accumulating them into
+	 * their vertices, atomic adds are only worth their cost when several threads run */
+	data.vnors = MEM_callocN(sizeof(*data.vnors) * (size_t)numVerts, __func__);
+	data.use_atomic = use_threading && (BLI_task_scheduler_num_threads(BLI_task_scheduler_get()) > 1);
 
-	if (pnors) {
-		mp = mpolys;
-		for (i = 0; i < numPolys; i++, mp++) {
-			mesh_calc_normals_poly_accum(mp, mloop + mp->loopstart, mverts, pnors[i], tnorms);
-		}
-	}
-	else {
-		float tpnor[3];  /* temp poly normal */
-		mp = mpolys;
-		for (i = 0; i < numPolys; i++, mp++) {
-			mesh_calc_normals_poly_accum(mp, mloop + mp->loopstart, mverts, tpnor, tnorms);
-		}
-	}
+	BLI_task_parallel_range(0, numPolys, &data, mesh_calc_normals_poly_accum_task, use_threading);
 
-	/* following Mesh convention; we use vertex coordinate itself for normal in this case */
-	for (i = 0; i < numVerts; i++) {
-		MVert *mv = &mverts[i];
-		float *no = tnorms[i];
+	/* then normalize the vertex normals, this only touches each vertex */
+	BLI_task_parallel_range(0, numVerts, &data, mesh_calc_normals_poly_finalize_task, use_threading);
 
-		if (UNLIKELY(normalize_v3(no) == 0.0f)) {
-			normalize_v3_v3(no, mv->co);
-		}
-
-		normal_float_to_short_v3(mv->no, no);
-	}
-
-	MEM_freeN(tnorms);
+	MEM_freeN(data.vnors);
 }
 
 void BKE_mesh_calc_normals(Mesh *mesh)
@@ -1378,216 +1410,257 @@ void BKE_mesh_loops_to_tessdata(CustomData *fdata, CustomData *ldata, CustomData
 	}
 }
 
-/**
- * Recreate tessellation.
- *
- * \param do_face_nor_copy controls whether the normals from the poly are copied to the tessellated faces.
- *
- * \return number of tessellation faces.
- */
-int BKE_mesh_recalc_tessellation(CustomData *fdata, CustomData *ldata, CustomData *pdata,
-                                 MVert *mvert, int totface, int totloop, int totpoly, const bool do_face_nor_cpy)
-{
-	/* use this to avoid locking pthread for _every_ polygon
-	 * and calling the fill function */
-
+/* use this to avoid locking pthread for _every_ polygon
+ * and calling the fill function */
 #define USE_TESSFACE_SPEEDUP
 #define USE_TESSFACE_QUADS  /* NEEDS FURTHER TESTING */
 
 /* We abuse MFace->edcode to tag quad faces. See below for details. */
 #define TESSFACE_IS_QUAD 1
 
-	const int looptris_tot = poly_to_tri_count(totpoly, totloop);
-
-	MPoly *mp, *mpoly;
-	MLoop *ml, *mloop;
-	MFace *mface, *mf;
-	MemArena *arena = NULL;
+typedef struct MeshRecalcTessellationData {
+	MVert *mvert;
+	MPoly *mpoly;
+	MLoop *mloop;
+	MFace *mface;
 	int *mface_to_poly_map;
 	unsigned int (*lindices)[4];
-	int poly_index, mface_index;
-	unsigned int j;
-
-	mpoly = CustomData_get_layer(pdata, CD_MPOLY);
-	mloop = CustomData_get_layer(ldata, CD_MLOOP);
+	/* index of the first tessface of every poly */
+	int *poly_mface_start;
+} MeshRecalcTessellationData;
 
-	/* allocate the length of totfaces, avoid many small reallocs,
-	 * if all faces are tri's it will be correct, quads == 2x allocs */
-	/* take care. we are _not_ calloc'ing so be sure to initialize each field */
-	mface_to_poly_map = MEM_mallocN(sizeof(*mface_to_poly_map) * (size_t)looptris_tot, __func__);
-	mface             = MEM_mallocN(sizeof(*mface) *             (size_t)looptris_tot, __func__);
-	lindices          = MEM_mallocN(sizeof(*lindices) *          (size_t)looptris_tot, __func__);
+static void mesh_recalc_tessellation_poly_task(
+        void *userdata, void *UNUSED(userdata_chunk), const int poly_index, const int UNUSED(threadid))
+{
+	MeshRecalcTessellationData *data = userdata;
+	MVert *mvert = data->mvert;
+	MPoly *mp = &data->mpoly[poly_index];
+	MLoop *ml, *mloop = data->mloop;
+	MFace *mf, *mface = data->mface;
+	int *mface_to_poly_map = data->mface_to_poly_map;
+	unsigned int (*lindices)[4] = data->lindices;
+	int mface_index = data->poly_mface_start[poly_index];
+	unsigned int j;
 
-	mface_index = 0;
-	mp = mpoly;
-	for (poly_index = 0; poly_index < totpoly; poly_index++, mp++) {
-		const unsigned int mp_loopstart = (unsigned int)mp->loopstart;
-		const unsigned int mp_totloop = (unsigned int)mp->totloop;
-		unsigned int l1, l2, l3, l4;
-		unsigned int *lidx;
-		if (mp_totloop < 3) {
-			/* do nothing */
-		}
+	const unsigned int mp_loopstart = (unsigned int)mp->loopstart;
+	const unsigned int mp_totloop = (unsigned int)mp->totloop;
+	unsigned int l1, l2, l3, l4;
+	unsigned int *lidx;
+	if (mp_totloop < 3) {
+		/* do nothing */
+	}
 
 #ifdef USE_TESSFACE_SPEEDUP
 
 #define ML_TO_MF(i1, i2, i3)                                                  \
-		mface_to_poly_map[mface_index] = poly_index;                          \
-		mf = &mface[mface_index];                                             \
-		lidx = lindices[mface_index];                                         \
-		/* set loop indices, transformed to vert indices later */             \
-		l1 = mp_loopstart + i1;                                               \
-		l2 = mp_loopstart + i2;                                               \
-		l3 = mp_loopstart + i3;                                               \
-		mf->v1 = mloop[l1].v;                                                 \
-		mf->v2 = mloop[l2].v;                                                 \
-		mf->v3 = mloop[l3].v;                                                 \
-		mf->v4 = 0;                                                           \
-		lidx[0] = l1;                                                         \
-		lidx[1] = l2;                                                         \
-		lidx[2] = l3;                                                         \
-		lidx[3] = 0;                                                          \
-		mf->mat_nr = mp->mat_nr;                                              \
-		mf->flag = mp->flag;                                                  \
-		mf->edcode = 0;                                                       \
-		(void)0
+	mface_to_poly_map[mface_index] = poly_index;                          \
+	mf = &mface[mface_index];                                             \
+	lidx = lindices[mface_index];                                         \
+	/* set loop indices, transformed to vert indices later */             \
+	l1 = mp_loopstart + i1;                                               \
+	l2 = mp_loopstart + i2;                                               \
+	l3 = mp_loopstart + i3;                                               \
+	mf->v1 = mloop[l1].v;                                                 \
+	mf->v2 = mloop[l2].v;                                                 \
+	mf->v3 = mloop[l3].v;                                                 \
+	mf->v4 = 0;                                                           \
+	lidx[0] = l1;                                                         \
+	lidx[1] = l2;                                                         \
+	lidx[2] = l3;                                                         \
+	lidx[3] = 0;                                                          \
+	mf->mat_nr = mp->mat_nr;                                              \
+	mf->flag = mp->flag;                                                  \
+	mf->edcode = 0;                                                       \
+	(void)0
 
 /* ALMOST IDENTICAL TO DEFINE ABOVE (see EXCEPTION) */
 #define ML_TO_MF_QUAD()                                                       \
-		mface_to_poly_map[mface_index] = poly_index;                          \
-		mf = &mface[mface_index];                                             \
-		lidx = lindices[mface_index];                                         \
-		/* set loop indices, transformed to vert indices later */             \
-		l1 = mp_loopstart + 0; /* EXCEPTION */                                \
-		l2 = mp_loopstart + 1; /* EXCEPTION */                                \
-		l3 = mp_loopstart + 2; /* EXCEPTION */                                \
-		l4 = mp_loopstart + 3; /* EXCEPTION */                                \
-		mf->v1 = mloop[l1].v;                                                 \
-		mf->v2 = mloop[l2].v;                                                 \
-		mf->v3 = mloop[l3].v;                                                 \
-		mf->v4 = mloop[l4].v;                                                 \
-		lidx[0] = l1;                                                         \
-		lidx[1] = l2;                                                         \
-		lidx[2] = l3;                                                         \
-		lidx[3] = l4;                                                         \
-		mf->mat_nr = mp->mat_nr;                                              \
-		mf->flag = mp->flag;                                                  \
-		mf->edcode = TESSFACE_IS_QUAD;                                        \
-		(void)0
-
-
-		else if (mp_totloop == 3) {
-			ML_TO_MF(0, 1, 2);
-			mface_index++;
-		}
-		else if (mp_totloop == 4) {
+	mface_to_poly_map[mface_index] = poly_index;                          \
+	mf = &mface[mface_index];                                             \
+	lidx = lindices[mface_index];                                         \
+	/* set loop indices, transformed to vert indices later */             \
+	l1 = mp_loopstart + 0; /* EXCEPTION */                                \
+	l2 = mp_loopstart + 1; /* EXCEPTION */                                \
+	l3 = mp_loopstart + 2; /* EXCEPTION */                                \
+	l4 = mp_loopstart + 3; /* EXCEPTION */                                \
+	mf->v1 = mloop[l1].v;                                                 \
+	mf->v2 = mloop[l2].v;                                                 \
+	mf->v3 = mloop[l3].v;                                                 \
+	mf->v4 = mloop[l4].v;                                                 \
+	lidx[0] = l1;                                                         \
+	lidx[1] = l2;                                                         \
+	lidx[2] = l3;                                                         \
+	lidx[3] = l4;                                                         \
+	mf->mat_nr = mp->mat_nr;                                              \
+	mf->flag = mp->flag;                                                  \
+	mf->edcode = TESSFACE_IS_QUAD;                                        \
+	(void)0
+
+
+	else if (mp_totloop == 3) {
+		ML_TO_MF(0, 1, 2);
+		mface_index++;
+	}
+	else if (mp_totloop == 4) {
 #ifdef USE_TESSFACE_QUADS
-			ML_TO_MF_QUAD();
-			mface_index++;
+		ML_TO_MF_QUAD();
+		mface_index++;
 #else
-			ML_TO_MF(0, 1, 2);
-			mface_index++;
-			ML_TO_MF(0, 2, 3);
-			mface_index++;
+		ML_TO_MF(0, 1, 2);
+		mface_index++;
+		ML_TO_MF(0, 2, 3);
+		mface_index++;
 #endif
-		}
+	}
 #endif /* USE_TESSFACE_SPEEDUP */
-		else {
-			const float *co_curr, *co_prev;
+	else {
+		const float *co_curr, *co_prev;
 
-			float normal[3];
+		float normal[3];
 
-			float axis_mat[3][3];
-			float (*projverts)[2];
-			unsigned int (*tris)[3];
+		float axis_mat[3][3];
+		float (*projverts)[2];
+		unsigned int (*tris)[3];
 
-			const unsigned int totfilltri = mp_totloop - 2;
+		const unsigned int totfilltri = mp_totloop - 2;
 
-			if (UNLIKELY(arena == NULL)) {
-				arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
-			}
+		/* every thread fills into its own arena */
+		MemArena *arena = BLI_thread_scratch_arena();
+		MemArenaMark arena_mark;
 
-			tris = BLI_memarena_alloc(arena, sizeof(*tris) * (size_t)totfilltri);
-			projverts = BLI_memarena_alloc(arena, sizeof(*projverts) * (size_t)mp_totloop);
+		BLI_memarena_mark(arena, &arena_mark);
 
-			zero_v3(normal);
+		tris = BLI_memarena_alloc(arena, sizeof(*tris) * (size_t)totfilltri);
+		projverts = BLI_memarena_alloc(arena, sizeof(*projverts) * (size_t)mp_totloop);
 
-			/* calc normal */
-			ml = mloop + mp_loopstart;
-			co_prev = mvert[ml[mp_totloop - 1].v].co;
-			for (j = 0; j < mp_totloop; j++, ml++) {
-				co_curr = mvert[ml->v].co;
-				add_newell_cross_v3_v3v3(normal, co_prev, co_curr);
-				co_prev = co_curr;
-			}
-			if (UNLIKELY(normalize_v3(normal) == 0.0f)) {
-				normal[2] = 1.0f;
-			}
+		zero_v3(normal);
 
-			/* project verts to 2d */
-			axis_dominant_v3_to_m3(axis_mat, normal);
+		/* calc normal */
+		ml = mloop + mp_loopstart;
+		co_prev = mvert[ml[mp_totloop - 1].v].co;
+		for (j = 0; j < mp_totloop; j++, ml++) {
+			co_curr = mvert[ml->v].co;
+			add_newell_cross_v3_v3v3(normal, co_prev, co_curr);
+			co_prev = co_curr;
+		}
+		if (UNLIKELY(normalize_v3(normal) == 0.0f)) {
+			normal[2] = 1.0f;
+		}
 
-			ml = mloop + mp_loopstart;
-			for (j = 0; j < mp_totloop; j++, ml++) {
-				mul_v2_m3v3(projverts[j], axis_mat, mvert[ml->v].co);
-			}
+		/* project verts to 2d */
+		axis_dominant_v3_to_m3(axis_mat, normal);
 
-			BLI_polyfill_calc_arena((const float (*)[2])projverts, mp_totloop, -1, tris, arena);
+		ml = mloop + mp_loopstart;
+		for (j = 0; j < mp_totloop; j++, ml++) {
+			mul_v2_m3v3(projverts[j], axis_mat, mvert[ml->v].co);
+		}
 
-			/* apply fill */
-			for (j = 0; j < totfilltri; j++) {
-				unsigned int *tri = tris[j];
-				lidx = lindices[mface_index];
+		BLI_polyfill_calc_arena((const float (*)[2])projverts, mp_totloop, -1, tris, arena);
 
-				mface_to_poly_map[mface_index] = poly_index;
-				mf = &mface[mface_index];
+		/* apply fill */
+		for (j = 0; j < totfilltri; j++) {
+			unsigned int *tri = tris[j];
+			lidx = lindices[mface_index];
 
-				/* set loop indices, transformed to vert indices later */
-				l1 = mp_loopstart + tri[0];
-				l2 = mp_loopstart + tri[1];
-				l3 = mp_loopstart + tri[2];
+			mface_to_poly_map[mface_index] = poly_index;
+			mf = &mface[mface_index];
 
-				/* sort loop indices to ensure winding is correct */
-				if (l1 > l2) SWAP(unsigned int, l1, l2);
-				if (l2 > l3) SWAP(unsigned int, l2, l3);
-				if (l1 > l2) SWAP(unsigned int, l1, l2);
+			/* set loop indices, transformed to vert indices later */
+			l1 = mp_loopstart + tri[0];
+			l2 = mp_loopstart + tri[1];
+			l3 = mp_loopstart + tri[2];
 
-				mf->v1 = mloop[l1].v;
-				mf->v2 = mloop[l2].v;
-				mf->v3 = mloop[l3].v;
-				mf->v4 = 0;
+			/* sort loop indices to ensure winding is correct */
+			if (l1 > l2) SWAP(unsigned int, l1, l2);
+			if (l2 > l3) SWAP(unsigned int, l2, l3);
+			if (l1 > l2) SWAP(unsigned int, l1, l2);
 
-				lidx[0] = l1;
-				lidx[1] = l2;
-				lidx[2] = l3;
-				lidx[3] = 0;
+			mf->v1 = mloop[l1].v;
+			mf->v2 = mloop[l2].v;
+			mf->v3 = mloop[l3].v;
+			mf->v4 = 0;
 
-				mf->mat_nr = mp->mat_nr;
-				mf->flag = mp->flag;
-				mf->edcode = 0;
+			lidx[0] = l1;
+			lidx[1] = l2;
+			lidx[2] = l3;
+			lidx[3] = 0;
 
-				mface_index++;
-			}
+			mf->mat_nr = mp->mat_nr;
+			mf->flag = mp->flag;
+			mf->edcode = 0;
 
-			BLI_memarena_clear(arena);
+			mface_index++;
 		}
+
+		BLI_memarena_rollback(arena, &arena_mark);
 	}
+}
+
+/**
+ * Recreate tessellation.
+ *
+ * \param do_face_nor_copy controls whether the normals from the poly are copied to the tessellated faces.
+ *
+ * \return number of tessellation faces.
+ */
+int BKE_mesh_recalc_tessellation(CustomData *fdata, CustomData *ldata, CustomData *pdata,
+                                 MVert *mvert, int totface, int totloop, int totpoly, const bool do_face_nor_cpy)
+{
+	MeshRecalcTessellationData data;
+	MPoly *mp, *mpoly;
+	MFace *mface, *mf;
+	int *mface_to_poly_map;
+	unsigned int (*lindices)[4];
+	int *poly_mface_start;
+	int poly_index, mface_index;
+
+	mpoly = CustomData_get_layer(pdata, CD_MPOLY);
+
+	/* count the tessfaces of every poly first, so all polys can be filled in parallel */
+	poly_mface_start = MEM_mallocN(sizeof(*poly_mface_start) * (size_t)totpoly, __func__);
+
+	mface_index = 0;
+	mp = mpoly;
+	for (poly_index = 0; poly_index < totpoly; poly_index++, mp++) {
+		poly_mface_start[poly_index] = mface_index;
 
-	if (arena) {
-		BLI_memarena_free(arena);
-		arena = NULL;
+		if (mp->totloop < 3) {
+			/* do nothing */
+		}
+#if defined(USE_TESSFACE_SPEEDUP) && defined(USE_TESSFACE_QUADS)
+		else if (mp->totloop == 4) {
+			mface_index++;
+		}
+#endif
+		else {
+			mface_index += mp->totloop - 2;
+		}
 	}
 
 	CustomData_free(fdata, totface);
 	totface = mface_index;
 
-	BLI_assert(totface <= looptris_tot);
+	BLI_assert(totface <= poly_to_tri_count(totpoly, totloop));
 
-	/* not essential but without this we store over-alloc'd memory in the CustomData layers */
-	if (LIKELY(looptris_tot != totface)) {
-		mface = MEM_reallocN(mface, sizeof(*mface) * (size_t)totface);
-		mface_to_poly_map = MEM_reallocN(mface_to_poly_map, sizeof(*mface_to_poly_map) * (size_t)totface);
-	}
+	/* take care. we are _not_ calloc'ing so be sure to initialize each field */
+	mface_to_poly_map = MEM_mallocN(sizeof(*mface_to_poly_map) * (size_t)totface, __func__);
+	mface             = MEM_mallocN(sizeof(*mface) *             (size_t)totface, __func__);
+	lindices          = MEM_mallocN(sizeof(*lindices) *          (size_t)totface, __func__);
+
+	data.mvert = mvert;
+	data.mpoly = mpoly;
+	data.mloop = CustomData_get_layer(ldata, CD_MLOOP);
+	data.mface = mface;
+	data.mface_to_poly_map = mface_to_poly_map;
+	data.lindices = lindices;
+	data.poly_mface_start = poly_mface_start;
+
+	/* n-gons take much longer than quads and tris, schedule dynamically */
+	BLI_task_parallel_range_ex(
+	        0, totpoly, &data, NULL, 0, mesh_recalc_tessellation_poly_task, NULL,
+	        totloop > BKE_MESH_OMP_LIMIT, true);
+
+	MEM_freeN(poly_mface_start);
 
 	CustomData_add_layer(fdata, CD_MFACE, CD_ASSIGN, mface, totface);
 
@@ -1634,6 +1707,7 @@ int BKE_mesh_recalc_tessellation(CustomData *fdata, CustomData *ldata, CustomDat
 	MEM_freeN(lindices);
 
 	return totface;
+}
 
 #undef USE_TESSFACE_SPEEDUP
 #undef USE_TESSFACE_QUADS
@@ -1641,8 +1715,6 @@ int BKE_mesh_recalc_tessellation(CustomData *fdata, CustomData *ldata, CustomDat
 #undef ML_TO_MF
 #undef ML_TO_MF_QUAD
 
-}
-
 #ifdef USE_BMESH_SAVE_AS_COMPAT
 
 /**
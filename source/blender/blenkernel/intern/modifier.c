@@ -48,6 +48,8 @@
 #include "DNA_armature_types.h"
 #include "DNA_object_types.h"
 #include "DNA_meshdata_types.h"
+#include "DNA_sdna_types.h"
+#include "DNA_genfile.h"
 
 #include "BLI_utildefines.h"
 #include "BLI_path_util.h"
@@ -71,6 +73,84 @@
 static ModifierTypeInfo *modifier_types[NUM_MODIFIER_TYPES] = {NULL};
 static VirtualModifierData virtualModifierCommonData;
 
+/* settings of each modifier type, -1 ranges when they couldn't be found (too many pointers) */
+#define MODIFIER_SETTINGS_RANGES_MAX 32
+static ModifierSettingsRange modifier_settings_ranges[NUM_MODIFIER_TYPES][MODIFIER_SETTINGS_RANGES_MAX];
+static int modifier_settings_totrange[NUM_MODIFIER_TYPES];
+
+/* add the non pointer members of the struct from \a offset on, returns the end of the struct */
+static int modifier_settings_ranges_add(SDNA *sdna, const int struct_nr, int offset, const bool skip_header,
+                                        ModifierSettingsRange *ranges, int *r_totrange)
+{
+	const short *sp = sdna->structs[struct_nr];
+	const int totmember = sp[1];
+	int i, j;
+
+	for (i = 0, sp += 2; i < totmember; i++, sp += 2) {
+		const char *name = sdna->names[sp[1]];
+		const int arraylen = DNA_elem_array_size(name);
+		const int struct_member_nr = DNA_struct_find_nr(sdna, sdna->types[sp[0]]);
+
+		if (name[0] == '*' || name[1] == '*') {
+			/* pointers and function pointers */
+			offset += sdna->pointerlen * arraylen;
+		}
+		else if (i == 0 && skip_header) {
+			offset += sdna->typelens[sp[0]] * arraylen;
+		}
+		else if (struct_member_nr != -1) {
+			for (j = 0; j < arraylen; j++) {
+				offset = modifier_settings_ranges_add(sdna, struct_member_nr, offset, false, ranges, r_totrange);
+			}
+		}
+		else {
+			const int size = sdna->typelens[sp[0]] * arraylen;
+
+			if (*r_totrange > 0 && *r_totrange <= MODIFIER_SETTINGS_RANGES_MAX &&
+			    ranges[*r_totrange - 1].offset + ranges[*r_totrange - 1].size == offset)
+			{
+				ranges[*r_totrange - 1].size += (unsigned short)size;
+			}
+			else {
+				if (*r_totrange < MODIFIER_SETTINGS_RANGES_MAX) {
+					ranges[*r_totrange].offset = (unsigned short)offset;
+					ranges[*r_totrange].size = (unsigned short)size;
+				}
+				(*r_totrange)++;
+			}
+			offset += size;
+		}
+	}
+
+	return offset;
+}
+
+/* find the settings from the DNA of the running blender, so they can be compared without
+ * knowing about every modifier type */
+static void modifier_settings_ranges_init(void)
+{
+	SDNA *sdna = DNA_sdna_from_data(DNAstr, DNAlen, false);
+	int type;
+
+	for (type = 0; type < NUM_MODIFIER_TYPES; type++) {
+		ModifierTypeInfo *mti = modifierType_getInfo(type);
+		int struct_nr, size, totrange = 0;
+
+		modifier_settings_totrange[type] = -1;
+
+		if (mti == NULL || (struct_nr = DNA_struct_find_nr(sdna, mti->structName)) == -1)
+			continue;
+
+		size = modifier_settings_ranges_add(sdna, struct_nr, 0, true, modifier_settings_ranges[type], &totrange);
+
+		BLI_assert(size == mti->structSize);
+		if (size == mti->structSize && totrange <= MODIFIER_SETTINGS_RANGES_MAX)
+			modifier_settings_totrange[type] = totrange;
+	}
+
+	DNA_sdna_free(sdna);
+}
+
 void BKE_modifier_init(void)
 {
 	ModifierData *md;
@@ -99,6 +179,8 @@ void BKE_modifier_init(void)
 	virtualModifierCommonData.cmd.modifier.mode |= eModifierMode_Virtual;
 	virtualModifierCommonData.lmd.modifier.mode |= eModifierMode_Virtual;
 	virtualModifierCommonData.smd.modifier.mode |= eModifierMode_Virtual;
+
+	modifier_settings_ranges_init();
 }
 
 ModifierTypeInfo *modifierType_getInfo(ModifierType type)
@@ -112,6 +194,18 @@ ModifierTypeInfo *modifierType_getInfo(ModifierType type)
 	}
 }
 
+/**
+ * Byte ranges of the settings of the modifier: the members of its struct after the
+ * ModifierData header which aren't pointers (to ID's, bound data or runtime caches).
+ *
+ * \return the number of ranges or -1 when unknown.
+ */
+int modifier_settingsRanges(const ModifierData *md, const ModifierSettingsRange **r_ranges)
+{
+	*r_ranges = modifier_settings_ranges[md->type];
+	return modifier_settings_totrange[md->type];
+}
+
 /***/
 
 ModifierData *modifier_new(int type)
@@ -196,6 +196,7 @@ void BKE_object_free_modifiers(Object *ob)
 	while ((md = BLI_pophead(&ob->modifiers))) {
 		modifier_free(md);
 	}
+	mesh_modifier_cache_free(ob);
 
 	/* particle modifiers were freed, so free the particlesystems as well */
 	BKE_object_free_particlesystems(ob);
@@ -413,6 +414,7 @@ void BKE_object_free_ex(Object *ob, bool do_id_user)
 			free_path(ob->curve_cache->path);
 		MEM_freeN(ob->curve_cache);
 	}
+	mesh_modifier_cache_free(ob);
 }
 
 void BKE_object_free(Object *ob)
@@ -1516,6 +1518,7 @@ Object *BKE_object_copy_ex(Main *bmain, Object *ob, bool copy_caches)
 
 	/* Copy runtime surve data. */
 	obn->curve_cache = NULL;
+	obn->modifier_cache = NULL;
 
 	return obn;
 }
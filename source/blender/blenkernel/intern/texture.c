@@ -40,6 +40,7 @@
 #include "BLI_blenlib.h"
 #include "BLI_math.h"
 #include "BLI_kdopbvh.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_math_color.h"
 
@@ -1626,17 +1627,13 @@ bool BKE_texture_dependsOnTime(const struct Tex *texture)
 
 /* ------------------------------------------------------------------------- */
 
-void BKE_texture_get_value(Scene *scene, Tex *texture, float *tex_co, TexResult *texres, bool use_color_management)
+static void texture_get_value_ex(
+        Tex *texture, float *tex_co, TexResult *texres, struct ImagePool *pool, bool do_color_manage)
 {
 	int result_type;
-	bool do_color_manage = false;
-
-	if (scene && use_color_management) {
-		do_color_manage = BKE_scene_check_color_management_enabled(scene);
-	}
 
 	/* no node textures for now */
-	result_type = multitex_ext_safe(texture, tex_co, texres, NULL, do_color_manage);
+	result_type = multitex_ext_safe(texture, tex_co, texres, pool, do_color_manage);
 
 	/* if the texture gave an RGB value, we assume it didn't give a valid
 	 * intensity, since this is in the context of modifiers don't use perceptual color conversion.
@@ -1649,3 +1646,63 @@ void BKE_texture_get_value(Scene *scene, Tex *texture, float *tex_co, TexResult
 		copy_v3_fl(&texres->tr, texres->tin);
 	}
 }
+
+void BKE_texture_get_value(Scene *scene, Tex *texture, float *tex_co, TexResult *texres, bool use_color_management)
+{
+	bool do_color_manage = false;
+
+	if (scene && use_color_management) {
+		do_color_manage = BKE_scene_check_color_management_enabled(scene);
+	}
+
+	texture_get_value_ex(texture, tex_co, texres, NULL, do_color_manage);
+}
+
+/* below this many samples threading isn't worth it */
+#define TEXTURE_THREAD_MIN 1000
+
+typedef struct TextureGetValuesData {
+	Tex *texture;
+	float (*tex_co)[3];
+	TexResult *texres;
+	struct ImagePool *pool;
+	bool do_color_manage;
+} TextureGetValuesData;
+
+static void texture_get_values_cb(void *userdata, const int i)
+{
+	TextureGetValuesData *data = userdata;
+	TexResult *texres = &data->texres[i];
+
+	texres->nor = NULL;
+	texture_get_value_ex(data->texture, data->tex_co[i], texres, data->pool, data->do_color_manage);
+}
+
+/**
+ * Same as #BKE_texture_get_value for an array of coordinates, sampled in parallel.
+ * Image buffers are acquired once for all samples.
+ */
+void BKE_texture_get_values(
+        Scene *scene, Tex *texture, float (*tex_co)[3], TexResult *r_texres, const int num,
+        bool use_color_management)
+{
+	TextureGetValuesData data;
+	const char use_nodes = texture->use_nodes;
+
+	data.texture = texture;
+	data.tex_co = tex_co;
+	data.texres = r_texres;
+	data.pool = BKE_image_pool_new();
+	data.do_color_manage = (scene && use_color_management) ?
+	                       BKE_scene_check_color_management_enabled(scene) : false;
+
+	/* multitex_ext_safe disables nodes around every sample, from several threads
+	 * that could leave them disabled, so do it once here */
+	texture->use_nodes = false;
+
+	BLI_task_parallel_range(0, num, &data, texture_get_values_cb, num > TEXTURE_THREAD_MIN);
+
+	texture->use_nodes = use_nodes;
+
+	BKE_image_pool_free(data.pool);
+}
@@ -105,6 +105,11 @@ int BLI_bvhtree_find_nearest(BVHTree *tree, const float co[3], BVHTreeNearest *n
 int BLI_bvhtree_ray_cast(BVHTree *tree, const float co[3], const float dir[3], float radius, BVHTreeRayHit *hit,
                          BVHTree_RayCastCallback callback, void *userdata);
 
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree, const float (*co)[3], const float (*dir)[3], const int totray,
+                                float radius, BVHTreeRayHit *hits,
+                                BVHTree_RayCastCallback callback, void *userdata,
+                                const bool use_threading);
+
 float BLI_bvhtree_bb_raycast(const float bv[6], const float light_start[3], const float light_end[3], float pos[3]);
 
 /* range query */
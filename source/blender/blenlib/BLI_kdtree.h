@@ -69,4 +69,18 @@ int BLI_kdtree_range_search__normal(
         KDTreeNearest **r_nearest,
         float range) ATTR_NONNULL(1, 2, 4) ATTR_WARN_UNUSED_RESULT;
 
+void BLI_kdtree_range_search_cb(
+        KDTree *tree, const float co[3], float range,
+        bool (*search_cb)(void *user_data, int index, const float co[3], float dist_sq),
+        void *user_data) ATTR_NONNULL(1, 2, 4);
+
+/* batched queries, for many points at once */
+void BLI_kdtree_find_nearest_batch(
+        KDTree *tree, const float (*co)[3], const int totco,
+        KDTreeNearest *r_nearest, const bool use_threading) ATTR_NONNULL(1, 2, 4);
+void BLI_kdtree_find_nearest_n_batch(
+        KDTree *tree, const float (*co)[3], const int totco,
+        KDTreeNearest *r_nearest, int *r_found, unsigned int n,
+        const bool use_threading) ATTR_NONNULL(1, 2, 4, 5);
+
 #endif  /* __BLI_KDTREE_H__ */
@@ -62,6 +62,17 @@ void               *BLI_memarena_calloc(struct MemArena *ma, size_t size) ATTR_W
 
 void BLI_memarena_clear(MemArena *ma) ATTR_NONNULL(1);
 
+/* Position in an arena to roll back to, freeing everything allocated since.
+ * Marks must be rolled back in reverse order, like a stack. */
+typedef struct MemArenaMark {
+	struct LinkNode *bufs;
+	unsigned char *curbuf;
+	size_t cursize;
+} MemArenaMark;
+
+void BLI_memarena_mark(MemArena *ma, MemArenaMark *r_mark) ATTR_NONNULL(1, 2);
+void BLI_memarena_rollback(MemArena *ma, const MemArenaMark *mark) ATTR_NONNULL(1, 2);
+
 #ifdef __cplusplus
 }
 #endif
@@ -83,6 +83,11 @@ typedef struct BLI_mempool_iter {
 enum {
 	BLI_MEMPOOL_NOP = 0,
 	BLI_MEMPOOL_ALLOW_ITER = (1 << 0),
+	/* #BLI_mempool_alloc, #BLI_mempool_calloc and #BLI_mempool_free may be called
+	 * from multiple threads at once, each thread keeps its own cache of free elements.
+	 * all other functions still need exclusive access to the pool.
+	 * Freeing all elements doesn't release any chunks, only clearing the pool does. */
+	BLI_MEMPOOL_THREADSAFE = (1 << 1),
 };
 
 void  BLI_mempool_iternew(BLI_mempool *pool, BLI_mempool_iter *iter) ATTR_NONNULL();
@@ -48,4 +48,11 @@ __attribute__((nonnull(1, 5)))
 #endif
 ;
 
+/* Stable sorting, multi-threaded for large arrays (sort_parallel.c) */
+void BLI_mergesort_r(void *a, size_t n, size_t es, BLI_sort_cmp_t cmp, void *thunk);
+
+void BLI_radixsort_uint(unsigned int *keys, int *values, const size_t n);
+void BLI_radixsort_int(int *keys, int *values, const size_t n);
+void BLI_radixsort_float(float *keys, int *values, const size_t n);
+
 #endif  /* __BLI_SORT_H__ */
@@ -100,6 +100,41 @@ ThreadMutex *BLI_task_pool_user_mutex(TaskPool *pool);
 /* number of tasks done, for stats, don't use this to make decisions */
 size_t BLI_task_pool_tasks_done(TaskPool *pool);
 
+/* Parallel for routines
+ *
+ * Call a function for every index in the range [start, stop), using the threads
+ * of the global task scheduler (BLI_task_scheduler_get). The range is split in
+ * chunks which are handed out to the threads as they become available.
+ *
+ * Every task works on its own copy of userdata_chunk, which can be used for
+ * scratch memory or to accumulate partial results. Once all iterations are done,
+ * func_finalize is called for each copy from the calling thread, to reduce them
+ * into userdata.
+ *
+ * With use_dynamic_scheduling, smaller chunks are used, which balances the load
+ * better when iterations differ a lot in cost, at the price of more locking.
+ * With use_threading false everything runs in the calling thread, callers
+ * typically pass a threshold on the number of iterations here. */
+
+typedef void (*TaskParallelRangeFunc)(void *userdata, const int iter);
+typedef void (*TaskParallelRangeFuncEx)(void *userdata, void *userdata_chunk, const int iter, const int thread_id);
+typedef void (*TaskParallelRangeFuncFinalize)(void *userdata, void *userdata_chunk);
+
+void BLI_task_parallel_range_ex(
+        int start, int stop,
+        void *userdata,
+        void *userdata_chunk,
+        const size_t userdata_chunk_size,
+        TaskParallelRangeFuncEx func_ex,
+        TaskParallelRangeFuncFinalize func_finalize,
+        const bool use_threading,
+        const bool use_dynamic_scheduling);
+void BLI_task_parallel_range(
+        int start, int stop,
+        void *userdata,
+        TaskParallelRangeFunc func,
+        const bool use_threading);
+
 #ifdef __cplusplus
 }
 #endif
@@ -45,6 +45,7 @@ extern "C" {
 #define BLENDER_MAX_THREADS     64
 
 struct ListBase;
+struct MemArena;
 struct TaskScheduler;
 
 /* Threading API */
@@ -69,6 +70,12 @@ int     BLI_thread_is_main(void);
 void BLI_begin_threaded_malloc(void);
 void BLI_end_threaded_malloc(void);
 
+/* Scratch memory arena owned by the calling thread, for temporary allocations
+ * in task callbacks. Use BLI_memarena_mark/rollback around each use, so the
+ * memory is reused instead of freed, and don't change the arena settings. */
+
+struct MemArena *BLI_thread_scratch_arena(void);
+
 /* System Information */
 
 int     BLI_system_thread_count(void); /* gets the number of threads the system can make use of */
@@ -161,6 +168,25 @@ void BLI_condition_notify_one(ThreadCondition *cond);
 void BLI_condition_notify_all(ThreadCondition *cond);
 void BLI_condition_end(ThreadCondition *cond);
 
+/* LockfreeQueue
+ *
+ * Bounded lock-free multiple producer, multiple consumer queue of pointers,
+ * size is rounded up to a power of two. Blocking push/pop only take a lock
+ * when they have to wait. */
+
+typedef struct LockfreeQueue LockfreeQueue;
+
+LockfreeQueue *BLI_lockfree_queue_init(unsigned int size);
+void BLI_lockfree_queue_free(LockfreeQueue *queue);
+
+bool BLI_lockfree_queue_try_push(LockfreeQueue *queue, void *work);
+bool BLI_lockfree_queue_try_pop(LockfreeQueue *queue, void **r_work);
+void BLI_lockfree_queue_push(LockfreeQueue *queue, void *work);
+bool BLI_lockfree_queue_pop(LockfreeQueue *queue, void **r_work, int timeout_ms);
+unsigned int BLI_lockfree_queue_size(LockfreeQueue *queue);
+
+void BLI_lockfree_queue_nowait(LockfreeQueue *queue);
+
 /* ThreadWorkQueue
  *
  * Thread-safe work queue to push work/pointers between threads. */
@@ -37,12 +37,17 @@
 #include "BLI_stack.h"
 #include "BLI_kdopbvh.h"
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_strict_flags.h"
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+#ifdef __SSE__
+#  include <xmmintrin.h>
+#endif
+
 #define MAX_TREETYPE 32
 
 /* Setting zero so we can catch bugs in OpenMP/KDOPBVH.
@@ -56,6 +61,17 @@
 #  endif
 #endif
 
+/* Same as KDOPBVH_OMP_LIMIT, for queries run with the task scheduler. */
+#ifdef DEBUG
+#  define KDOPBVH_THREAD_LEAF_THRESHOLD 0
+#else
+#  define KDOPBVH_THREAD_LEAF_THRESHOLD 1024
+#endif
+
+/* Split the overlap traversal into at least this many node pairs per thread,
+ * so threads which finish early can pick up more work. */
+#define KDOPBVH_OVERLAP_PAIRS_PER_THREAD 8
+
 typedef unsigned char axis_t;
 
 typedef struct BVHNode {
@@ -93,6 +109,12 @@ typedef struct BVHOverlapData {
 	axis_t start_axis, stop_axis;
 } BVHOverlapData;
 
+/* A pair of nodes to traverse, and where to store the overlaps found below them. */
+typedef struct BVHOverlapPair {
+	BVHOverlapData data;
+	BVHNode *node1, *node2;
+} BVHOverlapPair;
+
 typedef struct BVHNearestData {
 	BVHTree *tree;
 	const float *co;
@@ -1021,17 +1043,32 @@ float BLI_bvhtree_getepsilon(const BVHTree *tree)
 /**
  * overlap - is it possible for 2 bv's to collide ?
  */
-static int tree_overlap(BVHNode *node1, BVHNode *node2, axis_t start_axis, axis_t stop_axis)
+static int tree_overlap(const BVHNode *node1, const BVHNode *node2, axis_t start_axis, axis_t stop_axis)
 {
-	const float *bv1 = node1->bv;
-	const float *bv2 = node2->bv;
+	const float *bv1 = node1->bv + (start_axis << 1);
+	const float *bv2 = node2->bv + (start_axis << 1);
+	const float *bv1_end = node1->bv + (stop_axis << 1);
 
-	const float *bv1_end = bv1 + (stop_axis << 1);
-		
-	bv1 += start_axis << 1;
-	bv2 += start_axis << 1;
-	
-	/* test all axis if min + max overlap */
+#ifdef __SSE__
+	{
+		/* test two axis at once: negating the max values turns (max1 < min2) into (-max1 > -min2),
+		 * so all four lanes can be compared with a single 'greater than' */
+		const __m128 sign = _mm_set_ps(-1.0f, 1.0f, -1.0f, 1.0f);
+
+		for (; bv1_end - bv1 >= 4; bv1 += 4, bv2 += 4) {
+			const __m128 a = _mm_mul_ps(_mm_loadu_ps(bv1), sign);
+			__m128 b = _mm_loadu_ps(bv2);
+			/* swap min/max of each axis: (max2, min2, max2, min2) */
+			b = _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1)), sign);
+
+			if (_mm_movemask_ps(_mm_cmpgt_ps(a, b))) {
+				return 0;
+			}
+		}
+	}
+#endif
+
+	/* test all (remaining) axis if min + max overlap */
 	for (; bv1 != bv1_end; bv1 += 2, bv2 += 2) {
 		if ((*(bv1) > *(bv2 + 1)) || (*(bv2) > *(bv1 + 1)))
 			return 0;
@@ -1077,12 +1114,81 @@ static void traverse(BVHOverlapData *data, BVHNode *node1, BVHNode *node2)
 	return;
 }
 
+/**
+ * Descend both trees the same way #traverse does, until there are at least \a totpair_min
+ * overlapping node pairs (or only leafs are left), so every pair can be traversed by its own task.
+ *
+ * Pairs are kept in traversal order, so the overlaps end up in the same order on every run.
+ */
+static BVHOverlapPair *overlap_pairs_split(
+        const BVHOverlapData *data, BVHNode *root1, BVHNode *root2,
+        const int totpair_min, int *r_totpair)
+{
+	const int tree_type = max_ii(data->tree1->tree_type, data->tree2->tree_type);
+	BVHOverlapPair *pairs = MEM_mallocN(sizeof(*pairs), __func__);
+	int totpair = 1;
+	bool is_split = true;
+
+	pairs[0].node1 = root1;
+	pairs[0].node2 = root2;
+
+	while ((totpair < totpair_min) && is_split) {
+		BVHOverlapPair *pairs_next = MEM_mallocN(sizeof(*pairs) * (size_t)(totpair * tree_type), __func__);
+		int totpair_next = 0;
+		int i, j;
+
+		is_split = false;
+
+		for (i = 0; i < totpair; i++) {
+			BVHNode *node1 = pairs[i].node1;
+			BVHNode *node2 = pairs[i].node2;
+
+			if (!node1->totnode && !node2->totnode) {
+				pairs_next[totpair_next++] = pairs[i];
+			}
+			else {
+				for (j = 0; j < data->tree2->tree_type; j++) {
+					BVHNode *child = node1->totnode ? node1->children[j] : node2->children[j];
+
+					if (child) {
+						BVHNode *child1 = node1->totnode ? child : node1;
+						BVHNode *child2 = node1->totnode ? node2 : child;
+
+						if (tree_overlap(child1, child2, data->start_axis, data->stop_axis)) {
+							pairs_next[totpair_next].node1 = child1;
+							pairs_next[totpair_next].node2 = child2;
+							totpair_next++;
+						}
+					}
+				}
+				is_split = true;
+			}
+		}
+
+		MEM_freeN(pairs);
+		pairs = pairs_next;
+		totpair = totpair_next;
+	}
+
+	*r_totpair = totpair;
+	return pairs;
+}
+
+static void bvhtree_overlap_task_cb(void *userdata, void *UNUSED(userdata_chunk), const int i, const int UNUSED(thread_id))
+{
+	BVHOverlapPair *pair = &((BVHOverlapPair *)userdata)[i];
+	traverse(&pair->data, pair->node1, pair->node2);
+}
+
 BVHTreeOverlap *BLI_bvhtree_overlap(BVHTree *tree1, BVHTree *tree2, unsigned int *r_overlap_tot)
 {
+	const bool use_threading = (tree1->totleaf > KDOPBVH_THREAD_LEAF_THRESHOLD);
 	int j;
+	int totpair;
 	size_t total = 0;
 	BVHTreeOverlap *overlap = NULL, *to = NULL;
-	BVHOverlapData **data;
+	BVHOverlapData data;
+	BVHOverlapPair *pairs;
 	
 	/* check for compatibility of both trees (can't compare 14-DOP with 18-DOP) */
 	if (UNLIKELY((tree1->axis != tree2->axis) &&
@@ -1101,40 +1207,47 @@ BVHTreeOverlap *BLI_bvhtree_overlap(BVHTree *tree1, BVHTree *tree2, unsigned int
 		return NULL;
 	}
 
-	data = MEM_mallocN(sizeof(BVHOverlapData *) * tree1->tree_type, "BVHOverlapData_star");
-	
-	for (j = 0; j < tree1->tree_type; j++) {
-		data[j] = MEM_mallocN(sizeof(BVHOverlapData), "BVHOverlapData");
-		
-		/* init BVHOverlapData */
-		data[j]->overlap = BLI_stack_new(sizeof(BVHTreeOverlap), __func__);
-		data[j]->tree1 = tree1;
-		data[j]->tree2 = tree2;
-		data[j]->start_axis = min_axis(tree1->start_axis, tree2->start_axis);
-		data[j]->stop_axis  = min_axis(tree1->stop_axis,  tree2->stop_axis);
+	data.overlap = NULL;
+	data.tree1 = tree1;
+	data.tree2 = tree2;
+	data.start_axis = min_axis(tree1->start_axis, tree2->start_axis);
+	data.stop_axis  = min_axis(tree1->stop_axis,  tree2->stop_axis);
+
+	if (use_threading) {
+		const int totpair_min = BLI_task_scheduler_num_threads(BLI_task_scheduler_get()) * KDOPBVH_OVERLAP_PAIRS_PER_THREAD;
+		pairs = overlap_pairs_split(&data, tree1->nodes[tree1->totleaf], tree2->nodes[tree2->totleaf],
+		                            totpair_min, &totpair);
+	}
+	else {
+		pairs = MEM_mallocN(sizeof(*pairs), __func__);
+		pairs[0].node1 = tree1->nodes[tree1->totleaf];
+		pairs[0].node2 = tree2->nodes[tree2->totleaf];
+		totpair = 1;
 	}
 
-#pragma omp parallel for private(j) schedule(static)  if (tree1->totleaf > KDOPBVH_OMP_LIMIT)
-	for (j = 0; j < MIN2(tree1->tree_type, tree1->nodes[tree1->totleaf]->totnode); j++) {
-		traverse(data[j], tree1->nodes[tree1->totleaf]->children[j], tree2->nodes[tree2->totleaf]);
+	for (j = 0; j < totpair; j++) {
+		pairs[j].data = data;
+		/* many small stacks, keep the chunks small too */
+		pairs[j].data.overlap = BLI_stack_new_ex(sizeof(BVHTreeOverlap), __func__, 1 << 12);
 	}
+
+	/* pairs differ a lot in how much of the trees they cover, use dynamic scheduling */
+	BLI_task_parallel_range_ex(0, totpair, pairs, NULL, 0, bvhtree_overlap_task_cb, NULL,
+	                           use_threading, true);
 	
-	for (j = 0; j < tree1->tree_type; j++)
-		total += BLI_stack_count(data[j]->overlap);
+	for (j = 0; j < totpair; j++)
+		total += BLI_stack_count(pairs[j].data.overlap);
 	
 	to = overlap = MEM_mallocN(sizeof(BVHTreeOverlap) * total, "BVHTreeOverlap");
 	
-	for (j = 0; j < tree1->tree_type; j++) {
-		unsigned int count = (unsigned int)BLI_stack_count(data[j]->overlap);
-		BLI_stack_pop_n(data[j]->overlap, to, count);
-		BLI_stack_free(data[j]->overlap);
+	for (j = 0; j < totpair; j++) {
+		unsigned int count = (unsigned int)BLI_stack_count(pairs[j].data.overlap);
+		BLI_stack_pop_n(pairs[j].data.overlap, to, count);
+		BLI_stack_free(pairs[j].data.overlap);
 		to += count;
 	}
 	
-	for (j = 0; j < tree1->tree_type; j++) {
-		MEM_freeN(data[j]);
-	}
-	MEM_freeN(data);
+	MEM_freeN(pairs);
 	
 	*r_overlap_tot = (unsigned int)total;
 	return overlap;
@@ -1539,6 +1652,49 @@ int BLI_bvhtree_ray_cast(BVHTree *tree, const float co[3], const float dir[3], f
 	return data.hit.index;
 }
 
+typedef struct BVHRayCastBatchData {
+	BVHTree *tree;
+	const float (*co)[3];
+	const float (*dir)[3];
+	float radius;
+	BVHTreeRayHit *hits;
+	BVHTree_RayCastCallback callback;
+	void *userdata;
+} BVHRayCastBatchData;
+
+static void bvhtree_ray_cast_batch_task_cb(void *userdata, const int i)
+{
+	BVHRayCastBatchData *data = userdata;
+	BLI_bvhtree_ray_cast(data->tree, data->co[i], data->dir[i], data->radius, &data->hits[i],
+	                     data->callback, data->userdata);
+}
+
+/**
+ * Cast many rays against the same tree at once, optionally from multiple threads.
+ *
+ * \param hits  Array of \a totray hits, each one initialized the same as
+ * the \a hit argument of #BLI_bvhtree_ray_cast (index -1 and the maximum distance to search).
+ * \note \a callback must be thread-safe when \a use_threading is set.
+ */
+void BLI_bvhtree_ray_cast_batch(BVHTree *tree, const float (*co)[3], const float (*dir)[3], const int totray,
+                                float radius, BVHTreeRayHit *hits,
+                                BVHTree_RayCastCallback callback, void *userdata,
+                                const bool use_threading)
+{
+	BVHRayCastBatchData data;
+
+	data.tree = tree;
+	data.co = co;
+	data.dir = dir;
+	data.radius = radius;
+	data.hits = hits;
+	data.callback = callback;
+	data.userdata = userdata;
+
+	BLI_task_parallel_range(0, totray, &data, bvhtree_ray_cast_batch_task_cb,
+	                        use_threading && (totray > KDOPBVH_THREAD_LEAF_THRESHOLD));
+}
+
 float BLI_bvhtree_bb_raycast(const float bv[6], const float light_start[3], const float light_end[3], float pos[3])
 {
 	BVHRayCastData data;
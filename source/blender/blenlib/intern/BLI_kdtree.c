@@ -29,6 +29,7 @@
 
 #include "BLI_math.h"
 #include "BLI_kdtree.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 #include "BLI_strict_flags.h"
 
@@ -50,10 +51,16 @@ struct KDTree {
 #endif
 };
 
-#define KD_STACK_INIT 100      /* initial size for array (on the stack) */
-#define KD_NEAR_ALLOC_INC 100  /* alloc increment for collecting nearest */
+/* Size of the traversal stack (on the stack), balancing splits at the median
+ * so the tree depth is at most 32, every level adds one pending node at most. */
+#define KD_STACK_SIZE 64
 #define KD_FOUND_ALLOC_INC 50  /* alloc increment for collecting nearest */
 
+/* balance sub-trees larger than this in their own task */
+#define KD_BALANCE_TASK_MIN 10000
+/* use threads for batched queries with more points than this */
+#define KD_BATCH_THREAD_MIN 1000
+
 /**
  * Creates or free a kdtree
  */
@@ -106,17 +113,17 @@ void BLI_kdtree_insert(KDTree *tree, int index, const float co[3])
 #endif
 }
 
-static KDTreeNode *kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsigned int axis)
+/**
+ * Move the median node along \a axis to the middle of \a nodes,
+ * with all nodes before it smaller and all nodes after it larger.
+ *
+ * \return The index of the median.
+ */
+static unsigned int kdtree_balance_partition(KDTreeNode *nodes, unsigned int totnode, unsigned int axis)
 {
-	KDTreeNode *node;
 	float co;
 	unsigned int left, right, median, i, j;
 
-	if (totnode <= 0)
-		return NULL;
-	else if (totnode == 1)
-		return nodes;
-	
 	/* quicksort style sorting around median */
 	left = 0;
 	right = totnode - 1;
@@ -144,6 +151,21 @@ static KDTreeNode *kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsig
 			left = i + 1;
 	}
 
+	return median;
+}
+
+static KDTreeNode *kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsigned int axis)
+{
+	KDTreeNode *node;
+	unsigned int median;
+
+	if (totnode <= 0)
+		return NULL;
+	else if (totnode == 1)
+		return nodes;
+
+	median = kdtree_balance_partition(nodes, totnode, axis);
+
 	/* set node and sort subnodes */
 	node = &nodes[median];
 	node->d = axis;
@@ -153,9 +175,70 @@ static KDTreeNode *kdtree_balance(KDTreeNode *nodes, unsigned int totnode, unsig
 	return node;
 }
 
+typedef struct KDTreeBalanceTask {
+	KDTreeNode *nodes;
+	unsigned int totnode;
+	unsigned int axis;
+	KDTreeNode **r_node;  /* where to store the root of this sub-tree */
+} KDTreeBalanceTask;
+
+static void kdtree_balance_task_push(TaskPool *pool, KDTreeNode *nodes, unsigned int totnode, unsigned int axis,
+                                     KDTreeNode **r_node);
+
+/**
+ * Same as #kdtree_balance, both halves of \a nodes are independent once partitioned,
+ * so large halves are balanced by their own task.
+ */
+static void kdtree_balance_task_cb(TaskPool *pool, void *taskdata, int UNUSED(threadid))
+{
+	KDTreeBalanceTask *task = taskdata;
+	KDTreeNode *nodes = task->nodes;
+	const unsigned int totnode = task->totnode;
+	const unsigned int axis_next = (task->axis + 1) % 3;
+	KDTreeNode *node;
+	unsigned int median;
+
+	median = kdtree_balance_partition(nodes, totnode, task->axis);
+
+	node = &nodes[median];
+	node->d = task->axis;
+	*task->r_node = node;
+
+	kdtree_balance_task_push(pool, nodes, median, axis_next, &node->left);
+	kdtree_balance_task_push(pool, nodes + median + 1, totnode - (median + 1), axis_next, &node->right);
+}
+
+static void kdtree_balance_task_push(TaskPool *pool, KDTreeNode *nodes, unsigned int totnode, unsigned int axis,
+                                     KDTreeNode **r_node)
+{
+	if (totnode > KD_BALANCE_TASK_MIN) {
+		KDTreeBalanceTask *task = MEM_mallocN(sizeof(*task), __func__);
+
+		task->nodes = nodes;
+		task->totnode = totnode;
+		task->axis = axis;
+		task->r_node = r_node;
+
+		BLI_task_pool_push(pool, kdtree_balance_task_cb, task, true, TASK_PRIORITY_HIGH);
+	}
+	else {
+		*r_node = kdtree_balance(nodes, totnode, axis);
+	}
+}
+
 void BLI_kdtree_balance(KDTree *tree)
 {
-	tree->root = kdtree_balance(tree->nodes, tree->totnode, 0);
+	if (tree->totnode > KD_BALANCE_TASK_MIN) {
+		TaskPool *pool = BLI_task_pool_create(BLI_task_scheduler_get(), NULL);
+
+		kdtree_balance_task_push(pool, tree->nodes, tree->totnode, 0, &tree->root);
+
+		BLI_task_pool_work_and_wait(pool);
+		BLI_task_pool_free(pool);
+	}
+	else {
+		tree->root = kdtree_balance(tree->nodes, tree->totnode, 0);
+	}
 
 #ifdef DEBUG
 	tree->is_balanced = true;
@@ -180,17 +263,6 @@ static float squared_distance(const float v2[3], const float v1[3], const float
 	return dist;
 }
 
-static KDTreeNode **realloc_nodes(KDTreeNode **stack, unsigned int *totstack, const bool is_alloc)
-{
-	KDTreeNode **stack_new = MEM_mallocN((*totstack + KD_NEAR_ALLOC_INC) * sizeof(KDTreeNode *), "KDTree.treestack");
-	memcpy(stack_new, stack, *totstack * sizeof(KDTreeNode *));
-	// memset(stack_new + *totstack, 0, sizeof(KDTreeNode *) * KD_NEAR_ALLOC_INC);
-	if (is_alloc)
-		MEM_freeN(stack);
-	*totstack += KD_NEAR_ALLOC_INC;
-	return stack_new;
-}
-
 /**
  * Find nearest returns index, and -1 if no node is found.
  */
@@ -199,9 +271,9 @@ int BLI_kdtree_find_nearest(
         KDTreeNearest *r_nearest)
 {
 	KDTreeNode *root, *node, *min_node;
-	KDTreeNode **stack, *defaultstack[KD_STACK_INIT];
+	KDTreeNode *stack[KD_STACK_SIZE];
 	float min_dist, cur_dist;
-	unsigned int totstack, cur = 0;
+	unsigned int cur = 0;
 
 #ifdef DEBUG
 	BLI_assert(tree->is_balanced == true);
@@ -210,9 +282,6 @@ int BLI_kdtree_find_nearest(
 	if (UNLIKELY(!tree->root))
 		return -1;
 
-	stack = defaultstack;
-	totstack = KD_STACK_INIT;
-
 	root = tree->root;
 	min_node = root;
 	min_dist = len_squared_v3v3(root->co, co);
@@ -265,9 +334,7 @@ int BLI_kdtree_find_nearest(
 			if (node->left)
 				stack[cur++] = node->left;
 		}
-		if (UNLIKELY(cur + 3 > totstack)) {
-			stack = realloc_nodes(stack, &totstack, defaultstack != stack);
-		}
+		BLI_assert(cur <= KD_STACK_SIZE);
 	}
 
 	if (r_nearest) {
@@ -276,9 +343,6 @@ int BLI_kdtree_find_nearest(
 		copy_v3_v3(r_nearest->co, min_node->co);
 	}
 
-	if (stack != defaultstack)
-		MEM_freeN(stack);
-
 	return min_node->index;
 }
 
@@ -313,9 +377,9 @@ int BLI_kdtree_find_nearest_n__normal(
         unsigned int n)
 {
 	KDTreeNode *root, *node = NULL;
-	KDTreeNode **stack, *defaultstack[KD_STACK_INIT];
+	KDTreeNode *stack[KD_STACK_SIZE];
 	float cur_dist;
-	unsigned int totstack, cur = 0;
+	unsigned int cur = 0;
 	unsigned int i, found = 0;
 
 #ifdef DEBUG
@@ -325,9 +389,6 @@ int BLI_kdtree_find_nearest_n__normal(
 	if (UNLIKELY(!tree->root || n == 0))
 		return 0;
 
-	stack = defaultstack;
-	totstack = KD_STACK_INIT;
-
 	root = tree->root;
 
 	cur_dist = squared_distance(root->co, co, nor);
@@ -380,17 +441,12 @@ int BLI_kdtree_find_nearest_n__normal(
 			if (node->left)
 				stack[cur++] = node->left;
 		}
-		if (UNLIKELY(cur + 3 > totstack)) {
-			stack = realloc_nodes(stack, &totstack, defaultstack != stack);
-		}
+		BLI_assert(cur <= KD_STACK_SIZE);
 	}
 
 	for (i = 0; i < found; i++)
 		r_nearest[i].dist = sqrtf(r_nearest[i].dist);
 
-	if (stack != defaultstack)
-		MEM_freeN(stack);
-
 	return (int)found;
 }
 
@@ -436,10 +492,10 @@ int BLI_kdtree_range_search__normal(
         KDTreeNearest **r_nearest, float range)
 {
 	KDTreeNode *root, *node = NULL;
-	KDTreeNode **stack, *defaultstack[KD_STACK_INIT];
+	KDTreeNode *stack[KD_STACK_SIZE];
 	KDTreeNearest *foundstack = NULL;
 	float range2 = range * range, dist2;
-	unsigned int totstack, cur = 0, found = 0, totfoundstack = 0;
+	unsigned int cur = 0, found = 0, totfoundstack = 0;
 
 #ifdef DEBUG
 	BLI_assert(tree->is_balanced == true);
@@ -448,9 +504,6 @@ int BLI_kdtree_range_search__normal(
 	if (UNLIKELY(!tree->root))
 		return 0;
 
-	stack = defaultstack;
-	totstack = KD_STACK_INIT;
-
 	root = tree->root;
 
 	if (co[root->d] + range < root->co[root->d]) {
@@ -494,14 +547,9 @@ int BLI_kdtree_range_search__normal(
 				stack[cur++] = node->right;
 		}
 
-		if (UNLIKELY(cur + 3 > totstack)) {
-			stack = realloc_nodes(stack, &totstack, defaultstack != stack);
-		}
+		BLI_assert(cur <= KD_STACK_SIZE);
 	}
 
-	if (stack != defaultstack)
-		MEM_freeN(stack);
-
 	if (found)
 		qsort(foundstack, found, sizeof(KDTreeNearest), range_compare);
 
@@ -509,3 +557,132 @@ int BLI_kdtree_range_search__normal(
 
 	return (int)found;
 }
+
+/**
+ * A version of #BLI_kdtree_range_search which runs a callback
+ * instead of allocating an array of results.
+ *
+ * \param search_cb  Called for every node found in \a range (in no particular order),
+ * \a dist_sq is the squared distance, return false to stop the search.
+ */
+void BLI_kdtree_range_search_cb(
+        KDTree *tree, const float co[3], float range,
+        bool (*search_cb)(void *user_data, int index, const float co[3], float dist_sq), void *user_data)
+{
+	KDTreeNode *node;
+	KDTreeNode *stack[KD_STACK_SIZE];
+	float range_sq = range * range, dist_sq;
+	unsigned int cur = 0;
+
+#ifdef DEBUG
+	BLI_assert(tree->is_balanced == true);
+#endif
+
+	if (UNLIKELY(!tree->root))
+		return;
+
+	stack[cur++] = tree->root;
+
+	while (cur--) {
+		node = stack[cur];
+
+		if (co[node->d] + range < node->co[node->d]) {
+			if (node->left)
+				stack[cur++] = node->left;
+		}
+		else if (co[node->d] - range > node->co[node->d]) {
+			if (node->right)
+				stack[cur++] = node->right;
+		}
+		else {
+			dist_sq = len_squared_v3v3(node->co, co);
+			if (dist_sq <= range_sq) {
+				if (search_cb(user_data, node->index, node->co, dist_sq) == false) {
+					break;
+				}
+			}
+
+			if (node->left)
+				stack[cur++] = node->left;
+			if (node->right)
+				stack[cur++] = node->right;
+		}
+
+		BLI_assert(cur <= KD_STACK_SIZE);
+	}
+}
+
+/* -------------------------------------------------------------------- */
+/** \name Batched Queries
+ *
+ * Look up many points with a single call, optionally using threads.
+ * \{ */
+
+typedef struct KDTreeBatchData {
+	KDTree *tree;
+	const float (*co)[3];
+	KDTreeNearest *r_nearest;
+	int *r_found;
+	unsigned int n;
+} KDTreeBatchData;
+
+static void kdtree_find_nearest_batch_cb(void *userdata, const int i)
+{
+	KDTreeBatchData *data = userdata;
+	if (BLI_kdtree_find_nearest(data->tree, data->co[i], &data->r_nearest[i]) == -1) {
+		data->r_nearest[i].index = -1;
+	}
+}
+
+static void kdtree_find_nearest_n_batch_cb(void *userdata, const int i)
+{
+	KDTreeBatchData *data = userdata;
+	data->r_found[i] = BLI_kdtree_find_nearest_n(
+	        data->tree, data->co[i], &data->r_nearest[(size_t)i * data->n], data->n);
+}
+
+/**
+ * Find the nearest node for each of \a totco points.
+ *
+ * \param r_nearest  An array of \a totco results,
+ * the index is -1 for points where nothing was found (empty tree).
+ */
+void BLI_kdtree_find_nearest_batch(
+        KDTree *tree, const float (*co)[3], const int totco,
+        KDTreeNearest *r_nearest, const bool use_threading)
+{
+	KDTreeBatchData data;
+
+	data.tree = tree;
+	data.co = co;
+	data.r_nearest = r_nearest;
+	data.r_found = NULL;
+	data.n = 1;
+
+	BLI_task_parallel_range(0, totco, &data, kdtree_find_nearest_batch_cb,
+	                        use_threading && (totco > KD_BATCH_THREAD_MIN));
+}
+
+/**
+ * Find the \a n nearest nodes for each of \a totco points.
+ *
+ * \param r_nearest  An array of \a totco * \a n results, \a n for every point.
+ * \param r_found  An array of \a totco, the number of results found for every point.
+ */
+void BLI_kdtree_find_nearest_n_batch(
+        KDTree *tree, const float (*co)[3], const int totco,
+        KDTreeNearest *r_nearest, int *r_found, unsigned int n, const bool use_threading)
+{
+	KDTreeBatchData data;
+
+	data.tree = tree;
+	data.co = co;
+	data.r_nearest = r_nearest;
+	data.r_found = r_found;
+	data.n = n;
+
+	BLI_task_parallel_range(0, totco, &data, kdtree_find_nearest_n_batch_cb,
+	                        use_threading && (totco > KD_BATCH_THREAD_MIN));
+}
+
+/** \} */
@@ -48,6 +48,8 @@ struct MemArena {
 	unsigned char *curbuf;
 	const char *name;
 	LinkNode *bufs;
+	/* buffers of 'bufsize' released by rollback, reused before allocating new ones */
+	LinkNode *bufs_free;
 
 	size_t bufsize, cursize;
 	size_t align;
@@ -88,6 +90,7 @@ void BLI_memarena_use_align(struct MemArena *ma, const size_t align)
 void BLI_memarena_free(MemArena *ma)
 {
 	BLI_linklist_freeN(ma->bufs);
+	BLI_linklist_freeN(ma->bufs_free);
 
 #ifdef WITH_MEM_VALGRIND
 	VALGRIND_DESTROY_MEMPOOL(ma);
@@ -125,8 +128,22 @@ void *BLI_memarena_alloc(MemArena *ma, size_t size)
 			ma->cursize = ma->bufsize;
 		}
 
-		ma->curbuf = (ma->use_calloc ? MEM_callocN : MEM_mallocN)(ma->cursize, ma->name);
-		BLI_linklist_prepend(&ma->bufs, ma->curbuf);
+		if (ma->bufs_free && ma->cursize == ma->bufsize) {
+			/* reuse a buffer released by rollback, including its list node */
+			LinkNode *node = ma->bufs_free;
+			ma->bufs_free = node->next;
+			node->next = ma->bufs;
+			ma->bufs = node;
+
+			ma->curbuf = node->link;
+			if (ma->use_calloc) {
+				memset(ma->curbuf, 0, ma->cursize);
+			}
+		}
+		else {
+			ma->curbuf = (ma->use_calloc ? MEM_callocN : MEM_mallocN)(ma->cursize, ma->name);
+			BLI_linklist_prepend(&ma->bufs, ma->curbuf);
+		}
 		memarena_curbuf_align(ma);
 	}
 
@@ -188,3 +205,48 @@ void BLI_memarena_clear(MemArena *ma)
 #endif
 
 }
+
+/**
+ * Store the current position of the arena in \a r_mark.
+ */
+void BLI_memarena_mark(MemArena *ma, MemArenaMark *r_mark)
+{
+	r_mark->bufs = ma->bufs;
+	r_mark->curbuf = ma->curbuf;
+	r_mark->cursize = ma->cursize;
+}
+
+/**
+ * Free all allocations made since \a mark was taken.
+ *
+ * Buffers allocated in the meantime are kept for reuse,
+ * so code doing the same work over and over reaches a state where it doesn't allocate.
+ */
+void BLI_memarena_rollback(MemArena *ma, const MemArenaMark *mark)
+{
+	const bool is_same_buf = (ma->bufs == mark->bufs);
+
+	while (ma->bufs != mark->bufs) {
+		LinkNode *node = ma->bufs;
+		ma->bufs = node->next;
+
+		/* don't hold on to buffers made for large allocations */
+		if (MEM_allocN_len(node->link) < ma->bufsize * 2) {
+			node->next = ma->bufs_free;
+			ma->bufs_free = node;
+		}
+		else {
+			MEM_freeN(node->link);
+			MEM_freeN(node);
+		}
+	}
+
+	if (ma->use_calloc && mark->curbuf) {
+		/* when other buffers were used since, we don't know how much of this one was */
+		const size_t curbuf_used = is_same_buf ? (size_t)(ma->curbuf - mark->curbuf) : mark->cursize;
+		memset(mark->curbuf, 0, curbuf_used);
+	}
+
+	ma->curbuf = mark->curbuf;
+	ma->cursize = mark->cursize;
+}
@@ -35,11 +35,14 @@
 #include <stdlib.h>
 
 #include "BLI_utildefines.h"
+#include "BLI_threads.h"
 
 #include "BLI_mempool.h" /* own include */
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_strict_flags.h"  /* keep last */
 
 #ifdef WITH_MEM_VALGRIND
@@ -67,6 +70,12 @@
 /* optimize pool size */
 #define USE_CHUNK_POW2
 
+/* number of threads which can have their own cache in a BLI_MEMPOOL_THREADSAFE pool,
+ * matches the bits in 'mempool_thread_slots_used' */
+#define MEMPOOL_THREAD_SLOTS 64
+/* number of elements moved between a thread cache and the shared free list at once */
+#define MEMPOOL_THREAD_BATCH 32
+
 
 #ifndef NDEBUG
 static bool mempool_debug_memset = false;
@@ -94,6 +103,18 @@ typedef struct BLI_mempool_chunk {
 #endif
 } BLI_mempool_chunk;
 
+/**
+ * Free elements owned by a single thread, used by #BLI_MEMPOOL_THREADSAFE pools
+ * so most allocations and frees don't need to lock the pool.
+ *
+ * Padded to a cache line so neighboring threads don't write into the same one.
+ */
+typedef struct BLI_mempool_threadcache {
+	BLI_freenode *free;
+	unsigned int totfree;
+	char _pad[64 - sizeof(void *) - sizeof(unsigned int)];
+} BLI_mempool_threadcache;
+
 /**
  * The mempool, stores and tracks memory \a chunks and elements within those chunks \a free.
  */
@@ -112,6 +133,11 @@ struct BLI_mempool {
 	BLI_freenode *free;         /* free element list. Interleaved into chunk datas. */
 	unsigned int maxchunks;     /* use to know how many chunks to keep for BLI_mempool_clear */
 	unsigned int totused;       /* number of elements currently in use */
+
+	/* only used with BLI_MEMPOOL_THREADSAFE */
+	unsigned int lock;          /* protects 'chunks' and 'free', see #mempool_lock */
+	BLI_mempool_threadcache *thread_caches;  /* MEMPOOL_THREAD_SLOTS caches */
+	unsigned int thread_batch;  /* elements moved to/from a thread cache at once */
 #ifdef USE_TOTALLOC
 	unsigned int totalloc;          /* number of elements allocated in total */
 #endif
@@ -265,6 +291,86 @@ static void mempool_chunk_free_all(BLI_mempool_chunk *mpchunk)
 	}
 }
 
+/* -------------------------------------------------------------------- */
+/* Spin lock on an atomic, BLI_mempool is also linked into makesdna/makesrna
+ * without the rest of BLI_threads. */
+BLI_INLINE void mempool_lock(BLI_mempool *pool)
+{
+	while (atomic_cas_uint32(&pool->lock, 0, 1) != 0) {
+		/* only read until the lock looks free, so waiting threads don't keep
+		 * taking the cache line from the one holding it */
+		while (*(volatile unsigned int *)&pool->lock) {
+			atomic_spin_pause();
+		}
+	}
+}
+
+BLI_INLINE void mempool_unlock(BLI_mempool *pool)
+{
+	atomic_cas_uint32(&pool->lock, 1, 0);
+}
+
+/** \name Thread Slots
+ *
+ * Each thread allocating from a #BLI_MEMPOOL_THREADSAFE pool is given a slot,
+ * used as an index into #BLI_mempool.thread_caches.
+ * Slots are shared by all pools and released when their thread exits,
+ * a new thread may then inherit the free elements cached by the old one.
+ * \{ */
+
+static pthread_key_t mempool_thread_key;
+static pthread_once_t mempool_thread_once = PTHREAD_ONCE_INIT;
+static uint64_t mempool_thread_slots_used = 0;
+
+static void mempool_thread_slot_release(void *value)
+{
+	const uint64_t bit = (uint64_t)1 << ((uintptr_t)value - 1);
+	uint64_t used;
+
+	do {
+		used = mempool_thread_slots_used;
+	} while (atomic_cas_uint64(&mempool_thread_slots_used, used, used & ~bit) != used);
+}
+
+static void mempool_thread_key_create(void)
+{
+	pthread_key_create(&mempool_thread_key, mempool_thread_slot_release);
+}
+
+/**
+ * \return The slot of the calling thread,
+ * or -1 when all slots are taken (the pool is then locked for every element).
+ */
+static int mempool_thread_slot(void)
+{
+	uintptr_t value;
+
+	pthread_once(&mempool_thread_once, mempool_thread_key_create);
+
+	value = (uintptr_t)pthread_getspecific(mempool_thread_key);
+	if (UNLIKELY(value == 0)) {
+		uint64_t used;
+		unsigned int slot;
+
+		do {
+			used = mempool_thread_slots_used;
+			if (UNLIKELY(used == ~(uint64_t)0)) {
+				return -1;
+			}
+			for (slot = 0; used & ((uint64_t)1 << slot); slot++) {
+				/* pass */
+			}
+		} while (atomic_cas_uint64(&mempool_thread_slots_used, used, used | ((uint64_t)1 << slot)) != used);
+
+		value = (uintptr_t)slot + 1;
+		pthread_setspecific(mempool_thread_key, (void *)value);
+	}
+
+	return (int)value - 1;
+}
+
+/** \} */
+
 BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
                                 unsigned int pchunk, unsigned int flag)
 {
@@ -311,6 +417,16 @@ BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
 #endif
 	pool->totused = 0;
 
+	if (flag & BLI_MEMPOOL_THREADSAFE) {
+		pool->lock = 0;
+		pool->thread_caches = MEM_callocN(sizeof(*pool->thread_caches) * MEMPOOL_THREAD_SLOTS, "mempool thread caches");
+		pool->thread_batch = MIN2(pchunk, (unsigned int)MEMPOOL_THREAD_BATCH);
+	}
+	else {
+		pool->thread_caches = NULL;
+		pool->thread_batch = 0;
+	}
+
 	if (totelem) {
 		/* allocate the actual chunks */
 		for (i = 0; i < maxchunks; i++) {
@@ -326,10 +442,148 @@ BLI_mempool *BLI_mempool_create(unsigned int esize, unsigned int totelem,
 	return pool;
 }
 
+/* -------------------------------------------------------------------- */
+/** \name Thread Safe Alloc/Free
+ *
+ * Used for #BLI_MEMPOOL_THREADSAFE pools, threads take elements from their own cache,
+ * only locking the pool when it needs to be refilled from (or flushed back to) #BLI_mempool.free.
+ * \{ */
+
+/**
+ * Move up to \a pool->thread_batch elements from the shared free list into an empty \a cache.
+ */
+static void mempool_threadcache_refill(BLI_mempool *pool, BLI_mempool_threadcache *cache)
+{
+	BLI_freenode *head, *tail;
+	unsigned int i;
+
+	BLI_assert(cache->free == NULL);
+
+	mempool_lock(pool);
+
+	if (UNLIKELY(pool->free == NULL)) {
+		/* need to allocate a new chunk */
+		BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+		mempool_chunk_add(pool, mpchunk, NULL);
+	}
+
+	head = tail = pool->free;
+	for (i = 1; (i < pool->thread_batch) && tail->next; i++) {
+		tail = tail->next;
+	}
+	pool->free = tail->next;
+
+	mempool_unlock(pool);
+
+	tail->next = NULL;
+	cache->free = head;
+	cache->totfree = i;
+}
+
+/**
+ * Move the first \a totflush elements of \a cache back to the shared free list.
+ */
+static void mempool_threadcache_flush(BLI_mempool *pool, BLI_mempool_threadcache *cache,
+                                      const unsigned int totflush)
+{
+	BLI_freenode *head, *tail;
+	unsigned int i;
+
+	BLI_assert(totflush != 0 && totflush <= cache->totfree);
+
+	head = tail = cache->free;
+	for (i = 1; i < totflush; i++) {
+		tail = tail->next;
+	}
+	cache->free = tail->next;
+	cache->totfree -= totflush;
+
+	mempool_lock(pool);
+	tail->next = pool->free;
+	pool->free = head;
+	mempool_unlock(pool);
+}
+
+static void *mempool_alloc_threadsafe(BLI_mempool *pool)
+{
+	const int slot = mempool_thread_slot();
+	BLI_freenode *free_pop;
+
+	if (LIKELY(slot != -1)) {
+		BLI_mempool_threadcache *cache = &pool->thread_caches[slot];
+
+		if (UNLIKELY(cache->free == NULL)) {
+			mempool_threadcache_refill(pool, cache);
+		}
+
+		free_pop = cache->free;
+		cache->free = free_pop->next;
+		cache->totfree--;
+	}
+	else {
+		mempool_lock(pool);
+		if (UNLIKELY(pool->free == NULL)) {
+			BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
+			mempool_chunk_add(pool, mpchunk, NULL);
+		}
+		free_pop = pool->free;
+		pool->free = free_pop->next;
+		mempool_unlock(pool);
+	}
+
+	if (pool->flag & BLI_MEMPOOL_ALLOW_ITER) {
+		free_pop->freeword = USEDWORD;
+	}
+
+	atomic_add_uint32((uint32_t *)&pool->totused, 1);
+
+#ifdef WITH_MEM_VALGRIND
+	VALGRIND_MEMPOOL_ALLOC(pool, free_pop, pool->esize);
+#endif
+
+	return (void *)free_pop;
+}
+
+static void mempool_free_threadsafe(BLI_mempool *pool, BLI_freenode *newhead)
+{
+	const int slot = mempool_thread_slot();
+
+	if (LIKELY(slot != -1)) {
+		BLI_mempool_threadcache *cache = &pool->thread_caches[slot];
+
+		newhead->next = cache->free;
+		cache->free = newhead;
+		cache->totfree++;
+
+		/* keep a batch for the next allocations, give the rest back to other threads */
+		if (UNLIKELY(cache->totfree >= pool->thread_batch * 2)) {
+			mempool_threadcache_flush(pool, cache, pool->thread_batch);
+		}
+	}
+	else {
+		mempool_lock(pool);
+		newhead->next = pool->free;
+		pool->free = newhead;
+		mempool_unlock(pool);
+	}
+
+	atomic_sub_uint32((uint32_t *)&pool->totused, 1);
+
+#ifdef WITH_MEM_VALGRIND
+	VALGRIND_MEMPOOL_FREE(pool, newhead);
+#endif
+}
+
+/** \} */
+
 void *BLI_mempool_alloc(BLI_mempool *pool)
 {
 	BLI_freenode *free_pop;
 
+	if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+		return mempool_alloc_threadsafe(pool);
+	}
+
 	if (UNLIKELY(pool->free == NULL)) {
 		/* need to allocate a new chunk */
 		BLI_mempool_chunk *mpchunk = mempool_chunk_alloc(pool);
@@ -374,12 +628,18 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 	{
 		BLI_mempool_chunk *chunk;
 		bool found = false;
+		if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+			mempool_lock(pool);
+		}
 		for (chunk = pool->chunks; chunk; chunk = chunk->next) {
 			if (ARRAY_HAS_ITEM((char *)addr, (char *)CHUNK_DATA(chunk), pool->csize)) {
 				found = true;
 				break;
 			}
 		}
+		if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+			mempool_unlock(pool);
+		}
 		if (!found) {
 			BLI_assert(!"Attempt to free data which is not in pool.\n");
 		}
@@ -399,6 +659,13 @@ void BLI_mempool_free(BLI_mempool *pool, void *addr)
 		newhead->freeword = FREEWORD;
 	}
 
+	if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+		/* thread caches point into the chunks, so never free them here,
+		 * the pool only shrinks on #BLI_mempool_clear */
+		mempool_free_threadsafe(pool, newhead);
+		return;
+	}
+
 	newhead->next = pool->free;
 	pool->free = newhead;
 
@@ -646,6 +913,9 @@ void BLI_mempool_clear_ex(BLI_mempool *pool, const int totelem_reserve)
 	/* re-initialize */
 	pool->free = NULL;
 	pool->totused = 0;
+	if (pool->thread_caches) {
+		memset(pool->thread_caches, 0, sizeof(*pool->thread_caches) * MEMPOOL_THREAD_SLOTS);
+	}
 #ifdef USE_TOTALLOC
 	pool->totalloc = 0;
 #endif
@@ -675,6 +945,10 @@ void BLI_mempool_destroy(BLI_mempool *pool)
 {
 	mempool_chunk_free_all(pool->chunks);
 
+	if (pool->flag & BLI_MEMPOOL_THREADSAFE) {
+		MEM_freeN(pool->thread_caches);
+	}
+
 #ifdef WITH_MEM_VALGRIND
 	VALGRIND_DESTROY_MEMPOOL(pool);
 #endif
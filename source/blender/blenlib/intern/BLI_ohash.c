@@ -0,0 +1,608 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenlib/intern/BLI_ohash.c
+ *  \ingroup bli
+ *
+ * An open addressing (pointer -> pointer) hash table ADT, using robin hood hashing.
+ *
+ * All entries live in one power of two sized bucket array. An entry is placed at
+ * the first free bucket after its ideal one, taking over buckets from entries that
+ * are closer to their own ideal bucket. This keeps probe sequences short and allows
+ * lookups of missing keys to stop early. Removal shifts the following entries back,
+ * so no tombstones are needed.
+ *
+ * \note The API follows BLI_ghash.c, keep them in sync.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_sys_types.h"  /* for intptr_t support */
+#include "BLI_utildefines.h"
+#include "BLI_ohash.h"
+#include "BLI_strict_flags.h"
+
+/* smallest number of buckets is (1 << OHASH_BUCKET_BIT_MIN) */
+#define OHASH_BUCKET_BIT_MIN 3
+#define OHASH_BUCKET_BIT_MAX 31
+
+/***/
+
+typedef struct OHashBucket {
+	/* must be first, see BLI_ohashIterator_getKey */
+	void *key, *val;
+
+	unsigned int hash;
+	/* distance from the ideal bucket plus one, zero for empty buckets */
+	unsigned int dist;
+} OHashBucket;
+
+struct OHash {
+	GHashHashFP hashfp;
+	/* NULL when keys are compared by their pointer value */
+	GHashCmpFP cmpfp;
+
+	OHashBucket *buckets;
+	unsigned int nbuckets;
+	unsigned int nentries;
+	unsigned int bucket_bit;
+};
+
+
+/* -------------------------------------------------------------------- */
+/* OHash API */
+
+/** \name Internal Utility API
+ * \{ */
+
+/**
+ * Get the ideal bucket for a hash.
+ *
+ * Fibonacci hashing, uses the high bits of the product so that
+ * hashes which only differ in their high bits (aligned pointers) spread too.
+ */
+BLI_INLINE unsigned int ohash_bucket_index(OHash *oh, const unsigned int hash)
+{
+	return (hash * 2654435769u) >> (32 - oh->bucket_bit);
+}
+
+BLI_INLINE bool ohash_key_equal(OHash *oh, const void *key_a, const void *key_b)
+{
+	return oh->cmpfp ? (oh->cmpfp(key_a, key_b) == 0) : (key_a == key_b);
+}
+
+/**
+ * Check if the number of items in the OHash is large enough to require more buckets.
+ */
+BLI_INLINE bool ohash_test_expand_buckets(const unsigned int nentries, const unsigned int nbuckets)
+{
+	/* keep the load below 3/4 */
+	return (nentries > nbuckets - (nbuckets >> 2));
+}
+
+/**
+ * Place an entry, starting at its ideal bucket.
+ */
+static void ohash_bucket_place(OHash *oh, OHashBucket entry)
+{
+	const unsigned int mask = oh->nbuckets - 1;
+	unsigned int i = ohash_bucket_index(oh, entry.hash);
+
+	entry.dist = 1;
+
+	for (;; i = (i + 1) & mask, entry.dist++) {
+		OHashBucket *bucket = &oh->buckets[i];
+
+		if (bucket->dist == 0) {
+			*bucket = entry;
+			return;
+		}
+		else if (bucket->dist < entry.dist) {
+			/* take the bucket from the entry closer to its ideal bucket, and continue placing that one */
+			SWAP(OHashBucket, *bucket, entry);
+		}
+	}
+}
+
+static void ohash_resize_buckets(OHash *oh, const unsigned int bucket_bit)
+{
+	OHashBucket *buckets_old = oh->buckets;
+	const unsigned int nbuckets_old = oh->nbuckets;
+	unsigned int i;
+
+	BLI_assert(oh->bucket_bit != bucket_bit);
+	BLI_assert(bucket_bit <= OHASH_BUCKET_BIT_MAX);
+
+	oh->bucket_bit = bucket_bit;
+	oh->nbuckets = 1u << bucket_bit;
+	oh->buckets = MEM_callocN(oh->nbuckets * sizeof(*oh->buckets), "buckets");
+
+	for (i = 0; i < nbuckets_old; i++) {
+		if (buckets_old[i].dist) {
+			ohash_bucket_place(oh, buckets_old[i]);
+		}
+	}
+
+	MEM_freeN(buckets_old);
+}
+
+/**
+ * Increase initial bucket size to match a reserved amount.
+ */
+BLI_INLINE void ohash_buckets_reserve(OHash *oh, const unsigned int nentries_reserve)
+{
+	while (ohash_test_expand_buckets(nentries_reserve, oh->nbuckets) &&
+	       oh->bucket_bit < OHASH_BUCKET_BIT_MAX)
+	{
+		oh->bucket_bit++;
+		oh->nbuckets = 1u << oh->bucket_bit;
+	}
+}
+
+/**
+ * Internal lookup function.
+ * Takes a hash argument to avoid calling the hash function multiple times.
+ */
+BLI_INLINE OHashBucket *ohash_lookup_bucket_ex(OHash *oh, const void *key,
+                                               const unsigned int hash)
+{
+	const unsigned int mask = oh->nbuckets - 1;
+	unsigned int i = ohash_bucket_index(oh, hash);
+	unsigned int dist;
+
+	for (dist = 1; ; i = (i + 1) & mask, dist++) {
+		OHashBucket *bucket = &oh->buckets[i];
+
+		/* empty, or the key would have taken this bucket */
+		if (bucket->dist < dist) {
+			return NULL;
+		}
+		if (bucket->hash == hash && ohash_key_equal(oh, key, bucket->key)) {
+			return bucket;
+		}
+	}
+}
+
+/**
+ * Internal lookup function. Only wraps #ohash_lookup_bucket_ex
+ */
+BLI_INLINE OHashBucket *ohash_lookup_bucket(OHash *oh, const void *key)
+{
+	return ohash_lookup_bucket_ex(oh, key, oh->hashfp(key));
+}
+
+static OHash *ohash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+                        const unsigned int nentries_reserve)
+{
+	OHash *oh = MEM_mallocN(sizeof(*oh), info);
+
+	oh->hashfp = hashfp;
+	/* pointers and integers stored as pointers are equal when their value is */
+	oh->cmpfp = (cmpfp == BLI_ghashutil_ptrcmp || cmpfp == BLI_ghashutil_intcmp) ? NULL : cmpfp;
+
+	oh->bucket_bit = OHASH_BUCKET_BIT_MIN;
+	oh->nbuckets = 1u << oh->bucket_bit;
+	oh->nentries = 0;
+
+	/* if we have reserved the number of elements that this hash will contain */
+	if (nentries_reserve) {
+		ohash_buckets_reserve(oh, nentries_reserve);
+	}
+
+	oh->buckets = MEM_callocN(oh->nbuckets * sizeof(*oh->buckets), "buckets");
+
+	return oh;
+}
+
+/**
+ * Internal insert function.
+ * Takes a hash argument to avoid calling the hash function multiple times.
+ */
+BLI_INLINE void ohash_insert_ex(OHash *oh, void *key, void *val,
+                                const unsigned int hash)
+{
+	OHashBucket entry;
+
+	BLI_assert(ohash_lookup_bucket_ex(oh, key, hash) == NULL);
+
+	if (UNLIKELY(ohash_test_expand_buckets(oh->nentries + 1, oh->nbuckets))) {
+		ohash_resize_buckets(oh, oh->bucket_bit + 1);
+	}
+
+	entry.key = key;
+	entry.val = val;
+	entry.hash = hash;
+	ohash_bucket_place(oh, entry);
+
+	oh->nentries++;
+}
+
+/**
+ * Remove the entry in \a bucket, shifting back the entries after it.
+ */
+static void ohash_remove_bucket(OHash *oh, OHashBucket *bucket)
+{
+	const unsigned int mask = oh->nbuckets - 1;
+	unsigned int i = (unsigned int)(bucket - oh->buckets);
+
+	for (;;) {
+		OHashBucket *bucket_next = &oh->buckets[(i + 1) & mask];
+
+		/* stop at empty buckets and entries in their ideal bucket */
+		if (bucket_next->dist <= 1) {
+			break;
+		}
+
+		oh->buckets[i] = *bucket_next;
+		oh->buckets[i].dist--;
+		i = (i + 1) & mask;
+	}
+
+	memset(&oh->buckets[i], 0, sizeof(*oh->buckets));
+	oh->nentries--;
+}
+
+/**
+ * Run free callbacks for freeing entries.
+ */
+static void ohash_free_cb(OHash *oh,
+                          GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	unsigned int i;
+
+	BLI_assert(keyfreefp || valfreefp);
+
+	for (i = 0; i < oh->nbuckets; i++) {
+		OHashBucket *bucket = &oh->buckets[i];
+
+		if (bucket->dist) {
+			if (keyfreefp) keyfreefp(bucket->key);
+			if (valfreefp) valfreefp(bucket->val);
+		}
+	}
+}
+/** \} */
+
+
+/** \name Public API
+ * \{ */
+
+/**
+ * Creates a new, empty OHash.
+ *
+ * \param hashfp  Hash callback.
+ * \param cmpfp  Comparison callback.
+ * \param info  Identifier string for the OHash.
+ * \param nentries_reserve  Optionally reserve the number of members that the hash will hold.
+ * Use this to avoid resizing buckets if the size is known or can be closely approximated.
+ * \return  An empty OHash.
+ */
+OHash *BLI_ohash_new_ex(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info,
+                        const unsigned int nentries_reserve)
+{
+	return ohash_new(hashfp, cmpfp, info, nentries_reserve);
+}
+
+/**
+ * Wraps #BLI_ohash_new_ex with zero entries reserved.
+ */
+OHash *BLI_ohash_new(GHashHashFP hashfp, GHashCmpFP cmpfp, const char *info)
+{
+	return BLI_ohash_new_ex(hashfp, cmpfp, info, 0);
+}
+
+/**
+ * \return size of the OHash.
+ */
+int BLI_ohash_size(OHash *oh)
+{
+	return (int)oh->nentries;
+}
+
+/**
+ * Insert a key/value pair into the \a oh.
+ *
+ * \note Duplicates are not checked,
+ * the caller is expected to ensure elements are unique.
+ */
+void BLI_ohash_insert(OHash *oh, void *key, void *val)
+{
+	ohash_insert_ex(oh, key, val, oh->hashfp(key));
+}
+
+/**
+ * Inserts a new value to a key that may already be in ohash.
+ *
+ * Avoids #BLI_ohash_remove, #BLI_ohash_insert calls (double lookups)
+ *
+ * \returns true if a new key has been added.
+ */
+bool BLI_ohash_reinsert(OHash *oh, void *key, void *val, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	const unsigned int hash = oh->hashfp(key);
+	OHashBucket *bucket = ohash_lookup_bucket_ex(oh, key, hash);
+	if (bucket) {
+		if (keyfreefp) keyfreefp(bucket->key);
+		if (valfreefp) valfreefp(bucket->val);
+		bucket->key = key;
+		bucket->val = val;
+		return false;
+	}
+	else {
+		ohash_insert_ex(oh, key, val, hash);
+		return true;
+	}
+}
+
+/**
+ * Lookup the value of \a key in \a oh.
+ *
+ * \param key  The key to lookup.
+ * \returns the value for \a key or NULL.
+ *
+ * \note When NULL is a valid value, use #BLI_ohash_lookup_p to differentiate a missing key
+ * from a key with a NULL value. (Avoids calling #BLI_ohash_haskey before #BLI_ohash_lookup)
+ */
+void *BLI_ohash_lookup(OHash *oh, const void *key)
+{
+	OHashBucket *bucket = ohash_lookup_bucket(oh, key);
+	return bucket ? bucket->val : NULL;
+}
+
+/**
+ * A version of #BLI_ohash_lookup which accepts a fallback argument.
+ */
+void *BLI_ohash_lookup_default(OHash *oh, const void *key, void *val_default)
+{
+	OHashBucket *bucket = ohash_lookup_bucket(oh, key);
+	return bucket ? bucket->val : val_default;
+}
+
+/**
+ * Lookup a pointer to the value of \a key in \a oh.
+ *
+ * \param key  The key to lookup.
+ * \returns the pointer to value for \a key or NULL.
+ *
+ * \note The pointer is only valid until the next insertion or removal,
+ * entries move when the buckets are resized or shifted.
+ */
+void **BLI_ohash_lookup_p(OHash *oh, const void *key)
+{
+	OHashBucket *bucket = ohash_lookup_bucket(oh, key);
+	return bucket ? &bucket->val : NULL;
+}
+
+/**
+ * Remove \a key from \a oh, or return false if the key wasn't found.
+ *
+ * \param key  The key to remove.
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ * \return true if \a key was removed from \a oh.
+ */
+bool BLI_ohash_remove(OHash *oh, void *key, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	OHashBucket *bucket = ohash_lookup_bucket(oh, key);
+	if (bucket) {
+		if (keyfreefp) keyfreefp(bucket->key);
+		if (valfreefp) valfreefp(bucket->val);
+		ohash_remove_bucket(oh, bucket);
+		return true;
+	}
+	else {
+		return false;
+	}
+}
+
+/**
+ * Remove \a key from \a oh, returning the value or NULL if the key wasn't found.
+ *
+ * \param key  The key to remove.
+ * \param keyfreefp  Optional callback to free the key.
+ * \return the value of \a key int \a oh or NULL.
+ */
+void *BLI_ohash_popkey(OHash *oh, void *key, GHashKeyFreeFP keyfreefp)
+{
+	OHashBucket *bucket = ohash_lookup_bucket(oh, key);
+	if (bucket) {
+		void *val = bucket->val;
+		if (keyfreefp) keyfreefp(bucket->key);
+		ohash_remove_bucket(oh, bucket);
+		return val;
+	}
+	else {
+		return NULL;
+	}
+}
+
+/**
+ * \return true if the \a key is in \a oh.
+ */
+bool BLI_ohash_haskey(OHash *oh, const void *key)
+{
+	return (ohash_lookup_bucket(oh, key) != NULL);
+}
+
+/**
+ * Reset \a oh clearing all entries.
+ *
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ * \param nentries_reserve  Optionally reserve the number of members that the hash will hold.
+ */
+void BLI_ohash_clear_ex(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp,
+                        const unsigned int nentries_reserve)
+{
+	if (keyfreefp || valfreefp)
+		ohash_free_cb(oh, keyfreefp, valfreefp);
+
+	oh->bucket_bit = OHASH_BUCKET_BIT_MIN;
+	oh->nbuckets = 1u << oh->bucket_bit;
+	oh->nentries = 0;
+
+	if (nentries_reserve) {
+		ohash_buckets_reserve(oh, nentries_reserve);
+	}
+
+	MEM_freeN(oh->buckets);
+	oh->buckets = MEM_callocN(oh->nbuckets * sizeof(*oh->buckets), "buckets");
+}
+
+/**
+ * Wraps #BLI_ohash_clear_ex with zero entries reserved.
+ */
+void BLI_ohash_clear(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	BLI_ohash_clear_ex(oh, keyfreefp, valfreefp, 0);
+}
+
+/**
+ * Frees the OHash and its members.
+ *
+ * \param oh  The OHash to free.
+ * \param keyfreefp  Optional callback to free the key.
+ * \param valfreefp  Optional callback to free the value.
+ */
+void BLI_ohash_free(OHash *oh, GHashKeyFreeFP keyfreefp, GHashValFreeFP valfreefp)
+{
+	if (keyfreefp || valfreefp)
+		ohash_free_cb(oh, keyfreefp, valfreefp);
+
+	MEM_freeN(oh->buckets);
+	MEM_freeN(oh);
+}
+
+/** \} */
+
+
+/* -------------------------------------------------------------------- */
+/* OHash Iterator API */
+
+/** \name Iterator API
+ * \{ */
+
+/**
+ * Init an OHashIterator. The hash table must not
+ * be mutated while the iterator is in use, and the iterator will
+ * step exactly BLI_ohash_size(oh) times before becoming done.
+ *
+ * \param ohi The OHashIterator to initialize.
+ * \param oh The OHash to iterate over.
+ */
+void BLI_ohashIterator_init(OHashIterator *ohi, OHash *oh)
+{
+	ohi->oh = oh;
+	ohi->curBucket = NULL;
+	ohi->curIndex = UINT_MAX;  /* wraps to zero */
+	if (oh->nentries) {
+		BLI_ohashIterator_step(ohi);
+	}
+}
+
+/**
+ * Steps the iterator to the next index.
+ *
+ * \param ohi The iterator.
+ */
+void BLI_ohashIterator_step(OHashIterator *ohi)
+{
+	OHash *oh = ohi->oh;
+
+	ohi->curBucket = NULL;
+	while (++ohi->curIndex < oh->nbuckets) {
+		if (oh->buckets[ohi->curIndex].dist) {
+			ohi->curBucket = &oh->buckets[ohi->curIndex];
+			break;
+		}
+	}
+}
+
+/** \} */
+
+
+/** \name Convenience OHash Creation Functions
+ * \{ */
+
+OHash *BLI_ohash_ptr_new_ex(const char *info,
+                            const unsigned int nentries_reserve)
+{
+	return BLI_ohash_new_ex(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, info,
+	                        nentries_reserve);
+}
+OHash *BLI_ohash_ptr_new(const char *info)
+{
+	return BLI_ohash_ptr_new_ex(info, 0);
+}
+
+OHash *BLI_ohash_str_new_ex(const char *info,
+                            const unsigned int nentries_reserve)
+{
+	return BLI_ohash_new_ex(BLI_ghashutil_strhash_p, BLI_ghashutil_strcmp, info,
+	                        nentries_reserve);
+}
+OHash *BLI_ohash_str_new(const char *info)
+{
+	return BLI_ohash_str_new_ex(info, 0);
+}
+
+OHash *BLI_ohash_int_new_ex(const char *info,
+                            const unsigned int nentries_reserve)
+{
+	return BLI_ohash_new_ex(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, info,
+	                        nentries_reserve);
+}
+OHash *BLI_ohash_int_new(const char *info)
+{
+	return BLI_ohash_int_new_ex(info, 0);
+}
+
+/** \} */
+
+
+/** \name Debugging & Introspection
+ * \{ */
+#ifdef DEBUG
+
+/**
+ * Average number of buckets visited to find an existing key.
+ *
+ * Smaller is better, 1.0 means every entry is in its ideal bucket.
+ */
+double BLI_ohash_calc_quality(OHash *oh)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	if (oh->nentries == 0)
+		return -1.0;
+
+	for (i = 0; i < oh->nbuckets; i++) {
+		sum += oh->buckets[i].dist;
+	}
+	return (double)sum / (double)oh->nentries;
+}
+
+#endif
+/** \} */
@@ -0,0 +1,450 @@
+/*
+ * ***** BEGIN GPL LICENSE BLOCK *****
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * ***** END GPL LICENSE BLOCK *****
+ */
+
+/** \file blender/blenlib/intern/sort_parallel.c
+ *  \ingroup bli
+ *
+ * Stable sorting of large arrays using the task scheduler:
+ * a merge sort for any element type and a radix sort for 32bit keys,
+ * optionally moving an array of values (typically indices) along with the keys.
+ */
+
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+#include "BLI_utildefines.h"
+#include "BLI_math_base.h"
+#include "BLI_sort.h"
+#include "BLI_task.h"
+
+#include "BLI_strict_flags.h"
+
+/* sort arrays with fewer elements in the calling thread */
+#define MERGESORT_THREAD_MIN 10000
+#define RADIXSORT_THREAD_MIN 50000
+
+/* runs this short are sorted with insertion sort */
+#define MERGESORT_RUN_MIN 16
+
+/* split work into this many tasks per thread, to balance the load */
+#define SORT_TASKS_PER_THREAD 4
+
+#define ELEM_PTR(a, i) ((char *)(a) + ((size_t)(i) * es))
+
+static int sort_num_tasks(void)
+{
+	return BLI_task_scheduler_num_threads(BLI_task_scheduler_get()) * SORT_TASKS_PER_THREAD;
+}
+
+
+/* -------------------------------------------------------------------- */
+/** \name Merge Sort
+ * \{ */
+
+typedef struct MergeSortData {
+	size_t es;
+	BLI_sort_cmp_t cmp;
+	void *thunk;
+} MergeSortData;
+
+/**
+ * Stable insertion sort, \a elem_tmp is space for one element.
+ */
+static void mergesort_insertion(const MergeSortData *data, char *a, const size_t n, char *elem_tmp)
+{
+	const size_t es = data->es;
+	size_t i, j;
+
+	for (i = 1; i < n; i++) {
+		if (data->cmp(ELEM_PTR(a, i - 1), ELEM_PTR(a, i), data->thunk) > 0) {
+			memcpy(elem_tmp, ELEM_PTR(a, i), es);
+			for (j = i; j > 0 && data->cmp(ELEM_PTR(a, j - 1), elem_tmp, data->thunk) > 0; j--) {
+				memcpy(ELEM_PTR(a, j), ELEM_PTR(a, j - 1), es);
+			}
+			memcpy(ELEM_PTR(a, j), elem_tmp, es);
+		}
+	}
+}
+
+/**
+ * Merge the sorted runs \a a and \a b into \a r_dst,
+ * elements of \a a go first when they compare equal, which keeps the sort stable.
+ */
+static void mergesort_merge(const MergeSortData *data,
+                            const char *a, size_t na, const char *b, size_t nb, char *r_dst)
+{
+	const size_t es = data->es;
+
+	while (na && nb) {
+		if (data->cmp(a, b, data->thunk) <= 0) {
+			memcpy(r_dst, a, es);
+			a += es;
+			na--;
+		}
+		else {
+			memcpy(r_dst, b, es);
+			b += es;
+			nb--;
+		}
+		r_dst += es;
+	}
+
+	if (na) {
+		memcpy(r_dst, a, na * es);
+	}
+	else if (nb) {
+		memcpy(r_dst, b, nb * es);
+	}
+}
+
+/**
+ * Single threaded merge sort of \a a, using \a tmp (the same size) as scratch memory.
+ */
+static void mergesort_serial(const MergeSortData *data, char *a, char *tmp, const size_t n)
+{
+	const size_t es = data->es;
+	size_t half;
+
+	if (n <= MERGESORT_RUN_MIN) {
+		mergesort_insertion(data, a, n, tmp);
+		return;
+	}
+
+	half = n / 2;
+	mergesort_serial(data, a, tmp, half);
+	mergesort_serial(data, ELEM_PTR(a, half), ELEM_PTR(tmp, half), n - half);
+
+	/* already in order, common for partially sorted data */
+	if (data->cmp(ELEM_PTR(a, half - 1), ELEM_PTR(a, half), data->thunk) <= 0) {
+		return;
+	}
+
+	memcpy(tmp, a, n * es);
+	mergesort_merge(data, tmp, half, ELEM_PTR(tmp, half), n - half, a);
+}
+
+/**
+ * The number of elements of \a a in the first \a k elements of merging \a a and \a b,
+ * allows merging two runs in independent parts.
+ */
+static size_t mergesort_split(const MergeSortData *data,
+                              const char *a, const size_t na, const char *b, const size_t nb, const size_t k)
+{
+	const size_t es = data->es;
+	size_t lo = (k > nb) ? k - nb : 0;
+	size_t hi = MIN2(k, na);
+
+	/* smallest 'i' where b[k - i - 1] goes before a[i] */
+	while (lo < hi) {
+		const size_t mid = (lo + hi) / 2;
+		if (data->cmp(ELEM_PTR(b, k - mid - 1), ELEM_PTR(a, mid), data->thunk) < 0) {
+			hi = mid;
+		}
+		else {
+			lo = mid + 1;
+		}
+	}
+
+	return lo;
+}
+
+typedef struct MergeSortTaskData {
+	MergeSortData data;
+	char *src, *dst;
+	size_t n;
+	size_t run_len;    /* length of the sorted runs in 'src' */
+	int parts_per_merge;  /* merging two runs is split into this many tasks */
+} MergeSortTaskData;
+
+static void mergesort_block_cb(void *userdata, const int i)
+{
+	MergeSortTaskData *task_data = userdata;
+	const size_t es = task_data->data.es;
+	const size_t start = (size_t)i * task_data->run_len;
+	const size_t len = MIN2(task_data->run_len, task_data->n - start);
+
+	mergesort_serial(&task_data->data, ELEM_PTR(task_data->src, start), ELEM_PTR(task_data->dst, start), len);
+}
+
+static void mergesort_merge_cb(void *userdata, const int i)
+{
+	MergeSortTaskData *task_data = userdata;
+	const MergeSortData *data = &task_data->data;
+	const size_t es = data->es;
+	const size_t merge = (size_t)(i / task_data->parts_per_merge);
+	const size_t part = (size_t)(i % task_data->parts_per_merge);
+	const size_t start = merge * task_data->run_len * 2;
+	const size_t na = MIN2(task_data->run_len, task_data->n - start);
+	const size_t nb = MIN2(task_data->run_len, task_data->n - start - na);
+	const char *a = ELEM_PTR(task_data->src, start);
+	const char *b = ELEM_PTR(a, na);
+	/* range of the merged output this task writes */
+	const size_t k_start = ((na + nb) * part) / (size_t)task_data->parts_per_merge;
+	const size_t k_end = ((na + nb) * (part + 1)) / (size_t)task_data->parts_per_merge;
+	const size_t ia_start = mergesort_split(data, a, na, b, nb, k_start);
+	const size_t ia_end = mergesort_split(data, a, na, b, nb, k_end);
+
+	mergesort_merge(data,
+	                ELEM_PTR(a, ia_start), ia_end - ia_start,
+	                ELEM_PTR(b, k_start - ia_start), (k_end - ia_end) - (k_start - ia_start),
+	                ELEM_PTR(task_data->dst, start + k_start));
+}
+
+/**
+ * Stable merge sort, using multiple threads for large arrays.
+ * Takes the same arguments as #BLI_qsort_r, but allocates a temporary copy of the array.
+ */
+void BLI_mergesort_r(void *a, size_t n, size_t es, BLI_sort_cmp_t cmp, void *thunk)
+{
+	MergeSortTaskData task_data;
+	char *tmp;
+
+	if (n < 2) {
+		return;
+	}
+
+	tmp = MEM_mallocN(n * es, __func__);
+
+	task_data.data.es = es;
+	task_data.data.cmp = cmp;
+	task_data.data.thunk = thunk;
+
+	if (n < MERGESORT_THREAD_MIN) {
+		mergesort_serial(&task_data.data, a, tmp, n);
+	}
+	else {
+		const int num_tasks = sort_num_tasks();
+		int num_runs;
+
+		task_data.n = n;
+
+		/* sort blocks in place */
+		task_data.src = a;
+		task_data.dst = tmp;
+		task_data.run_len = (n + (size_t)num_tasks - 1) / (size_t)num_tasks;
+		num_runs = (int)((n + task_data.run_len - 1) / task_data.run_len);
+		BLI_task_parallel_range(0, num_runs, &task_data, mergesort_block_cb, true);
+
+		/* merge pairs of runs, ping-ponging between both buffers */
+		while (num_runs > 1) {
+			const int num_merges = (num_runs + 1) / 2;
+
+			task_data.parts_per_merge = max_ii(1, num_tasks / num_merges);
+			BLI_task_parallel_range(0, num_merges * task_data.parts_per_merge, &task_data, mergesort_merge_cb, true);
+
+			SWAP(char *, task_data.src, task_data.dst);
+			task_data.run_len *= 2;
+			num_runs = num_merges;
+		}
+
+		if (task_data.src != a) {
+			memcpy(a, task_data.src, n * es);
+		}
+	}
+
+	MEM_freeN(tmp);
+}
+
+/** \} */
+
+
+/* -------------------------------------------------------------------- */
+/** \name Radix Sort
+ *
+ * Least significant digit first, 8 bits per pass.
+ * Signed and float keys are mapped to unsigned keys with the same order before sorting.
+ * \{ */
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_SIZE - 1)
+
+typedef struct RadixSortTaskData {
+	unsigned int *keys_src, *keys_dst;
+	int *values_src, *values_dst;
+	size_t n;
+	size_t block_len;
+	unsigned int shift;
+	size_t (*offsets)[RADIX_SIZE];  /* per block, counts and then write offsets for every digit */
+} RadixSortTaskData;
+
+static void radixsort_count_cb(void *userdata, const int block)
+{
+	RadixSortTaskData *task_data = userdata;
+	const size_t start = (size_t)block * task_data->block_len;
+	const size_t end = MIN2(start + task_data->block_len, task_data->n);
+	const unsigned int shift = task_data->shift;
+	size_t *count = task_data->offsets[block];
+	size_t i;
+
+	memset(count, 0, sizeof(*task_data->offsets));
+	for (i = start; i < end; i++) {
+		count[(task_data->keys_src[i] >> shift) & RADIX_MASK]++;
+	}
+}
+
+static void radixsort_scatter_cb(void *userdata, const int block)
+{
+	RadixSortTaskData *task_data = userdata;
+	const size_t start = (size_t)block * task_data->block_len;
+	const size_t end = MIN2(start + task_data->block_len, task_data->n);
+	const unsigned int shift = task_data->shift;
+	size_t *offset = task_data->offsets[block];
+	size_t i;
+
+	if (task_data->values_src) {
+		for (i = start; i < end; i++) {
+			const size_t j = offset[(task_data->keys_src[i] >> shift) & RADIX_MASK]++;
+			task_data->keys_dst[j] = task_data->keys_src[i];
+			task_data->values_dst[j] = task_data->values_src[i];
+		}
+	}
+	else {
+		for (i = start; i < end; i++) {
+			const size_t j = offset[(task_data->keys_src[i] >> shift) & RADIX_MASK]++;
+			task_data->keys_dst[j] = task_data->keys_src[i];
+		}
+	}
+}
+
+static void radixsort_uint(unsigned int *keys, int *values, const size_t n)
+{
+	RadixSortTaskData task_data;
+	const bool use_threading = (n >= RADIXSORT_THREAD_MIN);
+	const int num_blocks = use_threading ? sort_num_tasks() : 1;
+	unsigned int *keys_tmp;
+	int *values_tmp = NULL;
+	unsigned int shift;
+
+	if (n < 2) {
+		return;
+	}
+
+	keys_tmp = MEM_mallocN(sizeof(*keys_tmp) * n, __func__);
+	if (values) {
+		values_tmp = MEM_mallocN(sizeof(*values_tmp) * n, __func__);
+	}
+
+	task_data.keys_src = keys;
+	task_data.keys_dst = keys_tmp;
+	task_data.values_src = values;
+	task_data.values_dst = values_tmp;
+	task_data.n = n;
+	task_data.block_len = (n + (size_t)num_blocks - 1) / (size_t)num_blocks;
+	task_data.offsets = MEM_mallocN(sizeof(*task_data.offsets) * (size_t)num_blocks, __func__);
+
+	for (shift = 0; shift < 32; shift += RADIX_BITS) {
+		size_t offset = 0;
+		int digit, block;
+		bool is_sorted = false;
+
+		task_data.shift = shift;
+		BLI_task_parallel_range(0, num_blocks, &task_data, radixsort_count_cb, use_threading);
+
+		/* turn counts into write offsets, blocks in order so the sort stays stable */
+		for (digit = 0; digit < RADIX_SIZE; digit++) {
+			size_t count_digit = 0;
+			for (block = 0; block < num_blocks; block++) {
+				const size_t count = task_data.offsets[block][digit];
+				task_data.offsets[block][digit] = offset;
+				offset += count;
+				count_digit += count;
+			}
+			/* all keys share this digit, nothing to do */
+			if (count_digit == n) {
+				is_sorted = true;
+				break;
+			}
+		}
+
+		if (is_sorted) {
+			continue;
+		}
+
+		BLI_task_parallel_range(0, num_blocks, &task_data, radixsort_scatter_cb, use_threading);
+
+		SWAP(unsigned int *, task_data.keys_src, task_data.keys_dst);
+		SWAP(int *, task_data.values_src, task_data.values_dst);
+	}
+
+	/* odd number of passes done */
+	if (task_data.keys_src != keys) {
+		memcpy(keys, task_data.keys_src, sizeof(*keys) * n);
+		if (values) {
+			memcpy(values, task_data.values_src, sizeof(*values) * n);
+		}
+	}
+
+	MEM_freeN(task_data.offsets);
+	MEM_freeN(keys_tmp);
+	if (values_tmp) {
+		MEM_freeN(values_tmp);
+	}
+}
+
+/**
+ * Sort \a keys in ascending order, stable.
+ *
+ * \param values  Optional, moved along with the keys (to sort indices by key for example).
+ */
+void BLI_radixsort_uint(unsigned int *keys, int *values, const size_t n)
+{
+	radixsort_uint(keys, values, n);
+}
+
+void BLI_radixsort_int(int *keys, int *values, const size_t n)
+{
+	unsigned int *keys_u = (unsigned int *)keys;
+	size_t i;
+
+	/* flip the sign bit, so negative numbers go first */
+	for (i = 0; i < n; i++) {
+		keys_u[i] ^= 0x80000000u;
+	}
+
+	radixsort_uint(keys_u, values, n);
+
+	for (i = 0; i < n; i++) {
+		keys_u[i] ^= 0x80000000u;
+	}
+}
+
+/**
+ * \note -0.0 sorts before 0.0, NaN's sort before or after all numbers depending on their sign.
+ */
+void BLI_radixsort_float(float *keys, int *values, const size_t n)
+{
+	unsigned int *keys_u = (unsigned int *)keys;
+	size_t i;
+
+	/* positive: flip the sign bit, negative: flip all bits to reverse their order */
+	for (i = 0; i < n; i++) {
+		keys_u[i] ^= (keys_u[i] & 0x80000000u) ? 0xffffffffu : 0x80000000u;
+	}
+
+	radixsort_uint(keys_u, values, n);
+
+	for (i = 0; i < n; i++) {
+		keys_u[i] ^= (keys_u[i] & 0x80000000u) ? 0x80000000u : 0xffffffffu;
+	}
+}
+
+/** \} */
@@ -25,15 +25,23 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "MEM_guardedalloc.h"
 
+#include "atomic_ops.h"
+
 #include "BLI_listbase.h"
+#include "BLI_math_base.h"
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
 /* Types */
 
+/* Number of tasks a worker thread can hold in its own queue, tasks
+ * pushed when it is full go to the shared queue. Must be a power of two. */
+#define TASK_DEQUE_SIZE 1024
+
 typedef struct Task {
 	struct Task *next, *prev;
 
@@ -43,6 +51,24 @@ typedef struct Task {
 	TaskPool *pool;
 } Task;
 
+/* Work stealing queue of a worker thread (Chase-Lev deque with a fixed size).
+ *
+ * The owner pushes and pops tasks at the bottom without locking, other threads
+ * steal the oldest tasks from the top, only racing with each other and with the
+ * owner for the very last task through a compare and swap on top. The pool is
+ * stored next to the task so thieves can filter on it without touching a task
+ * that might already be freed. */
+typedef struct TaskDequeItem {
+	Task *task;
+	TaskPool *pool;
+} TaskDequeItem;
+
+typedef struct TaskDeque {
+	volatile size_t top;
+	volatile size_t bottom;
+	TaskDequeItem items[TASK_DEQUE_SIZE];
+} TaskDeque;
+
 struct TaskPool {
 	TaskScheduler *scheduler;
 
@@ -62,18 +88,135 @@ struct TaskScheduler {
 	struct TaskThread *task_threads;
 	int num_threads;
 
+	/* shared queue, for tasks pushed from threads that are not workers
+	 * of this scheduler, or when the queue of a worker is full */
 	ListBase queue;
 	ThreadMutex queue_mutex;
 	ThreadCondition queue_cond;
 
+	/* number of workers waiting on queue_cond */
+	volatile unsigned int num_sleeping;
+
+	/* TaskThread of the worker, NULL for other threads */
+	pthread_key_t thread_key;
+
 	volatile bool do_exit;
 };
 
 typedef struct TaskThread {
 	TaskScheduler *scheduler;
 	int id;
+	TaskDeque deque;
 } TaskThread;
 
+/* Task Deque */
+
+/* only called from the owner thread */
+static bool task_deque_push(TaskDeque *deque, Task *task)
+{
+	const size_t b = deque->bottom;
+	TaskDequeItem *item;
+
+	if (b - deque->top >= TASK_DEQUE_SIZE) {
+		return false;
+	}
+
+	item = &deque->items[b & (TASK_DEQUE_SIZE - 1)];
+	item->task = task;
+	item->pool = task->pool;
+
+	/* full barrier, the item is visible before the new bottom */
+	atomic_add_z((size_t *)&deque->bottom, 1);
+
+	return true;
+}
+
+/* only called from the owner thread, takes the newest task if it belongs to pool (any pool if NULL) */
+static Task *task_deque_pop(TaskDeque *deque, TaskPool *pool)
+{
+	size_t b = deque->bottom;
+	size_t t = deque->top;
+	TaskDequeItem *item;
+	Task *task = NULL;
+
+	if (t >= b) {
+		return NULL;
+	}
+
+	b--;
+	item = &deque->items[b & (TASK_DEQUE_SIZE - 1)];
+	if (pool && item->pool != pool) {
+		return NULL;
+	}
+
+	/* reserve the task, full barrier before reading top */
+	atomic_sub_z((size_t *)&deque->bottom, 1);
+	t = deque->top;
+
+	if (t < b) {
+		/* more than one task left, thieves can't reach this one */
+		return item->task;
+	}
+
+	if (t == b) {
+		/* last task, race against thieves */
+		if (atomic_cas_z((size_t *)&deque->top, t, t + 1) == t) {
+			task = item->task;
+		}
+	}
+
+	/* the deque is empty now */
+	deque->bottom = b + 1;
+
+	return task;
+}
+
+/* called from any thread, takes the oldest task if it belongs to pool (any pool if NULL) */
+static Task *task_deque_steal(TaskDeque *deque, TaskPool *pool)
+{
+	/* full barrier, top is read before bottom */
+	const size_t t = atomic_add_z((size_t *)&deque->top, 0);
+	const size_t b = deque->bottom;
+	TaskDequeItem item;
+
+	if (t >= b) {
+		return NULL;
+	}
+
+	item = deque->items[t & (TASK_DEQUE_SIZE - 1)];
+	if (pool && item.pool != pool) {
+		return NULL;
+	}
+
+	/* another thread took it, the item might have been stale */
+	if (atomic_cas_z((size_t *)&deque->top, t, t + 1) != t) {
+		return NULL;
+	}
+
+	return item.task;
+}
+
+BLI_INLINE bool task_deque_is_empty(TaskDeque *deque)
+{
+	return deque->top >= deque->bottom;
+}
+
+/* check if the deque holds a task of pool anywhere, exact for the owner thread.
+ * for other threads it is only a hint, the items can change while they are read */
+static bool task_deque_has_pool(TaskDeque *deque, TaskPool *pool)
+{
+	const size_t b = deque->bottom;
+	size_t t;
+
+	for (t = deque->top; t < b; t++) {
+		if (deque->items[t & (TASK_DEQUE_SIZE - 1)].pool == pool) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 /* Task Scheduler */
 
 static void task_pool_num_decrease(TaskPool *pool, size_t done)
@@ -101,25 +244,163 @@ static void task_pool_num_increase(TaskPool *pool)
 	BLI_mutex_unlock(&pool->num_mutex);
 }
 
-static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, Task **task)
+static void task_free(Task *task)
+{
+	if (task->free_taskdata)
+		MEM_freeN(task->taskdata);
+	MEM_freeN(task);
+}
+
+static void task_run_and_free(Task *task, int thread_id)
+{
+	TaskPool *pool = task->pool;
+
+	/* tasks of canceled pools still queued by a worker are dropped here */
+	if (!pool->do_cancel)
+		task->run(pool, task->taskdata, thread_id);
+
+	task_free(task);
+
+	/* notify pool task was done */
+	task_pool_num_decrease(pool, 1);
+}
+
+static void task_scheduler_shared_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
 {
 	BLI_mutex_lock(&scheduler->queue_mutex);
 
-	while (!scheduler->queue.first && !scheduler->do_exit)
-		BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+	if (priority == TASK_PRIORITY_HIGH)
+		BLI_addhead(&scheduler->queue, task);
+	else
+		BLI_addtail(&scheduler->queue, task);
 
-	if (!scheduler->queue.first) {
-		BLI_mutex_unlock(&scheduler->queue_mutex);
-		BLI_assert(scheduler->do_exit);
-		return false;
+	BLI_condition_notify_one(&scheduler->queue_cond);
+	BLI_mutex_unlock(&scheduler->queue_mutex);
+}
+
+/* take a task from the shared queue, belonging to pool (any pool if NULL) */
+static Task *task_scheduler_shared_pop(TaskScheduler *scheduler, TaskPool *pool)
+{
+	Task *task;
+
+	/* unlocked check to avoid contention on the lock, pushes wake up sleeping threads */
+	if (scheduler->queue.first == NULL)
+		return NULL;
+
+	BLI_mutex_lock(&scheduler->queue_mutex);
+
+	/* find task from this pool. if we get a task from another pool,
+	 * we can get into deadlock */
+	for (task = scheduler->queue.first; task; task = task->next) {
+		if (pool == NULL || task->pool == pool) {
+			BLI_remlink(&scheduler->queue, task);
+			break;
+		}
 	}
-	
-	*task = scheduler->queue.first;
-	BLI_remlink(&scheduler->queue, *task);
 
 	BLI_mutex_unlock(&scheduler->queue_mutex);
 
-	return true;
+	return task;
+}
+
+/* steal a task from the workers, starting after the worker with the given id.
+ * the own queue is included, its oldest task can be the one a waiting thread needs */
+static Task *task_scheduler_steal(TaskScheduler *scheduler, TaskPool *pool, int thread_id)
+{
+	int i;
+
+	for (i = 0; i < scheduler->num_threads; i++) {
+		TaskThread *victim = &scheduler->task_threads[(thread_id + i) % scheduler->num_threads];
+		Task *task = task_deque_steal(&victim->deque, pool);
+
+		/* tasks of other pools on top are moved to the shared queue, until one of pool is reached */
+		while (task == NULL && pool && task_deque_has_pool(&victim->deque, pool)) {
+			Task *other = task_deque_steal(&victim->deque, NULL);
+			if (other) {
+				if (other->pool == pool)
+					return other;
+				task_scheduler_shared_push(scheduler, other, TASK_PRIORITY_HIGH);
+			}
+			task = task_deque_steal(&victim->deque, pool);
+		}
+
+		if (task)
+			return task;
+	}
+
+	return NULL;
+}
+
+/* find work for a thread, its own tasks first, restricted to pool if not NULL */
+static Task *task_scheduler_find_task(TaskScheduler *scheduler, TaskThread *thread, TaskPool *pool)
+{
+	Task *task = NULL;
+	int thread_id = 0;
+
+	if (thread) {
+		task = task_deque_pop(&thread->deque, pool);
+		thread_id = thread->id;
+
+		/* Tasks of other pools pushed after the ones of pool (by tasks run while waiting)
+		 * are moved to the shared queue, otherwise they hide the tasks this thread waits for. */
+		while (task == NULL && pool && task_deque_has_pool(&thread->deque, pool)) {
+			Task *other = task_deque_pop(&thread->deque, NULL);
+			if (other == NULL)
+				break;
+			if (other->pool == pool) {
+				task = other;
+				break;
+			}
+			task_scheduler_shared_push(scheduler, other, TASK_PRIORITY_HIGH);
+			task = task_deque_pop(&thread->deque, pool);
+		}
+	}
+	if (task == NULL)
+		task = task_scheduler_shared_pop(scheduler, pool);
+	if (task == NULL)
+		task = task_scheduler_steal(scheduler, pool, thread_id);
+
+	return task;
+}
+
+static bool task_scheduler_has_tasks(TaskScheduler *scheduler)
+{
+	int i;
+
+	if (scheduler->queue.first)
+		return true;
+
+	for (i = 0; i < scheduler->num_threads; i++) {
+		if (!task_deque_is_empty(&scheduler->task_threads[i].deque))
+			return true;
+	}
+
+	return false;
+}
+
+static bool task_scheduler_thread_wait_pop(TaskScheduler *scheduler, TaskThread *thread, Task **task)
+{
+	while (!scheduler->do_exit) {
+		*task = task_scheduler_find_task(scheduler, thread, NULL);
+		if (*task)
+			return true;
+
+		/* nothing to do, sleep until a task is pushed */
+		BLI_mutex_lock(&scheduler->queue_mutex);
+
+		/* full barrier, pushing threads either see this thread sleeping
+		 * or the task is visible in the check below */
+		atomic_add_u((unsigned int *)&scheduler->num_sleeping, 1);
+
+		if (!scheduler->do_exit && !task_scheduler_has_tasks(scheduler))
+			BLI_condition_wait(&scheduler->queue_cond, &scheduler->queue_mutex);
+
+		atomic_sub_u((unsigned int *)&scheduler->num_sleeping, 1);
+
+		BLI_mutex_unlock(&scheduler->queue_mutex);
+	}
+
+	return false;
 }
 
 static void *task_scheduler_thread_run(void *thread_p)
@@ -129,22 +410,15 @@ static void *task_scheduler_thread_run(void *thread_p)
 	int thread_id = thread->id;
 	Task *task;
 
-	/* keep popping off tasks */
-	while (task_scheduler_thread_wait_pop(scheduler, &task)) {
-		TaskPool *pool = task->pool;
+	pthread_setspecific(scheduler->thread_key, thread);
 
-		/* run task */
-		task->run(pool, task->taskdata, thread_id);
-
-		/* delete task */
-		if (task->free_taskdata)
-			MEM_freeN(task->taskdata);
-		MEM_freeN(task);
-
-		/* notify pool task was done */
-		task_pool_num_decrease(pool, 1);
+	/* keep popping off tasks */
+	while (task_scheduler_thread_wait_pop(scheduler, thread, &task)) {
+		task_run_and_free(task, thread_id);
 	}
 
+	MEM_thread_exit();
+
 	return NULL;
 }
 
@@ -160,6 +434,8 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 	BLI_mutex_init(&scheduler->queue_mutex);
 	BLI_condition_init(&scheduler->queue_cond);
 
+	pthread_key_create(&scheduler->thread_key, NULL);
+
 	if (num_threads == 0) {
 		/* automatic number of threads will be main thread + num cores */
 		num_threads = BLI_system_thread_count();
@@ -176,14 +452,18 @@ TaskScheduler *BLI_task_scheduler_create(int num_threads)
 		scheduler->threads = MEM_callocN(sizeof(pthread_t) * num_threads, "TaskScheduler threads");
 		scheduler->task_threads = MEM_callocN(sizeof(TaskThread) * num_threads, "TaskScheduler task threads");
 
+		/* initialize all queues before any thread can steal from them */
 		for (i = 0; i < num_threads; i++) {
 			TaskThread *thread = &scheduler->task_threads[i];
 			thread->scheduler = scheduler;
 			thread->id = i + 1;
+		}
+
+		for (i = 0; i < num_threads; i++) {
+			TaskThread *thread = &scheduler->task_threads[i];
 
 			if (pthread_create(&scheduler->threads[i], NULL, task_scheduler_thread_run, thread) != 0) {
 				fprintf(stderr, "TaskScheduler failed to launch thread %d/%d\n", i, num_threads);
-				MEM_freeN(thread);
 			}
 		}
 	}
@@ -213,8 +493,16 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
 		MEM_freeN(scheduler->threads);
 	}
 
-	/* Delete task thread data */
+	/* Delete task thread data, and tasks left in their queues */
 	if (scheduler->task_threads) {
+		int i;
+
+		for (i = 0; i < scheduler->num_threads; i++) {
+			while ((task = task_deque_pop(&scheduler->task_threads[i].deque, NULL))) {
+				task_free(task);
+			}
+		}
+
 		MEM_freeN(scheduler->task_threads);
 	}
 
@@ -229,6 +517,8 @@ void BLI_task_scheduler_free(TaskScheduler *scheduler)
 	BLI_mutex_end(&scheduler->queue_mutex);
 	BLI_condition_end(&scheduler->queue_cond);
 
+	pthread_key_delete(scheduler->thread_key);
+
 	MEM_freeN(scheduler);
 }
 
@@ -239,18 +529,22 @@ int BLI_task_scheduler_num_threads(TaskScheduler *scheduler)
 
 static void task_scheduler_push(TaskScheduler *scheduler, Task *task, TaskPriority priority)
 {
-	task_pool_num_increase(task->pool);
+	TaskThread *thread = pthread_getspecific(scheduler->thread_key);
 
-	/* add task to queue */
-	BLI_mutex_lock(&scheduler->queue_mutex);
+	task_pool_num_increase(task->pool);
 
-	if (priority == TASK_PRIORITY_HIGH)
-		BLI_addhead(&scheduler->queue, task);
-	else
-		BLI_addtail(&scheduler->queue, task);
+	/* workers push to their own queue, without locking */
+	if (thread && task_deque_push(&thread->deque, task)) {
+		/* the push was a full barrier, see task_scheduler_thread_wait_pop */
+		if (scheduler->num_sleeping) {
+			BLI_mutex_lock(&scheduler->queue_mutex);
+			BLI_condition_notify_one(&scheduler->queue_cond);
+			BLI_mutex_unlock(&scheduler->queue_mutex);
+		}
+		return;
+	}
 
-	BLI_condition_notify_one(&scheduler->queue_cond);
-	BLI_mutex_unlock(&scheduler->queue_mutex);
+	task_scheduler_shared_push(scheduler, task, priority);
 }
 
 static void task_scheduler_clear(TaskScheduler *scheduler, TaskPool *pool)
@@ -336,50 +630,31 @@ void BLI_task_pool_push(TaskPool *pool, TaskRunFunction run,
 void BLI_task_pool_work_and_wait(TaskPool *pool)
 {
 	TaskScheduler *scheduler = pool->scheduler;
+	/* when called from a task, the worker running it */
+	TaskThread *thread = pthread_getspecific(scheduler->thread_key);
+	const int thread_id = thread ? thread->id : 0;
 
 	BLI_mutex_lock(&pool->num_mutex);
 
 	while (pool->num != 0) {
-		Task *task, *work_task = NULL;
-		bool found_task = false;
+		Task *work_task;
 
 		BLI_mutex_unlock(&pool->num_mutex);
 
-		BLI_mutex_lock(&scheduler->queue_mutex);
-
-		/* find task from this pool. if we get a task from another pool,
+		/* only run tasks from this pool. if we get a task from another pool,
 		 * we can get into deadlock */
-
-		for (task = scheduler->queue.first; task; task = task->next) {
-			if (task->pool == pool) {
-				work_task = task;
-				found_task = true;
-				BLI_remlink(&scheduler->queue, task);
-				break;
-			}
-		}
-
-		BLI_mutex_unlock(&scheduler->queue_mutex);
+		work_task = task_scheduler_find_task(scheduler, thread, pool);
 
 		/* if found task, do it, otherwise wait until other tasks are done */
-		if (found_task) {
-			/* run task */
-			work_task->run(pool, work_task->taskdata, 0);
-
-			/* delete task */
-			if (work_task->free_taskdata)
-				MEM_freeN(work_task->taskdata);
-			MEM_freeN(work_task);
-
-			/* notify pool task was done */
-			task_pool_num_decrease(pool, 1);
+		if (work_task) {
+			task_run_and_free(work_task, thread_id);
 		}
 
 		BLI_mutex_lock(&pool->num_mutex);
 		if (pool->num == 0)
 			break;
 
-		if (!found_task)
+		if (!work_task)
 			BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
 	}
 
@@ -392,18 +667,19 @@ void BLI_task_pool_cancel(TaskPool *pool)
 
 	task_scheduler_clear(pool->scheduler, pool);
 
-	/* wait until all entries are cleared */
-	BLI_mutex_lock(&pool->num_mutex);
-	while (pool->num)
-		BLI_condition_wait(&pool->num_cond, &pool->num_mutex);
-	BLI_mutex_unlock(&pool->num_mutex);
+	/* wait until all entries are cleared, tasks left in the queues
+	 * of worker threads are dropped when they are taken */
+	BLI_task_pool_work_and_wait(pool);
 
 	pool->do_cancel = false;
 }
 
 void BLI_task_pool_stop(TaskPool *pool)
 {
+	pool->do_cancel = true;
+
 	task_scheduler_clear(pool->scheduler, pool);
+	BLI_task_pool_work_and_wait(pool);
 
 	BLI_assert(pool->num == 0);
 }
@@ -428,3 +704,205 @@ size_t BLI_task_pool_tasks_done(TaskPool *pool)
 	return pool->done;
 }
 
+/* Parallel Range */
+
+/* number of chunks per task with dynamic scheduling */
+#define PARALLEL_RANGE_CHUNKS_PER_TASK 8
+
+typedef struct ParallelRangeState {
+	int start, stop;
+	void *userdata;
+
+	TaskParallelRangeFunc func;
+	TaskParallelRangeFuncEx func_ex;
+
+	int iter;
+	int chunk_size;
+	SpinLock lock;
+} ParallelRangeState;
+
+BLI_INLINE bool parallel_range_next_iter_get(ParallelRangeState *state, int *iter, int *count)
+{
+	bool result = false;
+
+	BLI_spin_lock(&state->lock);
+	if (state->iter < state->stop) {
+		*count = min_ii(state->chunk_size, state->stop - state->iter);
+		*iter = state->iter;
+		state->iter += *count;
+		result = true;
+	}
+	BLI_spin_unlock(&state->lock);
+
+	return result;
+}
+
+static void parallel_range_func(TaskPool *pool, void *userdata_chunk, int threadid)
+{
+	ParallelRangeState *state = BLI_task_pool_userdata(pool);
+	int iter, count, i;
+
+	while (parallel_range_next_iter_get(state, &iter, &count)) {
+		if (state->func_ex) {
+			for (i = 0; i < count; i++) {
+				state->func_ex(state->userdata, userdata_chunk, iter + i, threadid);
+			}
+		}
+		else {
+			for (i = 0; i < count; i++) {
+				state->func(state->userdata, iter + i);
+			}
+		}
+	}
+}
+
+static void parallel_range_execute(
+        int start, int stop,
+        void *userdata,
+        void *userdata_chunk,
+        const size_t userdata_chunk_size,
+        TaskParallelRangeFunc func,
+        TaskParallelRangeFuncEx func_ex,
+        TaskParallelRangeFuncFinalize func_finalize,
+        const bool use_threading,
+        const bool use_dynamic_scheduling)
+{
+	TaskScheduler *task_scheduler;
+	TaskPool *task_pool;
+	ParallelRangeState state;
+	char *userdata_chunk_array = NULL;
+	int i, num_tasks, range;
+
+	BLI_assert(start <= stop);
+	range = stop - start;
+
+	if (range == 0) {
+		return;
+	}
+
+	/* simple, single threaded case, when threading is disabled
+	 * or there is only one iteration */
+	if (!use_threading || range == 1) {
+		void *userdata_chunk_local = NULL;
+
+		if (userdata_chunk_size != 0) {
+			userdata_chunk_local = MEM_mallocN(userdata_chunk_size, "parallel range chunk");
+			memcpy(userdata_chunk_local, userdata_chunk, userdata_chunk_size);
+		}
+
+		for (i = start; i < stop; i++) {
+			if (func_ex) {
+				func_ex(userdata, userdata_chunk_local, i, 0);
+			}
+			else {
+				func(userdata, i);
+			}
+		}
+
+		if (func_finalize) {
+			func_finalize(userdata, userdata_chunk_local);
+		}
+		if (userdata_chunk_local) {
+			MEM_freeN(userdata_chunk_local);
+		}
+		return;
+	}
+
+	task_scheduler = BLI_task_scheduler_get();
+	task_pool = BLI_task_pool_create(task_scheduler, &state);
+
+	/* one task per thread, every task keeps taking chunks until the range is done */
+	num_tasks = BLI_task_scheduler_num_threads(task_scheduler);
+
+	state.start = start;
+	state.stop = stop;
+	state.userdata = userdata;
+	state.func = func;
+	state.func_ex = func_ex;
+	state.iter = start;
+	if (use_dynamic_scheduling) {
+		state.chunk_size = max_ii(1, range / (num_tasks * PARALLEL_RANGE_CHUNKS_PER_TASK));
+	}
+	else {
+		state.chunk_size = max_ii(1, (range + num_tasks - 1) / num_tasks);
+	}
+	BLI_spin_init(&state.lock);
+
+	num_tasks = min_ii(num_tasks, (range + state.chunk_size - 1) / state.chunk_size);
+
+	if (userdata_chunk_size != 0) {
+		userdata_chunk_array = MEM_mallocN(userdata_chunk_size * num_tasks, "parallel range chunks");
+	}
+
+	for (i = 0; i < num_tasks; i++) {
+		void *userdata_chunk_local = NULL;
+
+		if (userdata_chunk_array) {
+			userdata_chunk_local = userdata_chunk_array + userdata_chunk_size * i;
+			memcpy(userdata_chunk_local, userdata_chunk, userdata_chunk_size);
+		}
+
+		BLI_task_pool_push(task_pool, parallel_range_func, userdata_chunk_local, false, TASK_PRIORITY_HIGH);
+	}
+
+	BLI_task_pool_work_and_wait(task_pool);
+	BLI_task_pool_free(task_pool);
+
+	BLI_spin_end(&state.lock);
+
+	/* reduce the results of all tasks, in a fixed order */
+	if (func_finalize) {
+		for (i = 0; i < num_tasks; i++) {
+			func_finalize(userdata, userdata_chunk_array ? userdata_chunk_array + userdata_chunk_size * i : NULL);
+		}
+	}
+
+	if (userdata_chunk_array) {
+		MEM_freeN(userdata_chunk_array);
+	}
+}
+
+/**
+ * This function allows to parallelize for loops in a similar way to OpenMP's 'parallel for' statement.
+ *
+ * \param start First index to process.
+ * \param stop Index to stop looping (excluded).
+ * \param userdata Common userdata passed to all instances of \a func.
+ * \param userdata_chunk Optional, each task gets its own copy of it, passed to \a func_ex.
+ * \param userdata_chunk_size Memory size of \a userdata_chunk.
+ * \param func_ex Callback function, called for every iteration.
+ * \param func_finalize Optional, called for every copy of \a userdata_chunk once all iterations are done.
+ * \param use_threading If \a true, actually split-execute loop in threads, else just do a sequential forloop
+ *                      (allows caller to use any kind of test to switch on parallelization or not).
+ * \param use_dynamic_scheduling If \a true, the whole range is divided in a lot of small chunks,
+ *                               better when iterations take very different amounts of time.
+ */
+void BLI_task_parallel_range_ex(
+        int start, int stop,
+        void *userdata,
+        void *userdata_chunk,
+        const size_t userdata_chunk_size,
+        TaskParallelRangeFuncEx func_ex,
+        TaskParallelRangeFuncFinalize func_finalize,
+        const bool use_threading,
+        const bool use_dynamic_scheduling)
+{
+	parallel_range_execute(
+	        start, stop, userdata, userdata_chunk, userdata_chunk_size, NULL, func_ex, func_finalize,
+	        use_threading, use_dynamic_scheduling);
+}
+
+/**
+ * A simpler version of #BLI_task_parallel_range_ex, which does not use \a userdata_chunk
+ * and always uses static scheduling.
+ */
+void BLI_task_parallel_range(
+        int start, int stop,
+        void *userdata,
+        TaskParallelRangeFunc func,
+        const bool use_threading)
+{
+	parallel_range_execute(
+	        start, stop, userdata, NULL, 0, func, NULL, NULL,
+	        use_threading, false);
+}
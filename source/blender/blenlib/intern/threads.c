@@ -36,12 +36,15 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_listbase.h"
+#include "BLI_memarena.h"
 #include "BLI_gsqueue.h"
 #include "BLI_task.h"
 #include "BLI_threads.h"
 
 #include "PIL_time.h"
 
+#include "atomic_ops.h"
+
 /* for checking system threads - BLI_system_thread_count */
 #ifdef WIN32
 #  include <windows.h>
@@ -64,9 +67,15 @@ extern pthread_key_t gomp_tls_key;
 static void *thread_tls_data;
 #endif
 
+/* Implement ThreadQueue with the lock-free LockfreeQueue,
+ * instead of a GSQueue protected by a mutex. */
+#define USE_LOCKFREE_THREAD_QUEUE
+
 /* We're using one global task scheduler for all kind of tasks. */
 static TaskScheduler *task_scheduler = NULL;
 
+static void thread_scratch_arena_main_free(void);
+
 /* ********** basic thread control API ************ 
  * 
  * Many thread cases have an X amount of jobs, and only an Y amount of
@@ -158,7 +167,9 @@ void BLI_threadapi_exit(void)
 {
 	if (task_scheduler) {
 		BLI_task_scheduler_free(task_scheduler);
+		task_scheduler = NULL;
 	}
+	thread_scratch_arena_main_free();
 	BLI_spin_end(&_malloc_lock);
 }
 
@@ -241,6 +252,7 @@ int BLI_available_thread_index(ListBase *threadbase)
 static void *tslot_thread_start(void *tslot_p)
 {
 	ThreadSlot *tslot = (ThreadSlot *)tslot_p;
+	void *result;
 
 #ifdef USE_APPLE_OMP_FIX
 	/* workaround for Apple gcc 4.2.1 omp vs background thread bug,
@@ -248,7 +260,11 @@ static void *tslot_thread_start(void *tslot_p)
 	pthread_setspecific(gomp_tls_key, thread_tls_data);
 #endif
 
-	return tslot->do_thread(tslot->callerdata);
+	result = tslot->do_thread(tslot->callerdata);
+
+	MEM_thread_exit();
+
+	return result;
 }
 
 int BLI_thread_is_main(void)
@@ -623,6 +639,435 @@ void BLI_condition_end(ThreadCondition *cond)
 
 /* ************************************************ */
 
+static void wait_timeout(struct timespec *timeout, int ms)
+{
+	ldiv_t div_result;
+	long sec, usec, x;
+
+#ifdef WIN32
+	{
+		struct _timeb now;
+		_ftime(&now);
+		sec = now.time;
+		usec = now.millitm * 1000; /* microsecond precision would be better */
+	}
+#else
+	{
+		struct timeval now;
+		gettimeofday(&now, NULL);
+		sec = now.tv_sec;
+		usec = now.tv_usec;
+	}
+#endif
+
+	/* add current time + millisecond offset */
+	div_result = ldiv(ms, 1000);
+	timeout->tv_sec = sec + div_result.quot;
+
+	x = usec + (div_result.rem * 1000);
+
+	if (x >= 1000000) {
+		timeout->tv_sec++;
+		x -= 1000000;
+	}
+
+	timeout->tv_nsec = x * 1000;
+}
+
+/* ************************************************ */
+
+/* Bounded lock-free queue, based on the MPMC queue by Dmitry Vyukov:
+ * every cell has a sequence number telling whether it is ready to be written
+ * (sequence == position) or read (sequence == position + 1), producers and consumers
+ * claim a position with a single compare and swap. */
+
+/* number of attempts before a blocking push or pop goes to sleep */
+#define LOCKFREE_QUEUE_SPIN 64
+
+typedef struct LockfreeQueueCell {
+	size_t sequence;
+	void *work;
+} LockfreeQueueCell;
+
+struct LockfreeQueue {
+	LockfreeQueueCell *cells;
+	size_t mask;
+
+	/* keep positions on their own cache lines, they are written by different threads */
+	char _pad0[64];
+	size_t push_pos;
+	char _pad1[64];
+	size_t pop_pos;
+	char _pad2[64];
+
+	/* only used by threads waiting for work or space */
+	unsigned int num_waiting;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	volatile int nowait;
+};
+
+LockfreeQueue *BLI_lockfree_queue_init(unsigned int size)
+{
+	LockfreeQueue *queue;
+	size_t i, tot = 2;
+
+	while (tot < size) {
+		tot <<= 1;
+	}
+
+	queue = MEM_callocN(sizeof(LockfreeQueue), "LockfreeQueue");
+	queue->cells = MEM_mallocN(sizeof(*queue->cells) * tot, "LockfreeQueue cells");
+	queue->mask = tot - 1;
+
+	for (i = 0; i < tot; i++) {
+		queue->cells[i].sequence = i;
+	}
+
+	pthread_mutex_init(&queue->mutex, NULL);
+	pthread_cond_init(&queue->cond, NULL);
+
+	return queue;
+}
+
+void BLI_lockfree_queue_free(LockfreeQueue *queue)
+{
+	/* assumes no one is using queue anymore */
+	pthread_cond_destroy(&queue->cond);
+	pthread_mutex_destroy(&queue->mutex);
+
+	MEM_freeN(queue->cells);
+	MEM_freeN(queue);
+}
+
+static bool lockfree_queue_push(LockfreeQueue *queue, void *work)
+{
+	LockfreeQueueCell *cell;
+	size_t pos = *(volatile size_t *)&queue->push_pos;
+
+	for (;;) {
+		size_t sequence;
+
+		cell = &queue->cells[pos & queue->mask];
+		sequence = *(volatile size_t *)&cell->sequence;
+
+		if (sequence == pos) {
+			const size_t pos_prev = atomic_cas_z(&queue->push_pos, pos, pos + 1);
+			if (pos_prev == pos) {
+				break;
+			}
+			pos = pos_prev;
+		}
+		else if ((ptrdiff_t)(sequence - pos) < 0) {
+			/* full */
+			return false;
+		}
+		else {
+			/* another thread pushed here first */
+			pos = *(volatile size_t *)&queue->push_pos;
+		}
+	}
+
+	cell->work = work;
+	/* publish the work, the atomic add is a full barrier */
+	atomic_add_z(&cell->sequence, 1);
+
+	return true;
+}
+
+static bool lockfree_queue_pop(LockfreeQueue *queue, void **r_work)
+{
+	LockfreeQueueCell *cell;
+	size_t pos = *(volatile size_t *)&queue->pop_pos;
+
+	for (;;) {
+		size_t sequence;
+
+		cell = &queue->cells[pos & queue->mask];
+		sequence = *(volatile size_t *)&cell->sequence;
+
+		if (sequence == pos + 1) {
+			const size_t pos_prev = atomic_cas_z(&queue->pop_pos, pos, pos + 1);
+			if (pos_prev == pos) {
+				break;
+			}
+			pos = pos_prev;
+		}
+		else if ((ptrdiff_t)(sequence - (pos + 1)) < 0) {
+			/* empty */
+			return false;
+		}
+		else {
+			pos = *(volatile size_t *)&queue->pop_pos;
+		}
+	}
+
+	*r_work = cell->work;
+	/* make the cell available for writing once the queue wrapped around */
+	atomic_add_z(&cell->sequence, queue->mask);
+
+	return true;
+}
+
+/* wake threads waiting for work or space, only takes the lock when there are any */
+static void lockfree_queue_notify(LockfreeQueue *queue)
+{
+	if (queue->num_waiting) {
+		pthread_mutex_lock(&queue->mutex);
+		pthread_cond_broadcast(&queue->cond);
+		pthread_mutex_unlock(&queue->mutex);
+	}
+}
+
+/**
+ * Push without waiting, \return false when the queue is full.
+ */
+bool BLI_lockfree_queue_try_push(LockfreeQueue *queue, void *work)
+{
+	if (lockfree_queue_push(queue, work)) {
+		lockfree_queue_notify(queue);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Pop without waiting, \return false when the queue is empty.
+ */
+bool BLI_lockfree_queue_try_pop(LockfreeQueue *queue, void **r_work)
+{
+	if (lockfree_queue_pop(queue, r_work)) {
+		lockfree_queue_notify(queue);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * Push, waiting for space while the queue is full.
+ */
+void BLI_lockfree_queue_push(LockfreeQueue *queue, void *work)
+{
+	int i;
+
+	for (i = 0; i < LOCKFREE_QUEUE_SPIN; i++) {
+		if (BLI_lockfree_queue_try_push(queue, work)) {
+			return;
+		}
+	}
+
+	pthread_mutex_lock(&queue->mutex);
+	/* the atomic add is a full barrier, so either we see the free space,
+	 * or the popping thread sees us waiting */
+	atomic_add_uint32(&queue->num_waiting, 1);
+	while (!lockfree_queue_push(queue, work)) {
+		pthread_cond_wait(&queue->cond, &queue->mutex);
+	}
+	atomic_sub_uint32(&queue->num_waiting, 1);
+	pthread_mutex_unlock(&queue->mutex);
+
+	lockfree_queue_notify(queue);
+}
+
+/**
+ * Pop, waiting for work while the queue is empty.
+ *
+ * \param timeout_ms  Maximum time to wait in milliseconds, or -1 to wait until there is work.
+ * \return false when nothing could be popped, because of the timeout or #BLI_lockfree_queue_nowait.
+ */
+bool BLI_lockfree_queue_pop(LockfreeQueue *queue, void **r_work, int timeout_ms)
+{
+	struct timespec timeout;
+	bool found = false;
+	int i;
+
+	for (i = 0; i < LOCKFREE_QUEUE_SPIN; i++) {
+		if (BLI_lockfree_queue_try_pop(queue, r_work)) {
+			return true;
+		}
+		if (queue->nowait) {
+			return false;
+		}
+	}
+
+	if (timeout_ms >= 0) {
+		wait_timeout(&timeout, timeout_ms);
+	}
+
+	pthread_mutex_lock(&queue->mutex);
+	atomic_add_uint32(&queue->num_waiting, 1);
+	while (!(found = lockfree_queue_pop(queue, r_work)) && !queue->nowait) {
+		if (timeout_ms < 0) {
+			pthread_cond_wait(&queue->cond, &queue->mutex);
+		}
+		else if (pthread_cond_timedwait(&queue->cond, &queue->mutex, &timeout) == ETIMEDOUT) {
+			found = lockfree_queue_pop(queue, r_work);
+			break;
+		}
+	}
+	atomic_sub_uint32(&queue->num_waiting, 1);
+	pthread_mutex_unlock(&queue->mutex);
+
+	if (found) {
+		lockfree_queue_notify(queue);
+	}
+
+	return found;
+}
+
+/**
+ * Number of work items in the queue, only approximate while other threads push or pop.
+ */
+unsigned int BLI_lockfree_queue_size(LockfreeQueue *queue)
+{
+	const size_t pop_pos = *(volatile size_t *)&queue->pop_pos;
+	const size_t push_pos = *(volatile size_t *)&queue->push_pos;
+	return (push_pos > pop_pos) ? (unsigned int)(push_pos - pop_pos) : 0;
+}
+
+/**
+ * Stop waiting for work, blocked and future pops return right away when the queue is empty.
+ */
+void BLI_lockfree_queue_nowait(LockfreeQueue *queue)
+{
+	pthread_mutex_lock(&queue->mutex);
+
+	queue->nowait = 1;
+
+	pthread_cond_broadcast(&queue->cond);
+	pthread_mutex_unlock(&queue->mutex);
+}
+
+/* ************************************************ */
+
+#ifdef USE_LOCKFREE_THREAD_QUEUE
+
+/* ThreadQueue on top of LockfreeQueue. It is unbounded, so work which doesn't fit
+ * in the ring goes to an overflow queue under a lock. Once there is overflow all
+ * pushes go there and popping threads move it back into the ring, keeping the order. */
+
+#define THREAD_QUEUE_RING_SIZE 1024
+
+struct ThreadQueue {
+	LockfreeQueue *ring;
+	GSQueue *overflow;          /* protected by 'mutex' */
+	volatile int overflow_len;
+	unsigned int totwork;       /* work in 'ring' and 'overflow', updated atomically */
+	pthread_mutex_t mutex;
+	pthread_cond_t finish_cond;
+};
+
+ThreadQueue *BLI_thread_queue_init(void)
+{
+	ThreadQueue *queue;
+
+	queue = MEM_callocN(sizeof(ThreadQueue), "ThreadQueue");
+	queue->ring = BLI_lockfree_queue_init(THREAD_QUEUE_RING_SIZE);
+	queue->overflow = BLI_gsqueue_new(sizeof(void *));
+
+	pthread_mutex_init(&queue->mutex, NULL);
+	pthread_cond_init(&queue->finish_cond, NULL);
+
+	return queue;
+}
+
+void BLI_thread_queue_free(ThreadQueue *queue)
+{
+	/* destroy everything, assumes no one is using queue anymore */
+	pthread_cond_destroy(&queue->finish_cond);
+	pthread_mutex_destroy(&queue->mutex);
+
+	BLI_gsqueue_free(queue->overflow);
+	BLI_lockfree_queue_free(queue->ring);
+
+	MEM_freeN(queue);
+}
+
+/* move as much overflow into the ring as fits, called with the mutex locked */
+static void thread_queue_overflow_flush(ThreadQueue *queue)
+{
+	void *work;
+
+	while (queue->overflow_len) {
+		BLI_gsqueue_peek(queue->overflow, &work);
+		if (!BLI_lockfree_queue_try_push(queue->ring, work)) {
+			break;
+		}
+		BLI_gsqueue_pop(queue->overflow, &work);
+		queue->overflow_len--;
+	}
+}
+
+void BLI_thread_queue_push(ThreadQueue *queue, void *work)
+{
+	atomic_add_uint32(&queue->totwork, 1);
+
+	if (queue->overflow_len || !BLI_lockfree_queue_try_push(queue->ring, work)) {
+		pthread_mutex_lock(&queue->mutex);
+		BLI_gsqueue_push(queue->overflow, &work);
+		queue->overflow_len++;
+		/* the ring may have been emptied in the meantime */
+		thread_queue_overflow_flush(queue);
+		pthread_mutex_unlock(&queue->mutex);
+	}
+}
+
+static void *thread_queue_pop_ex(ThreadQueue *queue, int timeout_ms)
+{
+	void *work = NULL;
+
+	if (BLI_lockfree_queue_pop(queue->ring, &work, timeout_ms)) {
+		if (queue->overflow_len) {
+			pthread_mutex_lock(&queue->mutex);
+			thread_queue_overflow_flush(queue);
+			pthread_mutex_unlock(&queue->mutex);
+		}
+
+		/* don't use the return value, it differs between platforms */
+		atomic_sub_uint32(&queue->totwork, 1);
+		if (*(volatile unsigned int *)&queue->totwork == 0) {
+			pthread_mutex_lock(&queue->mutex);
+			pthread_cond_broadcast(&queue->finish_cond);
+			pthread_mutex_unlock(&queue->mutex);
+		}
+	}
+
+	return work;
+}
+
+void *BLI_thread_queue_pop(ThreadQueue *queue)
+{
+	return thread_queue_pop_ex(queue, -1);
+}
+
+void *BLI_thread_queue_pop_timeout(ThreadQueue *queue, int ms)
+{
+	return thread_queue_pop_ex(queue, ms);
+}
+
+int BLI_thread_queue_size(ThreadQueue *queue)
+{
+	return (int)queue->totwork;
+}
+
+void BLI_thread_queue_nowait(ThreadQueue *queue)
+{
+	BLI_lockfree_queue_nowait(queue->ring);
+}
+
+void BLI_thread_queue_wait_finish(ThreadQueue *queue)
+{
+	/* wait for finish condition */
+	pthread_mutex_lock(&queue->mutex);
+
+	while (queue->totwork)
+		pthread_cond_wait(&queue->finish_cond, &queue->mutex);
+
+	pthread_mutex_unlock(&queue->mutex);
+}
+
+#else  /* USE_LOCKFREE_THREAD_QUEUE */
+
 struct ThreadQueue {
 	GSQueue *queue;
 	pthread_mutex_t mutex;
@@ -691,41 +1136,6 @@ void *BLI_thread_queue_pop(ThreadQueue *queue)
 	return work;
 }
 
-static void wait_timeout(struct timespec *timeout, int ms)
-{
-	ldiv_t div_result;
-	long sec, usec, x;
-
-#ifdef WIN32
-	{
-		struct _timeb now;
-		_ftime(&now);
-		sec = now.time;
-		usec = now.millitm * 1000; /* microsecond precision would be better */
-	}
-#else
-	{
-		struct timeval now;
-		gettimeofday(&now, NULL);
-		sec = now.tv_sec;
-		usec = now.tv_usec;
-	}
-#endif
-
-	/* add current time + millisecond offset */
-	div_result = ldiv(ms, 1000);
-	timeout->tv_sec = sec + div_result.quot;
-
-	x = usec + (div_result.rem * 1000);
-
-	if (x >= 1000000) {
-		timeout->tv_sec++;
-		x -= 1000000;
-	}
-
-	timeout->tv_nsec = x * 1000;
-}
-
 void *BLI_thread_queue_pop_timeout(ThreadQueue *queue, int ms)
 {
 	double t;
@@ -790,6 +1200,8 @@ void BLI_thread_queue_wait_finish(ThreadQueue *queue)
 	pthread_mutex_unlock(&queue->mutex);
 }
 
+#endif  /* USE_LOCKFREE_THREAD_QUEUE */
+
 /* ************************************************ */
 
 void BLI_begin_threaded_malloc(void)
@@ -813,3 +1225,51 @@ void BLI_end_threaded_malloc(void)
 		MEM_set_lock_callback(NULL, NULL);
 }
 
+/* ************************************************ */
+
+static pthread_key_t thread_scratch_key;
+static pthread_once_t thread_scratch_once = PTHREAD_ONCE_INIT;
+
+static void thread_scratch_arena_free(void *arena)
+{
+	BLI_memarena_free(arena);
+}
+
+static void thread_scratch_key_create(void)
+{
+	/* arenas of other threads are freed when they exit */
+	pthread_key_create(&thread_scratch_key, thread_scratch_arena_free);
+}
+
+/**
+ * \return The scratch arena of the calling thread, created on first use.
+ */
+MemArena *BLI_thread_scratch_arena(void)
+{
+	MemArena *arena;
+
+	pthread_once(&thread_scratch_once, thread_scratch_key_create);
+
+	arena = pthread_getspecific(thread_scratch_key);
+	if (UNLIKELY(arena == NULL)) {
+		arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, "thread scratch arena");
+		pthread_setspecific(thread_scratch_key, arena);
+	}
+
+	return arena;
+}
+
+/* key destructors don't run for the main thread */
+static void thread_scratch_arena_main_free(void)
+{
+	MemArena *arena;
+
+	pthread_once(&thread_scratch_once, thread_scratch_key_create);
+
+	arena = pthread_getspecific(thread_scratch_key);
+	if (arena) {
+		BLI_memarena_free(arena);
+		pthread_setspecific(thread_scratch_key, NULL);
+	}
+}
+
@@ -37,6 +37,7 @@
 #include "BLI_math.h"
 #include "BLI_memarena.h"
 #include "BLI_polyfill2d.h"
+#include "BLI_threads.h"
 
 #include "bmesh.h"
 #include "bmesh_tools.h"
@@ -1213,6 +1214,7 @@ void BM_bmesh_calc_tessellation(BMesh *bm, BMLoop *(*looptris)[3], int *r_looptr
 	int i = 0;
 
 	MemArena *arena = NULL;
+	MemArenaMark arena_mark;
 
 	BM_ITER_MESH (efa, &iter, bm, BM_FACES_OF_MESH) {
 		/* don't consider two-edged faces */
@@ -1286,7 +1288,8 @@ void BM_bmesh_calc_tessellation(BMesh *bm, BMLoop *(*looptris)[3], int *r_looptr
 			const int totfilltri = efa->len - 2;
 
 			if (UNLIKELY(arena == NULL)) {
-				arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
+				arena = BLI_thread_scratch_arena();
+				BLI_memarena_mark(arena, &arena_mark);
 			}
 
 			tris = BLI_memarena_alloc(arena, sizeof(*tris) * totfilltri);
@@ -1314,15 +1317,10 @@ void BM_bmesh_calc_tessellation(BMesh *bm, BMLoop *(*looptris)[3], int *r_looptr
 				l_ptr[2] = l_arr[tri[0]];
 			}
 
-			BLI_memarena_clear(arena);
+			BLI_memarena_rollback(arena, &arena_mark);
 		}
 	}
 
-	if (arena) {
-		BLI_memarena_free(arena);
-		arena = NULL;
-	}
-
 	*r_looptris_tot = i;
 
 	BLI_assert(i <= looptris_tot);
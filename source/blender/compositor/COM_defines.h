@@ -109,4 +109,10 @@ typedef enum OrderOfChunks {
 
 #define COM_BLUR_BOKEH_PIXELS 512
 
+/**
+ * @brief number of pixels left of size pixels when executing at 1/divider of the resolution
+ * @see CompositorContext.getProxyDivider
+ */
+#define COM_PROXY_SIZE(size, divider) (((size) + (divider) - 1) / (divider))
+
 #endif  /* __COM_DEFINES_H__ */
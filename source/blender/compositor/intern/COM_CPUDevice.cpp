@@ -22,16 +22,20 @@
 
 #include "COM_CPUDevice.h"
 
+#include "PIL_time.h"
+
 void CPUDevice::execute(WorkPackage *work)
 {
 	const unsigned int chunkNumber = work->getChunkNumber();
 	ExecutionGroup *executionGroup = work->getExecutionGroup();
+	const double start = PIL_check_seconds_timer();
 	rcti rect;
 
 	executionGroup->determineChunkRect(&rect, chunkNumber);
 
 	executionGroup->getOutputOperation()->executeRegion(&rect, chunkNumber);
 
+	executionGroup->addChunkStatistics(&rect, PIL_check_seconds_timer() - start);
 	executionGroup->finalizeChunkExecution(chunkNumber, NULL);
 }
 
@@ -186,6 +186,19 @@ public:
 	void setFastCalculation(bool fastCalculation) {this->m_fastCalculation = fastCalculation;}
 	bool isFastCalculation() const { return this->m_fastCalculation; }
 	bool isGroupnodeBufferEnabled() const { return this->getbNodeTree()->flag & NTREE_COM_GROUPNODE_BUFFER; }
+	bool isStreamingEnabled() const { return (this->getbNodeTree()->flag & NTREE_COM_STREAMING) != 0; }
+	bool isProfilingEnabled() const { return (this->getbNodeTree()->flag & NTREE_COM_PROFILE) != 0; }
+
+	/**
+	 * @brief get the factor the resolution of the whole tree is divided by, always 1 when rendering
+	 * @see bNodeTree.edit_proxy
+	 */
+	int getProxyDivider() const { return this->m_rendering ? 1 : 1 << this->getbNodeTree()->edit_proxy; }
+
+	/**
+	 * @brief get the factor to apply to settings given in pixels
+	 */
+	float getProxyScale() const { return 1.0f / this->getProxyDivider(); }
 };
 
 
@@ -37,6 +37,7 @@
 #include "COM_Debug.h"
 
 #include "MEM_guardedalloc.h"
+#include "atomic_ops.h"
 #include "BLI_math.h"
 #include "BLI_string.h"
 #include "BKE_global.h"
@@ -62,6 +63,8 @@ ExecutionGroup::ExecutionGroup()
 	this->m_chunksFinished = 0;
 	BLI_rcti_init(&this->m_viewerBorder, 0, 0, 0, 0);
 	this->m_executionStartTime = 0;
+	this->m_executionTime = 0;
+	this->m_pixelsProcessed = 0;
 }
 
 CompositorPriority ExecutionGroup::getRenderPriotrity()
@@ -115,6 +118,9 @@ void ExecutionGroup::initExecution()
 	unsigned int index;
 	determineNumberOfChunks();
 
+	this->m_executionTime = 0;
+	this->m_pixelsProcessed = 0;
+
 	this->m_chunkExecutionStates = NULL;
 	if (this->m_numberOfChunks != 0) {
 		this->m_chunkExecutionStates = (ChunkExecutionState *)MEM_mallocN(sizeof(ChunkExecutionState) * this->m_numberOfChunks, __func__);
@@ -203,8 +209,13 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 	float centerX = 0.5;
 	float centerY = 0.5;
 	OrderOfChunks chunkorder = COM_ORDER_OF_CHUNKS_DEFAULT;
+	const bool use_streaming = context.isStreamingEnabled();
 
-	if (operation->isViewerOperation()) {
+	if (use_streaming) {
+		/* bands are calculated from top to bottom */
+		chunkorder = COM_TO_TOP_DOWN;
+	}
+	else if (operation->isViewerOperation()) {
 		ViewerOperation *viewer = (ViewerOperation *)operation;
 		centerX = viewer->getCenterX();
 		centerY = viewer->getCenterY();
@@ -303,6 +314,32 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 	DebugInfo::execution_group_started(this);
 	DebugInfo::graphviz(graph);
 
+	if (use_streaming) {
+		/* Only the rows of the intermediate buffers needed by the current band are kept in memory,
+		 * rows which are not needed anymore are freed before the next band is calculated. */
+		bool breaked = false;
+		for (unsigned int yChunk = 0; yChunk < this->m_numberOfYChunks && !breaked; yChunk++) {
+			rcti band;
+			determineBandRect(&band, yChunk);
+			graph->updateStreamingBuffers(this, &band);
+			breaked = scheduleChunks(graph, &chunkOrder[yChunk * this->m_numberOfXChunks], this->m_numberOfXChunks);
+		}
+	}
+	else {
+		scheduleChunks(graph, chunkOrder, this->m_numberOfChunks);
+	}
+
+	DebugInfo::execution_group_finished(this);
+	DebugInfo::graphviz(graph);
+
+	MEM_freeN(chunkOrder);
+}
+
+bool ExecutionGroup::scheduleChunks(ExecutionSystem *graph, const unsigned int *chunkOrder, unsigned int numberOfChunks)
+{
+	const bNodeTree *bTree = this->m_bTree;
+	unsigned int index;
+	unsigned int chunkNumber;
 	bool breaked = false;
 	bool finished = false;
 	unsigned int startIndex = 0;
@@ -313,7 +350,7 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 		finished = true;
 		int numberEvaluated = 0;
 
-		for (index = startIndex; index < this->m_numberOfChunks && numberEvaluated < maxNumberEvaluated; index++) {
+		for (index = startIndex; index < numberOfChunks && numberEvaluated < maxNumberEvaluated; index++) {
 			chunkNumber = chunkOrder[index];
 			int yChunk = chunkNumber / this->m_numberOfXChunks;
 			int xChunk = chunkNumber - (yChunk * this->m_numberOfXChunks);
@@ -343,10 +380,8 @@ void ExecutionGroup::execute(ExecutionSystem *graph)
 			breaked = true;
 		}
 	}
-	DebugInfo::execution_group_finished(this);
-	DebugInfo::graphviz(graph);
 
-	MEM_freeN(chunkOrder);
+	return breaked;
 }
 
 MemoryBuffer **ExecutionGroup::getInputBuffersOpenCL(int chunkNumber)
@@ -435,6 +470,12 @@ void ExecutionGroup::finalizeChunkExecution(int chunkNumber, MemoryBuffer **memo
 	}
 }
 
+void ExecutionGroup::addChunkStatistics(const rcti *rect, double time)
+{
+	atomic_add_z(&this->m_executionTime, (size_t)(time * 1e6));
+	atomic_add_z(&this->m_pixelsProcessed, (size_t)BLI_rcti_size_x(rect) * BLI_rcti_size_y(rect));
+}
+
 inline void ExecutionGroup::determineChunkRect(rcti *rect, const unsigned int xChunk, const unsigned int yChunk) const
 {
 	const int border_width = BLI_rcti_size_x(&this->m_viewerBorder);
@@ -574,6 +615,126 @@ void ExecutionGroup::determineDependingAreaOfInterest(rcti *input, ReadBufferOpe
 	this->getOutputOperation()->determineDependingAreaOfInterest(input, readOperation, output);
 }
 
+void ExecutionGroup::determineBandRect(rcti *rect, const unsigned int yChunk) const
+{
+	rcti last;
+	determineChunkRect(rect, 0, yChunk);
+	determineChunkRect(&last, this->m_numberOfXChunks - 1, yChunk);
+	rect->xmax = last.xmax;
+}
+
+bool ExecutionGroup::determineUnexecutedArea(const rcti *rect, rcti *r_area) const
+{
+	bool found = false;
+	rcti chunkRect;
+
+	for (unsigned int chunkNumber = 0; chunkNumber < this->m_numberOfChunks; chunkNumber++) {
+		if (this->m_chunkExecutionStates[chunkNumber] == COM_ES_EXECUTED) {
+			continue;
+		}
+		determineChunkRect(&chunkRect, chunkNumber);
+		if (chunkRect.xmin >= rect->xmax || chunkRect.xmax <= rect->xmin ||
+		    chunkRect.ymin >= rect->ymax || chunkRect.ymax <= rect->ymin)
+		{
+			continue;
+		}
+		if (found) {
+			BLI_rcti_union(r_area, &chunkRect);
+		}
+		else {
+			*r_area = chunkRect;
+			found = true;
+		}
+	}
+	return found;
+}
+
+void ExecutionGroup::alignAreaToChunkRows(rcti *area) const
+{
+	if (this->m_singleThreaded) {
+		*area = this->m_viewerBorder;
+		return;
+	}
+
+	const int chunkSize = this->m_chunkSize;
+	const int miny = max_ii(area->ymin - this->m_viewerBorder.ymin, 0);
+	const int maxy = min_ii(area->ymax - this->m_viewerBorder.ymin, BLI_rcti_size_y(&this->m_viewerBorder));
+
+	if (maxy <= miny || area->xmax <= this->m_viewerBorder.xmin || area->xmin >= this->m_viewerBorder.xmax) {
+		BLI_rcti_init(area, 0, 0, 0, 0);
+		return;
+	}
+
+	area->xmin = this->m_viewerBorder.xmin;
+	area->xmax = this->m_viewerBorder.xmax;
+	area->ymin = this->m_viewerBorder.ymin + (miny / chunkSize) * chunkSize;
+	area->ymax = min_ii(this->m_viewerBorder.ymin + ((maxy + chunkSize - 1) / chunkSize) * chunkSize,
+	                    this->m_viewerBorder.ymax);
+}
+
+void ExecutionGroup::determineStreamingAreas(const rcti *rect, StreamingAreas *areas, bool all_chunks)
+{
+	rcti unexecuted;
+	if (all_chunks) {
+		unexecuted = *rect;
+	}
+	else if (!determineUnexecutedArea(rect, &unexecuted)) {
+		return;
+	}
+
+	for (unsigned int index = 0; index < this->m_cachedReadOperations.size(); index++) {
+		ReadBufferOperation *readOperation = (ReadBufferOperation *)this->m_cachedReadOperations[index];
+		MemoryProxy *memoryProxy = readOperation->getMemoryProxy();
+		ExecutionGroup *group = memoryProxy->getExecutor();
+		rcti area;
+
+		BLI_rcti_init(&area, 0, 0, 0, 0);
+		determineDependingAreaOfInterest(&unexecuted, readOperation, &area);
+		group->alignAreaToChunkRows(&area);
+		if (BLI_rcti_is_empty(&area)) {
+			continue;
+		}
+
+		StreamingAreas::iterator found = areas->find(memoryProxy);
+		if (found != areas->end()) {
+			if (BLI_rcti_inside_rcti(&found->second, &area)) {
+				/* nothing new needed from this buffer */
+				continue;
+			}
+			BLI_rcti_union(&found->second, &area);
+			area = found->second;
+		}
+		else {
+			(*areas)[memoryProxy] = area;
+		}
+
+		group->determineStreamingAreas(&area, areas, all_chunks);
+	}
+}
+
+void ExecutionGroup::discardChunks(const rcti *window)
+{
+	rcti keep = *window;
+	rcti chunkRect;
+
+	for (unsigned int chunkNumber = 0; chunkNumber < this->m_numberOfChunks; chunkNumber++) {
+		if (this->m_chunkExecutionStates[chunkNumber] != COM_ES_EXECUTED) {
+			continue;
+		}
+		determineChunkRect(&chunkRect, chunkNumber);
+		if (!BLI_rcti_inside_rcti(&keep, &chunkRect)) {
+			this->m_chunkExecutionStates[chunkNumber] = COM_ES_NOT_SCHEDULED;
+		}
+	}
+}
+
+void ExecutionGroup::setChunksExecuted()
+{
+	for (unsigned int chunkNumber = 0; chunkNumber < this->m_numberOfChunks; chunkNumber++) {
+		this->m_chunkExecutionStates[chunkNumber] = COM_ES_EXECUTED;
+	}
+}
+
 void ExecutionGroup::determineDependingMemoryProxies(vector<MemoryProxy *> *memoryProxies)
 {
 	unsigned int index;
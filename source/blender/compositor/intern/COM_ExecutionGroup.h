@@ -26,6 +26,7 @@
 #include "COM_Node.h"
 #include "COM_NodeOperation.h"
 #include <vector>
+#include <map>
 #include "BLI_rect.h"
 #include "COM_MemoryProxy.h"
 #include "COM_Device.h"
@@ -65,6 +66,7 @@ typedef enum ChunkExecutionState {
 class ExecutionGroup {
 public:
 	 typedef std::vector<NodeOperation*> Operations;
+	 typedef std::map<MemoryProxy *, rcti> StreamingAreas;
 	
 private:
 	// fields
@@ -178,6 +180,17 @@ private:
 	 */
 	double m_executionStartTime;
 
+	/**
+	 * @brief wall time spent executing chunks of this group, in microseconds, summed over all devices
+	 * @note updated atomically, chunks finish concurrently
+	 */
+	size_t m_executionTime;
+
+	/**
+	 * @brief number of output pixels calculated by this group
+	 */
+	size_t m_pixelsProcessed;
+
 	// methods
 	/**
 	 * @brief check whether parameter operation can be added to the execution group
@@ -246,6 +259,23 @@ private:
 	 */
 	void determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
 
+	/**
+	 * @brief schedule chunks in the given order until all are executed or the execution has breaked
+	 * @return true when the execution has breaked (by user)
+	 */
+	bool scheduleChunks(ExecutionSystem *graph, const unsigned int *chunkOrder, unsigned int numberOfChunks);
+
+	/**
+	 * @brief determine the area covered by the chunks of rect that are not executed yet
+	 * @return false when all chunks are executed
+	 */
+	bool determineUnexecutedArea(const rcti *rect, rcti *r_area) const;
+
+	/**
+	 * @brief extend area to whole rows of chunks, clamped to the group resolution
+	 */
+	void alignAreaToChunkRows(rcti *area) const;
+
 
 public:
 	// constructors
@@ -302,6 +332,11 @@ public:
 	 * @brief does this ExecutionGroup contains a complex NodeOperation
 	 */
 	bool isComplex() const { return m_complex; }
+
+	/**
+	 * @brief is this ExecutionGroup executed as a single chunk
+	 */
+	bool isSingleThreaded() const { return m_singleThreaded; }
 	
 	
 	/**
@@ -357,6 +392,26 @@ public:
 	 * @param memorybuffers
 	 */
 	void finalizeChunkExecution(int chunkNumber, MemoryBuffer **memoryBuffers);
+
+	/**
+	 * @brief add the statistics of an executed chunk, used for profiling
+	 * @note called by the devices, can be called from multiple threads at once
+	 * @param rect the area that has been calculated
+	 * @param time wall time in seconds it took to calculate the chunk
+	 */
+	void addChunkStatistics(const rcti *rect, double time);
+
+	/**
+	 * @brief wall time in seconds spent executing the chunks of this group since initExecution
+	 */
+	double getExecutionTime() const { return this->m_executionTime * 1e-6; }
+
+	/**
+	 * @brief number of pixels calculated since initExecution
+	 */
+	size_t getPixelsProcessed() const { return this->m_pixelsProcessed; }
+
+	const Operations &getOperations() const { return this->m_operations; }
 	
 	/**
 	 * @brief deinitExecution is called just after execution the whole graph.
@@ -388,6 +443,35 @@ public:
 	 * @param memoryProxies result
 	 */
 	void determineDependingMemoryProxies(vector<MemoryProxy *> *memoryProxies);
+
+	/**
+	 * @brief gather the areas of all MemoryProxy's (recursively) needed to calculate rect
+	 * @note areas are whole rows of chunks of the MemoryProxy's executor
+	 * @param rect the area of this group to calculate
+	 * @param areas result, merged with the areas already in it
+	 * @param all_chunks also include chunks that are already executed
+	 */
+	void determineStreamingAreas(const rcti *rect, StreamingAreas *areas, bool all_chunks);
+
+	/**
+	 * @brief discard executed chunks that are not completely inside window
+	 * @note used when the rows of a streaming MemoryProxy are freed
+	 */
+	void discardChunks(const rcti *window);
+
+	/**
+	 * @brief mark all chunks as executed without scheduling them
+	 * @note used when the output buffer wraps memory that is already filled in
+	 * @see MemoryProxy.wrap
+	 */
+	void setChunksExecuted();
+
+	/**
+	 * @brief get the area of a band (row of chunks) of this group
+	 */
+	void determineBandRect(rcti *rect, const unsigned int yChunk) const;
+
+	unsigned int getNumberOfYChunks() const { return this->m_numberOfYChunks; }
 	
 	/**
 	 * @brief Determine the rect (minx, maxx, miny, maxy) of a chunk.
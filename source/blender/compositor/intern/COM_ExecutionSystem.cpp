@@ -22,8 +22,13 @@
 
 #include "COM_ExecutionSystem.h"
 
+#include <algorithm>
+#include <map>
+#include <set>
+
 #include "PIL_time.h"
 #include "BLI_utildefines.h"
+#include "BLI_string.h"
 extern "C" {
 #include "BKE_node.h"
 }
@@ -34,6 +39,7 @@ extern "C" {
 #include "COM_ExecutionGroup.h"
 #include "COM_WorkScheduler.h"
 #include "COM_ReadBufferOperation.h"
+#include "COM_WriteBufferOperation.h"
 #include "COM_Debug.h"
 
 #include "BKE_global.h"
@@ -137,11 +143,30 @@ void ExecutionSystem::execute()
 	}
 	unsigned int index;
 
+	for (index = 0; index < this->m_groups.size(); index++) {
+		ExecutionGroup *executionGroup = this->m_groups[index];
+		executionGroup->setChunksize(this->m_context.getChunksize());
+		executionGroup->initExecution();
+	}
+
+	/* needs to be known before the buffers are allocated */
+	determineStreamingProxies();
+
+	/* write buffer operations are initialized last, they can wrap the memory of their input */
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
 		operation->setbNodeTree(this->m_context.getbNodeTree());
-		operation->initExecution();
+		if (!operation->isWriteBufferOperation()) {
+			operation->initExecution();
+		}
 	}
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			operation->initExecution();
+		}
+	}
+	determineWrappedProxies();
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
 		if (operation->isReadBufferOperation()) {
@@ -149,12 +174,13 @@ void ExecutionSystem::execute()
 			readOperation->updateMemoryBuffer();
 		}
 	}
-	for (index = 0; index < this->m_groups.size(); index++) {
-		ExecutionGroup *executionGroup = this->m_groups[index];
-		executionGroup->setChunksize(this->m_context.getChunksize());
-		executionGroup->initExecution();
+
+	if (!this->m_streamingProxies.empty()) {
+		reportStreamingMemory();
 	}
 
+	const double startTime = PIL_check_seconds_timer();
+
 	WorkScheduler::start(this->m_context);
 
 	executeGroups(COM_PRIORITY_HIGH);
@@ -166,6 +192,11 @@ void ExecutionSystem::execute()
 	WorkScheduler::finish();
 	WorkScheduler::stop();
 
+	/* write buffer operations still know their input until deinitExecution */
+	if (this->m_context.isProfilingEnabled()) {
+		reportProfile(PIL_check_seconds_timer() - startTime);
+	}
+
 	for (index = 0; index < this->m_operations.size(); index++) {
 		NodeOperation *operation = this->m_operations[index];
 		operation->deinitExecution();
@@ -209,3 +240,309 @@ void ExecutionSystem::findOutputExecutionGroup(vector<ExecutionGroup *> *result)
 		}
 	}
 }
+
+void ExecutionSystem::determineStreamingProxies()
+{
+	unsigned int index;
+	this->m_streamingProxies.clear();
+
+	if (!this->m_context.isStreamingEnabled()) {
+		return;
+	}
+
+	/* complex operations are free to access their input buffers as a whole */
+	std::set<MemoryProxy *> wholeProxies;
+	for (index = 0; index < this->m_groups.size(); index++) {
+		ExecutionGroup *group = this->m_groups[index];
+		if (group->isComplex()) {
+			vector<MemoryProxy *> memoryProxies;
+			group->determineDependingMemoryProxies(&memoryProxies);
+			wholeProxies.insert(memoryProxies.begin(), memoryProxies.end());
+		}
+	}
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isReadBufferOperation()) {
+			ReadBufferOperation *readOperation = (ReadBufferOperation *)operation;
+			if (!readOperation->isStreamingSupported()) {
+				wholeProxies.insert(readOperation->getMemoryProxy());
+			}
+		}
+	}
+
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+			MemoryProxy *memoryProxy = writeOperation->getMemoryProxy();
+			ExecutionGroup *executor = memoryProxy->getExecutor();
+			/* single values are read from (0, 0) by every pixel */
+			bool streaming = (executor != NULL &&
+			                  !executor->isSingleThreaded() &&
+			                  !writeOperation->isSingleValue() &&
+			                  wholeProxies.find(memoryProxy) == wholeProxies.end());
+
+			memoryProxy->setStreaming(streaming);
+			if (streaming) {
+				this->m_streamingProxies.push_back(memoryProxy);
+			}
+		}
+	}
+}
+
+void ExecutionSystem::determineWrappedProxies()
+{
+	unsigned int index;
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			MemoryProxy *memoryProxy = ((WriteBufferOperation *)operation)->getMemoryProxy();
+			ExecutionGroup *executor = memoryProxy->getExecutor();
+			if (memoryProxy->isWrapped() && executor != NULL) {
+				/* content is already there, nothing to calculate */
+				executor->setChunksExecuted();
+			}
+		}
+	}
+
+	/* wrapped buffers always hold all rows */
+	vector<MemoryProxy *>::iterator iter = this->m_streamingProxies.begin();
+	while (iter != this->m_streamingProxies.end()) {
+		if ((*iter)->isStreaming()) {
+			++iter;
+		}
+		else {
+			iter = this->m_streamingProxies.erase(iter);
+		}
+	}
+}
+
+void ExecutionSystem::updateStreamingBuffers(ExecutionGroup *group, rcti *band)
+{
+	unsigned int index;
+	ExecutionGroup::StreamingAreas areas;
+	group->determineStreamingAreas(band, &areas, false);
+
+	for (index = 0; index < this->m_streamingProxies.size(); index++) {
+		MemoryProxy *memoryProxy = this->m_streamingProxies[index];
+		ExecutionGroup::StreamingAreas::const_iterator found = areas.find(memoryProxy);
+		rcti window;
+
+		if (found != areas.end()) {
+			window = found->second;
+		}
+		else {
+			BLI_rcti_init(&window, 0, 0, 0, 0);
+		}
+		memoryProxy->setWindow(&window);
+		memoryProxy->getExecutor()->discardChunks(&window);
+	}
+
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isReadBufferOperation()) {
+			ReadBufferOperation *readOperation = (ReadBufferOperation *)operation;
+			if (readOperation->getMemoryProxy()->isStreaming()) {
+				readOperation->updateMemoryBuffer();
+			}
+		}
+	}
+}
+
+void ExecutionSystem::reportStreamingMemory()
+{
+	unsigned int index;
+	size_t wholeMemory = 0;
+	size_t streamingMemory = 0;
+	const size_t pixelSize = sizeof(float) * COM_NUMBER_OF_CHANNELS;
+
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			MemoryProxy *memoryProxy = ((WriteBufferOperation *)operation)->getMemoryProxy();
+			if (!memoryProxy->isStreaming()) {
+				wholeMemory += (size_t)memoryProxy->getWidth() * memoryProxy->getHeight() * pixelSize;
+			}
+		}
+	}
+
+	/* the largest set of rows needed by any band, assuming nothing can be reused from the previous band */
+	vector<ExecutionGroup *> executionGroups;
+	this->findOutputExecutionGroup(&executionGroups);
+	for (index = 0; index < executionGroups.size(); index++) {
+		ExecutionGroup *group = executionGroups[index];
+		for (unsigned int yChunk = 0; yChunk < group->getNumberOfYChunks(); yChunk++) {
+			ExecutionGroup::StreamingAreas areas;
+			rcti band;
+			size_t bandMemory = 0;
+
+			group->determineBandRect(&band, yChunk);
+			group->determineStreamingAreas(&band, &areas, true);
+			for (ExecutionGroup::StreamingAreas::const_iterator iter = areas.begin(); iter != areas.end(); ++iter) {
+				if (iter->first->isStreaming()) {
+					bandMemory += (size_t)BLI_rcti_size_x(&iter->second) * BLI_rcti_size_y(&iter->second) * pixelSize;
+				}
+			}
+			streamingMemory = max(streamingMemory, bandMemory);
+		}
+	}
+
+	char str[256];
+	BLI_snprintf(str, sizeof(str), "Compositing | Buffers at most %.2fM (streamed %.2fM, whole %.2fM)",
+	             (wholeMemory + streamingMemory) / (1024.0 * 1024.0),
+	             streamingMemory / (1024.0 * 1024.0),
+	             wholeMemory / (1024.0 * 1024.0));
+
+	if (G.background) {
+		printf("%s\n", str);
+		fflush(stdout);
+	}
+
+	const bNodeTree *bTree = this->m_context.getbNodeTree();
+	if (bTree->stats_draw) {
+		bTree->stats_draw(bTree->sdh, str);
+	}
+}
+
+/* statistics of an editor node, summed over all operations created for it */
+typedef struct NodeProfile {
+	bNode *node;
+	double time;
+	size_t pixels;
+	size_t memory;
+	int operations;
+} NodeProfile;
+
+typedef std::map<bNode *, NodeProfile> NodeProfiles;
+
+static NodeProfile &profile_get(NodeProfiles &profiles, bNode *node)
+{
+	NodeProfiles::iterator iter = profiles.find(node);
+	if (iter == profiles.end()) {
+		NodeProfile profile = {node, 0.0, 0, 0, 0};
+		iter = profiles.insert(NodeProfiles::value_type(node, profile)).first;
+	}
+	return iter->second;
+}
+
+static bool profile_time_greater(const NodeProfile &a, const NodeProfile &b)
+{
+	return a.time > b.time;
+}
+
+/* Group nodes get the time of all nodes inside them. Only the nodes of the executed tree
+ * itself store a time, group trees can be linked from a library or shared between files
+ * and are never written to from the compositor thread. */
+static float profile_node_time(const NodeProfiles &profiles, bNode *node)
+{
+	if (node->type == NODE_GROUP && node->id) {
+		float time = 0.0f;
+		for (bNode *inner = (bNode *)((bNodeTree *)node->id)->nodes.first; inner; inner = inner->next) {
+			time += profile_node_time(profiles, inner);
+		}
+		return time;
+	}
+
+	NodeProfiles::const_iterator iter = profiles.find(node);
+	return (iter != profiles.end()) ? (float)iter->second.time : 0.0f;
+}
+
+static void profile_print_json_string(const char *str)
+{
+	fputc('"', stdout);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\') {
+			fputc('\\', stdout);
+		}
+		fputc(*str, stdout);
+	}
+	fputc('"', stdout);
+}
+
+void ExecutionSystem::reportProfile(double time)
+{
+	NodeProfiles profiles;
+	unsigned int index;
+
+	/* The time of a chunk can only be measured for the execution group as a whole,
+	 * complex operations have a group of their own so the expensive nodes are measured exactly.
+	 * The time of other groups is divided over the operations calculating pixels in it. */
+	for (index = 0; index < this->m_groups.size(); index++) {
+		ExecutionGroup *group = this->m_groups[index];
+		const ExecutionGroup::Operations &operations = group->getOperations();
+		std::map<bNode *, int> counts;
+		int total = 0;
+
+		if (group->getPixelsProcessed() == 0) {
+			continue;
+		}
+
+		for (ExecutionGroup::Operations::const_iterator iter = operations.begin(); iter != operations.end(); ++iter) {
+			NodeOperation *operation = *iter;
+			if (!operation->isReadBufferOperation() && !operation->isWriteBufferOperation()) {
+				counts[operation->getbNode()]++;
+				total++;
+			}
+		}
+
+		for (std::map<bNode *, int>::const_iterator iter = counts.begin(); iter != counts.end(); ++iter) {
+			NodeProfile &profile = profile_get(profiles, iter->first);
+			profile.time += group->getExecutionTime() * iter->second / total;
+			profile.pixels += group->getPixelsProcessed();
+			profile.operations += iter->second;
+		}
+	}
+
+	/* buffers belong to the operation writing them */
+	for (index = 0; index < this->m_operations.size(); index++) {
+		NodeOperation *operation = this->m_operations[index];
+		if (operation->isWriteBufferOperation()) {
+			WriteBufferOperation *writeOperation = (WriteBufferOperation *)operation;
+			NodeOperation *input = writeOperation->getInput();
+			NodeProfile &profile = profile_get(profiles, input ? input->getbNode() : NULL);
+			profile.memory += writeOperation->getMemoryProxy()->getPeakMemory();
+		}
+	}
+
+	vector<NodeProfile> sorted;
+	for (NodeProfiles::const_iterator iter = profiles.begin(); iter != profiles.end(); ++iter) {
+		sorted.push_back(iter->second);
+	}
+	std::sort(sorted.begin(), sorted.end(), profile_time_greater);
+
+	/* show the times in the node editor */
+	bNodeTree *bTree = (bNodeTree *)this->m_context.getbNodeTree();
+	for (bNode *node = (bNode *)bTree->nodes.first; node; node = node->next) {
+		node->exec_time = profile_node_time(profiles, node);
+	}
+
+	char str[256];
+	if (!sorted.empty() && sorted[0].node) {
+		BLI_snprintf(str, sizeof(str), "Compositing | Profiled %.2fs, slowest node %s %.2fs",
+		             time, sorted[0].node->name, sorted[0].time);
+	}
+	else {
+		BLI_snprintf(str, sizeof(str), "Compositing | Profiled %.2fs", time);
+	}
+	if (bTree->stats_draw) {
+		bTree->stats_draw(bTree->sdh, str);
+	}
+
+	if (G.background) {
+		printf("{\"compositor_profile\": {\"tree\": ");
+		profile_print_json_string(bTree->id.name + 2);
+		printf(", \"time\": %.6f, \"nodes\": [", time);
+		for (index = 0; index < sorted.size(); index++) {
+			const NodeProfile &profile = sorted[index];
+			printf("%s\n  {\"name\": ", index ? "," : "");
+			/* operations added by the compositor itself, e.g. data type conversions */
+			profile_print_json_string(profile.node ? profile.node->name : "");
+			printf(", \"type\": ");
+			profile_print_json_string(profile.node ? profile.node->idname : "");
+			printf(", \"time\": %.6f, \"pixels\": %lu, \"memory\": %lu, \"operations\": %d}",
+			       profile.time, (unsigned long)profile.pixels, (unsigned long)profile.memory, profile.operations);
+		}
+		printf("\n]}}\n");
+		fflush(stdout);
+	}
+}
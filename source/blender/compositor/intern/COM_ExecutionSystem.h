@@ -134,6 +134,12 @@ private:
 	 */
 	Groups m_groups;
 
+	/**
+	 * @brief MemoryProxy's which only keep the rows needed by the band being calculated
+	 * @see CompositorContext.isStreamingEnabled
+	 */
+	vector<MemoryProxy *> m_streamingProxies;
+
 private: //methods
 	/**
 	 * find all execution group with output nodes
@@ -176,9 +182,45 @@ public:
 	 */
 	const CompositorContext &getContext() const { return this->m_context; }
 
+	/**
+	 * @brief move the windows of the streaming MemoryProxy's to the rows needed to calculate band
+	 * @note called by the output ExecutionGroup before the chunks of a band are scheduled
+	 */
+	void updateStreamingBuffers(ExecutionGroup *group, rcti *band);
+
 private:
 	void executeGroups(CompositorPriority priority);
 
+	/**
+	 * @brief determine the MemoryProxy's that can be streamed.
+	 * @note buffers read by complex operations or written by single threaded groups are kept
+	 * completely in memory, complex operations may access their input buffers as a whole.
+	 */
+	void determineStreamingProxies();
+
+	/**
+	 * @brief skip the calculation of buffers that wrap the memory of their input.
+	 * @note called after the operations are initialized.
+	 * @see NodeOperation.getDirectBuffer
+	 */
+	void determineWrappedProxies();
+
+	/**
+	 * @brief determine an upper bound of the memory used by the buffers while streaming
+	 * and report it before the execution starts
+	 */
+	void reportStreamingMemory();
+
+	/**
+	 * @brief report the time, pixels and buffer memory used per editor node
+	 * @note stores the time in bNode.exec_time of the nodes in the executed tree for the node editor,
+	 * nodes inside groups are only counted in the time of their group node.
+	 * In background mode the statistics are printed as JSON.
+	 * @param time wall time of the whole execution in seconds
+	 * @see CompositorContext.isProfilingEnabled
+	 */
+	void reportProfile(double time);
+
 	/* allow the DebugInfo class to look at internals */
 	friend class DebugInfo;
 
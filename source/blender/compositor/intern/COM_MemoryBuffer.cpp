@@ -50,6 +50,7 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, unsigned int chunkNumber, r
 	this->m_state = COM_MB_ALLOCATED;
 	this->m_datatype = COM_DT_COLOR;
 	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
+	this->m_readOnly = false;
 }
 
 MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
@@ -61,7 +62,21 @@ MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect)
 	this->m_state = COM_MB_TEMPORARILY;
 	this->m_datatype = COM_DT_COLOR;
 	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
+	this->m_readOnly = false;
 }
+
+MemoryBuffer::MemoryBuffer(MemoryProxy *memoryProxy, float *buffer, rcti *rect)
+{
+	BLI_rcti_init(&this->m_rect, rect->xmin, rect->xmax, rect->ymin, rect->ymax);
+	this->m_memoryProxy = memoryProxy;
+	this->m_chunkNumber = 1;
+	this->m_buffer = buffer;
+	this->m_state = COM_MB_AVAILABLE;
+	this->m_datatype = COM_DT_COLOR;
+	this->m_chunkWidth = this->m_rect.xmax - this->m_rect.xmin;
+	this->m_readOnly = true;
+}
+
 MemoryBuffer *MemoryBuffer::duplicate()
 {
 	MemoryBuffer *result = new MemoryBuffer(this->m_memoryProxy, &this->m_rect);
@@ -70,6 +85,7 @@ MemoryBuffer *MemoryBuffer::duplicate()
 }
 void MemoryBuffer::clear()
 {
+	BLI_assert(!this->m_readOnly);
 	memset(this->m_buffer, 0, this->determineBufferSize() * COM_NUMBER_OF_CHANNELS * sizeof(float));
 }
 
@@ -130,7 +146,7 @@ float MemoryBuffer::getMaximumValue(rcti *rect)
 
 MemoryBuffer::~MemoryBuffer()
 {
-	if (this->m_buffer) {
+	if (this->m_buffer && !this->m_readOnly) {
 		MEM_freeN(this->m_buffer);
 		this->m_buffer = NULL;
 	}
@@ -142,6 +158,7 @@ void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
 		BLI_assert(0);
 		return;
 	}
+	BLI_assert(!this->m_readOnly);
 	unsigned int otherY;
 	unsigned int minX = max(this->m_rect.xmin, otherBuffer->m_rect.xmin);
 	unsigned int maxX = min(this->m_rect.xmax, otherBuffer->m_rect.xmax);
@@ -160,6 +177,7 @@ void MemoryBuffer::copyContentFrom(MemoryBuffer *otherBuffer)
 
 void MemoryBuffer::writePixel(int x, int y, const float color[4])
 {
+	BLI_assert(!this->m_readOnly);
 	if (x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 	    y >= this->m_rect.ymin && y < this->m_rect.ymax)
 	{
@@ -170,6 +188,7 @@ void MemoryBuffer::writePixel(int x, int y, const float color[4])
 
 void MemoryBuffer::addPixel(int x, int y, const float color[4])
 {
+	BLI_assert(!this->m_readOnly);
 	if (x >= this->m_rect.xmin && x < this->m_rect.xmax &&
 	    y >= this->m_rect.ymin && y < this->m_rect.ymax)
 	{
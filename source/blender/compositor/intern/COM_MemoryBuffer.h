@@ -97,6 +97,12 @@ private:
 	 */
 	float *m_buffer;
 
+	/**
+	 * @brief the buffer wraps memory owned by someone else (render result, image)
+	 * @note the memory is not freed and should not be written to
+	 */
+	bool m_readOnly;
+
 public:
 	/**
 	 * @brief construct new MemoryBuffer for a chunk
@@ -108,6 +114,13 @@ public:
 	 */
 	MemoryBuffer(MemoryProxy *memoryProxy, rcti *rect);
 	
+	/**
+	 * @brief construct a read only MemoryBuffer wrapping existing memory
+	 * @note the memory should contain COM_NUMBER_OF_CHANNELS floats per pixel of rect
+	 *       and stay valid as long as the MemoryBuffer exists.
+	 */
+	MemoryBuffer(MemoryProxy *memoryProxy, float *buffer, rcti *rect);
+	
 	/**
 	 * @brief destructor
 	 */
@@ -214,6 +227,11 @@ public:
 		int y2 = y1 + 1;
 		wrap_pixel(x1, y1, extend_x, extend_y);
 		wrap_pixel(x2, y2, extend_x, extend_y);
+		/* read() expects coordinates relative to the MemoryProxy */
+		x1 += m_rect.xmin;
+		y1 += m_rect.ymin;
+		x2 += m_rect.xmin;
+		y2 += m_rect.ymin;
 
 		float valuex = x - x1;
 		float valuey = y - y1;
@@ -253,6 +271,11 @@ public:
 	 */
 	inline const bool isTemporarily() const { return this->m_state == COM_MB_TEMPORARILY; }
 	
+	/**
+	 * @brief does this MemoryBuffer wrap memory it does not own
+	 */
+	inline bool isReadOnly() const { return this->m_readOnly; }
+	
 	/**
 	 * @brief add the content from otherBuffer to this MemoryBuffer
 	 * @param otherBuffer source buffer
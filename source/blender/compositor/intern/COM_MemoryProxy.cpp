@@ -27,6 +27,16 @@ MemoryProxy::MemoryProxy()
 {
 	this->m_writeBufferOperation = NULL;
 	this->m_executor = NULL;
+	this->m_buffer = NULL;
+	this->m_streaming = false;
+	this->m_width = 0;
+	this->m_height = 0;
+	this->m_peakMemory = 0;
+}
+
+static size_t memory_proxy_rect_memory(const rcti *rect)
+{
+	return (size_t)BLI_rcti_size_x(rect) * BLI_rcti_size_y(rect) * COM_NUMBER_OF_CHANNELS * sizeof(float);
 }
 
 void MemoryProxy::allocate(unsigned int width, unsigned int height)
@@ -35,11 +45,53 @@ void MemoryProxy::allocate(unsigned int width, unsigned int height)
 	result.xmin = 0;
 	result.xmax = width;
 	result.ymin = 0;
-	result.ymax = height;
+	result.ymax = this->m_streaming ? 0 : height;
 
+	this->m_width = width;
+	this->m_height = height;
+	this->m_peakMemory = memory_proxy_rect_memory(&result);
 	this->m_buffer = new MemoryBuffer(this, 1, &result);
 }
 
+void MemoryProxy::wrap(float *buffer, unsigned int width, unsigned int height)
+{
+	rcti result;
+	BLI_rcti_init(&result, 0, width, 0, height);
+
+	this->m_width = width;
+	this->m_height = height;
+	this->m_streaming = false;
+	this->m_peakMemory = 0;
+	this->m_buffer = new MemoryBuffer(this, buffer, &result);
+}
+
+bool MemoryProxy::isWrapped() const
+{
+	return this->m_buffer && this->m_buffer->isReadOnly();
+}
+
+void MemoryProxy::setWindow(const rcti *window)
+{
+	rcti result;
+	BLI_rcti_init(&result, 0, this->m_width, 0, 0);
+	if (!BLI_rcti_is_empty(window)) {
+		result.ymin = window->ymin;
+		result.ymax = window->ymax;
+	}
+
+	MemoryBuffer *buffer = this->m_buffer;
+	if (buffer && buffer->getRect()->ymin == result.ymin && buffer->getRect()->ymax == result.ymax) {
+		return;
+	}
+
+	this->m_peakMemory = max(this->m_peakMemory, memory_proxy_rect_memory(&result));
+	this->m_buffer = new MemoryBuffer(this, 1, &result);
+	if (buffer) {
+		this->m_buffer->copyContentFrom(buffer);
+		delete buffer;
+	}
+}
+
 void MemoryProxy::free()
 {
 	if (this->m_buffer) {
@@ -63,6 +63,23 @@ private:
 	 */
 	MemoryBuffer *m_buffer;
 
+	/**
+	 * @brief only a window of rows is kept in memory
+	 * @see ExecutionSystem.updateStreamingBuffers
+	 */
+	bool m_streaming;
+
+	/**
+	 * @brief full resolution of the buffer
+	 */
+	unsigned int m_width;
+	unsigned int m_height;
+
+	/**
+	 * @brief largest number of bytes allocated for the buffer at once
+	 */
+	size_t m_peakMemory;
+
 public:
 	MemoryProxy();
 	
@@ -94,6 +111,18 @@ public:
 	 */
 	void allocate(unsigned int width, unsigned int height);
 
+	/**
+	 * @brief use existing memory of size width x height instead of allocating it
+	 * @note the buffer is read only and never streamed
+	 * @see NodeOperation.getDirectBuffer
+	 */
+	void wrap(float *buffer, unsigned int width, unsigned int height);
+
+	/**
+	 * @brief is the buffer wrapping existing memory
+	 */
+	bool isWrapped() const;
+
 	/**
 	 * @brief free the allocated memory
 	 */
@@ -104,6 +133,29 @@ public:
 	 */
 	inline MemoryBuffer *getBuffer() { return this->m_buffer; }
 
+	/**
+	 * @brief set whether only a window of rows is kept in memory
+	 * @note needs to be set before allocate is called
+	 */
+	void setStreaming(bool streaming) { this->m_streaming = streaming; }
+	bool isStreaming() const { return this->m_streaming; }
+
+	unsigned int getWidth() const { return this->m_width; }
+	unsigned int getHeight() const { return this->m_height; }
+
+	/**
+	 * @brief move the window of a streaming buffer
+	 * @note content of rows inside both the old and the new window is kept,
+	 * the executor needs to discard the chunks outside the new window.
+	 * @param window the new window, an empty rect frees all rows
+	 */
+	void setWindow(const rcti *window);
+
+	/**
+	 * @brief largest amount of memory (in bytes) the buffer used since allocate was called
+	 */
+	size_t getPeakMemory() const { return this->m_peakMemory; }
+
 #ifdef WITH_CXX_GUARDEDALLOC
 	MEM_CXX_CLASS_ALLOC_FUNCS("COM:MemoryProxy")
 #endif
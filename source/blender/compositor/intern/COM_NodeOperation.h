@@ -121,6 +121,12 @@ private:
 	 */
 	const bNodeTree *m_btree;
 
+	/**
+	 * @brief the editor node this operation was created for, NULL for internal operations
+	 * @note only used to attribute profiling statistics, see ExecutionSystem.reportProfile
+	 */
+	bNode *m_bNode;
+
 	/**
 	 * @brief set to truth when resolution for this operation is set
 	 */
@@ -166,6 +172,8 @@ public:
 	virtual int isSingleThreaded() { return false; }
 
 	void setbNodeTree(const bNodeTree *tree) { this->m_btree = tree; }
+	void setbNode(bNode *node) { this->m_bNode = node; }
+	bNode *getbNode() const { return this->m_bNode; }
 	virtual void initExecution();
 	
 	/**
@@ -287,6 +295,25 @@ public:
 	virtual bool isPreviewOperation() const { return false; }
 	virtual bool isFileOutputOperation() const { return false; }
 	virtual bool isProxyOperation() const { return false; }
+	virtual bool isDownsampleOperation() const { return false; }
+
+	/**
+	 * @brief does this operation read external image data at its own resolution (images, render layers, clips)
+	 * @note the outputs of these operations are downsampled when a proxy resolution is used.
+	 * @see CompositorContext.getProxyDivider
+	 */
+	virtual bool hasOwnResolution() const { return false; }
+
+	/**
+	 * @brief memory containing the complete output of this operation
+	 *
+	 * The memory is laid out like a MemoryBuffer of the resolution of this operation
+	 * (COM_NUMBER_OF_CHANNELS floats per pixel) and stays valid until deinitExecution.
+	 * Buffers of this operation wrap the memory instead of copying it.
+	 * @note only available after initExecution, NULL when not supported
+	 * @see MemoryProxy.wrap
+	 */
+	virtual float *getDirectBuffer() { return NULL; }
 	
 	virtual bool useDatatypeConversion() const { return true; }
 	
@@ -39,6 +39,7 @@ extern "C" {
 #include "COM_ReadBufferOperation.h"
 #include "COM_WriteBufferOperation.h"
 #include "COM_ViewerOperation.h"
+#include "COM_DownsampleOperation.h"
 
 #include "COM_NodeOperationBuilder.h" /* own include */
 
@@ -107,9 +108,11 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 	
 	resolve_proxies();
 	
+	add_proxy_downsampling();
+	
 	determineResolutions();
 	
-	/* surround complex ops with read/write buffer */
+	/* surround complex ops with read/write buffer, cache downsampled inputs */
 	add_complex_operation_buffers();
 	
 	/* links not available from here on */
@@ -130,6 +133,8 @@ void NodeOperationBuilder::convertToOperations(ExecutionSystem *system)
 
 void NodeOperationBuilder::addOperation(NodeOperation *operation)
 {
+	if (m_current_node)
+		operation->setbNode(m_current_node->getbNode());
 	m_operations.push_back(operation);
 }
 
@@ -209,6 +214,9 @@ PreviewOperation *NodeOperationBuilder::make_preview_operation() const
 	/* do not calculate previews of hidden nodes */
 	if (m_current_node->getbNode()->flag & NODE_HIDDEN)
 		return NULL;
+	/* every preview would calculate the streamed buffers again */
+	if (m_context->isStreamingEnabled())
+		return NULL;
 	
 	bNodeInstanceHash *previews = m_context->getPreviewHash();
 	if (previews) {
@@ -390,6 +398,40 @@ void NodeOperationBuilder::resolve_proxies()
 	}
 }
 
+void NodeOperationBuilder::add_proxy_downsampling()
+{
+	const int divider = m_context->getProxyDivider();
+	if (divider == 1)
+		return;
+	
+	/* note: adding operations invalidates iterators over m_operations */
+	Operations input_ops;
+	for (Operations::const_iterator it = m_operations.begin(); it != m_operations.end(); ++it)
+		if ((*it)->hasOwnResolution())
+			input_ops.push_back(*it);
+	
+	for (Operations::const_iterator it = input_ops.begin(); it != input_ops.end(); ++it) {
+		NodeOperation *op = *it;
+		for (int index = 0; index < op->getNumberOfOutputSockets(); index++) {
+			NodeOperationOutput *output = op->getOutputSocket(index);
+			OpInputs targets = cache_output_links(output);
+			if (targets.empty())
+				continue;
+			
+			DownsampleOperation *downsample = new DownsampleOperation(output->getDataType());
+			downsample->setDivider(divider);
+			downsample->setbNode(op->getbNode());
+			addOperation(downsample);
+			
+			for (OpInputs::const_iterator it_target = targets.begin(); it_target != targets.end(); ++it_target) {
+				removeInputLink(*it_target);
+				addLink(downsample->getOutputSocket(), *it_target);
+			}
+			addLink(output, downsample->getInputSocket(0));
+		}
+	}
+}
+
 void NodeOperationBuilder::determineResolutions()
 {
 	/* determine all resolutions of the operations (Width/Height) */
@@ -549,10 +591,13 @@ void NodeOperationBuilder::add_complex_operation_buffers()
 	/* note: complex ops and get cached here first, since adding operations
 	 * will invalidate iterators over the main m_operations
 	 */
-	Operations complex_ops;
-	for (Operations::const_iterator it = m_operations.begin(); it != m_operations.end(); ++it)
+	Operations complex_ops, downsample_ops;
+	for (Operations::const_iterator it = m_operations.begin(); it != m_operations.end(); ++it) {
 		if ((*it)->isComplex())
 			complex_ops.push_back(*it);
+		else if ((*it)->isDownsampleOperation())
+			downsample_ops.push_back(*it);
+	}
 	
 	for (Operations::const_iterator it = complex_ops.begin(); it != complex_ops.end(); ++it) {
 		NodeOperation *op = *it;
@@ -565,6 +610,12 @@ void NodeOperationBuilder::add_complex_operation_buffers()
 		for (int index = 0; index < op->getNumberOfOutputSockets(); index++)
 			add_output_buffers(op, op->getOutputSocket(index));
 	}
+	
+	/* downsampled inputs are calculated once and read from the buffer afterwards */
+	for (Operations::const_iterator it = downsample_ops.begin(); it != downsample_ops.end(); ++it) {
+		NodeOperation *op = *it;
+		add_output_buffers(op, op->getOutputSocket());
+	}
 }
 
 typedef std::set<NodeOperation*> Tags;
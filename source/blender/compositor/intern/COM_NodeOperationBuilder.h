@@ -137,6 +137,9 @@ protected:
 	/** Replace proxy operations with direct links */
 	void resolve_proxies();
 	
+	/** Downsample the outputs of operations with their own resolution when a proxy resolution is used */
+	void add_proxy_downsampling();
+	
 	/** Calculate resolution for each operation */
 	void determineResolutions();
 	
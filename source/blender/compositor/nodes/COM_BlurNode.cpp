@@ -50,6 +50,14 @@ void BlurNode::convertToOperations(NodeConverter &converter, const CompositorCon
 	CompositorQuality quality = context.getQuality();
 	NodeOperation *input_operation = NULL, *output_operation = NULL;
 
+	/* the operations copy the settings, sizes are given in pixels of the full resolution */
+	NodeBlurData proxy_data = *data;
+	if (!data->relative) {
+		proxy_data.sizex = (short)(data->sizex * context.getProxyScale() + 0.5f);
+		proxy_data.sizey = (short)(data->sizey * context.getProxyScale() + 0.5f);
+	}
+	data = &proxy_data;
+
 	if (data->filtertype == R_FILTER_FAST_GAUSS) {
 		FastGaussianBlurOperation *operationfgb = new FastGaussianBlurOperation();
 		operationfgb->setData(data);
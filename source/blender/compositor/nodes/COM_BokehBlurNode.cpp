@@ -46,8 +46,9 @@ void BokehBlurNode::convertToOperations(NodeConverter &converter, const Composit
 		VariableSizeBokehBlurOperation *operation = new VariableSizeBokehBlurOperation();
 		operation->setQuality(context.getQuality());
 		operation->setThreshold(0.0f);
-		operation->setMaxBlur(b_node->custom4);
+		operation->setMaxBlur(b_node->custom4 * context.getProxyScale());
 		operation->setDoScaleSize(true);
+		operation->setExact((b_node->custom1 & CMP_NODEFLAG_BLUR_EXACT) != 0);
 		
 		converter.addOperation(operation);
 		converter.mapInputSocket(getInputSocket(0), operation->getInputSocket(0));
@@ -58,6 +59,7 @@ void BokehBlurNode::convertToOperations(NodeConverter &converter, const Composit
 	else {
 		BokehBlurOperation *operation = new BokehBlurOperation();
 		operation->setQuality(context.getQuality());
+		operation->setExact((b_node->custom1 & CMP_NODEFLAG_BLUR_EXACT) != 0);
 		
 		converter.addOperation(operation);
 		converter.mapInputSocket(getInputSocket(0), operation->getInputSocket(0));
@@ -60,8 +60,8 @@ void BoxMaskNode::convertToOperations(NodeConverter &converter, const Compositor
 		scaleOperation->setIsAspect(false);
 		scaleOperation->setIsCrop(false);
 		scaleOperation->setOffset(0.0f, 0.0f);
-		scaleOperation->setNewWidth(rd->xsch * rd->size / 100.0f);
-		scaleOperation->setNewHeight(rd->ysch * rd->size / 100.0f);
+		scaleOperation->setNewWidth(COM_PROXY_SIZE(rd->xsch * rd->size / 100, context.getProxyDivider()));
+		scaleOperation->setNewHeight(COM_PROXY_SIZE(rd->ysch * rd->size / 100, context.getProxyDivider()));
 		scaleOperation->getInputSocket(0)->setResizeMode(COM_SC_NO_RESIZE);
 		converter.addOperation(scaleOperation);
 
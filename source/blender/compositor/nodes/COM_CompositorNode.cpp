@@ -47,6 +47,7 @@ void CompositorNode::convertToOperations(NodeConverter &converter, const Composi
 	/* alpha socket gives either 1 or a custom alpha value if "use alpha" is enabled */
 	compositorOperation->setUseAlphaInput(ignore_alpha || alphaSocket->isLinked());
 	compositorOperation->setActive(is_active);
+	compositorOperation->setProxyDivider(context.getProxyDivider());
 	
 	converter.addOperation(compositorOperation);
 	converter.mapInputSocket(imageSocket, compositorOperation->getInputSocket(0));
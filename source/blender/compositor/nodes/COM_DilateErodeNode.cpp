@@ -47,10 +47,12 @@ void DilateErodeNode::convertToOperations(NodeConverter &converter, const Compos
 {
 	
 	bNode *editorNode = this->getbNode();
+	/* distances are given in pixels of the full resolution */
+	const float scale = context.getProxyScale();
 	if (editorNode->custom1 == CMP_NODE_DILATEERODE_DISTANCE_THRESH) {
 		DilateErodeThresholdOperation *operation = new DilateErodeThresholdOperation();
-		operation->setDistance(editorNode->custom2);
-		operation->setInset(editorNode->custom3);
+		operation->setDistance(editorNode->custom2 * scale);
+		operation->setInset(editorNode->custom3 * scale);
 		converter.addOperation(operation);
 		
 		converter.mapInputSocket(getInputSocket(0), operation->getInputSocket(0));
@@ -69,7 +71,7 @@ void DilateErodeNode::convertToOperations(NodeConverter &converter, const Compos
 	else if (editorNode->custom1 == CMP_NODE_DILATEERODE_DISTANCE) {
 		if (editorNode->custom2 > 0) {
 			DilateDistanceOperation *operation = new DilateDistanceOperation();
-			operation->setDistance(editorNode->custom2);
+			operation->setDistance(editorNode->custom2 * scale);
 			converter.addOperation(operation);
 			
 			converter.mapInputSocket(getInputSocket(0), operation->getInputSocket(0));
@@ -77,7 +79,7 @@ void DilateErodeNode::convertToOperations(NodeConverter &converter, const Compos
 		}
 		else {
 			ErodeDistanceOperation *operation = new ErodeDistanceOperation();
-			operation->setDistance(-editorNode->custom2);
+			operation->setDistance(-editorNode->custom2 * scale);
 			converter.addOperation(operation);
 			
 			converter.mapInputSocket(getInputSocket(0), operation->getInputSocket(0));
@@ -87,9 +89,11 @@ void DilateErodeNode::convertToOperations(NodeConverter &converter, const Compos
 	else if (editorNode->custom1 == CMP_NODE_DILATEERODE_DISTANCE_FEATHER) {
 		/* this uses a modified gaussian blur function otherwise its far too slow */
 		CompositorQuality quality = context.getQuality();
+		NodeBlurData alpha_blur = m_alpha_blur;
+		alpha_blur.sizex = alpha_blur.sizey = (short)(m_alpha_blur.sizex * scale + 0.5f);
 
 		GaussianAlphaXBlurOperation *operationx = new GaussianAlphaXBlurOperation();
-		operationx->setData(&m_alpha_blur);
+		operationx->setData(&alpha_blur);
 		operationx->setQuality(quality);
 		operationx->setFalloff(PROP_SMOOTH);
 		converter.addOperation(operationx);
@@ -98,7 +102,7 @@ void DilateErodeNode::convertToOperations(NodeConverter &converter, const Compos
 		// converter.mapInputSocket(getInputSocket(1), operationx->getInputSocket(1)); // no size input yet
 		
 		GaussianAlphaYBlurOperation *operationy = new GaussianAlphaYBlurOperation();
-		operationy->setData(&m_alpha_blur);
+		operationy->setData(&alpha_blur);
 		operationy->setQuality(quality);
 		operationy->setFalloff(PROP_SMOOTH);
 		converter.addOperation(operationy);
@@ -132,7 +136,7 @@ void DilateErodeNode::convertToOperations(NodeConverter &converter, const Compos
 	else {
 		if (editorNode->custom2 > 0) {
 			DilateStepOperation *operation = new DilateStepOperation();
-			operation->setIterations(editorNode->custom2);
+			operation->setIterations(max((int)(editorNode->custom2 * scale + 0.5f), 1));
 			converter.addOperation(operation);
 			
 			converter.mapInputSocket(getInputSocket(0), operation->getInputSocket(0));
@@ -140,7 +144,7 @@ void DilateErodeNode::convertToOperations(NodeConverter &converter, const Compos
 		}
 		else {
 			ErodeStepOperation *operation = new ErodeStepOperation();
-			operation->setIterations(-editorNode->custom2);
+			operation->setIterations(max((int)(-editorNode->custom2 * scale + 0.5f), 1));
 			converter.addOperation(operation);
 			
 			converter.mapInputSocket(getInputSocket(0), operation->getInputSocket(0));
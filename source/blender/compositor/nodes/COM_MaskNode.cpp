@@ -46,20 +46,25 @@ void MaskNode::convertToOperations(NodeConverter &converter, const CompositorCon
 
 	// always connect the output image
 	MaskOperation *operation = new MaskOperation();
+	int width, height;
 
 	if (editorNode->custom1 & CMP_NODEFLAG_MASK_FIXED) {
-		operation->setMaskWidth(data->size_x);
-		operation->setMaskHeight(data->size_y);
+		width = data->size_x;
+		height = data->size_y;
 	}
 	else if (editorNode->custom1 & CMP_NODEFLAG_MASK_FIXED_SCENE) {
-		operation->setMaskWidth(data->size_x * (rd->size / 100.0f));
-		operation->setMaskHeight(data->size_y * (rd->size / 100.0f));
+		width = data->size_x * (rd->size / 100.0f);
+		height = data->size_y * (rd->size / 100.0f);
 	}
 	else {
-		operation->setMaskWidth(rd->xsch * rd->size / 100.0f);
-		operation->setMaskHeight(rd->ysch * rd->size / 100.0f);
+		width = rd->xsch * rd->size / 100.0f;
+		height = rd->ysch * rd->size / 100.0f;
 	}
 
+	/* the mask is rasterized at the proxy resolution directly */
+	operation->setMaskWidth(COM_PROXY_SIZE(width, context.getProxyDivider()));
+	operation->setMaskHeight(COM_PROXY_SIZE(height, context.getProxyDivider()));
+
 	operation->setMask(mask);
 	operation->setFramenumber(context.getFramenumber());
 	operation->setSmooth((bool)(editorNode->custom1 & CMP_NODEFLAG_MASK_AA) != 0);
@@ -77,8 +77,8 @@ void ScaleNode::convertToOperations(NodeConverter &converter, const CompositorCo
 			operation->setIsAspect((bnode->custom2 & CMP_SCALE_RENDERSIZE_FRAME_ASPECT) != 0);
 			operation->setIsCrop((bnode->custom2 & CMP_SCALE_RENDERSIZE_FRAME_CROP) != 0);
 			operation->setOffset(bnode->custom3, bnode->custom4);
-			operation->setNewWidth(rd->xsch * rd->size / 100.0f);
-			operation->setNewHeight(rd->ysch * rd->size / 100.0f);
+			operation->setNewWidth(COM_PROXY_SIZE(rd->xsch * rd->size / 100, context.getProxyDivider()));
+			operation->setNewHeight(COM_PROXY_SIZE(rd->ysch * rd->size / 100, context.getProxyDivider()));
 			operation->getInputSocket(0)->setResizeMode(COM_SC_NO_RESIZE);
 			converter.addOperation(operation);
 			
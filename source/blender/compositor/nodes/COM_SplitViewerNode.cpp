@@ -55,6 +55,9 @@ void SplitViewerNode::convertToOperations(NodeConverter &converter, const Compos
 	viewerOperation->setImageUser(imageUser);
 	viewerOperation->setViewSettings(context.getViewSettings());
 	viewerOperation->setDisplaySettings(context.getDisplaySettings());
+	viewerOperation->setProxyDivider(context.getProxyDivider());
+	viewerOperation->setSceneName(context.getScene()->id.name);
+	viewerOperation->setRenderData(context.getRenderData());
 
 	/* defaults - the viewer node has these options but not exposed for split view
 	 * we could use the split to define an area of interest on one axis at least */
@@ -49,6 +49,8 @@ void TransformNode::convertToOperations(NodeConverter &converter, const Composit
 	converter.addOperation(rotateOperation);
 	
 	TranslateOperation *translateOperation = new TranslateOperation();
+	/* offsets are given in pixels of the full resolution */
+	translateOperation->setFactorXY(context.getProxyScale(), context.getProxyScale());
 	converter.addOperation(translateOperation);
 	
 	SetSamplerOperation *sampler = new SetSamplerOperation();
@@ -43,12 +43,17 @@ void TranslateNode::convertToOperations(NodeConverter &converter, const Composit
 	NodeOutput *outputSocket = this->getOutputSocket(0);
 	
 	TranslateOperation *operation = new TranslateOperation();
+	/* offsets are given in pixels of the full resolution */
+	const float scale = context.getProxyScale();
 	if (data->relative) {
 		const RenderData *rd = context.getRenderData();
 		float fx = rd->xsch * rd->size / 100.0f;
 		float fy = rd->ysch * rd->size / 100.0f;
 		
-		operation->setFactorXY(fx, fy);
+		operation->setFactorXY(fx * scale, fy * scale);
+	}
+	else {
+		operation->setFactorXY(scale, scale);
 	}
 	
 	converter.addOperation(operation);
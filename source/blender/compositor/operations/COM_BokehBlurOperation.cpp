@@ -22,7 +22,9 @@
 
 #include "COM_BokehBlurOperation.h"
 #include "BLI_math.h"
+#include "BLI_rect.h"
 #include "COM_OpenCLDevice.h"
+#include "MEM_guardedalloc.h"
 
 extern "C" {
 #  include "RE_pipeline.h"
@@ -43,17 +45,120 @@ BokehBlurOperation::BokehBlurOperation() : NodeOperation()
 	this->m_inputProgram = NULL;
 	this->m_inputBokehProgram = NULL;
 	this->m_inputBoundingBoxReader = NULL;
+
+	this->m_exact = false;
+	this->m_kernelAvailable = false;
+	this->m_kernelPixelSize = 0;
 }
 
+typedef struct BokehBlurTileData {
+	MemoryBuffer *inputBuffer;
+	/* row prefix sums of the input over prefixRect, (width + 1) pixels per row.
+	 * NULL when the exact kernel is used */
+	double *prefix;
+	rcti prefixRect;
+} BokehBlurTileData;
+
 void *BokehBlurOperation::initializeTileData(rcti *rect)
 {
 	lockMutex();
 	if (!this->m_sizeavailable) {
 		updateSize();
 	}
-	void *buffer = getInputOperation(0)->initializeTileData(NULL);
+	MemoryBuffer *inputBuffer = (MemoryBuffer *)getInputOperation(0)->initializeTileData(NULL);
+
+	const float max_dim = max(this->getWidth(), this->getHeight());
+	const int pixelSize = this->m_size * max_dim / 100.0f;
+	/* small kernels are cheap enough, they also blend in the center pixel.
+	 * Lower quality settings skip samples of the kernel, which the runs can't do */
+	const bool use_runs = (!this->m_exact && rect && pixelSize >= 2 && getStep() == 1);
+	if (use_runs && !this->m_kernelAvailable) {
+		updateKernel(pixelSize);
+	}
 	unlockMutex();
-	return buffer;
+
+	BokehBlurTileData *data = new BokehBlurTileData();
+	data->inputBuffer = inputBuffer;
+	data->prefix = NULL;
+
+	if (use_runs) {
+		rcti *bufferRect = inputBuffer->getRect();
+		rcti *prefixRect = &data->prefixRect;
+		prefixRect->xmin = max(rect->xmin - pixelSize, bufferRect->xmin);
+		prefixRect->xmax = min(rect->xmax + pixelSize, bufferRect->xmax);
+		prefixRect->ymin = max(rect->ymin - pixelSize, bufferRect->ymin);
+		prefixRect->ymax = min(rect->ymax + pixelSize, bufferRect->ymax);
+
+		const int width = BLI_rcti_size_x(prefixRect);
+		const int height = BLI_rcti_size_y(prefixRect);
+		if (width > 0 && height > 0) {
+			const int bufferWidth = inputBuffer->getWidth();
+			const float *buffer = inputBuffer->getBuffer();
+			const int stride = (width + 1) * COM_NUMBER_OF_CHANNELS;
+			double *prefix = (double *)MEM_mallocN(sizeof(double) * stride * height, "BokehBlurTileData prefix");
+
+			/* double precision, the runs subtract sums over the full row width */
+			for (int y = 0; y < height; y++) {
+				const float *in = &buffer[((prefixRect->ymin - bufferRect->ymin + y) * bufferWidth +
+				                           (prefixRect->xmin - bufferRect->xmin)) * COM_NUMBER_OF_CHANNELS];
+				double *row = &prefix[y * stride];
+				row[0] = row[1] = row[2] = row[3] = 0.0;
+				for (int x = 0; x < width * COM_NUMBER_OF_CHANNELS; x++) {
+					row[x + COM_NUMBER_OF_CHANNELS] = row[x] + (double)in[x];
+				}
+			}
+			data->prefix = prefix;
+		}
+	}
+	return data;
+}
+
+void BokehBlurOperation::deinitializeTileData(rcti *rect, void *data)
+{
+	BokehBlurTileData *tileData = (BokehBlurTileData *)data;
+	if (tileData->prefix) {
+		MEM_freeN(tileData->prefix);
+	}
+	delete tileData;
+}
+
+void BokehBlurOperation::updateKernel(int pixelSize)
+{
+	/* same sample positions as the exact kernel, consecutive samples
+	 * of a row with the same weight are merged into one run */
+	const float m = this->m_bokehDimension / pixelSize;
+	float bokeh[4];
+	BokehBlurKernelRun run;
+
+	this->m_kernelRuns.clear();
+	for (int dy = -pixelSize; dy < pixelSize; dy++) {
+		bool in_run = false;
+		for (int dx = -pixelSize; dx < pixelSize; dx++) {
+			float u = this->m_bokehMidX - dx * m;
+			float v = this->m_bokehMidY - dy * m;
+			this->m_inputBokehProgram->readSampled(bokeh, u, v, COM_PS_NEAREST);
+			if (in_run) {
+				if (equals_v4v4(bokeh, run.weight)) {
+					continue;
+				}
+				run.dx_max = dx;
+				this->m_kernelRuns.push_back(run);
+				in_run = false;
+			}
+			if (!is_zero_v4(bokeh)) {
+				run.dy = dy;
+				run.dx_min = dx;
+				copy_v4_v4(run.weight, bokeh);
+				in_run = true;
+			}
+		}
+		if (in_run) {
+			run.dx_max = pixelSize;
+			this->m_kernelRuns.push_back(run);
+		}
+	}
+	this->m_kernelPixelSize = pixelSize;
+	this->m_kernelAvailable = true;
 }
 
 void BokehBlurOperation::initExecution()
@@ -75,6 +180,61 @@ void BokehBlurOperation::initExecution()
 }
 
 void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
+{
+	BokehBlurTileData *tileData = (BokehBlurTileData *)data;
+	if (tileData->prefix == NULL) {
+		executePixelExact(output, x, y, tileData->inputBuffer);
+		return;
+	}
+
+	float tempBoundingBox[4];
+	this->m_inputBoundingBoxReader->readSampled(tempBoundingBox, x, y, COM_PS_NEAREST);
+	if (tempBoundingBox[0] > 0.0f) {
+		const rcti *prefixRect = &tileData->prefixRect;
+		const int stride = (BLI_rcti_size_x(prefixRect) + 1) * COM_NUMBER_OF_CHANNELS;
+		const int pixelSize = this->m_kernelPixelSize;
+		double color_accum[4] = {0.0, 0.0, 0.0, 0.0};
+		double multiplier_accum[4] = {0.0, 0.0, 0.0, 0.0};
+
+		const int miny = max(y - pixelSize, prefixRect->ymin);
+		const int maxy = min(y + pixelSize, prefixRect->ymax);
+		const int minx = max(x - pixelSize, prefixRect->xmin);
+		const int maxx = min(x + pixelSize, prefixRect->xmax);
+
+		for (std::vector<BokehBlurKernelRun>::const_iterator it = this->m_kernelRuns.begin();
+		     it != this->m_kernelRuns.end();
+		     ++it)
+		{
+			const BokehBlurKernelRun &run = *it;
+			const int ny = y + run.dy;
+			if (ny < miny || ny >= maxy) {
+				continue;
+			}
+			const int nxmin = max(x + run.dx_min, minx);
+			const int nxmax = min(x + run.dx_max, maxx);
+			if (nxmin >= nxmax) {
+				continue;
+			}
+			const double *row = &tileData->prefix[(ny - prefixRect->ymin) * stride];
+			const double *sum_min = &row[(nxmin - prefixRect->xmin) * COM_NUMBER_OF_CHANNELS];
+			const double *sum_max = &row[(nxmax - prefixRect->xmin) * COM_NUMBER_OF_CHANNELS];
+			const int samples = nxmax - nxmin;
+			for (int c = 0; c < COM_NUMBER_OF_CHANNELS; c++) {
+				color_accum[c] += run.weight[c] * (sum_max[c] - sum_min[c]);
+				multiplier_accum[c] += run.weight[c] * samples;
+			}
+		}
+		output[0] = color_accum[0] / multiplier_accum[0];
+		output[1] = color_accum[1] / multiplier_accum[1];
+		output[2] = color_accum[2] / multiplier_accum[2];
+		output[3] = color_accum[3] / multiplier_accum[3];
+	}
+	else {
+		this->m_inputProgram->readSampled(output, x, y, COM_PS_NEAREST);
+	}
+}
+
+void BokehBlurOperation::executePixelExact(float output[4], int x, int y, MemoryBuffer *inputBuffer)
 {
 	float color_accum[4];
 	float tempBoundingBox[4];
@@ -83,7 +243,6 @@ void BokehBlurOperation::executePixel(float output[4], int x, int y, void *data)
 	this->m_inputBoundingBoxReader->readSampled(tempBoundingBox, x, y, COM_PS_NEAREST);
 	if (tempBoundingBox[0] > 0.0f) {
 		float multiplier_accum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
-		MemoryBuffer *inputBuffer = (MemoryBuffer *)data;
 		float *buffer = inputBuffer->getBuffer();
 		int bufferwidth = inputBuffer->getWidth();
 		int bufferstartx = inputBuffer->getRect()->xmin;
@@ -140,6 +299,8 @@ void BokehBlurOperation::deinitExecution()
 	this->m_inputProgram = NULL;
 	this->m_inputBokehProgram = NULL;
 	this->m_inputBoundingBoxReader = NULL;
+	this->m_kernelRuns.clear();
+	this->m_kernelAvailable = false;
 }
 
 bool BokehBlurOperation::determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output)
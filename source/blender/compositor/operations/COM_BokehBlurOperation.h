@@ -23,9 +23,21 @@
 #ifndef __COM_BOKEHBLUROPERATION_H__
 #define __COM_BOKEHBLUROPERATION_H__
 
+#include <vector>
+
 #include "COM_NodeOperation.h"
 #include "COM_QualityStepHelper.h"
 
+/**
+ * Horizontal run of kernel samples that share the same bokeh weight.
+ * Covers the kernel offsets [dx_min, dx_max) on row dy.
+ */
+typedef struct BokehBlurKernelRun {
+	int dy;
+	int dx_min, dx_max;
+	float weight[4];
+} BokehBlurKernelRun;
+
 class BokehBlurOperation : public NodeOperation, public QualityStepHelper {
 private:
 	SocketReader *m_inputProgram;
@@ -37,10 +49,21 @@ private:
 	float m_bokehMidX;
 	float m_bokehMidY;
 	float m_bokehDimension;
+
+	/* accelerated path, the kernel is split in runs of equal weight
+	 * which are evaluated against row prefix sums of the input.
+	 * Only used at high quality, lower qualities sample every n-th pixel */
+	bool m_exact;
+	bool m_kernelAvailable;
+	int m_kernelPixelSize;
+	std::vector<BokehBlurKernelRun> m_kernelRuns;
+	void updateKernel(int pixelSize);
+	void executePixelExact(float output[4], int x, int y, MemoryBuffer *inputBuffer);
 public:
 	BokehBlurOperation();
 
 	void *initializeTileData(rcti *rect);
+	void deinitializeTileData(rcti *rect, void *data);
 	/**
 	 * the inner loop of this program
 	 */
@@ -59,6 +82,12 @@ public:
 	bool determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
 
 	void setSize(float size) { this->m_size = size; this->m_sizeavailable = true; }
+
+	/**
+	 * Evaluate every kernel sample per pixel instead of using the run-length kernel,
+	 * slower but matches the result of older versions exactly.
+	 */
+	void setExact(bool exact) { this->m_exact = exact; }
 	
 	void executeOpenCL(OpenCLDevice *device,
 	                   MemoryBuffer *outputMemoryBuffer, cl_mem clOutputBuffer,
@@ -35,6 +35,25 @@ extern "C" {
 #include "PIL_time.h"
 
 
+/* scale a buffer calculated at a proxy resolution up to the resolution of the render result */
+static float *upscale_proxy_buffer(float *buffer, int width, int height, int channels, int divider,
+                                   int full_width, int full_height)
+{
+	float *result = (float *)MEM_mallocN(sizeof(float) * full_width * full_height * channels, "CompositorOperation");
+
+	for (int y = 0; y < full_height; y++) {
+		const int proxy_y = min(y / divider, height - 1);
+		for (int x = 0; x < full_width; x++) {
+			const int proxy_x = min(x / divider, width - 1);
+			memcpy(&result[(y * full_width + x) * channels], &buffer[(proxy_y * width + proxy_x) * channels],
+			       sizeof(float) * channels);
+		}
+	}
+
+	MEM_freeN(buffer);
+	return result;
+}
+
 CompositorOperation::CompositorOperation() : NodeOperation()
 {
 	this->addInputSocket(COM_DT_COLOR);
@@ -50,6 +69,7 @@ CompositorOperation::CompositorOperation() : NodeOperation()
 
 	this->m_useAlphaInput = false;
 	this->m_active = false;
+	this->m_proxyDivider = 1;
 
 	this->m_sceneName[0] = '\0';
 }
@@ -81,6 +101,16 @@ void CompositorOperation::deinitExecution()
 		RenderResult *rr = RE_AcquireResultWrite(re);
 
 		if (rr) {
+			if (this->m_proxyDivider != 1) {
+				if (this->m_outputBuffer) {
+					this->m_outputBuffer = upscale_proxy_buffer(this->m_outputBuffer, getWidth(), getHeight(), 4,
+					                                            this->m_proxyDivider, rr->rectx, rr->recty);
+				}
+				if (this->m_depthBuffer) {
+					this->m_depthBuffer = upscale_proxy_buffer(this->m_depthBuffer, getWidth(), getHeight(), 1,
+					                                           this->m_proxyDivider, rr->rectx, rr->recty);
+				}
+			}
 			if (rr->rectf != NULL) {
 				MEM_freeN(rr->rectf);
 			}
@@ -224,6 +254,9 @@ void CompositorOperation::determineResolution(unsigned int resolution[2], unsign
 		RE_ReleaseResult(re);
 	}
 
+	width = COM_PROXY_SIZE(width, this->m_proxyDivider);
+	height = COM_PROXY_SIZE(height, this->m_proxyDivider);
+
 	preferredResolution[0] = width;
 	preferredResolution[1] = height;
 
@@ -75,6 +75,11 @@ private:
 	 * @brief operation is active for calculating final compo result
 	 */
 	bool m_active;
+
+	/**
+	 * @brief the tree is executed at 1/m_proxyDivider of the render resolution
+	 */
+	int m_proxyDivider;
 public:
 	CompositorOperation();
 	const bool isActiveCompositorOutput() const { return this->m_active; }
@@ -88,6 +93,7 @@ public:
 	void determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2]);
 	void setUseAlphaInput(bool value) { this->m_useAlphaInput = value; }
 	void setActive(bool active) { this->m_active = active; }
+	void setProxyDivider(int divider) { this->m_proxyDivider = divider; }
 };
 #endif
 
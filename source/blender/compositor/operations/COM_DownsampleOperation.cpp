@@ -0,0 +1,84 @@
+/*
+ * Copyright 2014, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "COM_DownsampleOperation.h"
+
+DownsampleOperation::DownsampleOperation(DataType datatype) : NodeOperation()
+{
+	this->addInputSocket(datatype, COM_SC_NO_RESIZE);
+	this->addOutputSocket(datatype);
+	this->m_inputOperation = NULL;
+	this->m_divider = 1;
+}
+
+void DownsampleOperation::initExecution()
+{
+	this->m_inputOperation = this->getInputSocketReader(0);
+}
+
+void DownsampleOperation::deinitExecution()
+{
+	this->m_inputOperation = NULL;
+}
+
+void DownsampleOperation::executePixelSampled(float output[4], float x, float y, PixelSampler sampler)
+{
+	const int xmin = (int)x * this->m_divider;
+	const int ymin = (int)y * this->m_divider;
+	const int xmax = min(xmin + this->m_divider, (int)this->m_inputOperation->getWidth());
+	const int ymax = min(ymin + this->m_divider, (int)this->m_inputOperation->getHeight());
+	float color[4];
+	int samples = 0;
+
+	zero_v4(output);
+	for (int ny = ymin; ny < ymax; ny++) {
+		for (int nx = xmin; nx < xmax; nx++) {
+			this->m_inputOperation->readSampled(color, nx, ny, COM_PS_NEAREST);
+			add_v4_v4(output, color);
+			samples++;
+		}
+	}
+
+	if (samples > 1) {
+		mul_v4_fl(output, 1.0f / samples);
+	}
+}
+
+void DownsampleOperation::determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2])
+{
+	unsigned int inputPreferredResolution[2];
+	inputPreferredResolution[0] = preferredResolution[0] * this->m_divider;
+	inputPreferredResolution[1] = preferredResolution[1] * this->m_divider;
+
+	NodeOperation::determineResolution(resolution, inputPreferredResolution);
+
+	resolution[0] = COM_PROXY_SIZE(resolution[0], this->m_divider);
+	resolution[1] = COM_PROXY_SIZE(resolution[1], this->m_divider);
+}
+
+bool DownsampleOperation::determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output)
+{
+	rcti newInput;
+	newInput.xmin = input->xmin * this->m_divider;
+	newInput.xmax = input->xmax * this->m_divider;
+	newInput.ymin = input->ymin * this->m_divider;
+	newInput.ymax = input->ymax * this->m_divider;
+
+	return NodeOperation::determineDependingAreaOfInterest(&newInput, readOperation, output);
+}
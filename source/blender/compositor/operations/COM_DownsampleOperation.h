@@ -0,0 +1,53 @@
+/*
+ * Copyright 2014, Blender Foundation.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef _COM_DownsampleOperation_h
+#define _COM_DownsampleOperation_h
+
+#include "COM_NodeOperation.h"
+
+/**
+ * @brief box filters the input to 1/divider of its resolution
+ * @note inserted after the operations with their own resolution when a proxy resolution is used,
+ * the result is written to a buffer so the input is only downsampled once.
+ * @see NodeOperation.hasOwnResolution
+ * @see CompositorContext.getProxyDivider
+ */
+class DownsampleOperation : public NodeOperation {
+private:
+	SocketReader *m_inputOperation;
+	int m_divider;
+
+public:
+	DownsampleOperation(DataType datatype);
+
+	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+	void determineResolution(unsigned int resolution[2], unsigned int preferredResolution[2]);
+	bool determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
+
+	void initExecution();
+	void deinitExecution();
+
+	void setDivider(int divider) { this->m_divider = divider; }
+
+	bool isDownsampleOperation() const { return true; }
+};
+
+#endif
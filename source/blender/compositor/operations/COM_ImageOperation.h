@@ -66,6 +66,8 @@ public:
 	void setImageUser(ImageUser *imageuser) { this->m_imageUser = imageuser; }
 
 	void setFramenumber(int framenumber) { this->m_framenumber = framenumber; }
+
+	bool hasOwnResolution() const { return true; }
 };
 class ImageOperation : public BaseImageOperation {
 public:
@@ -74,6 +76,7 @@ public:
 	 */
 	ImageOperation();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	float *getDirectBuffer() { return (this->m_numberOfChannels == 4) ? this->m_imageFloatBuffer : NULL; }
 };
 class ImageAlphaOperation : public BaseImageOperation {
 public:
@@ -81,6 +81,8 @@ public:
 	void setFramenumber(int framenumber) {this->m_framenumber = framenumber;}
 
 	void executePixel(float output[4], int x, int y, void *data);
+
+	bool hasOwnResolution() const { return true; }
 };
 
 #endif
@@ -58,6 +58,8 @@ public:
 
 	void setFramenumber(int framenumber) { this->m_framenumber = framenumber; }
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+	bool hasOwnResolution() const { return true; }
 };
 
 class MovieClipOperation : public MovieClipBaseOperation {
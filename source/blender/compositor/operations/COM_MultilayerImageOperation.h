@@ -47,6 +47,7 @@ public:
 		this->addOutputSocket(COM_DT_COLOR);
 	}
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	float *getDirectBuffer() { return (this->m_numberOfChannels == 4) ? this->m_imageFloatBuffer : NULL; }
 };
 
 class MultilayerValueOperation : public MultilayerBaseOperation {
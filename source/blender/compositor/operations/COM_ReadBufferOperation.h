@@ -44,6 +44,11 @@ public:
 	                        MemoryBufferExtend extend_x, MemoryBufferExtend extend_y);
 	void executePixelFiltered(float output[4], float x, float y, float dx[2], float dy[2], PixelSampler sampler);
 	const bool isReadBufferOperation() const { return true; }
+	/**
+	 * @brief can the buffer be read when only a window of rows is kept in memory
+	 * @see MemoryProxy.setStreaming
+	 */
+	virtual const bool isStreamingSupported() const { return true; }
 	void setOffset(unsigned int offset) { this->m_offset = offset; }
 	unsigned int getOffset() const { return this->m_offset; }
 	bool determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
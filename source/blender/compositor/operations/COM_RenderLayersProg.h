@@ -100,6 +100,13 @@ public:
 	void initExecution();
 	void deinitExecution();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+
+	bool hasOwnResolution() const { return true; }
+
+	/**
+	 * passes with 4 channels are used as they are, without copying them into a buffer
+	 */
+	float *getDirectBuffer() { return (this->m_elementsize == 4) ? this->m_inputBuffer : NULL; }
 };
 
 class RenderLayersAOOperation : public RenderLayersBaseProg {
@@ -111,6 +118,7 @@ class RenderLayersAlphaProg : public RenderLayersBaseProg {
 public:
 	RenderLayersAlphaProg();
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	float *getDirectBuffer() { return NULL; }
 };
 
 class RenderLayersColorOperation : public RenderLayersBaseProg {
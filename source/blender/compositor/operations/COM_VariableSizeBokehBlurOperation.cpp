@@ -22,7 +22,9 @@
 
 #include "COM_VariableSizeBokehBlurOperation.h"
 #include "BLI_math.h"
+#include "BLI_rect.h"
 #include "COM_OpenCLDevice.h"
+#include "MEM_guardedalloc.h"
 
 extern "C" {
 #  include "RE_pipeline.h"
@@ -46,6 +48,7 @@ VariableSizeBokehBlurOperation::VariableSizeBokehBlurOperation() : NodeOperation
 	this->m_maxBlur = 32.0f;
 	this->m_threshold = 1.0f;
 	this->m_do_size_scale = false;
+	this->m_exact = false;
 #ifdef COM_DEFOCUS_SEARCH
 	this->m_inputSearchProgram = NULL;
 #endif
@@ -68,6 +71,10 @@ struct VariableSizeBokehBlurTileData
 	MemoryBuffer *bokeh;
 	MemoryBuffer *size;
 	int maxBlurScalar;
+	/* maximum (unscaled) size per CELL_SIZE block over cellRect,
+	 * cellRect is in block coordinates. NULL when the exact loop is used */
+	float *cellMaxSize;
+	rcti cellRect;
 };
 
 void *VariableSizeBokehBlurOperation::initializeTileData(rcti *rect)
@@ -86,12 +93,57 @@ void *VariableSizeBokehBlurOperation::initializeTileData(rcti *rect)
 
 	data->maxBlurScalar = (int)(data->size->getMaximumValue(&rect2) * scalar);
 	CLAMP(data->maxBlurScalar, 1.0f, this->m_maxBlur);
+
+	data->cellMaxSize = NULL;
+	if (!this->m_exact) {
+		const int width = this->getWidth();
+		const int height = this->getHeight();
+		const int xmin = max(rect->xmin - data->maxBlurScalar, 0);
+		const int xmax = min(rect->xmax + data->maxBlurScalar, width);
+		const int ymin = max(rect->ymin - data->maxBlurScalar, 0);
+		const int ymax = min(rect->ymax + data->maxBlurScalar, height);
+
+		if (xmin < xmax && ymin < ymax) {
+			rcti *cellRect = &data->cellRect;
+			cellRect->xmin = xmin / CELL_SIZE;
+			cellRect->xmax = (xmax - 1) / CELL_SIZE + 1;
+			cellRect->ymin = ymin / CELL_SIZE;
+			cellRect->ymax = (ymax - 1) / CELL_SIZE + 1;
+
+			const int cellWidth = BLI_rcti_size_x(cellRect);
+			const int cellHeight = BLI_rcti_size_y(cellRect);
+			float *cellMaxSize = (float *)MEM_mallocN(sizeof(float) * cellWidth * cellHeight, "VariableSizeBokehBlur cells");
+			const float *sizeBuffer = data->size->getBuffer();
+			const int sizeWidth = data->size->getWidth();
+
+			for (int cy = 0; cy < cellHeight; cy++) {
+				const int ny_min = max((cellRect->ymin + cy) * CELL_SIZE, 0);
+				const int ny_max = min((cellRect->ymin + cy + 1) * CELL_SIZE, height);
+				for (int cx = 0; cx < cellWidth; cx++) {
+					const int nx_min = max((cellRect->xmin + cx) * CELL_SIZE, 0);
+					const int nx_max = min((cellRect->xmin + cx + 1) * CELL_SIZE, width);
+					float maxSize = -FLT_MAX;
+					for (int ny = ny_min; ny < ny_max; ny++) {
+						const float *size = &sizeBuffer[(ny * sizeWidth + nx_min) * COM_NUMBER_OF_CHANNELS];
+						for (int nx = nx_min; nx < nx_max; nx++, size += COM_NUMBER_OF_CHANNELS) {
+							maxSize = max(maxSize, size[0]);
+						}
+					}
+					cellMaxSize[cy * cellWidth + cx] = maxSize;
+				}
+			}
+			data->cellMaxSize = cellMaxSize;
+		}
+	}
 	return data;
 }
 
 void VariableSizeBokehBlurOperation::deinitializeTileData(rcti *rect, void *data)
 {
 	VariableSizeBokehBlurTileData *result = (VariableSizeBokehBlurTileData *)data;
+	if (result->cellMaxSize) {
+		MEM_freeN(result->cellMaxSize);
+	}
 	delete result;
 }
 
@@ -139,7 +191,58 @@ void VariableSizeBokehBlurOperation::executePixel(float output[4], int x, int y,
 		
 		const int addXStep = QualityStepHelper::getStep() * COM_NUMBER_OF_CHANNELS;
 		
-		if (size_center > this->m_threshold) {
+		if (size_center > this->m_threshold && tileData->cellMaxSize) {
+			/* Same samples and accumulation order as the loop below, but samples further
+			 * away than the center size and blocks whose largest size can't reach this
+			 * pixel are skipped, they never contribute to the result. */
+			const int step = QualityStepHelper::getStep();
+			const rcti *cellRect = &tileData->cellRect;
+			const int cellWidth = BLI_rcti_size_x(cellRect);
+			const int reach = (int)min(ceilf(size_center), (float)maxBlurScalar);
+			int fminx = max(minx, x - reach);
+			int fminy = max(miny, y - reach);
+			const int fmaxx = min(maxx, x + reach + 1);
+			const int fmaxy = min(maxy, y + reach + 1);
+			/* keep the samples aligned to the quality step */
+			fminx = minx + ((fminx - minx + step - 1) / step) * step;
+			fminy = miny + ((fminy - miny + step - 1) / step) * step;
+
+			for (int ny = fminy; ny < fmaxy; ny += step) {
+				float dy = ny - y;
+				const float *cellRow = &tileData->cellMaxSize[(ny / CELL_SIZE - cellRect->ymin) * cellWidth];
+				int offsetNy = ny * inputSizeBuffer->getWidth() * COM_NUMBER_OF_CHANNELS;
+				for (int cx = fminx / CELL_SIZE; cx <= (fmaxx - 1) / CELL_SIZE; cx++) {
+					const int cell_xmin = max(cx * CELL_SIZE, fminx);
+					const int cell_xmax = min((cx + 1) * CELL_SIZE, fmaxx);
+					const float cellSize = cellRow[cx - cellRect->xmin] * scalar;
+					const float cellDist = max(fabsf(dy), (float)(x < cell_xmin ? cell_xmin - x :
+					                                              (x >= cell_xmax ? x - (cell_xmax - 1) : 0)));
+					if (cellSize <= this->m_threshold || cellSize <= cellDist) {
+						continue;
+					}
+					const int nx_start = fminx + ((cell_xmin - fminx + step - 1) / step) * step;
+					int offsetNxNy = offsetNy + (nx_start * COM_NUMBER_OF_CHANNELS);
+					for (int nx = nx_start; nx < cell_xmax; nx += step) {
+						if (nx != x || ny != y) {
+							float size = min(inputSizeFloatBuffer[offsetNxNy] * scalar, size_center);
+							if (size > this->m_threshold) {
+								float dx = nx - x;
+								if (size > fabsf(dx) && size > fabsf(dy)) {
+									float uv[2] = {
+									    (float)(COM_BLUR_BOKEH_PIXELS / 2) + (dx / size) * (float)((COM_BLUR_BOKEH_PIXELS / 2) - 1),
+									    (float)(COM_BLUR_BOKEH_PIXELS / 2) + (dy / size) * (float)((COM_BLUR_BOKEH_PIXELS / 2) - 1)};
+									inputBokehBuffer->readNoCheck(bokeh, uv[0], uv[1]);
+									madd_v4_v4v4(color_accum, bokeh, &inputProgramFloatBuffer[offsetNxNy]);
+									add_v4_v4(multiplier_accum, bokeh);
+								}
+							}
+						}
+						offsetNxNy += addXStep;
+					}
+				}
+			}
+		}
+		else if (size_center > this->m_threshold) {
 			for (int ny = miny; ny < maxy; ny += QualityStepHelper::getStep()) {
 				float dy = ny - y;
 				int offsetNy = ny * inputSizeBuffer->getWidth() * COM_NUMBER_OF_CHANNELS;
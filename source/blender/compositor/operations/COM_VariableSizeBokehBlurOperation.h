@@ -32,6 +32,7 @@ private:
 	int m_maxBlur;
 	float m_threshold;
 	bool m_do_size_scale;  /* scale size, matching 'BokehBlurNode' */
+	bool m_exact;
 	SocketReader *m_inputProgram;
 	SocketReader *m_inputBokehProgram;
 	SocketReader *m_inputSizeProgram;
@@ -40,6 +41,10 @@ private:
 #endif
 
 public:
+	/* size of the blocks for which the maximum size is gathered, blocks that
+	 * can't reach a pixel are skipped as a whole */
+	static const int CELL_SIZE = 16;
+
 	VariableSizeBokehBlurOperation();
 
 	/**
@@ -69,6 +74,12 @@ public:
 
 	void setDoScaleSize(bool scale_size) { this->m_do_size_scale = scale_size; }
 
+	/**
+	 * Visit every sample in the maximum blur radius instead of skipping
+	 * the blocks of samples which can't contribute to a pixel.
+	 */
+	void setExact(bool exact) { this->m_exact = exact; }
+
 	void executeOpenCL(OpenCLDevice *device, MemoryBuffer *outputMemoryBuffer, cl_mem clOutputBuffer, MemoryBuffer **inputMemoryBuffers, list<cl_mem> *clMemToCleanUp, list<cl_kernel> *clKernelsToCleanUp);
 };
 
@@ -35,6 +35,7 @@ extern "C" {
 #  include "IMB_imbuf.h"
 #  include "IMB_imbuf_types.h"
 #  include "IMB_colormanagement.h"
+#  include "RE_pipeline.h"
 }
 
 
@@ -49,6 +50,9 @@ ViewerOperation::ViewerOperation() : NodeOperation()
 	this->m_viewSettings = NULL;
 	this->m_displaySettings = NULL;
 	this->m_useAlphaInput = false;
+	this->m_proxyDivider = 1;
+	this->m_sceneName[0] = '\0';
+	this->m_rd = NULL;
 	
 	this->addInputSocket(COM_DT_COLOR);
 	this->addInputSocket(COM_DT_VALUE);
@@ -85,6 +89,10 @@ void ViewerOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 	float *buffer = this->m_outputBuffer;
 	float *depthbuffer = this->m_depthBuffer;
 	if (!buffer) return;
+	if (this->m_proxyDivider != 1) {
+		executeRegionProxy(rect);
+		return;
+	}
 	const int x1 = rect->xmin;
 	const int y1 = rect->ymin;
 	const int x2 = rect->xmax;
@@ -120,21 +128,116 @@ void ViewerOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 	updateImage(rect);
 }
 
+void ViewerOperation::executeRegionProxy(rcti *rect)
+{
+	const int divider = this->m_proxyDivider;
+	const int width = this->m_ibuf->x;
+	const int height = this->m_ibuf->y;
+	float color[4], alpha[4], depth[4];
+	rcti fullRect;
+	bool breaked = false;
+
+	/* every calculated pixel covers a block of divider x divider image pixels */
+	fullRect.xmin = rect->xmin * divider;
+	fullRect.xmax = min(rect->xmax * divider, width);
+	fullRect.ymin = rect->ymin * divider;
+	fullRect.ymax = min(rect->ymax * divider, height);
+
+	for (int y = rect->ymin; y < rect->ymax && (!breaked); y++) {
+		const int by1 = y * divider;
+		const int by2 = min(by1 + divider, height);
+		for (int x = rect->xmin; x < rect->xmax; x++) {
+			const int bx1 = x * divider;
+			const int bx2 = min(bx1 + divider, width);
+
+			this->m_imageInput->readSampled(color, x, y, COM_PS_NEAREST);
+			if (this->m_useAlphaInput) {
+				this->m_alphaInput->readSampled(alpha, x, y, COM_PS_NEAREST);
+				color[3] = alpha[0];
+			}
+			this->m_depthInput->readSampled(depth, x, y, COM_PS_NEAREST);
+
+			for (int by = by1; by < by2; by++) {
+				for (int bx = bx1; bx < bx2; bx++) {
+					const int offset = by * width + bx;
+					copy_v4_v4(&this->m_outputBuffer[offset * 4], color);
+					if (this->m_depthBuffer) {
+						this->m_depthBuffer[offset] = depth[0];
+					}
+				}
+			}
+		}
+		if (isBreaked()) {
+			breaked = true;
+		}
+	}
+	updateImage(&fullRect);
+}
+
+/**
+ * The size of the image at full resolution. COM_PROXY_SIZE rounds up, so it can't be found from the
+ * proxy resolution alone. A viewer showing something of render size gets the size of the render result,
+ * like the compositor output, anything else is scaled up by the divider.
+ */
+void ViewerOperation::determineFullResolution(int r_size[2])
+{
+	const int divider = this->m_proxyDivider;
+	int render_size[2] = {0, 0};
+
+	r_size[0] = getWidth();
+	r_size[1] = getHeight();
+	if (divider == 1) {
+		return;
+	}
+
+	if (this->m_rd) {
+		render_size[0] = this->m_rd->xsch * this->m_rd->size / 100;
+		render_size[1] = this->m_rd->ysch * this->m_rd->size / 100;
+	}
+	Render *re = RE_GetRender(this->m_sceneName);
+	if (re) {
+		RenderResult *rr = RE_AcquireResultRead(re);
+		if (rr) {
+			render_size[0] = rr->rectx;
+			render_size[1] = rr->recty;
+		}
+		RE_ReleaseResult(re);
+	}
+
+	if (COM_PROXY_SIZE(render_size[0], divider) == r_size[0] &&
+	    COM_PROXY_SIZE(render_size[1], divider) == r_size[1])
+	{
+		r_size[0] = render_size[0];
+		r_size[1] = render_size[1];
+	}
+	else {
+		r_size[0] *= divider;
+		r_size[1] *= divider;
+	}
+}
+
 void ViewerOperation::initImage()
 {
 	Image *ima = this->m_image;
 	void *lock;
+	int size[2];
+
+	/* when executing at a proxy resolution the image is scaled up to the full resolution */
+	determineFullResolution(size);
+
 	ImBuf *ibuf = BKE_image_acquire_ibuf(ima, this->m_imageUser, &lock);
 
 	if (!ibuf) return;
 	BLI_lock_thread(LOCK_DRAW_IMAGE);
-	if (ibuf->x != (int)getWidth() || ibuf->y != (int)getHeight()) {
+	const int width = size[0];
+	const int height = size[1];
+	if (ibuf->x != width || ibuf->y != height) {
 
 		imb_freerectImBuf(ibuf);
 		imb_freerectfloatImBuf(ibuf);
 		IMB_freezbuffloatImBuf(ibuf);
-		ibuf->x = getWidth();
-		ibuf->y = getHeight();
+		ibuf->x = width;
+		ibuf->y = height;
 		/* zero size can happen if no image buffers exist to define a sensible resolution */
 		if (ibuf->x > 0 && ibuf->y > 0)
 			imb_addrectfloatImBuf(ibuf);
@@ -163,7 +266,7 @@ void ViewerOperation::initImage()
 
 void ViewerOperation::updateImage(rcti *rect)
 {
-	IMB_partial_display_buffer_update(this->m_ibuf, this->m_outputBuffer, NULL, getWidth(), 0, 0,
+	IMB_partial_display_buffer_update(this->m_ibuf, this->m_outputBuffer, NULL, this->m_ibuf->x, 0, 0,
 	                                  this->m_viewSettings, this->m_displaySettings,
 	                                  rect->xmin, rect->ymin, rect->xmax, rect->ymax, false);
 
@@ -25,6 +25,7 @@
 #include "COM_NodeOperation.h"
 #include "DNA_image_types.h"
 #include "BLI_rect.h"
+#include "BLI_string.h"
 #include "BKE_global.h"
 
 class ViewerOperation : public NodeOperation {
@@ -40,6 +41,17 @@ private:
 	bool m_doDepthBuffer;
 	ImBuf *m_ibuf;
 	bool m_useAlphaInput;
+
+	/**
+	 * @brief the tree is executed at 1/m_proxyDivider of the resolution, the image is kept at full resolution
+	 */
+	int m_proxyDivider;
+
+	/**
+	 * @brief Scene name and render data, the render size is the full resolution of a viewer showing the render.
+	 */
+	char m_sceneName[MAX_ID_NAME];
+	const RenderData *m_rd;
 	
 	const ColorManagedViewSettings *m_viewSettings;
 	const ColorManagedDisplaySettings *m_displaySettings;
@@ -67,11 +79,16 @@ public:
 	const CompositorPriority getRenderPriority() const;
 	bool isViewerOperation() const { return true; }
 	void setUseAlphaInput(bool value) { this->m_useAlphaInput = value; }
+	void setProxyDivider(int divider) { this->m_proxyDivider = divider; }
+	void setSceneName(const char *sceneName) { BLI_strncpy(this->m_sceneName, sceneName, sizeof(this->m_sceneName)); }
+	void setRenderData(const RenderData *rd) { this->m_rd = rd; }
 
 	void setViewSettings(const ColorManagedViewSettings *viewSettings) { this->m_viewSettings = viewSettings; }
 	void setDisplaySettings(const ColorManagedDisplaySettings *displaySettings) { this->m_displaySettings = displaySettings; }
 
 private:
+	void executeRegionProxy(rcti *rect);
+	void determineFullResolution(int r_size[2]);
 	void updateImage(rcti *rect);
 	void initImage();
 };
@@ -32,6 +32,8 @@ public:
 	WrapOperation();
 	bool determineDependingAreaOfInterest(rcti *input, ReadBufferOperation *readOperation, rcti *output);
 	void executePixelSampled(float output[4], float x, float y, PixelSampler sampler);
+	/* repeating needs the whole buffer */
+	const bool isStreamingSupported() const { return false; }
 
 	void setWrapping(int wrapping_type);
 	float getWrappedOriginalXPos(float x);
@@ -48,7 +48,15 @@ void WriteBufferOperation::executePixelSampled(float output[4], float x, float y
 void WriteBufferOperation::initExecution()
 {
 	this->m_input = this->getInputOperation(0);
-	this->m_memoryProxy->allocate(this->m_width, this->m_height);
+
+	float *directBuffer = this->m_input->getDirectBuffer();
+	if (directBuffer && this->m_input->getWidth() == this->m_width && this->m_input->getHeight() == this->m_height) {
+		/* the input already has its output in memory, no need to copy it */
+		this->m_memoryProxy->wrap(directBuffer, this->m_width, this->m_height);
+	}
+	else {
+		this->m_memoryProxy->allocate(this->m_width, this->m_height);
+	}
 }
 
 void WriteBufferOperation::deinitExecution()
@@ -60,7 +68,10 @@ void WriteBufferOperation::deinitExecution()
 void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 {
 	MemoryBuffer *memoryBuffer = this->m_memoryProxy->getBuffer();
+	BLI_assert(!memoryBuffer->isReadOnly());
 	float *buffer = memoryBuffer->getBuffer();
+	/* when streaming the buffer only holds a window of rows */
+	const rcti *bufferRect = memoryBuffer->getRect();
 	if (this->m_input->isComplex()) {
 		void *data = this->m_input->initializeTileData(rect);
 		int x1 = rect->xmin;
@@ -71,7 +82,7 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 		int y;
 		bool breaked = false;
 		for (y = y1; y < y2 && (!breaked); y++) {
-			int offset4 = (y * memoryBuffer->getWidth() + x1) * COM_NUMBER_OF_CHANNELS;
+			int offset4 = ((y - bufferRect->ymin) * memoryBuffer->getWidth() + x1 - bufferRect->xmin) * COM_NUMBER_OF_CHANNELS;
 			for (x = x1; x < x2; x++) {
 				this->m_input->read(&(buffer[offset4]), x, y, data);
 				offset4 += COM_NUMBER_OF_CHANNELS;
@@ -96,7 +107,7 @@ void WriteBufferOperation::executeRegion(rcti *rect, unsigned int tileNumber)
 		int y;
 		bool breaked = false;
 		for (y = y1; y < y2 && (!breaked); y++) {
-			int offset4 = (y * memoryBuffer->getWidth() + x1) * COM_NUMBER_OF_CHANNELS;
+			int offset4 = ((y - bufferRect->ymin) * memoryBuffer->getWidth() + x1 - bufferRect->xmin) * COM_NUMBER_OF_CHANNELS;
 			for (x = x1; x < x2; x++) {
 				this->m_input->readSampled(&(buffer[offset4]), x, y, COM_PS_NEAREST);
 				offset4 += COM_NUMBER_OF_CHANNELS;
@@ -35,6 +35,7 @@
 #include "BLI_edgehash.h"
 #include "BLI_memarena.h"
 #include "BLI_string.h"
+#include "BLI_task.h"
 
 #include "BLF_translation.h"
 
@@ -1043,7 +1044,11 @@ void rigid_deform_end(int cancel)
 
 #define MESHDEFORM_LEN_THRESHOLD 1e-6f
 
-#define MESHDEFORM_MIN_INFLUENCE 0.0005f
+/* dynamic bind, static bind uses MESHDEFORM_MIN_INFLUENCE */
+#define MESHDEFORM_MIN_DYNAMIC_INFLUENCE 0.0005f
+
+/* below this many vertices threading isn't worth it */
+#define MESHDEFORM_THREAD_MIN 1000
 
 static int MESHDEFORM_OFFSET[7][3] = {
 	{0, 0, 0}, {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}
@@ -1055,12 +1060,6 @@ typedef struct MDefBoundIsect {
 	float len;
 } MDefBoundIsect;
 
-typedef struct MDefBindInfluence {
-	struct MDefBindInfluence *next;
-	float weight;
-	int vertex;
-} MDefBindInfluence;
-
 typedef struct MeshDeformBind {
 	/* grid dimensions */
 	float min[3], max[3];
@@ -1084,6 +1083,9 @@ typedef struct MeshDeformBind {
 	int *inside;
 	float *weights;
 	MDefBindInfluence **dyngrid;
+	/* static bind: influences per vertex, weights of the current cage vertex */
+	MDefBindInfluence **bindinfs;
+	float *vertweights;
 	float cagemat[4][4];
 
 	/* direct solver */
@@ -1208,41 +1210,55 @@ static void harmonic_ray_callback(void *userdata, int index, const BVHTreeRay *r
 	}
 }
 
-static MDefBoundIsect *meshdeform_ray_tree_intersect(MeshDeformBind *mdb, const float co1[3], const float co2[3])
+/* doesn't allocate anything, so it can be used from multiple threads */
+static bool meshdeform_ray_tree_cast(MeshDeformBind *mdb, const float co1[3], const float co2[3],
+                                     MeshDeformIsect *r_isect_mdef)
 {
-	MDefBoundIsect *isect;
 	BVHTreeRayHit hit;
-	MeshDeformIsect isect_mdef;
-	float (*cagecos)[3];
-	void *data[3] = {mdb->cagedm->getTessFaceArray(mdb->cagedm), mdb, &isect_mdef};
-	MFace *mface1 = data[0], *mface;
-	float vert[4][3], len, end[3];
+	void *data[3] = {mdb->cagedm->getTessFaceArray(mdb->cagedm), mdb, r_isect_mdef};
+	float end[3];
 	// static float epsilon[3] = {1e-4, 1e-4, 1e-4};
 
 	/* happens binding when a cage has no faces */
 	if (UNLIKELY(mdb->bvhtree == NULL))
-		return NULL;
+		return false;
 
 	/* setup isec */
-	memset(&isect_mdef, 0, sizeof(isect_mdef));
-	isect_mdef.lambda = 1e10f;
+	memset(r_isect_mdef, 0, sizeof(*r_isect_mdef));
+	r_isect_mdef->lambda = 1e10f;
 
 #if 0
-	add_v3_v3v3(isect_mdef.start, co1, epsilon);
+	add_v3_v3v3(r_isect_mdef->start, co1, epsilon);
 	add_v3_v3v3(end, co2, epsilon);
 #else
-	copy_v3_v3(isect_mdef.start, co1);
+	copy_v3_v3(r_isect_mdef->start, co1);
 	copy_v3_v3(end, co2);
 #endif
-	sub_v3_v3v3(isect_mdef.vec, end, isect_mdef.start);
+	sub_v3_v3v3(r_isect_mdef->vec, end, r_isect_mdef->start);
 
 	hit.index = -1;
 	hit.dist = FLT_MAX;
-	if (BLI_bvhtree_ray_cast(mdb->bvhtree, isect_mdef.start, isect_mdef.vec,
+	if (BLI_bvhtree_ray_cast(mdb->bvhtree, r_isect_mdef->start, r_isect_mdef->vec,
 	                         0.0, &hit, harmonic_ray_callback, data) != -1)
 	{
+		r_isect_mdef->face = (MFace *)data[0] + hit.index;
+		return true;
+	}
+
+	return false;
+}
+
+static MDefBoundIsect *meshdeform_ray_tree_intersect(MeshDeformBind *mdb, const float co1[3], const float co2[3])
+{
+	MDefBoundIsect *isect;
+	MeshDeformIsect isect_mdef;
+	float (*cagecos)[3];
+	MFace *mface;
+	float vert[4][3], len;
+
+	if (meshdeform_ray_tree_cast(mdb, co1, co2, &isect_mdef)) {
 		len = isect_mdef.lambda;
-		isect_mdef.face = mface = mface1 + hit.index;
+		mface = isect_mdef.face;
 
 		/* create MDefBoundIsect */
 		isect = BLI_memarena_alloc(mdb->memarena, sizeof(*isect));
@@ -1280,7 +1296,7 @@ static MDefBoundIsect *meshdeform_ray_tree_intersect(MeshDeformBind *mdb, const
 
 static int meshdeform_inside_cage(MeshDeformBind *mdb, float *co)
 {
-	MDefBoundIsect *isect;
+	MeshDeformIsect isect_mdef;
 	float outside[3], start[3], dir[3];
 	int i;
 
@@ -1293,8 +1309,7 @@ static int meshdeform_inside_cage(MeshDeformBind *mdb, float *co)
 		sub_v3_v3v3(dir, outside, start);
 		normalize_v3(dir);
 		
-		isect = meshdeform_ray_tree_intersect(mdb, start, outside);
-		if (isect && !isect->facing)
+		if (meshdeform_ray_tree_cast(mdb, start, outside, &isect_mdef) && !isect_mdef.isect)
 			return 1;
 	}
 
@@ -1429,7 +1444,7 @@ static float meshdeform_boundary_phi(MeshDeformBind *UNUSED(mdb), MDefBoundIsect
 	return 0.0f;
 }
 
-static float meshdeform_interp_w(MeshDeformBind *mdb, float *gridvec, float *UNUSED(vec), int UNUSED(cagevert))
+static float meshdeform_interp_w(MeshDeformBind *mdb, const float gridvec[3])
 {
 	float dvec[3], ivec[3], wx, wy, wz, result = 0.0f;
 	float weight, totweight = 0.0f;
@@ -1604,10 +1619,28 @@ static void meshdeform_matrix_add_exterior_phi(MeshDeformBind *mdb, int x, int y
 		mdb->phi[acenter] = phi / totweight;
 }
 
+static void meshdeform_bind_weight_task(void *userdata, int b)
+{
+	MeshDeformBind *mdb = userdata;
+	const float *vec = mdb->vertexcos[b];
+	float gridvec[3];
+
+	if (mdb->inside[b]) {
+		gridvec[0] = (vec[0] - mdb->min[0] - mdb->halfwidth[0]) / mdb->width[0];
+		gridvec[1] = (vec[1] - mdb->min[1] - mdb->halfwidth[1]) / mdb->width[1];
+		gridvec[2] = (vec[2] - mdb->min[2] - mdb->halfwidth[2]) / mdb->width[2];
+
+		mdb->vertweights[b] = meshdeform_interp_w(mdb, gridvec);
+	}
+	else {
+		mdb->vertweights[b] = 0.0f;
+	}
+}
+
 static void meshdeform_matrix_solve(MeshDeformModifierData *mmd, MeshDeformBind *mdb)
 {
 	NLContext *context;
-	float vec[3], gridvec[3];
+	MDefBindInfluence *inf;
 	int a, b, x, y, z, totvar;
 	char message[256];
 
@@ -1677,25 +1710,26 @@ static void meshdeform_matrix_solve(MeshDeformModifierData *mmd, MeshDeformBind
 				mdb->totalphi[b] += mdb->phi[b];
 			}
 
-			if (mdb->weights) {
-				/* static bind : compute weights for each vertex */
-				for (b = 0; b < mdb->totvert; b++) {
-					if (mdb->inside[b]) {
-						copy_v3_v3(vec, mdb->vertexcos[b]);
-						gridvec[0] = (vec[0] - mdb->min[0] - mdb->halfwidth[0]) / mdb->width[0];
-						gridvec[1] = (vec[1] - mdb->min[1] - mdb->halfwidth[1]) / mdb->width[1];
-						gridvec[2] = (vec[2] - mdb->min[2] - mdb->halfwidth[2]) / mdb->width[2];
+			if (mdb->bindinfs) {
+				/* static bind : compute weights for each vertex, only keep the
+				 * ones above the threshold instead of a dense vertex * cage array */
+				BLI_task_parallel_range(0, mdb->totvert, mdb, meshdeform_bind_weight_task,
+				                        mdb->totvert > MESHDEFORM_THREAD_MIN);
 
-						mdb->weights[b * mdb->totcagevert + a] = meshdeform_interp_w(mdb, gridvec, vec, a);
+				for (b = 0; b < mdb->totvert; b++) {
+					if (mdb->vertweights[b] > MESHDEFORM_MIN_INFLUENCE) {
+						inf = BLI_memarena_alloc(mdb->memarena, sizeof(*inf));
+						inf->vertex = a;
+						inf->weight = mdb->vertweights[b];
+						inf->next = mdb->bindinfs[b];
+						mdb->bindinfs[b] = inf;
 					}
 				}
 			}
 			else {
-				MDefBindInfluence *inf;
-
 				/* dynamic bind */
 				for (b = 0; b < mdb->size3; b++) {
-					if (mdb->phi[b] >= MESHDEFORM_MIN_INFLUENCE) {
+					if (mdb->phi[b] >= MESHDEFORM_MIN_DYNAMIC_INFLUENCE) {
 						inf = BLI_memarena_alloc(mdb->memarena, sizeof(*inf));
 						inf->vertex = a;
 						inf->weight = mdb->phi[b];
@@ -1730,13 +1764,20 @@ static void meshdeform_matrix_solve(MeshDeformModifierData *mmd, MeshDeformBind
 	nlDeleteContext(context);
 }
 
+static void meshdeform_inside_task(void *userdata, int a)
+{
+	MeshDeformBind *mdb = userdata;
+
+	mdb->inside[a] = meshdeform_inside_cage(mdb, mdb->vertexcos[a]);
+}
+
 static void harmonic_coordinates_bind(Scene *UNUSED(scene), MeshDeformModifierData *mmd, MeshDeformBind *mdb)
 {
 	MDefBindInfluence *inf;
 	MDefInfluence *mdinf;
 	MDefCell *cell;
-	float center[3], vec[3], maxwidth, totweight;
-	int a, b, x, y, z, totinside, offset;
+	float center[3], maxwidth, totweight;
+	int a, b, x, y, z, offset;
 
 	/* compute bounding box of the cage mesh */
 	INIT_MINMAX(mdb->min, mdb->max);
@@ -1757,8 +1798,10 @@ static void harmonic_coordinates_bind(Scene *UNUSED(scene), MeshDeformModifierDa
 
 	if (mmd->flag & MOD_MDEF_DYNAMIC_BIND)
 		mdb->dyngrid = MEM_callocN(sizeof(MDefBindInfluence *) * mdb->size3, "MDefDynGrid");
-	else
-		mdb->weights = MEM_callocN(sizeof(float) * mdb->totvert * mdb->totcagevert, "MDefWeights");
+	else {
+		mdb->bindinfs = MEM_callocN(sizeof(MDefBindInfluence *) * mdb->totvert, "MDefBindInfs");
+		mdb->vertweights = MEM_mallocN(sizeof(float) * mdb->totvert, "MDefVertWeights");
+	}
 
 	mdb->memarena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, "harmonic coords arena");
 	BLI_memarena_use_calloc(mdb->memarena);
@@ -1785,17 +1828,7 @@ static void harmonic_coordinates_bind(Scene *UNUSED(scene), MeshDeformModifierDa
 
 	progress_bar(0, "Setting up mesh deform system");
 
-	totinside = 0;
-	for (a = 0; a < mdb->totvert; a++) {
-		copy_v3_v3(vec, mdb->vertexcos[a]);
-		mdb->inside[a] = meshdeform_inside_cage(mdb, vec);
-		if (mdb->inside[a])
-			totinside++;
-	}
-
-	/* free temporary MDefBoundIsects */
-	BLI_memarena_free(mdb->memarena);
-	mdb->memarena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, "harmonic coords arena");
+	BLI_task_parallel_range(0, mdb->totvert, mdb, meshdeform_inside_task, mdb->totvert > MESHDEFORM_THREAD_MIN);
 
 	/* start with all cells untyped */
 	for (a = 0; a < mdb->size3; a++)
@@ -1858,7 +1891,11 @@ static void harmonic_coordinates_bind(Scene *UNUSED(scene), MeshDeformModifierDa
 		MEM_freeN(mdb->dyngrid);
 	}
 	else {
-		mmd->bindweights = mdb->weights;
+		/* convert MDefBindInfluences to compressed rows of MDefInfluences per vertex */
+		modifier_mdef_compact_bind_influences((ModifierData *)mmd, mdb->bindinfs, mdb->totvert);
+
+		MEM_freeN(mdb->bindinfs);
+		MEM_freeN(mdb->vertweights);
 		MEM_freeN(mdb->inside);
 	}
 
@@ -1938,6 +1975,7 @@ static void heat_weighting_bind(Scene *scene, DerivedMesh *dm, MeshDeformModifie
 	laplacian_system_delete(sys);
 
 	mmd->bindweights = mdb->weights;
+	modifier_mdef_compact_influences((ModifierData *)mmd);
 }
 #endif
 
@@ -1991,9 +2029,6 @@ void mesh_deform_bind(Scene *scene, MeshDeformModifierData *mmd, float *vertexco
 	mdb.cagedm->release(mdb.cagedm);
 	MEM_freeN(mdb.vertexcos);
 
-	/* compact weights */
-	modifier_mdef_compact_influences((ModifierData *)mmd);
-
 	end_progress_bar();
 	waitcursor(0);
 }
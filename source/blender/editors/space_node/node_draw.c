@@ -869,6 +869,19 @@ static void node_draw_basis(const bContext *C, ARegion *ar, SpaceNode *snode, bN
 	         (short)(iconofs - rct->xmin - 18.0f), (short)NODE_DY,
 	         NULL, 0, 0, 0, 0, "");
 
+	/* time spent in the last profiled compositor execution, above the header */
+	if (ntree->type == NTREE_COMPOSIT && (ntree->flag & NTREE_COM_PROFILE) && node->exec_time > 0.0f) {
+		char timestr[32];
+		if (node->exec_time < 1.0f)
+			BLI_snprintf(timestr, sizeof(timestr), "%.1f ms", node->exec_time * 1000.0f);
+		else
+			BLI_snprintf(timestr, sizeof(timestr), "%.2f s", node->exec_time);
+		uiDefBut(node->block, LABEL, 0, timestr,
+		         (int)(rct->xmin + (NODE_MARGIN_X)), (int)rct->ymax,
+		         (short)(BLI_rctf_size_x(rct) - NODE_MARGIN_X), (short)NODE_DY,
+		         NULL, 0, 0, 0, 0, "");
+	}
+
 	/* body */
 	if (!nodeIsRegistered(node))
 		UI_ThemeColor4(TH_REDALERT);	/* use warning color to indicate undefined types */
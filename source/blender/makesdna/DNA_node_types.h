@@ -213,7 +213,7 @@ typedef struct bNode {
 	 * and replacing all uses with per-instance data.
 	 */
 	short preview_xsize, preview_ysize;	/* reserved size of the preview rect */
-	int pad2;
+	float exec_time;		/* runtime, seconds spent in the last compositor execution (profiling) */
 	struct uiBlock *block;	/* runtime during drawing */
 } bNode;
 
@@ -315,6 +315,12 @@ typedef struct bNodeLink {
 #define NTREE_QUALITY_MEDIUM  1
 #define NTREE_QUALITY_LOW     2
 
+/* tree->edit_proxy, execute at 1/2^n of the resolution */
+#define NTREE_PROXY_FULL      0
+#define NTREE_PROXY_HALF      1
+#define NTREE_PROXY_QUARTER   2
+#define NTREE_PROXY_EIGHTH    3
+
 /* tree->chunksize */
 #define NTREE_CHUNCKSIZE_32 32
 #define NTREE_CHUNCKSIZE_64 64
@@ -346,7 +352,8 @@ typedef struct bNodeTree {
 	int update;						/* update flags */
 	short is_updating;				/* flag to prevent reentrant update calls */
 	short done;						/* generic temporary flag for recursion check (DFS/BFS) */
-	int pad2;
+	short edit_proxy;				/* Resolution divider setting when editing (compositor) */
+	short pad2;
 	
 	int nodetype DNA_DEPRECATED;	/* specific node type this tree is used for */
 
@@ -406,6 +413,8 @@ typedef struct bNodeTree {
 #define NTREE_COM_GROUPNODE_BUFFER	8	/* use groupnode buffers */
 #define NTREE_VIEWER_BORDER			16	/* use a border for viewer nodes */
 #define NTREE_IS_LOCALIZED			32	/* tree is localized copy, free when deleting node groups */
+#define NTREE_COM_STREAMING			64	/* only keep the buffer rows still needed in memory */
+#define NTREE_COM_PROFILE			128	/* collect per node execution statistics */
 
 /* XXX not nice, but needed as a temporary flags
  * for group updates after library linking.
@@ -499,7 +508,8 @@ enum {
 };
 
 enum {
-	CMP_NODEFLAG_BLUR_VARIABLE_SIZE = (1 << 0)
+	CMP_NODEFLAG_BLUR_VARIABLE_SIZE = (1 << 0),
+	CMP_NODEFLAG_BLUR_EXACT         = (1 << 1)
 };
 
 typedef struct NodeFrame {
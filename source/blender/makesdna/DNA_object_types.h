@@ -273,6 +273,8 @@ typedef struct Object {
 
 	/* Runtime valuated curve-specific data, not stored in the file */
 	struct CurveCache *curve_cache;
+	/* Runtime cached results of the mesh modifier stack, not stored in the file */
+	struct ModifierStackCache *modifier_cache;
 
 	struct DerivedMesh *derivedDeform, *derivedFinal;
 	uint64_t lastDataMask;   /* the custom data layer mask that was last used to calculate derivedDeform and derivedFinal */
@@ -90,6 +90,14 @@ static EnumPropertyItem node_quality_items[] = {
 	{0, NULL, 0, NULL, NULL}
 };
 
+static EnumPropertyItem node_proxy_items[] = {
+	{NTREE_PROXY_FULL,    "FULL",     0,    "Full",     "Execute at full resolution"},
+	{NTREE_PROXY_HALF,    "HALF",     0,    "1/2",      "Execute at half the resolution"},
+	{NTREE_PROXY_QUARTER, "QUARTER",  0,    "1/4",      "Execute at a quarter of the resolution"},
+	{NTREE_PROXY_EIGHTH,  "EIGHTH",   0,    "1/8",      "Execute at an eighth of the resolution"},
+	{0, NULL, 0, NULL, NULL}
+};
+
 static EnumPropertyItem node_chunksize_items[] = {
 	{NTREE_CHUNCKSIZE_32,   "32",     0,    "32x32",     "Chunksize of 32x32"},
 	{NTREE_CHUNCKSIZE_64,   "64",     0,    "64x64",     "Chunksize of 64x64"},
@@ -5710,6 +5718,13 @@ static void def_cmp_bokehblur(StructRNA *srna)
 	                         "Support variable blur per-pixel when using an image for size input");
 	RNA_def_property_update(prop, NC_NODE | NA_EDITED, "rna_Node_update");
 
+	prop = RNA_def_property(srna, "use_exact", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "custom1", CMP_NODEFLAG_BLUR_EXACT);
+	RNA_def_property_ui_text(prop, "Exact",
+	                         "Evaluate every sample of the bokeh kernel per pixel instead of using the "
+	                         "accelerated kernel (slower)");
+	RNA_def_property_update(prop, NC_NODE | NA_EDITED, "rna_Node_update");
+
 #if 0
 	prop = RNA_def_property(srna, "f_stop", PROP_FLOAT, PROP_NONE);
 	RNA_def_property_float_sdna(prop, NULL, "custom3");
@@ -7205,6 +7220,13 @@ static void rna_def_node(BlenderRNA *brna)
 	RNA_def_property_ui_text(prop, "Show Preview", "");
 	RNA_def_property_update(prop, NC_NODE | ND_DISPLAY, NULL);
 
+	prop = RNA_def_property(srna, "execution_time", PROP_FLOAT, PROP_NONE);
+	RNA_def_property_float_sdna(prop, NULL, "exec_time");
+	RNA_def_property_clear_flag(prop, PROP_EDITABLE);
+	RNA_def_property_ui_text(prop, "Execution Time",
+	                         "Seconds spent executing this node in the last profiled compositor run, "
+	                         "group nodes include the nodes inside them");
+
 	prop = RNA_def_property(srna, "hide", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", NODE_HIDDEN);
 	RNA_def_property_ui_text(prop, "Hide", "");
@@ -7681,6 +7703,12 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
 	RNA_def_property_enum_items(prop, node_quality_items);
 	RNA_def_property_ui_text(prop, "Edit Quality", "Quality when editing");
 
+	prop = RNA_def_property(srna, "edit_proxy", PROP_ENUM, PROP_NONE);
+	RNA_def_property_enum_sdna(prop, NULL, "edit_proxy");
+	RNA_def_property_enum_items(prop, node_proxy_items);
+	RNA_def_property_ui_text(prop, "Edit Proxy", "Resolution at which the whole tree is executed when editing, "
+	                                             "inputs are downsampled and outputs scaled up again");
+
 	prop = RNA_def_property(srna, "chunk_size", PROP_ENUM, PROP_NONE);
 	RNA_def_property_enum_sdna(prop, NULL, "chunksize");
 	RNA_def_property_enum_items(prop, node_chunksize_items);
@@ -7700,6 +7728,18 @@ static void rna_def_composite_nodetree(BlenderRNA *brna)
 	RNA_def_property_ui_text(prop, "Two Pass", "Use two pass execution during editing: first calculate fast nodes, "
 	                                           "second pass calculate all nodes");
 
+	prop = RNA_def_property(srna, "use_streaming", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_STREAMING);
+	RNA_def_property_ui_text(prop, "Streaming", "Calculate the outputs in horizontal bands and only keep the rows of "
+	                                            "intermediate buffers which are still needed, to reduce memory usage "
+	                                            "of large images");
+
+	prop = RNA_def_property(srna, "use_profiling", PROP_BOOLEAN, PROP_NONE);
+	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_COM_PROFILE);
+	RNA_def_property_ui_text(prop, "Profiling", "Measure the time and memory used by every node and show it "
+	                                            "in the node editor");
+	RNA_def_property_update(prop, NC_NODE | ND_DISPLAY, NULL);
+
 	prop = RNA_def_property(srna, "use_viewer_border", PROP_BOOLEAN, PROP_NONE);
 	RNA_def_property_boolean_sdna(prop, NULL, "flag", NTREE_VIEWER_BORDER);
 	RNA_def_property_ui_text(prop, "Viewer Border", "Use boundaries for viewer nodes and composite backdrop");
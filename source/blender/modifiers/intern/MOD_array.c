@@ -38,6 +38,7 @@
 #include "MEM_guardedalloc.h"
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "DNA_curve_types.h"
@@ -152,36 +153,186 @@ static float vertarray_size(const MVert *mvert, int numVerts, int axis)
 	return max_co - min_co;
 }
 
-BLI_INLINE float sum_v3(const float v[3])
+/* below this many vertices threading isn't worth it */
+#define ARRAY_THREAD_MIN 1000
+
+/* Spatial hash of the vertices of one chunk, the cells are as large as the
+ * merge distance so doubles of a vertex can only be in the cells around it. */
+typedef struct VertDoublesHash {
+	const MVert *mverts;
+	int *bucket_first;      /* first vertex in a bucket, -1 for empty buckets */
+	int *bucket_next;       /* next vertex in the same bucket, indexed from start */
+	unsigned int bucket_mask;
+	int start;
+	float cell_size_inv;
+} VertDoublesHash;
+
+BLI_INLINE void vert_doubles_hash_cell(const VertDoublesHash *hash, const float co[3], int r_cell[3])
 {
-	return v[0] + v[1] + v[2];
+	/* keep far away vertices in the outer cells, neighboring cells stay neighbors */
+	const float cell_max = (float)(1 << 29);
+	int j;
+
+	for (j = 0; j < 3; j++) {
+		const float cell = floorf(co[j] * hash->cell_size_inv);
+
+		/* NaN can't be converted to int, put such vertices in one cell,
+		 * they never compare equal to anything anyway */
+		r_cell[j] = isnan(cell) ? 0 : (int)CLAMPIS(cell, -cell_max, cell_max);
+	}
+}
+
+BLI_INLINE unsigned int vert_doubles_hash_bucket(const VertDoublesHash *hash, const int cell[3])
+{
+	return (((unsigned int)cell[0] * 73856093u) ^
+	        ((unsigned int)cell[1] * 19349663u) ^
+	        ((unsigned int)cell[2] * 83492791u)) & hash->bucket_mask;
+}
+
+static void vert_doubles_hash_build(
+        VertDoublesHash *hash, const MVert *mverts, const int start, const int num_verts, const float dist)
+{
+	const unsigned int num_buckets = (unsigned int)power_of_2_max_i(max_ii(num_verts, 1));
+	int i;
+
+	hash->mverts = mverts;
+	hash->start = start;
+	hash->bucket_mask = num_buckets - 1;
+	/* for a zero merge distance only the same position is a double, any cell size works */
+	hash->cell_size_inv = (dist > 0.0f) ? 1.0f / dist : 1.0f;
+	hash->bucket_first = MEM_mallocN(sizeof(*hash->bucket_first) * num_buckets, __func__);
+	hash->bucket_next = MEM_mallocN(sizeof(*hash->bucket_next) * (size_t)max_ii(num_verts, 1), __func__);
+
+	fill_vn_i(hash->bucket_first, (int)num_buckets, -1);
+
+	/* insert backwards so buckets are in index order */
+	for (i = start + num_verts - 1; i >= start; i--) {
+		int cell[3];
+		unsigned int bucket;
+
+		vert_doubles_hash_cell(hash, mverts[i].co, cell);
+		bucket = vert_doubles_hash_bucket(hash, cell);
+		hash->bucket_next[i - start] = hash->bucket_first[bucket];
+		hash->bucket_first[bucket] = i;
+	}
 }
 
-/* Structure used for sorting vertices, when processing doubles */
-typedef struct SortVertsElem {
-	int vertex_num;     /* The original index of the vertex, prior to sorting */
-	float co[3];        /* Its coordinates */
-	float sum_co;       /* sum_v3(co), just so we don't do the sum many times.  */
-} SortVertsElem;
+static void vert_doubles_hash_free(VertDoublesHash *hash)
+{
+	MEM_freeN(hash->bucket_first);
+	MEM_freeN(hash->bucket_next);
+}
 
+/* Nearest vertex within dist, the lowest index for equal distances, or -1. */
+static int vert_doubles_hash_find(const VertDoublesHash *hash, const float co[3], const float dist)
+{
+	float dist_best_sq = dist * dist;
+	int index_best = -1;
+	int cell[3], x, y, z;
+
+	vert_doubles_hash_cell(hash, co, cell);
+
+	for (z = -1; z <= 1; z++) {
+		for (y = -1; y <= 1; y++) {
+			for (x = -1; x <= 1; x++) {
+				const int cell_test[3] = {cell[0] + x, cell[1] + y, cell[2] + z};
+				int i = hash->bucket_first[vert_doubles_hash_bucket(hash, cell_test)];
+
+				for (; i != -1; i = hash->bucket_next[i - hash->start]) {
+					const float dist_sq = len_squared_v3v3(co, hash->mverts[i].co);
+
+					if ((dist_sq < dist_best_sq) ||
+					    (dist_sq == dist_best_sq && (index_best == -1 || i < index_best)))
+					{
+						dist_best_sq = dist_sq;
+						index_best = i;
+					}
+				}
+			}
+		}
+	}
+
+	return index_best;
+}
+
+typedef struct FindDoublesData {
+	const VertDoublesHash *hash;
+	const MVert *mverts;
+	int *r_targets;
+	int source_start;
+	float dist;
+} FindDoublesData;
+
+static void dm_mvert_find_doubles_task(void *userdata, int i)
+{
+	FindDoublesData *data = userdata;
+
+	data->r_targets[i] = vert_doubles_hash_find(data->hash, data->mverts[data->source_start + i].co, data->dist);
+}
 
-static int svert_sum_cmp(const void *e1, const void *e2)
+/**
+ * For every vertex of source, find the nearest vertex of target within dist, or -1.
+ * Both sets of verts are defined by their start within the mverts array and their number.
+ * r_targets[source_num_verts] must have been allocated by caller.
+ */
+static void dm_mvert_find_doubles(
+        int *r_targets,
+        const MVert *mverts,
+        const int target_start,
+        const int target_num_verts,
+        const int source_start,
+        const int source_num_verts,
+        const float dist,
+        const bool use_threading)
 {
-	const SortVertsElem *sv1 = (SortVertsElem *)e1;
-	const SortVertsElem *sv2 = (SortVertsElem *)e2;
+	VertDoublesHash hash;
+	FindDoublesData data;
+
+	vert_doubles_hash_build(&hash, mverts, target_start, target_num_verts, dist);
+
+	data.hash = &hash;
+	data.mverts = mverts;
+	data.r_targets = r_targets;
+	data.source_start = source_start;
+	data.dist = dist;
+
+	BLI_task_parallel_range(0, source_num_verts, &data, dm_mvert_find_doubles_task,
+	                        use_threading && (source_num_verts > ARRAY_THREAD_MIN));
 
-	if      (sv1->sum_co > sv2->sum_co) return  1;
-	else if (sv1->sum_co < sv2->sum_co) return -1;
-	else                                return  0;
+	vert_doubles_hash_free(&hash);
 }
 
-static void svert_from_mvert(SortVertsElem *sv, const MVert *mv, const int i_begin, const int i_end)
+/**
+ * Add the doubles found by #dm_mvert_find_doubles to the mapping of all vertices.
+ * A source vertex that is mapped already (in an earlier call, with other chunks) is kept,
+ * when its target is mapped itself, behavior depends on with_follow option.
+ */
+static void dm_mvert_map_doubles_apply(
+        int *doubles_map,
+        const int *targets,
+        const int source_start,
+        const int source_num_verts,
+        const bool with_follow)
 {
 	int i;
-	for (i = i_begin; i < i_end; i++, sv++, mv++) {
-		sv->vertex_num = i;
-		copy_v3_v3(sv->co, mv->co);
-		sv->sum_co = sum_v3(mv->co);
+
+	for (i = 0; i < source_num_verts; i++) {
+		int target_vertex = targets[i];
+
+		if ((doubles_map[source_start + i] != -1) || (target_vertex == -1)) {
+			continue;
+		}
+
+		if (doubles_map[target_vertex] != -1) {
+			if (with_follow) { /* with_follow option:  map to initial target */
+				target_vertex = doubles_map[target_vertex];
+			}
+			else {
+				/* not with_follow: if target is mapped, then we do not map source */
+				continue;
+			}
+		}
+		doubles_map[source_start + i] = target_vertex;
 	}
 }
 
@@ -201,110 +352,89 @@ static void dm_mvert_map_doubles(
         const float dist,
         const bool with_follow)
 {
-	const float dist3 = (M_SQRT3 + 0.00005f) * dist;   /* Just above sqrt(3) */
-	int i_source, i_target, i_target_low_bound, target_end, source_end;
-	SortVertsElem *sorted_verts_target, *sorted_verts_source;
-	SortVertsElem *sve_source, *sve_target, *sve_target_low_bound;
-	bool target_scan_completed;
-
-	target_end = target_start + target_num_verts;
-	source_end = source_start + source_num_verts;
-
-	/* build array of MVerts to be tested for merging */
-	sorted_verts_target = MEM_mallocN(sizeof(SortVertsElem) * target_num_verts, __func__);
-	sorted_verts_source = MEM_mallocN(sizeof(SortVertsElem) * source_num_verts, __func__);
-
-	/* Copy target vertices index and cos into SortVertsElem array */
-	svert_from_mvert(sorted_verts_target, mverts + target_start, target_start, target_end);
-
-	/* Copy source vertices index and cos into SortVertsElem array */
-	svert_from_mvert(sorted_verts_source, mverts + source_start, source_start, source_end);
-
-	/* sort arrays according to sum of vertex coordinates (sumco) */
-	qsort(sorted_verts_target, target_num_verts, sizeof(SortVertsElem), svert_sum_cmp);
-	qsort(sorted_verts_source, source_num_verts, sizeof(SortVertsElem), svert_sum_cmp);
-
-	sve_target_low_bound = sorted_verts_target;
-	i_target_low_bound = 0;
-	target_scan_completed = false;
-
-	/* Scan source vertices, in SortVertsElem sorted array, */
-	/* all the while maintaining the lower bound of possible doubles in target vertices */
-	for (i_source = 0, sve_source = sorted_verts_source;
-	     i_source < source_num_verts;
-	     i_source++, sve_source++)
-	{
-		bool double_found;
-		float sve_source_sumco;
+	int *targets = MEM_mallocN(sizeof(*targets) * (size_t)max_ii(source_num_verts, 1), __func__);
 
-		/* If source has already been assigned to a target (in an earlier call, with other chunks) */
-		if (doubles_map[sve_source->vertex_num] != -1) {
-			continue;
-		}
+	dm_mvert_find_doubles(targets, mverts, target_start, target_num_verts, source_start, source_num_verts,
+	                      dist, true);
+	dm_mvert_map_doubles_apply(doubles_map, targets, source_start, source_num_verts, with_follow);
 
-		/* If target fully scanned already, then all remaining source vertices cannot have a double */
-		if (target_scan_completed) {
-			doubles_map[sve_source->vertex_num] = -1;
-			continue;
-		}
+	MEM_freeN(targets);
+}
 
-		sve_source_sumco = sum_v3(sve_source->co);
+typedef struct ArrayChunksData {
+	DerivedMesh *result;
+	MVert *mvert;
+	MEdge *medge;
+	MLoop *mloop;
+	MPoly *mpoly;
+	float (*offsets)[4][4];     /* cumulative offset of every copy */
+	int *chunk_targets;         /* doubles of every chunk in the previous one */
+	int chunk_nverts, chunk_nedges, chunk_nloops, chunk_npolys;
+	float merge_dist;
+} ArrayChunksData;
 
-		/* Skip all target vertices that are more than dist3 lower in terms of sumco */
-		/* and advance the overall lower bound, applicable to all remaining vertices as well. */
-		while ((i_target_low_bound < target_num_verts) &&
-		       (sve_target_low_bound->sum_co < sve_source_sumco - dist3))
-		{
-			i_target_low_bound++;
-			sve_target_low_bound++;
-		}
-		/* If end of target list reached, then no more possible doubles */
-		if (i_target_low_bound >= target_num_verts) {
-			doubles_map[sve_source->vertex_num] = -1;
-			target_scan_completed = true;
-			continue;
-		}
-		/* Test target candidates starting at the low bound of possible doubles, ordered in terms of sumco */
-		i_target = i_target_low_bound;
-		sve_target = sve_target_low_bound;
-
-		/* i_target will scan vertices in the [v_source_sumco - dist3;  v_source_sumco + dist3] range */
-
-		double_found = false;
-		while ((i_target < target_num_verts) &&
-		       (sve_target->sum_co <= sve_source_sumco + dist3))
-		{
-			/* Testing distance for candidate double in target */
-			/* v_target is within dist3 of v_source in terms of sumco;  check real distance */
-			if (compare_len_v3v3(sve_source->co, sve_target->co, dist)) {
-				/* Double found */
-				/* If double target is itself already mapped to other vertex,
-				 * behavior depends on with_follow option */
-				int target_vertex = sve_target->vertex_num;
-				if (doubles_map[target_vertex] != -1) {
-					if (with_follow) { /* with_follow option:  map to initial target */
-						target_vertex = doubles_map[target_vertex];
-					}
-					else {
-						/* not with_follow: if target is mapped, then we do not map source, and stop searching  */
-						break;
-					}
-				}
-				doubles_map[sve_source->vertex_num] = target_vertex;
-				double_found = true;
-				break;
-			}
-			i_target++;
-			sve_target++;
-		}
-		/* End of candidate scan: if none found then no doubles */
-		if (!double_found) {
-			doubles_map[sve_source->vertex_num] = -1;
-		}
+/* copy the first chunk and its customdata to copy c, and offset it */
+static void array_chunk_copy_task(void *userdata, int c)
+{
+	ArrayChunksData *data = userdata;
+	DerivedMesh *result = data->result;
+	const int chunk_nverts = data->chunk_nverts;
+	const int chunk_nedges = data->chunk_nedges;
+	const int chunk_nloops = data->chunk_nloops;
+	const int chunk_npolys = data->chunk_npolys;
+	MVert *mv;
+	MEdge *me;
+	MLoop *ml;
+	MPoly *mp;
+	int i;
+
+	/* copy customdata to new geometry */
+	DM_copy_vert_data(result, result, 0, c * chunk_nverts, chunk_nverts);
+	DM_copy_edge_data(result, result, 0, c * chunk_nedges, chunk_nedges);
+	DM_copy_loop_data(result, result, 0, c * chunk_nloops, chunk_nloops);
+	DM_copy_poly_data(result, result, 0, c * chunk_npolys, chunk_npolys);
+
+	/* apply offset to all new verts */
+	mv = data->mvert + c * chunk_nverts;
+	for (i = 0; i < chunk_nverts; i++, mv++) {
+		mul_m4_v3(data->offsets[c], mv->co);
+	}
+
+	/* adjust edge vertex indices */
+	me = data->medge + c * chunk_nedges;
+	for (i = 0; i < chunk_nedges; i++, me++) {
+		me->v1 += c * chunk_nverts;
+		me->v2 += c * chunk_nverts;
+	}
+
+	mp = data->mpoly + c * chunk_npolys;
+	for (i = 0; i < chunk_npolys; i++, mp++) {
+		mp->loopstart += c * chunk_nloops;
 	}
 
-	MEM_freeN(sorted_verts_source);
-	MEM_freeN(sorted_verts_target);
+	/* adjust loop vertex and edge indices */
+	ml = data->mloop + c * chunk_nloops;
+	for (i = 0; i < chunk_nloops; i++, ml++) {
+		ml->v += c * chunk_nverts;
+		ml->e += c * chunk_nedges;
+	}
+}
+
+/* find the doubles between chunk c and c - 1, chunks are handled independently */
+static void array_chunk_find_doubles_task(void *userdata, int c)
+{
+	ArrayChunksData *data = userdata;
+	const int chunk_nverts = data->chunk_nverts;
+
+	dm_mvert_find_doubles(
+	        data->chunk_targets + c * chunk_nverts,
+	        data->mvert,
+	        (c - 1) * chunk_nverts,
+	        chunk_nverts,
+	        c * chunk_nverts,
+	        chunk_nverts,
+	        data->merge_dist,
+	        false);
 }
 
 
@@ -388,11 +518,8 @@ static DerivedMesh *arrayModifier_doArray(
 {
 	const float eps = 1e-6f;
 	const MVert *src_mvert;
-	MVert *mv, *mv_prev, *result_dm_verts;
+	MVert *result_dm_verts;
 
-	MEdge *me;
-	MLoop *ml;
-	MPoly *mp;
 	int i, j, c, count;
 	float length = amd->length;
 	/* offset matrix */
@@ -400,7 +527,8 @@ static DerivedMesh *arrayModifier_doArray(
 	float scale[3];
 	bool offset_has_scale;
 	float current_offset[4][4];
-	float final_offset[4][4];
+	float (*offsets)[4][4];
+	ArrayChunksData chunks_data;
 	int *full_doubles_map = NULL;
 	int tot_doubles;
 
@@ -544,47 +672,43 @@ static DerivedMesh *arrayModifier_doArray(
 	first_chunk_start = 0;
 	first_chunk_nverts = chunk_nverts;
 
-	unit_m4(current_offset);
+	/* cumulative offsets of all copies, so copies don't depend on each other */
+	offsets = MEM_mallocN(sizeof(*offsets) * (size_t)count, "mod array offsets");
+	unit_m4(offsets[0]);
 	for (c = 1; c < count; c++) {
-		/* copy customdata to new geometry */
-		DM_copy_vert_data(result, result, 0, c * chunk_nverts, chunk_nverts);
-		DM_copy_edge_data(result, result, 0, c * chunk_nedges, chunk_nedges);
-		DM_copy_loop_data(result, result, 0, c * chunk_nloops, chunk_nloops);
-		DM_copy_poly_data(result, result, 0, c * chunk_npolys, chunk_npolys);
-
-		mv_prev = result_dm_verts;
-		mv = mv_prev + c * chunk_nverts;
-
-		/* recalculate cumulative offset here */
-		mul_m4_m4m4(current_offset, current_offset, offset);
-
-		/* apply offset to all new verts */
-		for (i = 0; i < chunk_nverts; i++, mv++, mv_prev++) {
-			mul_m4_v3(current_offset, mv->co);
-		}
-
-		/* adjust edge vertex indices */
-		me = CDDM_get_edges(result) + c * chunk_nedges;
-		for (i = 0; i < chunk_nedges; i++, me++) {
-			me->v1 += c * chunk_nverts;
-			me->v2 += c * chunk_nverts;
-		}
-
-		mp = CDDM_get_polys(result) + c * chunk_npolys;
-		for (i = 0; i < chunk_npolys; i++, mp++) {
-			mp->loopstart += c * chunk_nloops;
-		}
+		mul_m4_m4m4(offsets[c], offsets[c - 1], offset);
+	}
 
-		/* adjust loop vertex and edge indices */
-		ml = CDDM_get_loops(result) + c * chunk_nloops;
-		for (i = 0; i < chunk_nloops; i++, ml++) {
-			ml->v += c * chunk_nverts;
-			ml->e += c * chunk_nedges;
-		}
+	chunks_data.result = result;
+	chunks_data.mvert = result_dm_verts;
+	chunks_data.medge = CDDM_get_edges(result);
+	chunks_data.mloop = CDDM_get_loops(result);
+	chunks_data.mpoly = CDDM_get_polys(result);
+	chunks_data.offsets = offsets;
+	chunks_data.chunk_targets = NULL;
+	chunks_data.chunk_nverts = chunk_nverts;
+	chunks_data.chunk_nedges = chunk_nedges;
+	chunks_data.chunk_nloops = chunk_nloops;
+	chunks_data.chunk_npolys = chunk_npolys;
+	chunks_data.merge_dist = amd->merge_dist;
+
+	BLI_task_parallel_range(1, count, &chunks_data, array_chunk_copy_task,
+	                        ((count - 1) * chunk_nverts > ARRAY_THREAD_MIN));
+
+	/* Handle merge between chunk n and n-1 */
+	if ((amd->flags & MOD_ARR_MERGE) && (count > 1)) {
+		if (!offset_has_scale) {
+			dm_mvert_map_doubles(
+			        full_doubles_map,
+			        result_dm_verts,
+			        0,
+			        chunk_nverts,
+			        chunk_nverts,
+			        chunk_nverts,
+			        amd->merge_dist,
+			        false);
 
-		/* Handle merge between chunk n and n-1 */
-		if ((amd->flags & MOD_ARR_MERGE) && (c >= 1)) {
-			if (!offset_has_scale && (c >= 2)) {
+			for (c = 2; c < count; c++) {
 				/* Mapping chunk 3 to chunk 2 is a translation of mapping 2 to 1
 				 * ... that is except if scaling makes the distance grow */
 				int k;
@@ -603,24 +727,32 @@ static DerivedMesh *arrayModifier_doArray(
 					full_doubles_map[this_chunk_index] = target;
 				}
 			}
-			else {
-				dm_mvert_map_doubles(
+		}
+		else {
+			/* search all pairs of neighbor chunks at once, mapping them has to be done
+			 * in order since a chunk is not mapped to one that was mapped itself */
+			chunks_data.chunk_targets = MEM_mallocN(sizeof(int) * (size_t)(count * chunk_nverts),
+			                                        "mod array chunk targets");
+			BLI_task_parallel_range(1, count, &chunks_data, array_chunk_find_doubles_task,
+			                        ((count - 1) * chunk_nverts > ARRAY_THREAD_MIN));
+
+			for (c = 1; c < count; c++) {
+				dm_mvert_map_doubles_apply(
 				        full_doubles_map,
-				        result_dm_verts,
-				        (c - 1) * chunk_nverts,
-				        chunk_nverts,
+				        chunks_data.chunk_targets + c * chunk_nverts,
 				        c * chunk_nverts,
 				        chunk_nverts,
-				        amd->merge_dist,
 				        false);
 			}
+			MEM_freeN(chunks_data.chunk_targets);
 		}
 	}
 
 	last_chunk_start = (count - 1) * chunk_nverts;
 	last_chunk_nverts = chunk_nverts;
 
-	copy_m4_m4(final_offset, current_offset);
+	copy_m4_m4(current_offset, offsets[count - 1]);
+	MEM_freeN(offsets);
 
 	if ((amd->flags & MOD_ARR_MERGE) &&
 	    (amd->flags & MOD_ARR_MERGEFINAL) &&
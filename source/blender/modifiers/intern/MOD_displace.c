@@ -36,6 +36,7 @@
 #include "DNA_meshdata_types.h"
 #include "DNA_object_types.h"
 
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 
@@ -170,85 +171,109 @@ static void updateDepgraph(ModifierData *md, DagForest *forest,
 	
 }
 
+/* below this many vertices threading isn't worth it */
+#define DISPLACE_THREAD_MIN 1000
+
+typedef struct DisplaceUserdata {
+	DisplaceModifierData *dmd;
+	MDeformVert *dvert;
+	int defgrp_index;
+	float (*vertexCos)[3];
+	MVert *mvert;
+	TexResult *texres;
+	float delta_fixed;
+} DisplaceUserdata;
+
+static void displaceModifier_do_task(void *userdata, const int i)
+{
+	DisplaceUserdata *data = userdata;
+	DisplaceModifierData *dmd = data->dmd;
+	float (*vertexCos)[3] = data->vertexCos;
+	TexResult *texres = NULL;
+	float strength = dmd->strength;
+	float delta;
+
+	if (data->dvert) {
+		const float weight = defvert_find_weight(data->dvert + i, data->defgrp_index);
+		if (weight == 0.0f) {
+			return;
+		}
+		strength *= weight;
+	}
+
+	if (data->texres) {
+		texres = &data->texres[i];
+		delta = texres->tin - dmd->midlevel;
+	}
+	else {
+		delta = data->delta_fixed;  /* (1.0f - dmd->midlevel) */  /* never changes */
+	}
+
+	delta *= strength;
+	CLAMP(delta, -10000, 10000);
+
+	switch (dmd->direction) {
+		case MOD_DISP_DIR_X:
+			vertexCos[i][0] += delta;
+			break;
+		case MOD_DISP_DIR_Y:
+			vertexCos[i][1] += delta;
+			break;
+		case MOD_DISP_DIR_Z:
+			vertexCos[i][2] += delta;
+			break;
+		case MOD_DISP_DIR_RGB_XYZ:
+			vertexCos[i][0] += (texres->tr - dmd->midlevel) * strength;
+			vertexCos[i][1] += (texres->tg - dmd->midlevel) * strength;
+			vertexCos[i][2] += (texres->tb - dmd->midlevel) * strength;
+			break;
+		case MOD_DISP_DIR_NOR:
+			vertexCos[i][0] += delta * (data->mvert[i].no[0] / 32767.0f);
+			vertexCos[i][1] += delta * (data->mvert[i].no[1] / 32767.0f);
+			vertexCos[i][2] += delta * (data->mvert[i].no[2] / 32767.0f);
+			break;
+	}
+}
+
 /* dm must be a CDDerivedMesh */
 static void displaceModifier_do(
         DisplaceModifierData *dmd, Object *ob,
         DerivedMesh *dm, float (*vertexCos)[3], int numVerts)
 {
-	int i;
-	MVert *mvert;
+	DisplaceUserdata data;
 	MDeformVert *dvert;
 	int defgrp_index;
-	float (*tex_co)[3];
-	float weight = 1.0f; /* init value unused but some compilers may complain */
-	const float delta_fixed = 1.0f - dmd->midlevel;  /* when no texture is used, we fallback to white */
 
 	if (!dmd->texture && dmd->direction == MOD_DISP_DIR_RGB_XYZ) return;
 	if (dmd->strength == 0.0f) return;
 
-	mvert = CDDM_get_verts(dm);
 	modifier_get_vgroup(ob, dm, dmd->defgrp_name, &dvert, &defgrp_index);
 
+	data.dmd = dmd;
+	data.dvert = dvert;
+	data.defgrp_index = defgrp_index;
+	data.vertexCos = vertexCos;
+	data.mvert = CDDM_get_verts(dm);
+	data.texres = NULL;
+	data.delta_fixed = 1.0f - dmd->midlevel;  /* when no texture is used, we fallback to white */
+
 	if (dmd->texture) {
-		tex_co = MEM_callocN(sizeof(*tex_co) * numVerts,
-		                     "displaceModifier_do tex_co");
+		float (*tex_co)[3] = MEM_mallocN(sizeof(*tex_co) * numVerts, "displaceModifier_do tex_co");
+
 		get_texture_coords((MappingInfoModifierData *)dmd, ob, dm, vertexCos, tex_co, numVerts);
 
 		modifier_init_texture(dmd->modifier.scene, dmd->texture);
-	}
-	else {
-		tex_co = NULL;
-	}
 
-	for (i = 0; i < numVerts; i++) {
-		TexResult texres;
-		float strength = dmd->strength;
-		float delta;
-
-		if (dvert) {
-			weight = defvert_find_weight(dvert + i, defgrp_index);
-			if (weight == 0.0f) continue;
-		}
+		data.texres = MEM_mallocN(sizeof(*data.texres) * numVerts, "displaceModifier_do texres");
+		BKE_texture_get_values(dmd->modifier.scene, dmd->texture, tex_co, data.texres, numVerts, false);
 
-		if (dmd->texture) {
-			texres.nor = NULL;
-			BKE_texture_get_value(dmd->modifier.scene, dmd->texture, tex_co[i], &texres, false);
-			delta = texres.tin - dmd->midlevel;
-		}
-		else {
-			delta = delta_fixed;  /* (1.0f - dmd->midlevel) */  /* never changes */
-		}
-
-		if (dvert) strength *= weight;
-
-		delta *= strength;
-		CLAMP(delta, -10000, 10000);
-
-		switch (dmd->direction) {
-			case MOD_DISP_DIR_X:
-				vertexCos[i][0] += delta;
-				break;
-			case MOD_DISP_DIR_Y:
-				vertexCos[i][1] += delta;
-				break;
-			case MOD_DISP_DIR_Z:
-				vertexCos[i][2] += delta;
-				break;
-			case MOD_DISP_DIR_RGB_XYZ:
-				vertexCos[i][0] += (texres.tr - dmd->midlevel) * strength;
-				vertexCos[i][1] += (texres.tg - dmd->midlevel) * strength;
-				vertexCos[i][2] += (texres.tb - dmd->midlevel) * strength;
-				break;
-			case MOD_DISP_DIR_NOR:
-				vertexCos[i][0] += delta * (mvert[i].no[0] / 32767.0f);
-				vertexCos[i][1] += delta * (mvert[i].no[1] / 32767.0f);
-				vertexCos[i][2] += delta * (mvert[i].no[2] / 32767.0f);
-				break;
-		}
+		MEM_freeN(tex_co);
 	}
 
-	if (tex_co) {
-		MEM_freeN(tex_co);
+	BLI_task_parallel_range(0, numVerts, &data, displaceModifier_do_task, numVerts > DISPLACE_THREAD_MIN);
+
+	if (data.texres) {
+		MEM_freeN(data.texres);
 	}
 }
 
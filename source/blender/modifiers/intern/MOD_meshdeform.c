@@ -37,6 +37,7 @@
 #include "DNA_scene_types.h"
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 #include "BLI_utildefines.h"
 
 #include "BLF_translation.h"
@@ -53,6 +54,8 @@
 
 #include "MOD_util.h"
 
+/* below this many vertices threading isn't worth it */
+#define MESHDEFORM_THREAD_MIN 1000
 
 static void initData(ModifierData *md)
 {
@@ -181,6 +184,68 @@ static float meshdeform_dynamic_bind(MeshDeformModifierData *mmd, float (*dco)[3
 	return totweight;
 }
 
+typedef struct MeshdeformUserdata {
+	MeshDeformModifierData *mmd;
+	MDeformVert *dvert;
+	int defgrp_index;
+	float (*vertexCos)[3];
+	float (*dco)[3];
+	float (*cagemat)[4];
+	float (*icagemat)[3];
+} MeshdeformUserdata;
+
+static void meshdeform_vert_task(void *userdata, int b)
+{
+	MeshdeformUserdata *data = userdata;
+	MeshDeformModifierData *mmd = data->mmd;
+	const MDefInfluence *influences = mmd->bindinfluences;
+	const int *offsets = mmd->bindoffsets;
+	float (*dco)[3] = data->dco;
+	float co[3], weight, totweight, fac = 1.0f;
+	int a;
+
+	if (mmd->flag & MOD_MDEF_DYNAMIC_BIND)
+		if (!mmd->dynverts[b])
+			return;
+
+	if (data->dvert) {
+		fac = defvert_find_weight(&data->dvert[b], data->defgrp_index);
+
+		if (mmd->flag & MOD_MDEF_INVERT_VGROUP) {
+			fac = 1.0f - fac;
+		}
+
+		if (fac <= 0.0f) {
+			return;
+		}
+	}
+
+	if (mmd->flag & MOD_MDEF_DYNAMIC_BIND) {
+		/* transform coordinate into cage's local space */
+		mul_v3_m4v3(co, data->cagemat, data->vertexCos[b]);
+		totweight = meshdeform_dynamic_bind(mmd, dco, co);
+	}
+	else {
+		totweight = 0.0f;
+		zero_v3(co);
+
+		for (a = offsets[b]; a < offsets[b + 1]; a++) {
+			weight = influences[a].weight;
+			madd_v3_v3fl(co, dco[influences[a].vertex], weight);
+			totweight += weight;
+		}
+	}
+
+	if (totweight > 0.0f) {
+		mul_v3_fl(co, fac / totweight);
+		mul_m3_v3(data->icagemat, co);
+		if (G.debug_value != 527)
+			add_v3_v3(data->vertexCos[b], co);
+		else
+			copy_v3_v3(data->vertexCos[b], co);
+	}
+}
+
 static void meshdeformModifier_do(
         ModifierData *md, Object *ob, DerivedMesh *dm,
         float (*vertexCos)[3], int numVerts)
@@ -188,12 +253,11 @@ static void meshdeformModifier_do(
 	MeshDeformModifierData *mmd = (MeshDeformModifierData *) md;
 	DerivedMesh *tmpdm, *cagedm;
 	MDeformVert *dvert = NULL;
-	MDefInfluence *influences;
-	const int *offsets;
 	float imat[4][4], cagemat[4][4], iobmat[4][4], icagemat[3][3], cmat[4][4];
-	float weight, totweight, fac, co[3], (*dco)[3], (*bindcagecos)[3];
-	int a, b, totvert, totcagevert, defgrp_index;
+	float co[3], (*dco)[3], (*bindcagecos)[3];
+	int a, totvert, totcagevert, defgrp_index;
 	float (*cagecos)[3];
+	MeshdeformUserdata data;
 
 	if (!mmd->object || (!mmd->bindcagecos && !mmd->bindfunc))
 		return;
@@ -273,8 +337,6 @@ static void meshdeformModifier_do(
 
 	/* setup deformation data */
 	cagedm->getVertCos(cagedm, cagecos);
-	influences = mmd->bindinfluences;
-	offsets = mmd->bindoffsets;
 	bindcagecos = (float(*)[3])mmd->bindcagecos;
 
 	dco = MEM_callocN(sizeof(*dco) * totcagevert, "MDefDco");
@@ -294,50 +356,15 @@ static void meshdeformModifier_do(
 	modifier_get_vgroup(ob, dm, mmd->defgrp_name, &dvert, &defgrp_index);
 
 	/* do deformation */
-	fac = 1.0f;
-
-	for (b = 0; b < totvert; b++) {
-		if (mmd->flag & MOD_MDEF_DYNAMIC_BIND)
-			if (!mmd->dynverts[b])
-				continue;
-
-		if (dvert) {
-			fac = defvert_find_weight(&dvert[b], defgrp_index);
-
-			if (mmd->flag & MOD_MDEF_INVERT_VGROUP) {
-				fac = 1.0f - fac;
-			}
-
-			if (fac <= 0.0f) {
-				continue;
-			}
-		}
-
-		if (mmd->flag & MOD_MDEF_DYNAMIC_BIND) {
-			/* transform coordinate into cage's local space */
-			mul_v3_m4v3(co, cagemat, vertexCos[b]);
-			totweight = meshdeform_dynamic_bind(mmd, dco, co);
-		}
-		else {
-			totweight = 0.0f;
-			zero_v3(co);
-
-			for (a = offsets[b]; a < offsets[b + 1]; a++) {
-				weight = influences[a].weight;
-				madd_v3_v3fl(co, dco[influences[a].vertex], weight);
-				totweight += weight;
-			}
-		}
+	data.mmd = mmd;
+	data.dvert = dvert;
+	data.defgrp_index = defgrp_index;
+	data.vertexCos = vertexCos;
+	data.dco = dco;
+	data.cagemat = cagemat;
+	data.icagemat = icagemat;
 
-		if (totweight > 0.0f) {
-			mul_v3_fl(co, fac / totweight);
-			mul_m3_v3(icagemat, co);
-			if (G.debug_value != 527)
-				add_v3_v3(vertexCos[b], co);
-			else
-				copy_v3_v3(vertexCos[b], co);
-		}
-	}
+	BLI_task_parallel_range(0, totvert, &data, meshdeform_vert_task, totvert > MESHDEFORM_THREAD_MIN);
 
 	/* release cage derivedmesh */
 	MEM_freeN(dco);
@@ -375,8 +402,6 @@ static void deformVertsEM(ModifierData *md, Object *ob,
 		dm->release(dm);
 }
 
-#define MESHDEFORM_MIN_INFLUENCE 0.00001f
-
 void modifier_mdef_compact_influences(ModifierData *md)
 {
 	MeshDeformModifierData *mmd = (MeshDeformModifierData *)md;
@@ -438,6 +463,48 @@ void modifier_mdef_compact_influences(ModifierData *md)
 	mmd->bindweights = NULL;
 }
 
+/* Same result as modifier_mdef_compact_influences, from the influences above MESHDEFORM_MIN_INFLUENCE
+ * collected in a list per vertex (in reverse cage vertex order) instead of the dense bindweights array. */
+void modifier_mdef_compact_bind_influences(ModifierData *md, MDefBindInfluence **bindinfs, int totvert)
+{
+	MeshDeformModifierData *mmd = (MeshDeformModifierData *)md;
+	MDefBindInfluence *inf;
+	MDefInfluence *mdinf;
+	float totweight;
+	int a, b, offset;
+
+	mmd->totinfluence = 0;
+	for (a = 0; a < totvert; a++)
+		for (inf = bindinfs[a]; inf; inf = inf->next)
+			mmd->totinfluence++;
+
+	mmd->bindinfluences = MEM_callocN(sizeof(MDefInfluence) * mmd->totinfluence, "MDefBindInfluence");
+	mmd->bindoffsets = MEM_callocN(sizeof(int) * (totvert + 1), "MDefBindOffset");
+
+	offset = 0;
+	for (a = 0; a < totvert; a++) {
+		mmd->bindoffsets[a] = offset;
+		for (inf = bindinfs[a]; inf; inf = inf->next)
+			offset++;
+
+		/* fill in from the end, for the same order as the dense array */
+		mdinf = mmd->bindinfluences + offset;
+		for (inf = bindinfs[a]; inf; inf = inf->next) {
+			mdinf--;
+			mdinf->weight = inf->weight;
+			mdinf->vertex = inf->vertex;
+		}
+
+		/* normalize, summed in the same order as modifier_mdef_compact_influences */
+		totweight = 0.0f;
+		for (b = mmd->bindoffsets[a]; b < offset; b++)
+			totweight += mmd->bindinfluences[b].weight;
+		for (b = mmd->bindoffsets[a]; b < offset; b++)
+			mmd->bindinfluences[b].weight /= totweight;
+	}
+	mmd->bindoffsets[a] = offset;
+}
+
 ModifierTypeInfo modifierType_MeshDeform = {
 	/* name */              "MeshDeform",
 	/* structName */        "MeshDeformModifierData",
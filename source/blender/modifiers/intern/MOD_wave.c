@@ -34,6 +34,7 @@
 
 
 #include "BLI_math.h"
+#include "BLI_task.h"
 
 #include "DNA_meshdata_types.h"
 #include "DNA_scene_types.h"
@@ -169,11 +170,134 @@ static CustomDataMask requiredDataMask(Object *UNUSED(ob), ModifierData *md)
 	return dataMask;
 }
 
+/* below this many vertices threading isn't worth it */
+#define WAVE_THREAD_MIN 1000
+
+typedef struct WaveUserdata {
+	WaveModifierData *wmd;
+	MVert *mvert;
+	MDeformVert *dvert;
+	int defgrp_index;
+	float (*vertexCos)[3];
+	float *amplits;     /* amplitude of every vertex, zero outside of the wave */
+	float ctime;
+	float minfac;
+	float lifefac;
+	float falloff_inv;
+	int wmd_axis;
+} WaveUserdata;
+
+static void waveModifier_amplit_task(void *userdata, const int i)
+{
+	WaveUserdata *data = userdata;
+	WaveModifierData *wmd = data->wmd;
+	const float falloff = wmd->falloff;
+	const int wmd_axis = data->wmd_axis;
+	const float *co = data->vertexCos[i];
+	float x = co[0] - wmd->startx;
+	float y = co[1] - wmd->starty;
+	float amplit = 0.0f;
+	float def_weight = 1.0f;
+	float falloff_fac = 1.0f; /* when falloff == 0.0f this stays at 1.0f */
+
+	data->amplits[i] = 0.0f;
+
+	/* get weights */
+	if (data->dvert) {
+		def_weight = defvert_find_weight(&data->dvert[i], data->defgrp_index);
+
+		/* if this vert isn't in the vgroup, don't deform it */
+		if (def_weight == 0.0f) {
+			return;
+		}
+	}
+
+	switch (wmd_axis) {
+		case MOD_WAVE_X | MOD_WAVE_Y:
+			amplit = sqrtf(x * x + y * y);
+			break;
+		case MOD_WAVE_X:
+			amplit = x;
+			break;
+		case MOD_WAVE_Y:
+			amplit = y;
+			break;
+	}
+
+	/* this way it makes nice circles */
+	amplit -= (data->ctime - wmd->timeoffs) * wmd->speed;
+
+	if (wmd->flag & MOD_WAVE_CYCL) {
+		amplit = (float)fmodf(amplit - wmd->width, 2.0f * wmd->width) +
+		         wmd->width;
+	}
+
+	if (falloff != 0.0f) {
+		float dist = 0.0f;
+
+		switch (wmd_axis) {
+			case MOD_WAVE_X | MOD_WAVE_Y:
+				dist = sqrtf(x * x + y * y);
+				break;
+			case MOD_WAVE_X:
+				dist = fabsf(x);
+				break;
+			case MOD_WAVE_Y:
+				dist = fabsf(y);
+				break;
+		}
+
+		falloff_fac = (1.0f - (dist * data->falloff_inv));
+		CLAMP(falloff_fac, 0.0f, 1.0f);
+	}
+
+	/* GAUSSIAN */
+	if ((falloff_fac != 0.0f) && (amplit > -wmd->width) && (amplit < wmd->width)) {
+		amplit = amplit * wmd->narrow;
+		amplit = (float)(1.0f / expf(amplit * amplit) - data->minfac);
+
+		/*apply weight & falloff, the texture is applied afterwards */
+		data->amplits[i] = amplit * def_weight * falloff_fac;
+	}
+}
+
+static void waveModifier_apply_task(void *userdata, const int i)
+{
+	WaveUserdata *data = userdata;
+	WaveModifierData *wmd = data->wmd;
+	const float amplit = data->amplits[i];
+	float *co = data->vertexCos[i];
+
+	if (amplit == 0.0f) {
+		return;
+	}
+
+	if (data->mvert) {
+		const MVert *mv = &data->mvert[i];
+
+		/* move along normals */
+		if (wmd->flag & MOD_WAVE_NORM_X) {
+			co[0] += (data->lifefac * amplit) * mv->no[0] / 32767.0f;
+		}
+		if (wmd->flag & MOD_WAVE_NORM_Y) {
+			co[1] += (data->lifefac * amplit) * mv->no[1] / 32767.0f;
+		}
+		if (wmd->flag & MOD_WAVE_NORM_Z) {
+			co[2] += (data->lifefac * amplit) * mv->no[2] / 32767.0f;
+		}
+	}
+	else {
+		/* move along local z axis */
+		co[2] += data->lifefac * amplit;
+	}
+}
+
 static void waveModifier_do(WaveModifierData *md, 
                             Scene *scene, Object *ob, DerivedMesh *dm,
                             float (*vertexCos)[3], int numVerts)
 {
 	WaveModifierData *wmd = (WaveModifierData *) md;
+	WaveUserdata data;
 	MVert *mvert = NULL;
 	MDeformVert *dvert;
 	int defgrp_index;
@@ -181,9 +305,8 @@ static void waveModifier_do(WaveModifierData *md,
 	float minfac = (float)(1.0 / exp(wmd->width * wmd->narrow * wmd->width * wmd->narrow));
 	float lifefac = wmd->height;
 	float (*tex_co)[3] = NULL;
-	const int wmd_axis = wmd->flag & (MOD_WAVE_X | MOD_WAVE_Y);
 	const float falloff = wmd->falloff;
-	float falloff_fac = 1.0f; /* when falloff == 0.0f this stays at 1.0f */
+	const bool use_threading = (numVerts > WAVE_THREAD_MIN);
 
 	if ((wmd->flag & MOD_WAVE_NORM) && (ob->type == OB_MESH))
 		mvert = dm->getVertArray(dm);
@@ -214,6 +337,10 @@ static void waveModifier_do(WaveModifierData *md,
 		}
 	}
 
+	if (lifefac == 0.0f) {
+		return;
+	}
+
 	if (wmd->texture) {
 		tex_co = MEM_mallocN(sizeof(*tex_co) * numVerts,
 		                     "waveModifier_do tex_co");
@@ -222,104 +349,49 @@ static void waveModifier_do(WaveModifierData *md,
 		modifier_init_texture(wmd->modifier.scene, wmd->texture);
 	}
 
-	if (lifefac != 0.0f) {
-		/* avoid divide by zero checks within the loop */
-		float falloff_inv = falloff ? 1.0f / falloff : 1.0f;
-		int i;
+	data.wmd = wmd;
+	data.mvert = mvert;
+	data.dvert = dvert;
+	data.defgrp_index = defgrp_index;
+	data.vertexCos = vertexCos;
+	data.amplits = MEM_mallocN(sizeof(*data.amplits) * numVerts, "waveModifier_do amplits");
+	data.ctime = ctime;
+	data.minfac = minfac;
+	data.lifefac = lifefac;
+	/* avoid divide by zero checks within the loop */
+	data.falloff_inv = falloff ? 1.0f / falloff : 1.0f;
+	data.wmd_axis = wmd->flag & (MOD_WAVE_X | MOD_WAVE_Y);
+
+	BLI_task_parallel_range(0, numVerts, &data, waveModifier_amplit_task, use_threading);
+
+	/*apply texture, only sampled for the vertices in the wave */
+	if (wmd->texture) {
+		int *tex_index = MEM_mallocN(sizeof(*tex_index) * numVerts, "waveModifier_do tex_index");
+		TexResult *texres;
+		int i, tex_num = 0;
 
 		for (i = 0; i < numVerts; i++) {
-			float *co = vertexCos[i];
-			float x = co[0] - wmd->startx;
-			float y = co[1] - wmd->starty;
-			float amplit = 0.0f;
-			float def_weight = 1.0f;
-
-			/* get weights */
-			if (dvert) {
-				def_weight = defvert_find_weight(&dvert[i], defgrp_index);
-
-				/* if this vert isn't in the vgroup, don't deform it */
-				if (def_weight == 0.0f) {
-					continue;
-				}
-			}
-
-			switch (wmd_axis) {
-				case MOD_WAVE_X | MOD_WAVE_Y:
-					amplit = sqrtf(x * x + y * y);
-					break;
-				case MOD_WAVE_X:
-					amplit = x;
-					break;
-				case MOD_WAVE_Y:
-					amplit = y;
-					break;
-			}
-
-			/* this way it makes nice circles */
-			amplit -= (ctime - wmd->timeoffs) * wmd->speed;
-
-			if (wmd->flag & MOD_WAVE_CYCL) {
-				amplit = (float)fmodf(amplit - wmd->width, 2.0f * wmd->width) +
-				         wmd->width;
+			if (data.amplits[i] != 0.0f) {
+				copy_v3_v3(tex_co[tex_num], tex_co[i]);
+				tex_index[tex_num++] = i;
 			}
+		}
 
-			if (falloff != 0.0f) {
-				float dist = 0.0f;
-
-				switch (wmd_axis) {
-					case MOD_WAVE_X | MOD_WAVE_Y:
-						dist = sqrtf(x * x + y * y);
-						break;
-					case MOD_WAVE_X:
-						dist = fabsf(x);
-						break;
-					case MOD_WAVE_Y:
-						dist = fabsf(y);
-						break;
-				}
-
-				falloff_fac = (1.0f - (dist * falloff_inv));
-				CLAMP(falloff_fac, 0.0f, 1.0f);
-			}
+		texres = MEM_mallocN(sizeof(*texres) * (size_t)max_ii(tex_num, 1), "waveModifier_do texres");
+		BKE_texture_get_values(wmd->modifier.scene, wmd->texture, tex_co, texres, tex_num, false);
 
-			/* GAUSSIAN */
-			if ((falloff_fac != 0.0f) && (amplit > -wmd->width) && (amplit < wmd->width)) {
-				amplit = amplit * wmd->narrow;
-				amplit = (float)(1.0f / expf(amplit * amplit) - minfac);
-
-				/*apply texture*/
-				if (wmd->texture) {
-					TexResult texres;
-					texres.nor = NULL;
-					BKE_texture_get_value(wmd->modifier.scene, wmd->texture, tex_co[i], &texres, false);
-					amplit *= texres.tin;
-				}
-
-				/*apply weight & falloff */
-				amplit *= def_weight * falloff_fac;
-
-				if (mvert) {
-					/* move along normals */
-					if (wmd->flag & MOD_WAVE_NORM_X) {
-						co[0] += (lifefac * amplit) * mvert[i].no[0] / 32767.0f;
-					}
-					if (wmd->flag & MOD_WAVE_NORM_Y) {
-						co[1] += (lifefac * amplit) * mvert[i].no[1] / 32767.0f;
-					}
-					if (wmd->flag & MOD_WAVE_NORM_Z) {
-						co[2] += (lifefac * amplit) * mvert[i].no[2] / 32767.0f;
-					}
-				}
-				else {
-					/* move along local z axis */
-					co[2] += lifefac * amplit;
-				}
-			}
+		for (i = 0; i < tex_num; i++) {
+			data.amplits[tex_index[i]] *= texres[i].tin;
 		}
+
+		MEM_freeN(texres);
+		MEM_freeN(tex_index);
+		MEM_freeN(tex_co);
 	}
 
-	if (wmd->texture) MEM_freeN(tex_co);
+	BLI_task_parallel_range(0, numVerts, &data, waveModifier_apply_task, use_threading);
+
+	MEM_freeN(data.amplits);
 }
 
 static void deformVerts(ModifierData *md, Object *ob,
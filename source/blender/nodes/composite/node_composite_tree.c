@@ -149,6 +149,9 @@ static void local_merge(bNodeTree *localtree, bNodeTree *ntree)
 	
 	for (lnode = localtree->nodes.first; lnode; lnode = lnode->next) {
 		if (ntreeNodeExists(ntree, lnode->new_node)) {
+			/* profiling results, see NTREE_COM_PROFILE */
+			lnode->new_node->exec_time = lnode->exec_time;
+			
 			if (ELEM(lnode->type, CMP_NODE_VIEWER, CMP_NODE_SPLITVIEWER)) {
 				if (lnode->id && (lnode->flag & NODE_DO_OUTPUT)) {
 					/* image_merge does sanity check for pointers */
@@ -531,6 +531,8 @@ void WM_exit_ext(bContext *C, const bool do_python)
 	wm_autosave_delete();
 
 	BLI_temp_dir_session_purge();
+
+	MEM_exit();
 }
 
 void WM_exit(bContext *C)
@@ -0,0 +1,262 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "DNA_armature_types.h"
+#include "DNA_action_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_lattice.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+/* A synthetic character sized rig: a mesh with NUM_VERTS vertices, each weighted
+ * to NUM_WEIGHTS of NUM_BONES bones, which are all posed with a random transform. */
+
+#define NUM_VERTS 200000
+#define NUM_BONES 300
+#define NUM_WEIGHTS 4
+
+typedef struct SyntheticRig {
+	Object arm_ob;
+	bArmature arm;
+	bPose pose;
+	Bone *bones;
+	bPoseChannel *pchans;
+
+	Object mesh_ob;
+	Mesh mesh;
+	bDeformGroup *defgroups;
+	MDeformVert *dverts;
+	MDeformWeight *dweights;
+	float (*cos)[3];
+} SyntheticRig;
+
+static void rig_create(SyntheticRig *rig)
+{
+	RNG *rng = BLI_rng_new(0);
+	int i, j;
+
+	memset(rig, 0, sizeof(*rig));
+
+	rig->bones = (Bone *)MEM_callocN(sizeof(Bone) * NUM_BONES, __func__);
+	rig->pchans = (bPoseChannel *)MEM_callocN(sizeof(bPoseChannel) * NUM_BONES, __func__);
+	rig->defgroups = (bDeformGroup *)MEM_callocN(sizeof(bDeformGroup) * NUM_BONES, __func__);
+
+	for (i = 0; i < NUM_BONES; i++) {
+		Bone *bone = &rig->bones[i];
+		bPoseChannel *pchan = &rig->pchans[i];
+		float quat[4], axis[3];
+
+		BLI_snprintf(bone->name, sizeof(bone->name), "Bone%d", i);
+		BLI_strncpy(pchan->name, bone->name, sizeof(pchan->name));
+		BLI_strncpy(rig->defgroups[i].name, bone->name, sizeof(rig->defgroups[i].name));
+
+		bone->segments = 1;
+		bone->length = 0.1f;
+		bone->weight = 1.0f;
+		unit_m4(bone->arm_mat);
+		bone->arm_mat[3][1] = (float)i / NUM_BONES;
+
+		BLI_rng_get_float_unit_v3(rng, axis);
+		axis_angle_to_quat(quat, axis, BLI_rng_get_float(rng));
+		quat_to_mat4(pchan->chan_mat, quat);
+		pchan->chan_mat[3][0] = 0.1f * BLI_rng_get_float(rng);
+		pchan->chan_mat[3][1] = 0.1f * BLI_rng_get_float(rng);
+		pchan->chan_mat[3][2] = 0.1f * BLI_rng_get_float(rng);
+
+		pchan->bone = bone;
+		BLI_addtail(&rig->pose.chanbase, pchan);
+		BLI_addtail(&rig->mesh_ob.defbase, &rig->defgroups[i]);
+	}
+
+	rig->arm_ob.type = OB_ARMATURE;
+	rig->arm_ob.data = &rig->arm;
+	rig->arm_ob.pose = &rig->pose;
+	unit_m4(rig->arm_ob.obmat);
+
+	rig->dverts = (MDeformVert *)MEM_callocN(sizeof(MDeformVert) * NUM_VERTS, __func__);
+	rig->dweights = (MDeformWeight *)MEM_callocN(sizeof(MDeformWeight) * NUM_VERTS * NUM_WEIGHTS, __func__);
+	rig->cos = (float (*)[3])MEM_mallocN(sizeof(float[3]) * NUM_VERTS, __func__);
+
+	for (i = 0; i < NUM_VERTS; i++) {
+		/* neighbouring bones along the chain */
+		const int bone_first = (i * (NUM_BONES - NUM_WEIGHTS)) / NUM_VERTS;
+
+		rig->cos[i][0] = BLI_rng_get_float(rng) - 0.5f;
+		rig->cos[i][1] = (float)i / NUM_VERTS;
+		rig->cos[i][2] = BLI_rng_get_float(rng) - 0.5f;
+
+		rig->dverts[i].dw = &rig->dweights[i * NUM_WEIGHTS];
+		rig->dverts[i].totweight = NUM_WEIGHTS;
+		for (j = 0; j < NUM_WEIGHTS; j++) {
+			rig->dverts[i].dw[j].def_nr = bone_first + j;
+			rig->dverts[i].dw[j].weight = BLI_rng_get_float(rng);
+		}
+	}
+
+	rig->mesh.dvert = rig->dverts;
+	rig->mesh.totvert = NUM_VERTS;
+	rig->mesh_ob.type = OB_MESH;
+	rig->mesh_ob.data = &rig->mesh;
+	unit_m4(rig->mesh_ob.obmat);
+
+	BLI_rng_free(rng);
+}
+
+static void rig_free(SyntheticRig *rig)
+{
+	MEM_freeN(rig->bones);
+	MEM_freeN(rig->pchans);
+	MEM_freeN(rig->defgroups);
+	MEM_freeN(rig->dverts);
+	MEM_freeN(rig->dweights);
+	MEM_freeN(rig->cos);
+}
+
+/* plain linear blend skinning, one bone at a time */
+static void rig_deform_reference(const SyntheticRig *rig, float (*cos)[3])
+{
+	int i, j;
+
+	for (i = 0; i < NUM_VERTS; i++) {
+		const MDeformVert *dvert = &rig->dverts[i];
+		float vec[3] = {0.0f, 0.0f, 0.0f}, contrib = 0.0f;
+
+		for (j = 0; j < dvert->totweight; j++) {
+			const float weight = dvert->dw[j].weight;
+			float co[3];
+
+			mul_v3_m4v3(co, (float (*)[4])rig->pchans[dvert->dw[j].def_nr].chan_mat, cos[i]);
+			sub_v3_v3(co, cos[i]);
+			madd_v3_v3fl(vec, co, weight);
+			contrib += weight;
+		}
+
+		if (contrib > 0.0001f) {
+			madd_v3_v3fl(cos[i], vec, 1.0f / contrib);
+		}
+	}
+}
+
+/* dual quaternion skinning, one bone at a time */
+static void rig_deform_reference_dq(const SyntheticRig *rig, float (*cos)[3])
+{
+	DualQuat *dqs = (DualQuat *)MEM_mallocN(sizeof(DualQuat) * NUM_BONES, __func__);
+	int i, j;
+
+	for (i = 0; i < NUM_BONES; i++) {
+		mat4_to_dquat(&dqs[i], rig->bones[i].arm_mat, (float (*)[4])rig->pchans[i].chan_mat);
+	}
+
+	for (i = 0; i < NUM_VERTS; i++) {
+		const MDeformVert *dvert = &rig->dverts[i];
+		DualQuat sumdq;
+		float contrib = 0.0f;
+
+		memset(&sumdq, 0, sizeof(sumdq));
+		for (j = 0; j < dvert->totweight; j++) {
+			add_weighted_dq_dq(&sumdq, &dqs[dvert->dw[j].def_nr], dvert->dw[j].weight);
+			contrib += dvert->dw[j].weight;
+		}
+
+		if (contrib > 0.0001f) {
+			normalize_dq(&sumdq, contrib);
+			mul_v3m3_dq(cos[i], NULL, &sumdq);
+		}
+	}
+
+	MEM_freeN(dqs);
+}
+
+static float rig_max_error(float (*cos_a)[3], float (*cos_b)[3])
+{
+	float error = 0.0f;
+	int i;
+
+	for (i = 0; i < NUM_VERTS; i++) {
+		error = max_ff(error, len_v3v3(cos_a[i], cos_b[i]));
+	}
+
+	return error;
+}
+
+static void rig_deform_test(const int num_threads)
+{
+	SyntheticRig rig;
+	float (*cos)[3], (*cos_ref)[3];
+	float (*defmats)[3][3];
+	int i;
+
+	BLI_system_num_threads_override_set(num_threads);
+	BLI_threadapi_init();
+
+	rig_create(&rig);
+
+	cos = (float (*)[3])MEM_dupallocN(rig.cos);
+	cos_ref = (float (*)[3])MEM_dupallocN(rig.cos);
+	defmats = (float (*)[3][3])MEM_mallocN(sizeof(float[3][3]) * NUM_VERTS, __func__);
+
+	rig_deform_reference(&rig, cos_ref);
+
+	TIMEIT_START(linear);
+	armature_deform_verts(&rig.arm_ob, &rig.mesh_ob, NULL, cos, NULL, NUM_VERTS,
+	                      ARM_DEF_VGROUP, NULL, NULL);
+	TIMEIT_END(linear);
+	EXPECT_GT(1e-4f, rig_max_error(cos, cos_ref));
+
+	memcpy(cos, rig.cos, sizeof(float[3]) * NUM_VERTS);
+	for (i = 0; i < NUM_VERTS; i++) {
+		unit_m3(defmats[i]);
+	}
+	TIMEIT_START(linear_defmats);
+	armature_deform_verts(&rig.arm_ob, &rig.mesh_ob, NULL, cos, defmats, NUM_VERTS,
+	                      ARM_DEF_VGROUP, NULL, NULL);
+	TIMEIT_END(linear_defmats);
+	EXPECT_GT(1e-4f, rig_max_error(cos, cos_ref));
+
+	memcpy(cos, rig.cos, sizeof(float[3]) * NUM_VERTS);
+	memcpy(cos_ref, rig.cos, sizeof(float[3]) * NUM_VERTS);
+	rig_deform_reference_dq(&rig, cos_ref);
+
+	TIMEIT_START(dual_quaternion);
+	armature_deform_verts(&rig.arm_ob, &rig.mesh_ob, NULL, cos, NULL, NUM_VERTS,
+	                      ARM_DEF_VGROUP | ARM_DEF_QUATERNION, NULL, NULL);
+	TIMEIT_END(dual_quaternion);
+
+	EXPECT_GT(1e-4f, rig_max_error(cos, cos_ref));
+
+	MEM_freeN(cos);
+	MEM_freeN(cos_ref);
+	MEM_freeN(defmats);
+	rig_free(&rig);
+
+	BLI_threadapi_exit();
+	BLI_system_num_threads_override_set(0);
+}
+
+TEST(armature_deform, Performance)
+{
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	printf("single thread:\n");
+	rig_deform_test(1);
+
+	printf("all threads:\n");
+	rig_deform_test(0);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+}
@@ -0,0 +1,430 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "DNA_armature_types.h"
+#include "DNA_action_types.h"
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_armature.h"
+#include "BKE_lattice.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+/* A chain of connected bones along Y, posed with a random transform each, and a mesh
+ * around it. The mesh has more vertices than the deform threads at, so the threaded
+ * vertex loop is compared with deforming the vertices one bone at a time. */
+
+#define NUM_VERTS 5000
+#define NUM_BONES 8
+#define BONE_LENGTH 0.25f
+
+/* the extra vertex group doesn't belong to a bone, like the ones used for softbody */
+#define DEFGROUP_NO_BONE NUM_BONES
+
+typedef struct DeformTestRig {
+	Object arm_ob;
+	bArmature arm;
+	bPose pose;
+	Bone bones[NUM_BONES];
+	bPoseChannel pchans[NUM_BONES];
+
+	Object mesh_ob;
+	Mesh mesh;
+	bDeformGroup defgroups[NUM_BONES + 1];
+	MDeformVert *dverts;
+	MDeformWeight *dweights;
+	float (*cos)[3];
+} DeformTestRig;
+
+static void rig_create(DeformTestRig *rig, const int segments)
+{
+	RNG *rng = BLI_rng_new(0);
+	const float tail[3] = {0.0f, BONE_LENGTH, 0.0f};
+	int i;
+
+	memset(rig, 0, sizeof(*rig));
+
+	for (i = 0; i < NUM_BONES; i++) {
+		Bone *bone = &rig->bones[i];
+		bPoseChannel *pchan = &rig->pchans[i];
+		float quat[4], axis[3];
+
+		BLI_snprintf(bone->name, sizeof(bone->name), "Bone%d", i);
+		BLI_strncpy(pchan->name, bone->name, sizeof(pchan->name));
+		BLI_strncpy(rig->defgroups[i].name, bone->name, sizeof(rig->defgroups[i].name));
+
+		bone->segments = segments;
+		bone->length = BONE_LENGTH;
+		bone->ease1 = bone->ease2 = 1.0f;
+		bone->weight = 1.0f;
+		bone->rad_head = bone->rad_tail = 0.1f;
+		bone->dist = 0.25f;
+		unit_m4(bone->arm_mat);
+		bone->arm_mat[3][1] = (float)i * BONE_LENGTH;
+		copy_v3_v3(bone->arm_head, bone->arm_mat[3]);
+		mul_v3_m4v3(bone->arm_tail, bone->arm_mat, tail);
+
+		BLI_rng_get_float_unit_v3(rng, axis);
+		axis_angle_to_quat(quat, axis, 0.5f * BLI_rng_get_float(rng));
+		quat_to_mat4(pchan->chan_mat, quat);
+		pchan->chan_mat[3][0] = 0.1f * BLI_rng_get_float(rng);
+		pchan->chan_mat[3][1] = 0.1f * BLI_rng_get_float(rng);
+		pchan->chan_mat[3][2] = 0.1f * BLI_rng_get_float(rng);
+
+		/* the B-bone curves bend towards the neighbouring bones */
+		mul_m4_m4m4(pchan->pose_mat, pchan->chan_mat, bone->arm_mat);
+		copy_v3_v3(pchan->pose_head, pchan->pose_mat[3]);
+		mul_v3_m4v3(pchan->pose_tail, pchan->pose_mat, tail);
+
+		pchan->bone = bone;
+		if (i > 0) {
+			bone->flag |= BONE_CONNECTED;
+			pchan->parent = &rig->pchans[i - 1];
+			rig->pchans[i - 1].child = pchan;
+		}
+
+		BLI_addtail(&rig->pose.chanbase, pchan);
+		BLI_addtail(&rig->mesh_ob.defbase, &rig->defgroups[i]);
+	}
+	BLI_strncpy(rig->defgroups[DEFGROUP_NO_BONE].name, "Softbody", sizeof(rig->defgroups[0].name));
+	BLI_addtail(&rig->mesh_ob.defbase, &rig->defgroups[DEFGROUP_NO_BONE]);
+
+	rig->bones[2].flag |= BONE_NO_DEFORM;
+	rig->bones[5].flag |= BONE_MULT_VG_ENV;
+
+	rig->arm_ob.type = OB_ARMATURE;
+	rig->arm_ob.data = &rig->arm;
+	rig->arm_ob.pose = &rig->pose;
+	unit_m4(rig->arm_ob.obmat);
+
+	rig->dverts = (MDeformVert *)MEM_callocN(sizeof(MDeformVert) * NUM_VERTS, __func__);
+	rig->dweights = (MDeformWeight *)MEM_callocN(sizeof(MDeformWeight) * NUM_VERTS * 2, __func__);
+	rig->cos = (float (*)[3])MEM_mallocN(sizeof(float[3]) * NUM_VERTS, __func__);
+
+	for (i = 0; i < NUM_VERTS; i++) {
+		const int bone_first = (i * (NUM_BONES - 1)) / NUM_VERTS;
+		MDeformVert *dvert = &rig->dverts[i];
+
+		/* around the chain, partly outside of the envelopes */
+		rig->cos[i][0] = 0.6f * (BLI_rng_get_float(rng) - 0.5f);
+		rig->cos[i][1] = (float)i * (NUM_BONES * BONE_LENGTH) / NUM_VERTS;
+		rig->cos[i][2] = 0.6f * (BLI_rng_get_float(rng) - 0.5f);
+
+		dvert->dw = &rig->dweights[i * 2];
+		if (i % 7 == 0) {
+			/* no weights */
+		}
+		else if (i % 11 == 0) {
+			dvert->totweight = 1;
+			dvert->dw[0].def_nr = DEFGROUP_NO_BONE;
+			dvert->dw[0].weight = 1.0f;
+		}
+		else {
+			dvert->totweight = 2;
+			dvert->dw[0].def_nr = bone_first;
+			dvert->dw[0].weight = BLI_rng_get_float(rng);
+			dvert->dw[1].def_nr = bone_first + 1;
+			dvert->dw[1].weight = BLI_rng_get_float(rng);
+		}
+	}
+
+	rig->mesh.dvert = rig->dverts;
+	rig->mesh.totvert = NUM_VERTS;
+	rig->mesh_ob.type = OB_MESH;
+	rig->mesh_ob.data = &rig->mesh;
+	unit_m4(rig->mesh_ob.obmat);
+	/* so the vertices go into armature space and back */
+	rig->mesh_ob.obmat[3][0] = 0.1f;
+	rig->mesh_ob.obmat[3][2] = -0.2f;
+
+	BLI_rng_free(rng);
+}
+
+static void rig_free(DeformTestRig *rig)
+{
+	MEM_freeN(rig->dverts);
+	MEM_freeN(rig->dweights);
+	MEM_freeN(rig->cos);
+}
+
+/* Reference, every bone transforms the vertex on its own and the offsets are summed. */
+
+typedef struct BoneDeformSum {
+	float vec[3];
+	float smat[3][3];
+	DualQuat dq;
+	float contrib;
+} BoneDeformSum;
+
+/* the matrix of the B-bone segment the vertex is in */
+static void bbone_segment_mat(bPoseChannel *pchan, const float co[3], float r_mat[4][4])
+{
+	Bone *bone = pchan->bone;
+	Mat4 b_bone[MAX_BBONE_SUBDIV], b_bone_rest[MAX_BBONE_SUBDIV];
+	float imat[4][4], irest[4][4], bone_co[3];
+	int a;
+
+	invert_m4_m4(imat, bone->arm_mat);
+	mul_v3_m4v3(bone_co, imat, co);
+	a = (int)(bone_co[1] / (bone->length / (float)bone->segments));
+	CLAMP(a, 0, bone->segments - 1);
+
+	b_bone_spline_setup(pchan, 0, b_bone);
+	b_bone_spline_setup(pchan, 1, b_bone_rest);
+	invert_m4_m4(irest, b_bone_rest[a].mat);
+
+	mul_m4_series(r_mat, pchan->chan_mat, bone->arm_mat, b_bone[a].mat, irest, imat);
+}
+
+static void bone_deform_add(bPoseChannel *pchan, const float weight, const bool use_quaternion,
+                            const float co[3], BoneDeformSum *sum)
+{
+	float mat[4][4];
+
+	if (weight == 0.0f) {
+		return;
+	}
+
+	if (pchan->bone->segments > 1) {
+		bbone_segment_mat(pchan, co, mat);
+	}
+	else {
+		copy_m4_m4(mat, pchan->chan_mat);
+	}
+
+	if (use_quaternion) {
+		DualQuat dq;
+		mat4_to_dquat(&dq, pchan->bone->arm_mat, mat);
+		add_weighted_dq_dq(&sum->dq, &dq, weight);
+	}
+	else {
+		float vec[3], mat3[3][3];
+
+		mul_v3_m4v3(vec, mat, co);
+		sub_v3_v3(vec, co);
+		madd_v3_v3fl(sum->vec, vec, weight);
+
+		copy_m3_m4(mat3, mat);
+		mul_m3_fl(mat3, weight);
+		add_m3_m3m3(sum->smat, sum->smat, mat3);
+	}
+
+	sum->contrib += weight;
+}
+
+static void envelope_deform_add(DeformTestRig *rig, const bool use_quaternion, const float co[3],
+                                BoneDeformSum *sum)
+{
+	int a;
+
+	for (a = 0; a < NUM_BONES; a++) {
+		Bone *bone = &rig->bones[a];
+		float fac;
+
+		if (bone->flag & BONE_NO_DEFORM) {
+			continue;
+		}
+
+		fac = distfactor_to_bone(co, bone->arm_head, bone->arm_tail, bone->rad_head, bone->rad_tail, bone->dist);
+		fac *= bone->weight;
+		if (fac > 0.0f) {
+			bone_deform_add(&rig->pchans[a], fac, use_quaternion, co, sum);
+		}
+	}
+}
+
+static void rig_deform_reference(DeformTestRig *rig, const int deformflag, float (*cos)[3],
+                                 float (*defmats)[3][3])
+{
+	const bool use_quaternion = (deformflag & ARM_DEF_QUATERNION) != 0;
+	const bool use_envelope = (deformflag & ARM_DEF_ENVELOPE) != 0;
+	float premat[4][4], postmat[4][4], premat3[3][3], postmat3[3][3];
+	int i, j;
+
+	invert_m4_m4(postmat, rig->mesh_ob.obmat);
+	mul_m4_m4m4(postmat, postmat, rig->arm_ob.obmat);
+	invert_m4_m4(premat, postmat);
+	copy_m3_m4(premat3, premat);
+	copy_m3_m4(postmat3, postmat);
+
+	for (i = 0; i < NUM_VERTS; i++) {
+		const MDeformVert *dvert = rig->mesh.dvert ? &rig->mesh.dvert[i] : NULL;
+		BoneDeformSum sum;
+		float *co = cos[i];
+
+		memset(&sum, 0, sizeof(sum));
+		mul_m4_v3(premat, co);
+
+		if ((deformflag & ARM_DEF_VGROUP) && dvert && dvert->totweight) {
+			bool deformed = false;
+
+			for (j = 0; j < dvert->totweight; j++) {
+				const int def_nr = dvert->dw[j].def_nr;
+				Bone *bone;
+				float weight = dvert->dw[j].weight;
+
+				if (def_nr >= NUM_BONES || (rig->bones[def_nr].flag & BONE_NO_DEFORM)) {
+					continue;
+				}
+
+				bone = &rig->bones[def_nr];
+				if (bone->flag & BONE_MULT_VG_ENV) {
+					weight *= distfactor_to_bone(co, bone->arm_head, bone->arm_tail,
+					                             bone->rad_head, bone->rad_tail, bone->dist);
+				}
+				bone_deform_add(&rig->pchans[def_nr], weight, use_quaternion, co, &sum);
+				deformed = true;
+			}
+
+			if (!deformed && use_envelope) {
+				envelope_deform_add(rig, use_quaternion, co, &sum);
+			}
+		}
+		else if (use_envelope) {
+			envelope_deform_add(rig, use_quaternion, co, &sum);
+		}
+
+		if (sum.contrib > 0.0001f) {
+			if (use_quaternion) {
+				normalize_dq(&sum.dq, sum.contrib);
+				mul_v3m3_dq(co, sum.smat, &sum.dq);
+			}
+			else {
+				madd_v3_v3fl(co, sum.vec, 1.0f / sum.contrib);
+				mul_m3_fl(sum.smat, 1.0f / sum.contrib);
+			}
+
+			if (defmats) {
+				float tmpmat[3][3];
+
+				copy_m3_m3(tmpmat, defmats[i]);
+				mul_m3_series(defmats[i], postmat3, sum.smat, premat3, tmpmat);
+			}
+		}
+
+		mul_m4_v3(postmat, co);
+	}
+}
+
+static void rig_deform_test(DeformTestRig *rig, const int deformflag, const bool use_defmats)
+{
+	float (*cos)[3] = (float (*)[3])MEM_dupallocN(rig->cos);
+	float (*cos_ref)[3] = (float (*)[3])MEM_dupallocN(rig->cos);
+	float (*defmats)[3][3] = NULL, (*defmats_ref)[3][3] = NULL;
+	float error = 0.0f, error_mat = 0.0f;
+	int i, j, k, moved = 0;
+
+	if (use_defmats) {
+		defmats = (float (*)[3][3])MEM_mallocN(sizeof(float[3][3]) * NUM_VERTS, __func__);
+		defmats_ref = (float (*)[3][3])MEM_mallocN(sizeof(float[3][3]) * NUM_VERTS, __func__);
+		for (i = 0; i < NUM_VERTS; i++) {
+			unit_m3(defmats[i]);
+			unit_m3(defmats_ref[i]);
+		}
+	}
+
+	armature_deform_verts(&rig->arm_ob, &rig->mesh_ob, NULL, cos, defmats, NUM_VERTS, deformflag, NULL, NULL);
+	rig_deform_reference(rig, deformflag, cos_ref, defmats_ref);
+
+	for (i = 0; i < NUM_VERTS; i++) {
+		error = max_ff(error, len_v3v3(cos[i], cos_ref[i]));
+		moved += (len_v3v3(cos[i], rig->cos[i]) > 1e-4f);
+
+		if (use_defmats) {
+			for (j = 0; j < 3; j++) {
+				for (k = 0; k < 3; k++) {
+					error_mat = max_ff(error_mat, fabsf(defmats[i][j][k] - defmats_ref[i][j][k]));
+				}
+			}
+		}
+	}
+
+	EXPECT_GT(1e-4f, error);
+	EXPECT_GT(1e-4f, error_mat);
+	if ((deformflag & ARM_DEF_ENVELOPE) || ((deformflag & ARM_DEF_VGROUP) && rig->mesh.dvert)) {
+		EXPECT_LT(0, moved);
+	}
+	else {
+		EXPECT_EQ(0, moved);
+	}
+
+	MEM_freeN(cos);
+	MEM_freeN(cos_ref);
+	if (use_defmats) {
+		MEM_freeN(defmats);
+		MEM_freeN(defmats_ref);
+	}
+}
+
+static void rig_deform_test_all(const int segments, const int deformflag)
+{
+	DeformTestRig rig;
+
+	BLI_threadapi_init();
+	rig_create(&rig, segments);
+
+	rig_deform_test(&rig, deformflag, false);
+	rig_deform_test(&rig, deformflag, true);
+	rig_deform_test(&rig, deformflag | ARM_DEF_QUATERNION, false);
+	rig_deform_test(&rig, deformflag | ARM_DEF_QUATERNION, true);
+
+	rig_free(&rig);
+	BLI_threadapi_exit();
+}
+
+TEST(armature_deform, VertexGroups)
+{
+	rig_deform_test_all(1, ARM_DEF_VGROUP);
+}
+
+TEST(armature_deform, Envelopes)
+{
+	rig_deform_test_all(1, ARM_DEF_ENVELOPE);
+}
+
+TEST(armature_deform, VertexGroupsEnvelopes)
+{
+	rig_deform_test_all(1, ARM_DEF_VGROUP | ARM_DEF_ENVELOPE);
+}
+
+TEST(armature_deform, BBoneVertexGroups)
+{
+	rig_deform_test_all(4, ARM_DEF_VGROUP);
+}
+
+TEST(armature_deform, BBoneEnvelopes)
+{
+	rig_deform_test_all(4, ARM_DEF_VGROUP | ARM_DEF_ENVELOPE);
+}
+
+TEST(armature_deform, NoVertexGroups)
+{
+	DeformTestRig rig;
+
+	BLI_threadapi_init();
+	rig_create(&rig, 1);
+
+	/* nothing deforms without vertex groups or envelopes */
+	rig_deform_test(&rig, 0, true);
+
+	/* a mesh without weights only deforms by envelope */
+	rig.mesh.dvert = NULL;
+	rig_deform_test(&rig, ARM_DEF_VGROUP, true);
+	rig_deform_test(&rig, ARM_DEF_VGROUP | ARM_DEF_ENVELOPE, true);
+	rig_deform_test(&rig, ARM_DEF_VGROUP | ARM_DEF_ENVELOPE | ARM_DEF_QUATERNION, true);
+
+	rig_free(&rig);
+	BLI_threadapi_exit();
+}
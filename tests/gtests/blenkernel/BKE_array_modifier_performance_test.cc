@@ -0,0 +1,71 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_DerivedMesh.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+#include "BKE_test_util.h"
+
+/* Many copies of a grid side by side with their touching columns merged,
+ * translated only and with a slight scale. */
+
+TEST(array_modifier, MergeChunksPerformance)
+{
+	const int res = 64, count = 128;
+	ArrayModifierData *amd;
+	DerivedMesh *result;
+	Object ob, offset_ob;
+	Mesh me;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	grid_mesh_init(&me, res);
+	mesh_object_init(&ob, &me);
+
+	amd = (ArrayModifierData *)modifier_new(eModifierType_Array);
+	amd->count = count;
+	amd->flags = MOD_ARR_MERGE;
+
+	TIMEIT_START(array_translate);
+	result = modifier_test_apply((ModifierData *)amd, &ob);
+	TIMEIT_END(array_translate);
+	EXPECT_EQ(count * res * res - (count - 1) * res, result->getNumVerts(result));
+	result->release(result);
+
+	memset(&offset_ob, 0, sizeof(offset_ob));
+	unit_m4(offset_ob.obmat);
+	offset_ob.obmat[1][1] = 1.00001f;
+	offset_ob.obmat[3][0] = 1.0f;
+	amd->offset_type = MOD_ARR_OFF_OBJ;
+	amd->offset_ob = &offset_ob;
+
+	TIMEIT_START(array_scale);
+	result = modifier_test_apply((ModifierData *)amd, &ob);
+	TIMEIT_END(array_scale);
+	EXPECT_EQ(count * res * res - (count - 1) * res, result->getNumVerts(result));
+	result->release(result);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	modifier_free((ModifierData *)amd);
+	BKE_mesh_free(&me, false);
+
+	BLI_threadapi_exit();
+}
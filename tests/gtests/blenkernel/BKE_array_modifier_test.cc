@@ -0,0 +1,91 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_DerivedMesh.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+}
+
+#include "BKE_test_util.h"
+
+/* Copies of a grid side by side, the last column of every copy is at the
+ * position of the first column of the next copy and gets merged. */
+
+/* offset_ob is used for the offset when given, else the relative offset along x */
+static DerivedMesh *array_apply(Mesh *me, const int count, const bool merge, Object *offset_ob)
+{
+	ArrayModifierData *amd = (ArrayModifierData *)modifier_new(eModifierType_Array);
+	DerivedMesh *result;
+	Object ob;
+
+	mesh_object_init(&ob, me);
+
+	amd->count = count;
+	amd->flags = merge ? MOD_ARR_MERGE : 0;
+	if (offset_ob) {
+		amd->offset_type = MOD_ARR_OFF_OBJ;
+		amd->offset_ob = offset_ob;
+	}
+
+	result = modifier_test_apply((ModifierData *)amd, &ob);
+	modifier_free((ModifierData *)amd);
+
+	return result;
+}
+
+TEST(array_modifier, MergeChunks)
+{
+	const int res = 32, count = 8;
+	DerivedMesh *result;
+	Object offset_ob;
+	Mesh me;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+
+	grid_mesh_init(&me, res);
+
+	result = array_apply(&me, count, false, NULL);
+	EXPECT_EQ(count * res * res, result->getNumVerts(result));
+	EXPECT_EQ(count * (res - 1) * (res - 1), result->getNumPolys(result));
+	result->release(result);
+
+	/* translation only, doubles of the following chunks are translated from the first ones */
+	result = array_apply(&me, count, true, NULL);
+	EXPECT_EQ(count * res * res - (count - 1) * res, result->getNumVerts(result));
+	EXPECT_EQ(count * (res - 1) * (res - 1), result->getNumPolys(result));
+	result->release(result);
+
+	/* a slight scale, doubles are searched between all neighbor chunks */
+	memset(&offset_ob, 0, sizeof(offset_ob));
+	unit_m4(offset_ob.obmat);
+	offset_ob.obmat[1][1] = 1.0001f;
+	offset_ob.obmat[3][0] = 1.0f;
+	result = array_apply(&me, count, true, &offset_ob);
+	EXPECT_EQ(count * res * res - (count - 1) * res, result->getNumVerts(result));
+	EXPECT_EQ(count * (res - 1) * (res - 1), result->getNumPolys(result));
+	result->release(result);
+
+	/* invalid coordinates away from the merged columns are never merged */
+	me.mvert[res + 1].co[0] = NAN;
+	me.mvert[res + 2].co[1] = INFINITY;
+	me.mvert[res + 3].co[2] = -INFINITY;
+	result = array_apply(&me, count, true, &offset_ob);
+	EXPECT_EQ(count * res * res - (count - 1) * res, result->getNumVerts(result));
+	result->release(result);
+
+	BKE_mesh_free(&me, false);
+
+	BLI_threadapi_exit();
+}
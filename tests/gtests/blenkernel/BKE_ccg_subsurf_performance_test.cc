@@ -0,0 +1,52 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_threads.h"
+
+#include "intern/CCGSubSurf.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+#include "BKE_test_util.h"
+
+/* A grid synced into a new subsurf every time, against a subsurf kept between syncs. */
+
+#define SUBSURF_LEVELS 3
+
+TEST(ccg_subsurf, AnimatedSyncPerformance)
+{
+	const int res = 128;
+	CCGSubSurf *ss;
+	int i;
+
+	BLI_threadapi_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	TIMEIT_START(new_subsurf);
+	for (i = 0; i < 5; i++) {
+		ss = grid_subsurf_new(SUBSURF_LEVELS);
+		grid_subsurf_sync(ss, res, (float)i, -1);
+		ccgSubSurf_free(ss);
+	}
+	TIMEIT_END(new_subsurf);
+
+	ss = grid_subsurf_new(SUBSURF_LEVELS);
+	grid_subsurf_sync(ss, res, 0.0f, -1);
+
+	TIMEIT_START(kept_subsurf);
+	for (i = 0; i < 5; i++) {
+		grid_subsurf_sync(ss, res, (float)(i + 1), -1);
+	}
+	TIMEIT_END(kept_subsurf);
+
+	ccgSubSurf_free(ss);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,95 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "intern/CCGSubSurf.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#include "BKE_test_util.h"
+
+/* A grid synced into a subsurf that is kept between syncs, like the modifier
+ * does in the viewport, compared against a new subsurf for every sync. */
+
+#define SUBSURF_LEVELS 3
+
+static void grid_subsurf_compare(CCGSubSurf *ss, CCGSubSurf *ss_ref, const int res)
+{
+	const int gridSize = ccgSubSurf_getGridSize(ss);
+	float maxdiff = 0.0f;
+	int i, S, j;
+
+	ASSERT_EQ(ccgSubSurf_getNumVerts(ss_ref), ccgSubSurf_getNumVerts(ss));
+	ASSERT_EQ(ccgSubSurf_getNumEdges(ss_ref), ccgSubSurf_getNumEdges(ss));
+	ASSERT_EQ(ccgSubSurf_getNumFaces(ss_ref), ccgSubSurf_getNumFaces(ss));
+	ASSERT_EQ(ccgSubSurf_getNumFinalVerts(ss_ref), ccgSubSurf_getNumFinalVerts(ss));
+
+	for (i = 0; i < (res - 1) * (res - 1); i++) {
+		CCGFace *f = ccgSubSurf_getFace(ss, SET_INT_IN_POINTER(i));
+		CCGFace *f_ref = ccgSubSurf_getFace(ss_ref, SET_INT_IN_POINTER(i));
+
+		ASSERT_EQ(f == NULL, f_ref == NULL);
+		if (f == NULL) {
+			continue;
+		}
+
+		for (S = 0; S < ccgSubSurf_getFaceNumVerts(f); S++) {
+			float (*grid)[6] = (float (*)[6])ccgSubSurf_getFaceGridDataArray(ss, f, S);
+			float (*grid_ref)[6] = (float (*)[6])ccgSubSurf_getFaceGridDataArray(ss_ref, f_ref, S);
+
+			for (j = 0; j < gridSize * gridSize; j++) {
+				maxdiff = max_ff(maxdiff, len_v3v3(grid[j], grid_ref[j]));
+				maxdiff = max_ff(maxdiff, len_v3v3(&grid[j][3], &grid_ref[j][3]));
+			}
+		}
+	}
+
+	EXPECT_GT(1e-6f, maxdiff);
+}
+
+TEST(ccg_subsurf, TopologyCachedSync)
+{
+	const int res = 32;
+	CCGSubSurf *ss, *ss_ref;
+	int i;
+
+	BLI_threadapi_init();
+
+	ss = grid_subsurf_new(SUBSURF_LEVELS);
+
+	/* moving vertices, the topology of the first sync is reused */
+	for (i = 0; i < 3; i++) {
+		grid_subsurf_sync(ss, res, (float)i, -1);
+		ss_ref = grid_subsurf_new(SUBSURF_LEVELS);
+		grid_subsurf_sync(ss_ref, res, (float)i, -1);
+		grid_subsurf_compare(ss, ss_ref, res);
+		ccgSubSurf_free(ss_ref);
+	}
+
+	/* removed face, then added back */
+	for (i = 0; i < 2; i++) {
+		const int skip_face = (i == 0) ? res : -1;
+		grid_subsurf_sync(ss, res, 3.0f, skip_face);
+		ss_ref = grid_subsurf_new(SUBSURF_LEVELS);
+		grid_subsurf_sync(ss_ref, res, 3.0f, skip_face);
+		grid_subsurf_compare(ss, ss_ref, res);
+		ccgSubSurf_free(ss_ref);
+	}
+
+	/* nothing changed */
+	grid_subsurf_sync(ss, res, 3.0f, -1);
+	ss_ref = grid_subsurf_new(SUBSURF_LEVELS);
+	grid_subsurf_sync(ss_ref, res, 3.0f, -1);
+	grid_subsurf_compare(ss, ss_ref, res);
+	ccgSubSurf_free(ss_ref);
+
+	ccgSubSurf_free(ss);
+
+	BLI_threadapi_exit();
+}
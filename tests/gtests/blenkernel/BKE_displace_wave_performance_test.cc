@@ -0,0 +1,77 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_texture_types.h"
+
+#include "BKE_image.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_texture.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+#include "BKE_test_util.h"
+
+#define GRID_RES 256
+
+TEST(displace_wave, DisplacePerformance)
+{
+	DisplaceModifierData *dmd;
+	float (*cos)[3];
+	Scene scene;
+	Object ob;
+	Mesh me;
+	Tex tex;
+	int i;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+	BKE_images_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	memset(&scene, 0, sizeof(scene));
+	scene.r.cfra = 1;
+	scene.r.framelen = 1.0f;
+
+	grid_mesh_init(&me, GRID_RES);
+	BKE_mesh_calc_normals(&me);
+	mesh_object_init(&ob, &me);
+
+	memset(&tex, 0, sizeof(tex));
+	default_tex(&tex);
+	tex_set_type(&tex, TEX_CLOUDS);
+	/* the modifier releases its user when freed */
+	tex.id.us = 2;
+
+	dmd = (DisplaceModifierData *)modifier_new(eModifierType_Displace);
+	dmd->modifier.scene = &scene;
+	dmd->texture = &tex;
+
+	TIMEIT_START(displace_clouds);
+	for (i = 0; i < 5; i++) {
+		cos = modifier_test_deform_verts((ModifierData *)dmd, &ob);
+		MEM_freeN(cos);
+	}
+	TIMEIT_END(displace_clouds);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	modifier_free((ModifierData *)dmd);
+	BKE_mesh_free(&me, false);
+
+	BKE_images_exit();
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,183 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+#include "DNA_texture_types.h"
+
+#include "BKE_image.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_texture.h"
+
+#include "RE_shader_ext.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#include "BKE_test_util.h"
+
+/* Displace and wave with a procedural texture on a grid, compared against
+ * sampling the texture one vertex at a time. */
+
+#define GRID_RES 256
+
+typedef struct TexModifierTestScene {
+	Scene scene;
+	Object ob;
+	Mesh mesh;
+	Tex tex;
+} TexModifierTestScene;
+
+static void tex_modifier_test_scene_init(TexModifierTestScene *ts, const int tex_type)
+{
+	int i;
+
+	memset(ts, 0, sizeof(*ts));
+
+	ts->scene.r.cfra = 1;
+	ts->scene.r.framelen = 1.0f;
+
+	/* grid from -2 to 2 */
+	grid_mesh_init(&ts->mesh, GRID_RES);
+	for (i = 0; i < ts->mesh.totvert; i++) {
+		ts->mesh.mvert[i].co[0] = 4.0f * ts->mesh.mvert[i].co[0] - 2.0f;
+		ts->mesh.mvert[i].co[1] = 4.0f * ts->mesh.mvert[i].co[1] - 2.0f;
+	}
+	BKE_mesh_calc_normals(&ts->mesh);
+	mesh_object_init(&ts->ob, &ts->mesh);
+
+	default_tex(&ts->tex);
+	tex_set_type(&ts->tex, tex_type);
+	/* modifiers release their user when freed */
+	ts->tex.id.us = 2;
+}
+
+static float (*tex_modifier_apply(TexModifierTestScene *ts, ModifierData *md))[3]
+{
+	md->scene = &ts->scene;
+	return modifier_test_deform_verts(md, &ts->ob);
+}
+
+static void tex_value(TexModifierTestScene *ts, const float co[3], TexResult *texres)
+{
+	float tex_co[3];
+
+	copy_v3_v3(tex_co, co);
+	texres->nor = NULL;
+	BKE_texture_get_value(NULL, &ts->tex, tex_co, texres, false);
+}
+
+TEST(displace_wave, DisplaceTexture)
+{
+	TexModifierTestScene ts;
+	DisplaceModifierData *dmd;
+	float (*cos)[3];
+	float maxdiff = 0.0f;
+	int i;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+	BKE_images_init();
+
+	tex_modifier_test_scene_init(&ts, TEX_MAGIC);
+
+	/* intensity along normals */
+	dmd = (DisplaceModifierData *)modifier_new(eModifierType_Displace);
+	dmd->texture = &ts.tex;
+	dmd->direction = MOD_DISP_DIR_NOR;
+	cos = tex_modifier_apply(&ts, (ModifierData *)dmd);
+
+	for (i = 0; i < ts.mesh.totvert; i++) {
+		const float *co_orig = ts.mesh.mvert[i].co;
+		TexResult texres;
+
+		tex_value(&ts, co_orig, &texres);
+		maxdiff = max_ff(maxdiff, fabsf(cos[i][2] - (co_orig[2] + (texres.tin - dmd->midlevel) * dmd->strength)));
+		maxdiff = max_ff(maxdiff, len_v2v2(cos[i], co_orig));
+	}
+	EXPECT_GT(1e-5f, maxdiff);
+	MEM_freeN(cos);
+
+	/* color */
+	dmd->direction = MOD_DISP_DIR_RGB_XYZ;
+	cos = tex_modifier_apply(&ts, (ModifierData *)dmd);
+
+	maxdiff = 0.0f;
+	for (i = 0; i < ts.mesh.totvert; i++) {
+		const float *co_orig = ts.mesh.mvert[i].co;
+		TexResult texres;
+		float co[3];
+
+		tex_value(&ts, co_orig, &texres);
+		co[0] = co_orig[0] + (texres.tr - dmd->midlevel) * dmd->strength;
+		co[1] = co_orig[1] + (texres.tg - dmd->midlevel) * dmd->strength;
+		co[2] = co_orig[2] + (texres.tb - dmd->midlevel) * dmd->strength;
+		maxdiff = max_ff(maxdiff, len_v3v3(cos[i], co));
+	}
+	EXPECT_GT(1e-5f, maxdiff);
+	MEM_freeN(cos);
+
+	modifier_free((ModifierData *)dmd);
+	BKE_mesh_free(&ts.mesh, false);
+
+	BKE_images_exit();
+	BLI_threadapi_exit();
+}
+
+TEST(displace_wave, WaveTexture)
+{
+	TexModifierTestScene ts;
+	WaveModifierData *wmd;
+	float (*cos)[3], (*cos_tex)[3];
+	float maxdiff = 0.0f;
+	int i, tot_moved = 0;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+	BKE_images_init();
+
+	tex_modifier_test_scene_init(&ts, TEX_MAGIC);
+
+	wmd = (WaveModifierData *)modifier_new(eModifierType_Wave);
+	cos = tex_modifier_apply(&ts, (ModifierData *)wmd);
+
+	/* the texture scales the offset of every vertex by its intensity */
+	wmd->texture = &ts.tex;
+	cos_tex = tex_modifier_apply(&ts, (ModifierData *)wmd);
+
+	for (i = 0; i < ts.mesh.totvert; i++) {
+		const float *co_orig = ts.mesh.mvert[i].co;
+		TexResult texres;
+		float offset[3];
+
+		tex_value(&ts, co_orig, &texres);
+		sub_v3_v3v3(offset, cos[i], co_orig);
+		madd_v3_v3fl(offset, offset, texres.tin - 1.0f);
+		add_v3_v3(offset, co_orig);
+		maxdiff = max_ff(maxdiff, len_v3v3(cos_tex[i], offset));
+
+		if (cos[i][2] != co_orig[2]) {
+			tot_moved++;
+		}
+	}
+	EXPECT_GT(1e-5f, maxdiff);
+	EXPECT_LT(ts.mesh.totvert / 4, tot_moved);
+
+	MEM_freeN(cos);
+	MEM_freeN(cos_tex);
+	modifier_free((ModifierData *)wmd);
+	BKE_mesh_free(&ts.mesh, false);
+
+	BKE_images_exit();
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,58 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+#include "BKE_test_util.h"
+
+#define GRID_RES 256
+
+TEST(laplacian_smooth, SmoothPerformance)
+{
+	LaplacianSmoothModifierData *smd;
+	float (*cos)[3];
+	Object ob;
+	Mesh me;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	grid_mesh_init(&me, GRID_RES);
+	mesh_object_init(&ob, &me);
+
+	smd = (LaplacianSmoothModifierData *)modifier_new(eModifierType_LaplacianSmooth);
+	smd->flag = MOD_LAPLACIANSMOOTH_X | MOD_LAPLACIANSMOOTH_Y | MOD_LAPLACIANSMOOTH_Z;
+	smd->repeat = 5;
+	smd->lambda = 1.0f;
+	smd->lambda_border = 1.0f;
+
+	TIMEIT_START(laplacian_smooth);
+	cos = modifier_test_deform_verts((ModifierData *)smd, &ob);
+	TIMEIT_END(laplacian_smooth);
+
+	MEM_freeN(cos);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	modifier_free((ModifierData *)smd);
+	BKE_mesh_free(&me, false);
+
+	BLI_threadapi_exit();
+}
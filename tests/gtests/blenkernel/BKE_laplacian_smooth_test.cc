@@ -0,0 +1,98 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#include "BKE_test_util.h"
+
+/* A noisy grid large enough for the coordinates to be solved in parallel, without volume
+ * preservation every axis is smoothed on its own, so smoothing all axes at once has to
+ * give the same result as smoothing them one by one. */
+
+#define GRID_RES 128
+
+/* a grid with noise in every axis, so smoothing moves every vertex */
+static void noisy_grid_mesh_init(Mesh *me, const int res)
+{
+	RNG *rng = BLI_rng_new(0);
+	int i;
+
+	grid_mesh_init(me, res);
+
+	for (i = 0; i < me->totvert; i++) {
+		me->mvert[i].co[0] += 0.2f * BLI_rng_get_float(rng) / (float)res;
+		me->mvert[i].co[1] += 0.2f * BLI_rng_get_float(rng) / (float)res;
+		me->mvert[i].co[2] = 0.1f * BLI_rng_get_float(rng);
+	}
+
+	BLI_rng_free(rng);
+}
+
+static float (*laplacian_smooth(Mesh *me, const short flag, const short repeat))[3]
+{
+	LaplacianSmoothModifierData *smd = (LaplacianSmoothModifierData *)modifier_new(eModifierType_LaplacianSmooth);
+	float (*cos)[3];
+	Object ob;
+
+	mesh_object_init(&ob, me);
+
+	smd->flag = flag;
+	smd->repeat = repeat;
+	smd->lambda = 1.0f;
+	smd->lambda_border = 1.0f;
+	cos = modifier_test_deform_verts((ModifierData *)smd, &ob);
+
+	modifier_free((ModifierData *)smd);
+
+	return cos;
+}
+
+TEST(laplacian_smooth, IndependentAxes)
+{
+	const short axis_flags[3] = {MOD_LAPLACIANSMOOTH_X, MOD_LAPLACIANSMOOTH_Y, MOD_LAPLACIANSMOOTH_Z};
+	float (*cos_all)[3];
+	float maxdiff = 0.0f, maxmove = 0.0f;
+	Mesh me;
+	int i, j;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+
+	noisy_grid_mesh_init(&me, GRID_RES);
+
+	cos_all = laplacian_smooth(&me, MOD_LAPLACIANSMOOTH_X | MOD_LAPLACIANSMOOTH_Y | MOD_LAPLACIANSMOOTH_Z, 3);
+
+	for (j = 0; j < 3; j++) {
+		float (*cos_axis)[3] = laplacian_smooth(&me, axis_flags[j], 3);
+
+		for (i = 0; i < me.totvert; i++) {
+			maxdiff = max_ff(maxdiff, fabsf(cos_all[i][j] - cos_axis[i][j]));
+			maxmove = max_ff(maxmove, fabsf(cos_all[i][j] - me.mvert[i].co[j]));
+		}
+		MEM_freeN(cos_axis);
+	}
+
+	EXPECT_GT(1e-5f, maxdiff);
+	EXPECT_LT(1e-3f, maxmove);
+
+	MEM_freeN(cos_all);
+	BKE_mesh_free(&me, false);
+
+	BLI_threadapi_exit();
+}
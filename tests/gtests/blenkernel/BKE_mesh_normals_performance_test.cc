@@ -0,0 +1,42 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+
+#include "BKE_mesh.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+#include "BKE_test_util.h"
+
+#define SPHERE_RES 256
+
+TEST(mesh_normals, SpherePerformance)
+{
+	Mesh me;
+	int i;
+
+	BLI_threadapi_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	sphere_mesh_init(&me, 4 * SPHERE_RES);
+
+	TIMEIT_START(mesh_calc_normals);
+	for (i = 0; i < 10; i++) {
+		BKE_mesh_calc_normals(&me);
+	}
+	TIMEIT_END(mesh_calc_normals);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	BKE_mesh_free(&me, false);
+
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,79 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_mesh.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#include "BKE_test_util.h"
+
+/* A latitude/longitude sphere, closed around its longitude, dense enough for the
+ * normals to be computed in parallel. Away from the poles every vertex normal has to
+ * point away from the center and every face normal along its face center. */
+
+#define SPHERE_RES 256
+
+TEST(mesh_normals, Sphere)
+{
+	float (*pnors)[3];
+	float mindot_vert = 1.0f, mindot_poly = 1.0f;
+	Mesh me;
+	int i, j;
+
+	/* several threads even on single core machines, so vertex normals are accumulated atomically */
+	BLI_system_num_threads_override_set(4);
+	BLI_threadapi_init();
+
+	sphere_mesh_init(&me, SPHERE_RES);
+	pnors = (float (*)[3])MEM_mallocN(sizeof(*pnors) * (size_t)me.totpoly, __func__);
+
+	BKE_mesh_calc_normals_poly(me.mvert, me.totvert, me.mloop, me.mpoly, me.totloop, me.totpoly, pnors, false);
+
+	/* skip the rings next to the poles, they only have faces on one side */
+	for (i = SPHERE_RES; i < me.totvert - SPHERE_RES; i++) {
+		float no[3];
+
+		normal_short_to_float_v3(no, me.mvert[i].no);
+		mindot_vert = min_ff(mindot_vert, dot_v3v3(no, me.mvert[i].co));
+	}
+
+	for (i = 0; i < me.totpoly; i++) {
+		float cent[3] = {0.0f, 0.0f, 0.0f};
+
+		for (j = 0; j < 4; j++) {
+			add_v3_v3(cent, me.mvert[me.mloop[me.mpoly[i].loopstart + j].v].co);
+		}
+		normalize_v3(cent);
+		mindot_poly = min_ff(mindot_poly, dot_v3v3(pnors[i], cent));
+	}
+
+	EXPECT_LT(0.9999f, mindot_vert);
+	EXPECT_LT(0.9999f, mindot_poly);
+
+	/* face normals only */
+	memset(pnors, 0, sizeof(*pnors) * (size_t)me.totpoly);
+	BKE_mesh_calc_normals_poly(me.mvert, me.totvert, me.mloop, me.mpoly, me.totloop, me.totpoly, pnors, true);
+
+	mindot_poly = 1.0f;
+	for (i = 0; i < me.totpoly; i++) {
+		mindot_poly = min_ff(mindot_poly, dot_v3v3(pnors[i], pnors[i]));
+	}
+	EXPECT_LT(0.9999f, mindot_poly);
+
+	MEM_freeN(pnors);
+	BKE_mesh_free(&me, false);
+
+	BLI_threadapi_exit();
+	BLI_system_num_threads_override_set(0);
+}
@@ -0,0 +1,43 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+
+#include "BKE_mesh.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+#include "BKE_test_util.h"
+
+#define POLY_SIZE_MAX 40
+
+TEST(mesh_tessellation, NGonsPerformance)
+{
+	Mesh me;
+	int i;
+
+	BLI_threadapi_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	ngon_mesh_init(&me, 20000, 4 * POLY_SIZE_MAX);
+
+	TIMEIT_START(mesh_recalc_tessellation);
+	for (i = 0; i < 5; i++) {
+		me.totface = BKE_mesh_recalc_tessellation(&me.fdata, &me.ldata, &me.pdata, me.mvert,
+		                                          me.totface, me.totloop, me.totpoly, false);
+	}
+	TIMEIT_END(mesh_recalc_tessellation);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	BKE_mesh_free(&me, false);
+
+	BLI_threadapi_exit();
+}
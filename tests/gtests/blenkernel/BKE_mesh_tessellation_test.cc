@@ -0,0 +1,95 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_mesh.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#include "BKE_test_util.h"
+
+/* Separate polygons side by side, tris, quads and star shaped (concave) n-gons of
+ * increasing size. The tessellation of every polygon has to cover exactly its area. */
+
+#define POLY_SIZE_MAX 40
+
+static int ngon_mesh_tessellate(Mesh *me)
+{
+	return BKE_mesh_recalc_tessellation(&me->fdata, &me->ldata, &me->pdata, me->mvert,
+	                                    me->totface, me->totloop, me->totpoly, false);
+}
+
+TEST(mesh_tessellation, NGons)
+{
+	const int totpoly = 2000;
+	float (*poly_areas)[2] = (float (*)[2])MEM_callocN(sizeof(*poly_areas) * totpoly, __func__);
+	float (*cos)[3] = (float (*)[3])MEM_mallocN(sizeof(*cos) * POLY_SIZE_MAX, __func__);
+	MFace *mface;
+	int *origindex;
+	int i, j, totface, totface_expect = 0;
+	float maxdiff = 0.0f;
+	Mesh me;
+
+	/* several threads even on single core machines */
+	BLI_system_num_threads_override_set(4);
+	BLI_threadapi_init();
+
+	ngon_mesh_init(&me, totpoly, POLY_SIZE_MAX);
+
+	totface = me.totface = ngon_mesh_tessellate(&me);
+
+	for (i = 0; i < totpoly; i++) {
+		const int size = ngon_poly_size(i, POLY_SIZE_MAX);
+		totface_expect += (size == 4) ? 1 : size - 2;
+	}
+	EXPECT_EQ(totface_expect, totface);
+
+	mface = (MFace *)CustomData_get_layer(&me.fdata, CD_MFACE);
+	origindex = (int *)CustomData_get_layer(&me.fdata, CD_ORIGINDEX);
+
+	for (i = 0; i < totface; i++) {
+		const MFace *mf = &mface[i];
+		const MPoly *mp = &me.mpoly[origindex[i]];
+
+		/* faces of a poly are stored together, in the order of the polys */
+		EXPECT_TRUE(i == 0 || origindex[i] == origindex[i - 1] || origindex[i] == origindex[i - 1] + 1);
+		EXPECT_TRUE(mf->v1 >= (unsigned int)mp->loopstart && mf->v1 < (unsigned int)(mp->loopstart + mp->totloop));
+
+		if (mf->v4) {
+			poly_areas[origindex[i]][0] += area_quad_v3(me.mvert[mf->v1].co, me.mvert[mf->v2].co,
+			                                            me.mvert[mf->v3].co, me.mvert[mf->v4].co);
+		}
+		else {
+			poly_areas[origindex[i]][0] += area_tri_v3(me.mvert[mf->v1].co, me.mvert[mf->v2].co,
+			                                           me.mvert[mf->v3].co);
+		}
+	}
+
+	for (i = 0; i < totpoly; i++) {
+		const MPoly *mp = &me.mpoly[i];
+
+		for (j = 0; j < mp->totloop; j++) {
+			copy_v3_v3(cos[j], me.mvert[me.mloop[mp->loopstart + j].v].co);
+		}
+		poly_areas[i][1] = area_poly_v3((const float (*)[3])cos, (unsigned int)mp->totloop);
+		maxdiff = max_ff(maxdiff, fabsf(poly_areas[i][0] - poly_areas[i][1]));
+	}
+	EXPECT_GT(1e-4f, maxdiff);
+
+	MEM_freeN(poly_areas);
+	MEM_freeN(cos);
+	BKE_mesh_free(&me, false);
+
+	BLI_threadapi_exit();
+	BLI_system_num_threads_override_set(0);
+}
@@ -0,0 +1,99 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_compiler_attrs.h"
+#include "BLI_rand.h"
+
+#include "DNA_modifier_types.h"
+
+#include "BKE_modifier.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+/* The static bind collects the weights above the threshold in lists per vertex,
+ * compacting those has to give the same rows as compacting the dense weights did. */
+
+#define TOTVERT 500
+#define TOTCAGEVERT 40
+
+static float bind_test_weight(RNG *rng)
+{
+	const float r = BLI_rng_get_float(rng);
+
+	/* mostly nothing, some weights around the threshold */
+	if (r < 0.6f)
+		return 0.0f;
+	else if (r < 0.8f)
+		return MESHDEFORM_MIN_INFLUENCE * 2.0f * BLI_rng_get_float(rng);
+	else
+		return BLI_rng_get_float(rng);
+}
+
+TEST(meshdeform_bind, CompactInfluences)
+{
+	MeshDeformModifierData mmd_dense, mmd_lists;
+	MDefBindInfluence **bindinfs, *infs;
+	RNG *rng = BLI_rng_new(0);
+	float *weights;
+	int a, b, totinf = 0;
+
+	memset(&mmd_dense, 0, sizeof(mmd_dense));
+	memset(&mmd_lists, 0, sizeof(mmd_lists));
+
+	weights = (float *)MEM_mallocN(sizeof(float) * TOTVERT * TOTCAGEVERT, __func__);
+	for (a = 0; a < TOTVERT * TOTCAGEVERT; a++) {
+		weights[a] = bind_test_weight(rng);
+	}
+	/* a vertex without any influence */
+	for (a = 0; a < TOTCAGEVERT; a++) {
+		weights[a + 7 * TOTCAGEVERT] = 0.0f;
+	}
+
+	/* lists filled like the bind does, one cage vertex at a time */
+	bindinfs = (MDefBindInfluence **)MEM_callocN(sizeof(*bindinfs) * TOTVERT, __func__);
+	infs = (MDefBindInfluence *)MEM_mallocN(sizeof(*infs) * TOTVERT * TOTCAGEVERT, __func__);
+	for (a = 0; a < TOTCAGEVERT; a++) {
+		for (b = 0; b < TOTVERT; b++) {
+			if (weights[a + b * TOTCAGEVERT] > MESHDEFORM_MIN_INFLUENCE) {
+				MDefBindInfluence *inf = &infs[totinf++];
+				inf->vertex = a;
+				inf->weight = weights[a + b * TOTCAGEVERT];
+				inf->next = bindinfs[b];
+				bindinfs[b] = inf;
+			}
+		}
+	}
+
+	mmd_dense.bindweights = weights;
+	mmd_dense.totvert = TOTVERT;
+	mmd_dense.totcagevert = TOTCAGEVERT;
+	modifier_mdef_compact_influences((ModifierData *)&mmd_dense);
+	EXPECT_EQ(NULL, mmd_dense.bindweights);
+
+	modifier_mdef_compact_bind_influences((ModifierData *)&mmd_lists, bindinfs, TOTVERT);
+
+	ASSERT_EQ(mmd_dense.totinfluence, mmd_lists.totinfluence);
+	EXPECT_EQ(totinf, mmd_lists.totinfluence);
+
+	for (a = 0; a <= TOTVERT; a++) {
+		EXPECT_EQ(mmd_dense.bindoffsets[a], mmd_lists.bindoffsets[a]);
+	}
+	EXPECT_EQ(mmd_lists.bindoffsets[7], mmd_lists.bindoffsets[8]);
+
+	for (a = 0; a < mmd_lists.totinfluence; a++) {
+		EXPECT_EQ(mmd_dense.bindinfluences[a].vertex, mmd_lists.bindinfluences[a].vertex);
+		EXPECT_EQ(mmd_dense.bindinfluences[a].weight, mmd_lists.bindinfluences[a].weight);
+	}
+
+	MEM_freeN(mmd_dense.bindinfluences);
+	MEM_freeN(mmd_dense.bindoffsets);
+	MEM_freeN(mmd_lists.bindinfluences);
+	MEM_freeN(mmd_lists.bindoffsets);
+	MEM_freeN(bindinfs);
+	MEM_freeN(infs);
+	BLI_rng_free(rng);
+}
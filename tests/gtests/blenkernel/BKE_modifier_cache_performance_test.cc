@@ -0,0 +1,83 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_listbase.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_DerivedMesh.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_object.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+#include "BKE_test_util.h"
+
+/* A grid with a remesh and an animated displace after it, evaluated from scratch
+ * every time against evaluated with the remesh result cached. */
+
+#define GRID_RES 64
+
+TEST(modifier_cache, AnimatedDisplacePerformance)
+{
+	RemeshModifierData *rmd;
+	DisplaceModifierData *dmd;
+	ToolSettings toolsettings;
+	Scene scene;
+	Object ob;
+	Mesh me;
+	int i;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	memset(&scene, 0, sizeof(scene));
+	memset(&toolsettings, 0, sizeof(toolsettings));
+	scene.toolsettings = &toolsettings;
+
+	grid_mesh_init(&me, GRID_RES);
+	mesh_object_init(&ob, &me);
+
+	rmd = (RemeshModifierData *)modifier_new(eModifierType_Remesh);
+	rmd->depth = 7;
+	rmd->flag = 0;
+	BLI_addtail(&ob.modifiers, rmd);
+
+	dmd = (DisplaceModifierData *)modifier_new(eModifierType_Displace);
+	BLI_addtail(&ob.modifiers, dmd);
+
+	TIMEIT_START(uncached);
+	for (i = 0; i < 10; i++) {
+		DerivedMesh *dm;
+		dmd->strength = 0.01f * (float)i;
+		dm = mesh_create_derived_view(&scene, &ob, CD_MASK_BAREMESH);
+		dm->release(dm);
+	}
+	TIMEIT_END(uncached);
+
+	TIMEIT_START(cached);
+	for (i = 0; i < 10; i++) {
+		dmd->strength = 0.01f * (float)i;
+		makeDerivedMesh(&scene, &ob, NULL, CD_MASK_BAREMESH, false);
+	}
+	TIMEIT_END(cached);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	BKE_object_free_derived_caches(&ob);
+	BKE_object_free_modifiers(&ob);
+	BKE_mesh_free(&me, false);
+
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,224 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_listbase.h"
+#include "BLI_math.h"
+#include "BLI_string.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+#include "DNA_scene_types.h"
+
+#include "BKE_customdata.h"
+#include "BKE_deform.h"
+#include "BKE_DerivedMesh.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_object.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#include "BKE_test_util.h"
+
+/* A grid with a remesh or subsurf and an animated displace after it, the
+ * constructive modifier result should come from the cache while only the
+ * displace is redone. */
+
+#define GRID_RES 64
+
+typedef struct CacheTestScene {
+	Scene scene;
+	ToolSettings toolsettings;
+	Object ob;
+	Mesh mesh;
+	ModifierData *cmd;
+	DisplaceModifierData *dmd;
+} CacheTestScene;
+
+static void cache_test_scene_init(CacheTestScene *ts, const int res, ModifierData *cmd)
+{
+	int i;
+
+	memset(ts, 0, sizeof(*ts));
+
+	ts->scene.toolsettings = &ts->toolsettings;
+
+	grid_mesh_init(&ts->mesh, res);
+	for (i = 0; i < ts->mesh.totvert; i++) {
+		ts->mesh.mvert[i].co[2] = 0.1f * sinf((float)i);
+	}
+	mesh_object_init(&ts->ob, &ts->mesh);
+
+	ts->cmd = cmd;
+	BLI_addtail(&ts->ob.modifiers, ts->cmd);
+
+	ts->dmd = (DisplaceModifierData *)modifier_new(eModifierType_Displace);
+	BLI_addtail(&ts->ob.modifiers, ts->dmd);
+}
+
+static void cache_test_scene_free(CacheTestScene *ts)
+{
+	BKE_object_free_derived_caches(&ts->ob);
+	BKE_object_free_modifiers(&ts->ob);
+	EXPECT_EQ(NULL, ts->ob.modifier_cache);
+	BLI_freelistN(&ts->ob.defbase);
+	BKE_mesh_free(&ts->mesh, false);
+}
+
+/* evaluate like the viewport does, the final vertex coordinates */
+static float (*cache_test_final_cos(CacheTestScene *ts, int *r_totvert, int *r_totpoly))[3]
+{
+	DerivedMesh *dm;
+	float (*cos)[3];
+
+	makeDerivedMesh(&ts->scene, &ts->ob, NULL, CD_MASK_BAREMESH, false);
+	dm = ts->ob.derivedFinal;
+
+	*r_totvert = dm->getNumVerts(dm);
+	*r_totpoly = dm->getNumPolys(dm);
+	cos = (float (*)[3])MEM_mallocN(sizeof(*cos) * (size_t)*r_totvert, __func__);
+	dm->getVertCos(dm, cos);
+
+	return cos;
+}
+
+/* compare against the same evaluation without the results cached so far */
+static void cache_test_evaluate(CacheTestScene *ts)
+{
+	struct ModifierStackCache *cache;
+	float (*cos)[3], (*cos_ref)[3];
+	float maxdiff = 0.0f;
+	int i, totvert, totvert_ref, totpoly, totpoly_ref;
+
+	cos = cache_test_final_cos(ts, &totvert, &totpoly);
+
+	cache = ts->ob.modifier_cache;
+	ts->ob.modifier_cache = NULL;
+	cos_ref = cache_test_final_cos(ts, &totvert_ref, &totpoly_ref);
+	mesh_modifier_cache_free(&ts->ob);
+	ts->ob.modifier_cache = cache;
+
+	EXPECT_LT(0, totvert);
+	EXPECT_EQ(totpoly_ref, totpoly);
+	ASSERT_EQ(totvert_ref, totvert);
+
+	for (i = 0; i < totvert; i++) {
+		maxdiff = max_ff(maxdiff, len_v3v3(cos[i], cos_ref[i]));
+	}
+	EXPECT_GT(1e-5f, maxdiff);
+
+	MEM_freeN(cos);
+	MEM_freeN(cos_ref);
+}
+
+static RemeshModifierData *cache_test_remesh_new(const int depth)
+{
+	RemeshModifierData *rmd = (RemeshModifierData *)modifier_new(eModifierType_Remesh);
+
+	rmd->depth = (char)depth;
+	rmd->flag = 0;
+	return rmd;
+}
+
+TEST(modifier_cache, ChangedInputs)
+{
+	CacheTestScene ts;
+	RemeshModifierData *rmd;
+	int i;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+
+	rmd = cache_test_remesh_new(6);
+	cache_test_scene_init(&ts, GRID_RES, (ModifierData *)rmd);
+
+	/* animated displace, remesh result is reused */
+	for (i = 0; i < 6; i++) {
+		ts.dmd->strength = 0.1f * (float)i;
+		cache_test_evaluate(&ts);
+	}
+	EXPECT_NE((void *)NULL, (void *)ts.ob.modifier_cache);
+
+	/* settings of the cached modifier */
+	rmd->depth = 5;
+	cache_test_evaluate(&ts);
+	cache_test_evaluate(&ts);
+	cache_test_evaluate(&ts);
+
+	/* mesh data */
+	ts.mesh.mvert[0].co[2] = 1.0f;
+	cache_test_evaluate(&ts);
+	cache_test_evaluate(&ts);
+	cache_test_evaluate(&ts);
+
+	/* disabling a modifier */
+	rmd->modifier.mode &= ~eModifierMode_Realtime;
+	cache_test_evaluate(&ts);
+	rmd->modifier.mode |= eModifierMode_Realtime;
+	cache_test_evaluate(&ts);
+
+	/* no memory for the cache */
+	mesh_modifier_cache_limit_set(0);
+	cache_test_evaluate(&ts);
+	EXPECT_EQ(NULL, ts.ob.modifier_cache);
+	mesh_modifier_cache_limit_set((size_t)256 << 20);
+
+	cache_test_scene_free(&ts);
+
+	BLI_threadapi_exit();
+}
+
+/* state outside of the settings of the cached modifier */
+TEST(modifier_cache, SubsurfInputs)
+{
+	CacheTestScene ts;
+	SubsurfModifierData *smd;
+	MDeformVert *dvert;
+	int i;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+
+	smd = (SubsurfModifierData *)modifier_new(eModifierType_Subsurf);
+	smd->levels = 2;
+	cache_test_scene_init(&ts, GRID_RES / 4, (ModifierData *)smd);
+
+	/* half of the grid in a vertex group */
+	BKE_defgroup_new(&ts.ob, "Group");
+	dvert = (MDeformVert *)CustomData_add_layer(&ts.mesh.vdata, CD_MDEFORMVERT, CD_CALLOC, NULL, ts.mesh.totvert);
+	BKE_mesh_update_customdata_pointers(&ts.mesh, false);
+	for (i = 0; i < ts.mesh.totvert / 2; i++) {
+		defvert_add_index_notest(&dvert[i], 0, 1.0f);
+	}
+
+	for (i = 0; i < 3; i++) {
+		cache_test_evaluate(&ts);
+	}
+
+	/* the vertex group has to be kept by the subsurf now */
+	BLI_strncpy(ts.dmd->defgrp_name, "Group", sizeof(ts.dmd->defgrp_name));
+	cache_test_evaluate(&ts);
+	cache_test_evaluate(&ts);
+	cache_test_evaluate(&ts);
+
+	/* levels limited by the scene */
+	ts.scene.r.mode |= R_SIMPLIFY;
+	ts.scene.r.simplify_subsurf = 1;
+	cache_test_evaluate(&ts);
+	cache_test_evaluate(&ts);
+	cache_test_evaluate(&ts);
+
+	ts.scene.r.simplify_subsurf = 0;
+	cache_test_evaluate(&ts);
+
+	cache_test_scene_free(&ts);
+
+	BLI_threadapi_exit();
+}
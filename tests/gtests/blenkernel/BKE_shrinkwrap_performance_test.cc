@@ -0,0 +1,92 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_cdderivedmesh.h"
+#include "BKE_DerivedMesh.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_shrinkwrap.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+#include "BKE_test_util.h"
+
+/* Random points above a flat grid wrapped onto its nearest surface. */
+
+#define GRID_RES 64
+
+TEST(shrinkwrap, NearestSurfacePerformance)
+{
+	const int num = 500000;
+	float (*cos_orig)[3] = (float (*)[3])MEM_mallocN(sizeof(*cos_orig) * (size_t)num, __func__);
+	float (*cos)[3] = (float (*)[3])MEM_mallocN(sizeof(*cos) * (size_t)num, __func__);
+	ShrinkwrapModifierData *smd;
+	Object ob, target;
+	Mesh target_mesh;
+	DerivedMesh *dm;
+	RNG *rng = BLI_rng_new(1);
+	int i;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	for (i = 0; i < num; i++) {
+		cos_orig[i][0] = BLI_rng_get_float(rng);
+		cos_orig[i][1] = BLI_rng_get_float(rng);
+		cos_orig[i][2] = 0.1f + BLI_rng_get_float(rng);
+	}
+
+	memset(&ob, 0, sizeof(ob));
+	ob.type = OB_MESH;
+	unit_m4(ob.obmat);
+
+	grid_mesh_init(&target_mesh, GRID_RES);
+	mesh_object_init(&target, &target_mesh);
+	dm = CDDM_from_mesh(&target_mesh);
+	DM_ensure_tessface(dm);
+	dm->needsFree = 0;
+	target.derivedFinal = dm;
+
+	smd = (ShrinkwrapModifierData *)modifier_new(eModifierType_Shrinkwrap);
+	smd->target = &target;
+
+	TIMEIT_START(nearest_surface);
+	for (i = 0; i < 5; i++) {
+		memcpy(cos, cos_orig, sizeof(*cos) * (size_t)num);
+		shrinkwrapModifier_deform(smd, &ob, NULL, cos, num, false);
+	}
+	TIMEIT_END(nearest_surface);
+
+	/* everything ends up on the grid */
+	for (i = 0; i < num; i++) {
+		EXPECT_GT(1e-5f, fabsf(cos[i][2]));
+	}
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	dm->needsFree = 1;
+	dm->release(dm);
+	modifier_free((ModifierData *)smd);
+	BKE_mesh_free(&target_mesh, false);
+	MEM_freeN(cos_orig);
+	MEM_freeN(cos);
+	BLI_rng_free(rng);
+
+	BLI_threadapi_exit();
+}
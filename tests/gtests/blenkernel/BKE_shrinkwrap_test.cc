@@ -0,0 +1,151 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_bvhutils.h"
+#include "BKE_cdderivedmesh.h"
+#include "BKE_DerivedMesh.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+#include "BKE_shrinkwrap.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#include "BKE_test_util.h"
+
+/* Points above a flat grid wrapped onto it, the grid is the evaluated
+ * mesh of the target object and keeps its bvh tree between evaluations. */
+
+#define GRID_RES 64
+
+typedef struct ShrinkwrapTestScene {
+	Object ob, target;
+	Mesh target_mesh;
+	ShrinkwrapModifierData *smd;
+} ShrinkwrapTestScene;
+
+static void shrinkwrap_test_scene_init(ShrinkwrapTestScene *ts)
+{
+	DerivedMesh *dm;
+
+	memset(ts, 0, sizeof(*ts));
+
+	ts->ob.type = OB_MESH;
+	unit_m4(ts->ob.obmat);
+
+	grid_mesh_init(&ts->target_mesh, GRID_RES);
+	mesh_object_init(&ts->target, &ts->target_mesh);
+
+	dm = CDDM_from_mesh(&ts->target_mesh);
+	DM_ensure_tessface(dm);
+	dm->needsFree = 0;
+	ts->target.derivedFinal = dm;
+
+	ts->smd = (ShrinkwrapModifierData *)modifier_new(eModifierType_Shrinkwrap);
+	ts->smd->target = &ts->target;
+}
+
+static void shrinkwrap_test_scene_free(ShrinkwrapTestScene *ts)
+{
+	DerivedMesh *dm = ts->target.derivedFinal;
+
+	dm->needsFree = 1;
+	dm->release(dm);
+	modifier_free((ModifierData *)ts->smd);
+	BKE_mesh_free(&ts->target_mesh, false);
+}
+
+/* points inside the grid bounds, above it */
+static float (*random_points(const int num, const unsigned int seed))[3]
+{
+	RNG *rng = BLI_rng_new(seed);
+	float (*co)[3] = (float (*)[3])MEM_mallocN(sizeof(*co) * (size_t)num, __func__);
+	int i;
+
+	for (i = 0; i < num; i++) {
+		co[i][0] = BLI_rng_get_float(rng);
+		co[i][1] = BLI_rng_get_float(rng);
+		co[i][2] = 0.1f + BLI_rng_get_float(rng);
+	}
+
+	BLI_rng_free(rng);
+	return co;
+}
+
+/* all points end up on the grid, projected ones straight below, nearest vertex ones on the
+ * closest grid vertex, the nearest surface search isn't exact so only check it stays close */
+static void shrinkwrap_test_check(float (*cos)[3], float (*cos_orig)[3], const int num, const short type)
+{
+	const float grid_step = 1.0f / (float)(GRID_RES - 1);
+	float maxdiff = 0.0f, maxdiff_surface = 0.0f;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		maxdiff = max_ff(maxdiff, fabsf(cos[i][2]));
+		if (type == MOD_SHRINKWRAP_NEAREST_VERTEX) {
+			maxdiff = max_ff(maxdiff, fabsf(cos[i][0] - roundf(cos_orig[i][0] / grid_step) * grid_step));
+			maxdiff = max_ff(maxdiff, fabsf(cos[i][1] - roundf(cos_orig[i][1] / grid_step) * grid_step));
+		}
+		else if (type == MOD_SHRINKWRAP_PROJECT) {
+			maxdiff = max_ff(maxdiff, len_v2v2(cos[i], cos_orig[i]));
+		}
+		else {
+			maxdiff_surface = max_ff(maxdiff_surface, len_v2v2(cos[i], cos_orig[i]));
+		}
+	}
+
+	EXPECT_GT(1e-5f, maxdiff);
+	EXPECT_GT(grid_step, maxdiff_surface);
+}
+
+TEST(shrinkwrap, TargetTypes)
+{
+	const int num = 20000;
+	const short types[3] = {MOD_SHRINKWRAP_NEAREST_SURFACE, MOD_SHRINKWRAP_PROJECT, MOD_SHRINKWRAP_NEAREST_VERTEX};
+	float (*cos_orig)[3] = random_points(num, 0);
+	float (*cos)[3] = (float (*)[3])MEM_mallocN(sizeof(*cos) * (size_t)num, __func__);
+	ShrinkwrapTestScene ts;
+	BVHTree *tree;
+	int i;
+
+	BLI_threadapi_init();
+	BKE_modifier_init();
+
+	shrinkwrap_test_scene_init(&ts);
+	ts.smd->projAxis = MOD_SHRINKWRAP_PROJECT_OVER_Z_AXIS;
+	ts.smd->shrinkOpts = MOD_SHRINKWRAP_PROJECT_ALLOW_NEG_DIR;
+
+	for (i = 0; i < 3; i++) {
+		ts.smd->shrinkType = types[i];
+		memcpy(cos, cos_orig, sizeof(*cos) * (size_t)num);
+		shrinkwrapModifier_deform(ts.smd, &ts.ob, NULL, cos, num, false);
+		shrinkwrap_test_check(cos, cos_orig, num, types[i]);
+	}
+
+	/* the trees are built once and kept with the target mesh */
+	tree = bvhcache_find(&ts.target.derivedFinal->bvhCache, BVHTREE_FROM_FACES);
+	EXPECT_NE((void *)NULL, (void *)tree);
+	EXPECT_NE((void *)NULL, (void *)bvhcache_find(&ts.target.derivedFinal->bvhCache, BVHTREE_FROM_VERTICES));
+
+	ts.smd->shrinkType = MOD_SHRINKWRAP_NEAREST_SURFACE;
+	shrinkwrapModifier_deform(ts.smd, &ts.ob, NULL, cos, num, false);
+	EXPECT_EQ(tree, bvhcache_find(&ts.target.derivedFinal->bvhCache, BVHTREE_FROM_FACES));
+
+	shrinkwrap_test_scene_free(&ts);
+	MEM_freeN(cos_orig);
+	MEM_freeN(cos);
+
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,259 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+
+#include "DNA_mesh_types.h"
+#include "DNA_meshdata_types.h"
+#include "DNA_modifier_types.h"
+#include "DNA_object_types.h"
+
+#include "BKE_cdderivedmesh.h"
+#include "BKE_customdata.h"
+#include "BKE_DerivedMesh.h"
+#include "BKE_mesh.h"
+#include "BKE_modifier.h"
+
+#include "intern/CCGSubSurf.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#include "BKE_test_util.h"
+
+/* Meshes */
+
+static void mesh_test_alloc(Mesh *me, const int totvert, const int totpoly, const int totloop)
+{
+	memset(me, 0, sizeof(*me));
+	CustomData_reset(&me->vdata);
+	CustomData_reset(&me->edata);
+	CustomData_reset(&me->fdata);
+	CustomData_reset(&me->pdata);
+	CustomData_reset(&me->ldata);
+
+	me->totvert = totvert;
+	me->totpoly = totpoly;
+	me->totloop = totloop;
+
+	CustomData_add_layer(&me->vdata, CD_MVERT, CD_CALLOC, NULL, me->totvert);
+	CustomData_add_layer(&me->pdata, CD_MPOLY, CD_CALLOC, NULL, me->totpoly);
+	CustomData_add_layer(&me->ldata, CD_MLOOP, CD_CALLOC, NULL, me->totloop);
+	BKE_mesh_update_customdata_pointers(me, false);
+}
+
+void grid_mesh_init(Mesh *me, const int res)
+{
+	MVert *mvert;
+	MPoly *mpoly;
+	MLoop *mloop;
+	int x, y, i;
+
+	mesh_test_alloc(me, res * res, (res - 1) * (res - 1), (res - 1) * (res - 1) * 4);
+
+	for (y = 0, mvert = me->mvert; y < res; y++) {
+		for (x = 0; x < res; x++, mvert++) {
+			mvert->co[0] = (float)x / (float)(res - 1);
+			mvert->co[1] = (float)y / (float)(res - 1);
+		}
+	}
+
+	for (y = 0, i = 0, mpoly = me->mpoly, mloop = me->mloop; y < res - 1; y++) {
+		for (x = 0; x < res - 1; x++, i++, mpoly++) {
+			const unsigned int v = (unsigned int)(y * res + x);
+			mpoly->loopstart = i * 4;
+			mpoly->totloop = 4;
+			(mloop++)->v = v;
+			(mloop++)->v = v + 1;
+			(mloop++)->v = v + (unsigned int)res + 1;
+			(mloop++)->v = v + (unsigned int)res;
+		}
+	}
+
+	BKE_mesh_calc_edges(me, false, false);
+}
+
+void sphere_mesh_init(Mesh *me, const int res)
+{
+	MVert *mvert;
+	MPoly *mpoly;
+	MLoop *mloop;
+	int x, y, i;
+
+	mesh_test_alloc(me, res * res, res * (res - 1), res * (res - 1) * 4);
+
+	for (y = 0, mvert = me->mvert; y < res; y++) {
+		const float lat = (float)M_PI * ((float)(y + 1) / (float)(res + 1) - 0.5f);
+		for (x = 0; x < res; x++, mvert++) {
+			const float lon = 2.0f * (float)M_PI * (float)x / (float)res;
+			mvert->co[0] = cosf(lat) * cosf(lon);
+			mvert->co[1] = cosf(lat) * sinf(lon);
+			mvert->co[2] = sinf(lat);
+		}
+	}
+
+	for (y = 0, i = 0, mpoly = me->mpoly, mloop = me->mloop; y < res - 1; y++) {
+		for (x = 0; x < res; x++, i++, mpoly++) {
+			const unsigned int v = (unsigned int)(y * res);
+			const unsigned int x_next = (unsigned int)((x + 1) % res);
+			mpoly->loopstart = i * 4;
+			mpoly->totloop = 4;
+			(mloop++)->v = v + (unsigned int)x;
+			(mloop++)->v = v + x_next;
+			(mloop++)->v = v + (unsigned int)res + x_next;
+			(mloop++)->v = v + (unsigned int)res + (unsigned int)x;
+		}
+	}
+
+	BKE_mesh_calc_edges(me, false, false);
+}
+
+int ngon_poly_size(const int poly_index, const int size_max)
+{
+	return 3 + poly_index % (size_max - 2);
+}
+
+void ngon_mesh_init(Mesh *me, const int totpoly, const int size_max)
+{
+	MVert *mvert;
+	MPoly *mpoly;
+	MLoop *mloop;
+	int i, j, totloop = 0;
+
+	for (i = 0; i < totpoly; i++) {
+		totloop += ngon_poly_size(i, size_max);
+	}
+	mesh_test_alloc(me, totloop, totpoly, totloop);
+
+	for (i = 0, mvert = me->mvert, mpoly = me->mpoly, mloop = me->mloop; i < totpoly; i++, mpoly++) {
+		const int size = ngon_poly_size(i, size_max);
+		const float center[2] = {3.0f * (float)(i % 100), 3.0f * (float)(i / 100)};
+
+		mpoly->loopstart = (int)(mloop - me->mloop);
+		mpoly->totloop = size;
+
+		for (j = 0; j < size; j++, mvert++, mloop++) {
+			const float angle = 2.0f * (float)M_PI * (float)j / (float)size;
+			const float radius = (size > 5 && (j % 2)) ? 0.5f : 1.0f;
+
+			mvert->co[0] = center[0] + radius * cosf(angle);
+			mvert->co[1] = center[1] + radius * sinf(angle);
+			mloop->v = (unsigned int)(mvert - me->mvert);
+		}
+	}
+
+	BKE_mesh_calc_edges(me, false, false);
+}
+
+/* Modifiers */
+
+void mesh_object_init(Object *ob, Mesh *me)
+{
+	memset(ob, 0, sizeof(*ob));
+	ob->type = OB_MESH;
+	ob->data = me;
+	unit_m4(ob->obmat);
+}
+
+float (*modifier_test_deform_verts(ModifierData *md, Object *ob))[3]
+{
+	const ModifierTypeInfo *mti = modifierType_getInfo((ModifierType)md->type);
+	Mesh *me = (Mesh *)ob->data;
+	float (*cos)[3] = (float (*)[3])MEM_mallocN(sizeof(*cos) * (size_t)me->totvert, __func__);
+	DerivedMesh *dm = CDDM_from_mesh(me);
+	int i;
+
+	for (i = 0; i < me->totvert; i++) {
+		copy_v3_v3(cos[i], me->mvert[i].co);
+	}
+
+	mti->deformVerts(md, ob, dm, cos, me->totvert, (ModifierApplyFlag)0);
+
+	dm->release(dm);
+	return cos;
+}
+
+DerivedMesh *modifier_test_apply(ModifierData *md, Object *ob)
+{
+	const ModifierTypeInfo *mti = modifierType_getInfo((ModifierType)md->type);
+	DerivedMesh *dm = CDDM_from_mesh((Mesh *)ob->data);
+	DerivedMesh *result = mti->applyModifier(md, ob, dm, (ModifierApplyFlag)0);
+
+	if (result != dm) {
+		dm->release(dm);
+	}
+	return result;
+}
+
+/* Subsurf */
+
+CCGSubSurf *grid_subsurf_new(const int levels)
+{
+	CCGMeshIFC ifc;
+	CCGSubSurf *ss;
+
+	ifc.vertUserSize = ifc.edgeUserSize = ifc.faceUserSize = 4;
+	ifc.numLayers = 3;
+	ifc.vertDataSize = sizeof(float) * 6;
+	ifc.simpleSubdiv = 0;
+
+	ss = ccgSubSurf_new(&ifc, levels, NULL, NULL);
+	ccgSubSurf_setCalcVertexNormals(ss, 1, sizeof(float) * 3);
+
+	return ss;
+}
+
+static void grid_vert_co(const int res, const int x, const int y, const float time, float r_co[6])
+{
+	r_co[0] = (float)x / (float)res;
+	r_co[1] = (float)y / (float)res;
+	r_co[2] = 0.1f * sinf((float)(x + y) + time);
+	r_co[3] = r_co[4] = r_co[5] = 0.0f;
+}
+
+void grid_subsurf_sync(CCGSubSurf *ss, const int res, const float time, const int skip_face)
+{
+	float co[6];
+	int x, y, i;
+
+	ccgSubSurf_initFullSync(ss);
+
+	for (y = 0; y < res; y++) {
+		for (x = 0; x < res; x++) {
+			grid_vert_co(res, x, y, time, co);
+			ccgSubSurf_syncVert(ss, SET_INT_IN_POINTER(y * res + x), co, 0, NULL);
+		}
+	}
+
+	for (y = 0, i = 0; y < res; y++) {
+		for (x = 0; x < res; x++) {
+			const int v = y * res + x;
+			if (x < res - 1) {
+				ccgSubSurf_syncEdge(ss, SET_INT_IN_POINTER(i++), SET_INT_IN_POINTER(v), SET_INT_IN_POINTER(v + 1),
+				                    0.0f, NULL);
+			}
+			if (y < res - 1) {
+				ccgSubSurf_syncEdge(ss, SET_INT_IN_POINTER(i++), SET_INT_IN_POINTER(v), SET_INT_IN_POINTER(v + res),
+				                    0.0f, NULL);
+			}
+		}
+	}
+
+	for (y = 0, i = 0; y < res - 1; y++) {
+		for (x = 0; x < res - 1; x++, i++) {
+			const int v = y * res + x;
+			CCGVertHDL fVerts[4] = {
+			    SET_INT_IN_POINTER(v), SET_INT_IN_POINTER(v + 1),
+			    SET_INT_IN_POINTER(v + res + 1), SET_INT_IN_POINTER(v + res)};
+
+			if (i != skip_face) {
+				EXPECT_EQ(eCCGError_None, ccgSubSurf_syncFace(ss, SET_INT_IN_POINTER(i), 4, fVerts, NULL));
+			}
+		}
+	}
+
+	ccgSubSurf_processSync(ss);
+}
@@ -0,0 +1,39 @@
+/* Apache License, Version 2.0 */
+
+#ifndef __BKE_TEST_UTIL_H__
+#define __BKE_TEST_UTIL_H__
+
+/* Data shared by the blenkernel tests and performance tests. */
+
+struct CCGSubSurf;
+struct DerivedMesh;
+struct Mesh;
+struct ModifierData;
+struct Object;
+
+/* Meshes, freed with BKE_mesh_free(me, false) */
+
+/* res * res vertices with quads between them, from 0 to 1 in X and Y */
+void grid_mesh_init(struct Mesh *me, const int res);
+/* latitude/longitude sphere of radius 1, closed around its longitude, open at the poles */
+void sphere_mesh_init(struct Mesh *me, const int res);
+/* separate polygons side by side, tris, quads and star shaped (concave) n-gons up to size_max */
+void ngon_mesh_init(struct Mesh *me, const int totpoly, const int size_max);
+int ngon_poly_size(const int poly_index, const int size_max);
+
+/* Modifiers */
+
+/* object at the origin, using me as data */
+void mesh_object_init(struct Object *ob, struct Mesh *me);
+/* deformVerts of md on a copy of the vertex coordinates of the object mesh */
+float (*modifier_test_deform_verts(struct ModifierData *md, struct Object *ob))[3];
+/* applyModifier of md on the object mesh */
+struct DerivedMesh *modifier_test_apply(struct ModifierData *md, struct Object *ob);
+
+/* Subsurf, a res * res grid moving in Z over time, like the modifier syncs it */
+
+struct CCGSubSurf *grid_subsurf_new(const int levels);
+/* skip_face is left out of the synced faces, -1 to sync all of them */
+void grid_subsurf_sync(struct CCGSubSurf *ss, const int res, const float time, const int skip_face);
+
+#endif  /* __BKE_TEST_UTIL_H__ */
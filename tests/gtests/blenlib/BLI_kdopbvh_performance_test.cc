@@ -0,0 +1,174 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+/* Trees built from a crumpled grid of triangles, sized like cloth meshes,
+ * as used for cloth self collision, shrinkwrap and snapping. */
+
+#define NUM_RAYS 100000
+
+typedef struct GridMesh {
+	float (*co)[3];
+	unsigned int (*tris)[3];
+	int totvert;
+	int tottri;
+} GridMesh;
+
+static void grid_mesh_create(GridMesh *mesh, const int res, const unsigned int seed)
+{
+	RNG *rng = BLI_rng_new(seed);
+	int x, y, i;
+
+	mesh->totvert = res * res;
+	mesh->tottri = (res - 1) * (res - 1) * 2;
+	mesh->co = (float (*)[3])MEM_mallocN(sizeof(*mesh->co) * (size_t)mesh->totvert, __func__);
+	mesh->tris = (unsigned int (*)[3])MEM_mallocN(sizeof(*mesh->tris) * (size_t)mesh->tottri, __func__);
+
+	for (y = 0, i = 0; y < res; y++) {
+		for (x = 0; x < res; x++, i++) {
+			mesh->co[i][0] = (float)x / (float)res;
+			mesh->co[i][1] = (float)y / (float)res;
+			mesh->co[i][2] = 0.05f * BLI_rng_get_float(rng);
+		}
+	}
+
+	for (y = 0, i = 0; y < res - 1; y++) {
+		for (x = 0; x < res - 1; x++) {
+			const unsigned int v = (unsigned int)(y * res + x);
+			mesh->tris[i][0] = v;
+			mesh->tris[i][1] = v + 1;
+			mesh->tris[i][2] = v + (unsigned int)res;
+			i++;
+			mesh->tris[i][0] = v + 1;
+			mesh->tris[i][1] = v + (unsigned int)res + 1;
+			mesh->tris[i][2] = v + (unsigned int)res;
+			i++;
+		}
+	}
+
+	BLI_rng_free(rng);
+}
+
+static void grid_mesh_free(GridMesh *mesh)
+{
+	MEM_freeN(mesh->co);
+	MEM_freeN(mesh->tris);
+}
+
+static BVHTree *grid_mesh_bvhtree(const GridMesh *mesh, const float epsilon, const char axis)
+{
+	BVHTree *tree = BLI_bvhtree_new(mesh->tottri, epsilon, 4, axis);
+	int i;
+
+	for (i = 0; i < mesh->tottri; i++) {
+		float co[3][3];
+		copy_v3_v3(co[0], mesh->co[mesh->tris[i][0]]);
+		copy_v3_v3(co[1], mesh->co[mesh->tris[i][1]]);
+		copy_v3_v3(co[2], mesh->co[mesh->tris[i][2]]);
+		BLI_bvhtree_insert(tree, i, co[0], 3);
+	}
+	BLI_bvhtree_balance(tree);
+	return tree;
+}
+
+static void grid_mesh_ray_cast_cb(void *userdata, int index, const BVHTreeRay *ray, BVHTreeRayHit *hit)
+{
+	const GridMesh *mesh = (const GridMesh *)userdata;
+	const float *v0 = mesh->co[mesh->tris[index][0]];
+	const float *v1 = mesh->co[mesh->tris[index][1]];
+	const float *v2 = mesh->co[mesh->tris[index][2]];
+	float dist;
+
+	if (isect_ray_tri_v3(ray->origin, ray->direction, v0, v1, v2, &dist, NULL) && dist < hit->dist) {
+		hit->index = index;
+		hit->dist = dist;
+		madd_v3_v3v3fl(hit->co, ray->origin, ray->direction, dist);
+	}
+}
+
+TEST(kdopbvh, ClothPerformance)
+{
+	GridMesh mesh;
+	BVHTree *tree;
+	BVHTreeOverlap *overlap;
+	BVHTreeRayHit *hits, *hits_single;
+	float (*ray_co)[3], (*ray_dir)[3];
+	unsigned int overlap_tot;
+	RNG *rng = BLI_rng_new(1);
+	int i, hit_tot = 0;
+
+	BLI_threadapi_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	grid_mesh_create(&mesh, 256, 0);
+
+	TIMEIT_START(build_kdop26);
+	tree = grid_mesh_bvhtree(&mesh, 0.001f, 26);
+	TIMEIT_END(build_kdop26);
+
+	TIMEIT_START(self_overlap_kdop26);
+	overlap = BLI_bvhtree_overlap(tree, tree, &overlap_tot);
+	TIMEIT_END(self_overlap_kdop26);
+	printf("%d triangles, %u overlaps\n", mesh.tottri, overlap_tot);
+	EXPECT_LT(0, (int)overlap_tot);
+	MEM_freeN(overlap);
+	BLI_bvhtree_free(tree);
+
+	tree = grid_mesh_bvhtree(&mesh, 0.0f, 6);
+
+	ray_co = (float (*)[3])MEM_mallocN(sizeof(*ray_co) * NUM_RAYS, __func__);
+	ray_dir = (float (*)[3])MEM_mallocN(sizeof(*ray_dir) * NUM_RAYS, __func__);
+	hits = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * NUM_RAYS, __func__);
+	hits_single = (BVHTreeRayHit *)MEM_mallocN(sizeof(*hits) * NUM_RAYS, __func__);
+
+	for (i = 0; i < NUM_RAYS; i++) {
+		ray_co[i][0] = BLI_rng_get_float(rng);
+		ray_co[i][1] = BLI_rng_get_float(rng);
+		ray_co[i][2] = 1.0f;
+		BLI_rng_get_float_unit_v3(rng, ray_dir[i]);
+		ray_dir[i][2] = -1.0f - fabsf(ray_dir[i][2]);
+		hits[i].index = hits_single[i].index = -1;
+		hits[i].dist = hits_single[i].dist = FLT_MAX;
+	}
+
+	TIMEIT_START(ray_cast_single);
+	BLI_bvhtree_ray_cast_batch(tree, ray_co, ray_dir, NUM_RAYS, 0.0f, hits_single,
+	                           grid_mesh_ray_cast_cb, &mesh, false);
+	TIMEIT_END(ray_cast_single);
+
+	TIMEIT_START(ray_cast_batch);
+	BLI_bvhtree_ray_cast_batch(tree, ray_co, ray_dir, NUM_RAYS, 0.0f, hits,
+	                           grid_mesh_ray_cast_cb, &mesh, true);
+	TIMEIT_END(ray_cast_batch);
+
+	for (i = 0; i < NUM_RAYS; i++) {
+		EXPECT_EQ(hits_single[i].index, hits[i].index);
+		hit_tot += (hits[i].index != -1);
+	}
+	EXPECT_LT(0, hit_tot);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	MEM_freeN(ray_co);
+	MEM_freeN(ray_dir);
+	MEM_freeN(hits);
+	MEM_freeN(hits_single);
+	BLI_bvhtree_free(tree);
+	grid_mesh_free(&mesh);
+	BLI_rng_free(rng);
+
+	BLI_threadapi_exit();
+}
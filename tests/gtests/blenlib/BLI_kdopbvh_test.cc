@@ -0,0 +1,267 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_kdopbvh.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+/* The overlaps of k-DOP trees must match testing every pair of triangles
+ * against each other along the same axes. Large enough trees are split into
+ * node pairs traversed by separate tasks, small ones are traversed at once. */
+
+/* same as KDOP_AXES in BLI_kdopbvh.c */
+static const float kdop_axes[13][3] = {
+	{1.0, 0, 0}, {0, 1.0, 0}, {0, 0, 1.0}, {1.0, 1.0, 1.0}, {1.0, -1.0, 1.0}, {1.0, 1.0, -1.0},
+	{1.0, -1.0, -1.0}, {1.0, 1.0, 0}, {1.0, 0, 1.0}, {0, 1.0, 1.0}, {1.0, -1.0, 0}, {1.0, 0, -1.0},
+	{0, 1.0, -1.0}
+};
+
+typedef struct GridMesh {
+	float (*co)[3];
+	unsigned int (*tris)[3];
+	int totvert;
+	int tottri;
+} GridMesh;
+
+static void grid_mesh_create(GridMesh *mesh, const int res, const unsigned int seed)
+{
+	RNG *rng = BLI_rng_new(seed);
+	int x, y, i;
+
+	mesh->totvert = res * res;
+	mesh->tottri = (res - 1) * (res - 1) * 2;
+	mesh->co = (float (*)[3])MEM_mallocN(sizeof(*mesh->co) * (size_t)mesh->totvert, __func__);
+	mesh->tris = (unsigned int (*)[3])MEM_mallocN(sizeof(*mesh->tris) * (size_t)mesh->tottri, __func__);
+
+	for (y = 0, i = 0; y < res; y++) {
+		for (x = 0; x < res; x++, i++) {
+			mesh->co[i][0] = (float)x / (float)res;
+			mesh->co[i][1] = (float)y / (float)res;
+			mesh->co[i][2] = 0.05f * BLI_rng_get_float(rng);
+		}
+	}
+
+	for (y = 0, i = 0; y < res - 1; y++) {
+		for (x = 0; x < res - 1; x++) {
+			const unsigned int v = (unsigned int)(y * res + x);
+			mesh->tris[i][0] = v;
+			mesh->tris[i][1] = v + 1;
+			mesh->tris[i][2] = v + (unsigned int)res;
+			i++;
+			mesh->tris[i][0] = v + 1;
+			mesh->tris[i][1] = v + (unsigned int)res + 1;
+			mesh->tris[i][2] = v + (unsigned int)res;
+			i++;
+		}
+	}
+
+	BLI_rng_free(rng);
+}
+
+static void grid_mesh_free(GridMesh *mesh)
+{
+	MEM_freeN(mesh->co);
+	MEM_freeN(mesh->tris);
+}
+
+static void kdop_axis_range(const char axis, int *r_start, int *r_stop)
+{
+	switch (axis) {
+		case 26: *r_start = 0; *r_stop = 13; break;
+		case 18: *r_start = 7; *r_stop = 13; break;
+		case 14: *r_start = 0; *r_stop = 7; break;
+		case 8:  *r_start = 0; *r_stop = 4; break;
+		default: *r_start = 0; *r_stop = 3; break;
+	}
+}
+
+/* bounds of every triangle along the axes, two floats (min, max) per axis */
+static float *grid_mesh_kdops(const GridMesh *mesh, const float epsilon, const char axis)
+{
+	float *bounds = (float *)MEM_mallocN(sizeof(float) * 26 * (size_t)mesh->tottri, __func__);
+	int start, stop;
+	int i, j, k;
+
+	kdop_axis_range(axis, &start, &stop);
+
+	for (i = 0; i < mesh->tottri; i++) {
+		float *bv = &bounds[i * 26];
+		for (k = start; k < stop; k++) {
+			bv[2 * k] = FLT_MAX;
+			bv[2 * k + 1] = -FLT_MAX;
+			for (j = 0; j < 3; j++) {
+				const float proj = dot_v3v3(mesh->co[mesh->tris[i][j]], kdop_axes[k]);
+				bv[2 * k] = min_ff(bv[2 * k], proj);
+				bv[2 * k + 1] = max_ff(bv[2 * k + 1], proj);
+			}
+			bv[2 * k] -= epsilon;
+			bv[2 * k + 1] += epsilon;
+		}
+	}
+	return bounds;
+}
+
+static bool kdop_overlap(const float *bv1, const float *bv2, const char axis)
+{
+	int start, stop, k;
+
+	kdop_axis_range(axis, &start, &stop);
+
+	for (k = start; k < stop; k++) {
+		if ((bv1[2 * k] > bv2[2 * k + 1]) || (bv2[2 * k] > bv1[2 * k + 1])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static BVHTree *grid_mesh_bvhtree(const GridMesh *mesh, const float epsilon, const char axis)
+{
+	BVHTree *tree = BLI_bvhtree_new(mesh->tottri, epsilon, 4, axis);
+	int i;
+
+	for (i = 0; i < mesh->tottri; i++) {
+		float co[3][3];
+		copy_v3_v3(co[0], mesh->co[mesh->tris[i][0]]);
+		copy_v3_v3(co[1], mesh->co[mesh->tris[i][1]]);
+		copy_v3_v3(co[2], mesh->co[mesh->tris[i][2]]);
+		BLI_bvhtree_insert(tree, i, co[0], 3);
+	}
+	BLI_bvhtree_balance(tree);
+	return tree;
+}
+
+/* mesh_b NULL for a self overlap, which leaves out pairs of the same triangle */
+static void overlap_brute_force_test(const GridMesh *mesh_a, const GridMesh *mesh_b, const char axis)
+{
+	const float epsilon = 0.001f;
+	const GridMesh *mesh_other = mesh_b ? mesh_b : mesh_a;
+	BVHTree *tree_a = grid_mesh_bvhtree(mesh_a, epsilon, axis);
+	BVHTree *tree_b = mesh_b ? grid_mesh_bvhtree(mesh_b, epsilon, axis) : tree_a;
+	float *bounds_a = grid_mesh_kdops(mesh_a, epsilon, axis);
+	float *bounds_b = mesh_b ? grid_mesh_kdops(mesh_b, epsilon, axis) : bounds_a;
+	char *found = (char *)MEM_callocN((size_t)mesh_a->tottri * (size_t)mesh_other->tottri, __func__);
+	BVHTreeOverlap *overlap;
+	unsigned int overlap_tot;
+	int tot_expect = 0, tot_invalid = 0, tot_duplicate = 0;
+	int i, j;
+
+	for (i = 0; i < mesh_a->tottri; i++) {
+		for (j = 0; j < mesh_other->tottri; j++) {
+			if ((mesh_b || i != j) && kdop_overlap(&bounds_a[i * 26], &bounds_b[j * 26], axis)) {
+				tot_expect++;
+			}
+		}
+	}
+
+	overlap = BLI_bvhtree_overlap(tree_a, tree_b, &overlap_tot);
+	EXPECT_LT(0, tot_expect);
+	EXPECT_EQ(tot_expect, (int)overlap_tot);
+
+	for (i = 0; i < (int)overlap_tot; i++) {
+		const int a = overlap[i].indexA, b = overlap[i].indexB;
+		char *f = &found[(size_t)a * (size_t)mesh_other->tottri + (size_t)b];
+
+		if ((!mesh_b && a == b) || !kdop_overlap(&bounds_a[a * 26], &bounds_b[b * 26], axis)) {
+			tot_invalid++;
+		}
+		if (*f) {
+			tot_duplicate++;
+		}
+		*f = 1;
+	}
+	EXPECT_EQ(0, tot_invalid);
+	EXPECT_EQ(0, tot_duplicate);
+
+	if (overlap) {
+		MEM_freeN(overlap);
+	}
+	MEM_freeN(found);
+	MEM_freeN(bounds_a);
+	BLI_bvhtree_free(tree_a);
+	if (mesh_b) {
+		MEM_freeN(bounds_b);
+		BLI_bvhtree_free(tree_b);
+	}
+}
+
+static void self_overlap_test(const int res, const char axis)
+{
+	GridMesh mesh;
+
+	BLI_threadapi_init();
+
+	grid_mesh_create(&mesh, res, 0);
+	overlap_brute_force_test(&mesh, NULL, axis);
+	grid_mesh_free(&mesh);
+
+	BLI_threadapi_exit();
+}
+
+static void two_tree_overlap_test(const int res, const char axis)
+{
+	GridMesh mesh_a, mesh_b;
+	int i;
+
+	BLI_threadapi_init();
+
+	grid_mesh_create(&mesh_a, res, 0);
+	grid_mesh_create(&mesh_b, res, 1);
+	/* half a face off, so faces overlap partially */
+	for (i = 0; i < mesh_b.totvert; i++) {
+		mesh_b.co[i][0] += 0.5f / (float)res;
+		mesh_b.co[i][1] += 0.5f / (float)res;
+	}
+
+	overlap_brute_force_test(&mesh_a, &mesh_b, axis);
+
+	grid_mesh_free(&mesh_a);
+	grid_mesh_free(&mesh_b);
+
+	BLI_threadapi_exit();
+}
+
+/* 6: three axes, one SSE test of two axes plus one scalar */
+TEST(kdopbvh, SelfOverlapKdop6)
+{
+	self_overlap_test(32, 6);
+}
+
+/* 8: four axes, only SSE tests */
+TEST(kdopbvh, SelfOverlapKdop8)
+{
+	self_overlap_test(32, 8);
+}
+
+/* 18: six axes not starting at the first one */
+TEST(kdopbvh, SelfOverlapKdop18)
+{
+	self_overlap_test(32, 18);
+}
+
+/* 26: thirteen axes */
+TEST(kdopbvh, SelfOverlapKdop26)
+{
+	self_overlap_test(32, 26);
+}
+
+/* below the threading threshold, traversed from the roots at once (in release builds) */
+TEST(kdopbvh, SelfOverlapSmall)
+{
+	self_overlap_test(8, 6);
+	self_overlap_test(8, 26);
+}
+
+TEST(kdopbvh, OverlapTwoTrees)
+{
+	two_tree_overlap_test(32, 6);
+	two_tree_overlap_test(32, 26);
+	two_tree_overlap_test(8, 8);
+}
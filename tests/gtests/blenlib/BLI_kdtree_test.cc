@@ -0,0 +1,112 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_kdtree.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+/* large enough for the tree to be balanced by multiple tasks */
+#define NUM_POINTS 50000
+#define NUM_QUERIES 2000
+#define NUM_NEAREST 8
+
+static float (*random_points(const int num, const unsigned int seed))[3]
+{
+	RNG *rng = BLI_rng_new(seed);
+	float (*co)[3] = (float (*)[3])MEM_mallocN(sizeof(*co) * (size_t)num, __func__);
+	int i;
+
+	for (i = 0; i < num; i++) {
+		co[i][0] = BLI_rng_get_float(rng);
+		co[i][1] = BLI_rng_get_float(rng);
+		co[i][2] = BLI_rng_get_float(rng);
+	}
+
+	BLI_rng_free(rng);
+	return co;
+}
+
+static bool count_in_range_cb(void *user_data, int UNUSED(index), const float UNUSED(co[3]), float UNUSED(dist_sq))
+{
+	(*(int *)user_data)++;
+	return true;
+}
+
+TEST(kdtree, BatchQueries)
+{
+	float (*points)[3] = random_points(NUM_POINTS, 0);
+	float (*queries)[3] = random_points(NUM_QUERIES, 1);
+	KDTreeNearest *nearest = (KDTreeNearest *)MEM_mallocN(sizeof(*nearest) * NUM_QUERIES, __func__);
+	KDTreeNearest *nearest_n = (KDTreeNearest *)MEM_mallocN(sizeof(*nearest_n) * NUM_QUERIES * NUM_NEAREST, __func__);
+	int *found = (int *)MEM_mallocN(sizeof(*found) * NUM_QUERIES, __func__);
+	KDTree *tree;
+	int i, j;
+
+	BLI_threadapi_init();
+
+	tree = BLI_kdtree_new(NUM_POINTS);
+	for (i = 0; i < NUM_POINTS; i++) {
+		BLI_kdtree_insert(tree, i, points[i]);
+	}
+	BLI_kdtree_balance(tree);
+
+	BLI_kdtree_find_nearest_batch(tree, queries, NUM_QUERIES, nearest, true);
+	BLI_kdtree_find_nearest_n_batch(tree, queries, NUM_QUERIES, nearest_n, found, NUM_NEAREST, true);
+
+	for (i = 0; i < NUM_QUERIES; i++) {
+		const float range = 0.05f;
+		float dist_min_sq = FLT_MAX;
+		int index_min = -1, tot_in_range = 0, tot_in_range_cb = 0;
+
+		/* brute force */
+		for (j = 0; j < NUM_POINTS; j++) {
+			const float dist_sq = len_squared_v3v3(points[j], queries[i]);
+			if (dist_sq < dist_min_sq) {
+				dist_min_sq = dist_sq;
+				index_min = j;
+			}
+			if (dist_sq <= range * range) {
+				tot_in_range++;
+			}
+		}
+
+		EXPECT_EQ(index_min, nearest[i].index);
+		EXPECT_EQ(NUM_NEAREST, found[i]);
+		EXPECT_EQ(index_min, nearest_n[i * NUM_NEAREST].index);
+		for (j = 1; j < NUM_NEAREST; j++) {
+			EXPECT_LE(nearest_n[i * NUM_NEAREST + j - 1].dist, nearest_n[i * NUM_NEAREST + j].dist);
+		}
+
+		BLI_kdtree_range_search_cb(tree, queries[i], range, count_in_range_cb, &tot_in_range_cb);
+		EXPECT_EQ(tot_in_range, tot_in_range_cb);
+	}
+
+	BLI_kdtree_free(tree);
+	MEM_freeN(points);
+	MEM_freeN(queries);
+	MEM_freeN(nearest);
+	MEM_freeN(nearest_n);
+	MEM_freeN(found);
+
+	BLI_threadapi_exit();
+}
+
+TEST(kdtree, EmptyTree)
+{
+	float co[1][3] = {{0.0f, 0.0f, 0.0f}};
+	KDTreeNearest nearest;
+	KDTree *tree = BLI_kdtree_new(0);
+
+	BLI_kdtree_balance(tree);
+	BLI_kdtree_find_nearest_batch(tree, co, 1, &nearest, false);
+	EXPECT_EQ(-1, nearest.index);
+
+	BLI_kdtree_free(tree);
+}
@@ -0,0 +1,120 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_memarena.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#define NUM_ALLOCS 1000
+
+static void memarena_fill(MemArena *arena, const int num, const size_t size, const unsigned char value)
+{
+	for (int i = 0; i < num; i++) {
+		unsigned char *ptr = (unsigned char *)BLI_memarena_alloc(arena, size);
+		memset(ptr, value, size);
+	}
+}
+
+TEST(memarena, MarkRollback)
+{
+	MemArena *arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
+	MemArenaMark mark, mark_nested;
+	void *ptr_first, *ptr;
+	unsigned int totblock;
+
+	ptr_first = BLI_memarena_alloc(arena, 16);
+	BLI_memarena_mark(arena, &mark);
+	ptr = BLI_memarena_alloc(arena, 16);
+
+	/* spills into several buffers, including one larger than the buffer size */
+	memarena_fill(arena, NUM_ALLOCS, 100, 1);
+	BLI_memarena_mark(arena, &mark_nested);
+	memarena_fill(arena, 1, BLI_MEMARENA_STD_BUFSIZE * 4, 2);
+	BLI_memarena_rollback(arena, &mark_nested);
+	BLI_memarena_rollback(arena, &mark);
+
+	EXPECT_EQ(ptr, BLI_memarena_alloc(arena, 16));
+	BLI_memarena_rollback(arena, &mark);
+
+	/* doing the same work again reuses the buffers */
+	totblock = MEM_get_memory_blocks_in_use();
+	for (int i = 0; i < 4; i++) {
+		memarena_fill(arena, NUM_ALLOCS, 100, 1);
+		BLI_memarena_rollback(arena, &mark);
+	}
+	EXPECT_EQ(totblock, MEM_get_memory_blocks_in_use());
+
+	/* rolling back to an empty arena */
+	BLI_memarena_clear(arena);
+	EXPECT_EQ(ptr_first, BLI_memarena_alloc(arena, 16));
+
+	BLI_memarena_free(arena);
+}
+
+TEST(memarena, MarkRollbackCalloc)
+{
+	MemArena *arena = BLI_memarena_new(BLI_MEMARENA_STD_BUFSIZE, __func__);
+	MemArenaMark mark;
+	int errors = 0;
+
+	BLI_memarena_use_calloc(arena);
+	BLI_memarena_mark(arena, &mark);
+
+	for (int i = 0; i < 4; i++) {
+		for (int j = 0; j < NUM_ALLOCS; j++) {
+			unsigned char *ptr = (unsigned char *)BLI_memarena_alloc(arena, 100);
+			for (int k = 0; k < 100; k++) {
+				errors += (ptr[k] != 0);
+			}
+			memset(ptr, 255, 100);
+		}
+		BLI_memarena_rollback(arena, &mark);
+	}
+
+	EXPECT_EQ(0, errors);
+	BLI_memarena_free(arena);
+}
+
+static void scratch_arena_cb(void *userdata, const int iter)
+{
+	bool *errors = (bool *)userdata;
+	MemArena *arena = BLI_thread_scratch_arena();
+	MemArenaMark mark;
+	int *values;
+
+	BLI_memarena_mark(arena, &mark);
+
+	values = (int *)BLI_memarena_alloc(arena, sizeof(int) * NUM_ALLOCS);
+	for (int i = 0; i < NUM_ALLOCS; i++) {
+		values[i] = iter;
+	}
+	for (int i = 0; i < NUM_ALLOCS; i++) {
+		if (values[i] != iter) {
+			errors[iter] = true;
+		}
+	}
+
+	BLI_memarena_rollback(arena, &mark);
+}
+
+TEST(memarena, ThreadScratch)
+{
+	bool *errors = (bool *)MEM_callocN(sizeof(bool) * NUM_ALLOCS, __func__);
+
+	BLI_threadapi_init();
+
+	EXPECT_EQ(BLI_thread_scratch_arena(), BLI_thread_scratch_arena());
+	BLI_task_parallel_range(0, NUM_ALLOCS, errors, scratch_arena_cb, true);
+	for (int i = 0; i < NUM_ALLOCS; i++) {
+		EXPECT_FALSE(errors[i]);
+	}
+	MEM_freeN(errors);
+
+	BLI_threadapi_exit();
+}
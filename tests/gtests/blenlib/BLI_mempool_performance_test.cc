@@ -0,0 +1,135 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+/* Every thread allocates a batch of elements, checks nothing else wrote into them
+ * and frees them again, so all threads hit the allocator at the same time. */
+
+#define NUM_ITERS 20000
+#define NUM_ELEMS 64
+
+typedef struct Elem {
+	int iter;
+	int index;
+	float data[6];
+} Elem;
+
+typedef struct MempoolTestData {
+	BLI_mempool *pool;
+	SpinLock lock;
+	bool use_lock;
+	bool use_malloc;
+	int errors;
+} MempoolTestData;
+
+static void mempool_test_cb(void *userdata, const int iter)
+{
+	MempoolTestData *test_data = (MempoolTestData *)userdata;
+	Elem *elems[NUM_ELEMS];
+	int errors = 0;
+	int i;
+
+	for (i = 0; i < NUM_ELEMS; i++) {
+		if (test_data->use_malloc) {
+			elems[i] = (Elem *)MEM_mallocN(sizeof(Elem), __func__);
+		}
+		else if (test_data->use_lock) {
+			BLI_spin_lock(&test_data->lock);
+			elems[i] = (Elem *)BLI_mempool_alloc(test_data->pool);
+			BLI_spin_unlock(&test_data->lock);
+		}
+		else {
+			elems[i] = (Elem *)BLI_mempool_alloc(test_data->pool);
+		}
+		elems[i]->iter = iter;
+		elems[i]->index = i;
+	}
+
+	for (i = 0; i < NUM_ELEMS; i++) {
+		if (elems[i]->iter != iter || elems[i]->index != i) {
+			errors++;
+		}
+
+		if (test_data->use_malloc) {
+			MEM_freeN(elems[i]);
+		}
+		else if (test_data->use_lock) {
+			BLI_spin_lock(&test_data->lock);
+			BLI_mempool_free(test_data->pool, elems[i]);
+			BLI_spin_unlock(&test_data->lock);
+		}
+		else {
+			BLI_mempool_free(test_data->pool, elems[i]);
+		}
+	}
+
+	if (errors) {
+		BLI_spin_lock(&test_data->lock);
+		test_data->errors += errors;
+		BLI_spin_unlock(&test_data->lock);
+	}
+}
+
+static void mempool_test_run(const unsigned int flag, const bool use_lock, const bool use_malloc,
+                             const bool use_threading)
+{
+	MempoolTestData test_data;
+
+	test_data.pool = use_malloc ? NULL : BLI_mempool_create(sizeof(Elem), 0, 512, flag);
+	test_data.use_lock = use_lock;
+	test_data.use_malloc = use_malloc;
+	test_data.errors = 0;
+	BLI_spin_init(&test_data.lock);
+
+	BLI_task_parallel_range(0, NUM_ITERS, &test_data, mempool_test_cb, use_threading);
+
+	EXPECT_EQ(0, test_data.errors);
+	if (test_data.pool) {
+		EXPECT_EQ(0, BLI_mempool_count(test_data.pool));
+		BLI_mempool_destroy(test_data.pool);
+	}
+
+	BLI_spin_end(&test_data.lock);
+}
+
+TEST(mempool, ThreadContention)
+{
+	BLI_threadapi_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	TIMEIT_START(single_thread);
+	mempool_test_run(BLI_MEMPOOL_NOP, false, false, false);
+	TIMEIT_END(single_thread);
+
+	TIMEIT_START(locked);
+	mempool_test_run(BLI_MEMPOOL_NOP, true, false, true);
+	TIMEIT_END(locked);
+
+	TIMEIT_START(threadsafe);
+	mempool_test_run(BLI_MEMPOOL_THREADSAFE, false, false, true);
+	TIMEIT_END(threadsafe);
+
+	TIMEIT_START(threadsafe_iter);
+	mempool_test_run(BLI_MEMPOOL_THREADSAFE | BLI_MEMPOOL_ALLOW_ITER, false, false, true);
+	TIMEIT_END(threadsafe_iter);
+
+	TIMEIT_START(guardedalloc);
+	mempool_test_run(BLI_MEMPOOL_NOP, false, true, true);
+	TIMEIT_END(guardedalloc);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	BLI_threadapi_exit();
+}
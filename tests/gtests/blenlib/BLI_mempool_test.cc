@@ -0,0 +1,76 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_mempool.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#define NUM_ELEMS 80000
+
+typedef struct Elem {
+	int iter;
+	int index;
+	float data[6];
+} Elem;
+
+/* Elements freed by another thread than the one allocating them
+ * end up in the wrong cache, make sure they get recycled and counted. */
+static void mempool_alloc_cb(void *userdata, const int iter)
+{
+	void **elems = (void **)userdata;
+	BLI_mempool *pool = (BLI_mempool *)elems[0];
+	elems[iter + 1] = BLI_mempool_calloc(pool);
+}
+
+static void mempool_free_cb(void *userdata, const int iter)
+{
+	void **elems = (void **)userdata;
+	BLI_mempool *pool = (BLI_mempool *)elems[0];
+	BLI_mempool_free(pool, elems[iter + 1]);
+}
+
+TEST(mempool, ThreadsafeCrossThreadFree)
+{
+	const int num = NUM_ELEMS;
+	void **elems = (void **)MEM_mallocN(sizeof(void *) * (size_t)(num + 1), __func__);
+	BLI_mempool *pool = BLI_mempool_create(sizeof(Elem), 0, 512, BLI_MEMPOOL_THREADSAFE | BLI_MEMPOOL_ALLOW_ITER);
+	BLI_mempool_iter iter;
+	int i;
+
+	BLI_threadapi_init();
+
+	elems[0] = pool;
+	for (i = 0; i < 4; i++) {
+		BLI_task_parallel_range(0, num, elems, mempool_alloc_cb, true);
+		EXPECT_EQ(num, BLI_mempool_count(pool));
+
+		/* iteration sees exactly the allocated elements */
+		{
+			int tot = 0;
+			BLI_mempool_iternew(pool, &iter);
+			while (BLI_mempool_iterstep(&iter)) {
+				tot++;
+			}
+			EXPECT_EQ(num, tot);
+		}
+
+		/* chunks are scheduled differently, so many elements are freed by another thread */
+		BLI_task_parallel_range(0, num, elems, mempool_free_cb, true);
+		EXPECT_EQ(0, BLI_mempool_count(pool));
+	}
+
+	BLI_mempool_clear(pool);
+	BLI_task_parallel_range(0, num, elems, mempool_alloc_cb, true);
+	EXPECT_EQ(num, BLI_mempool_count(pool));
+
+	BLI_mempool_destroy(pool);
+	MEM_freeN(elems);
+
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,110 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_ghash.h"
+#include "BLI_ohash.h"
+#include "BLI_rand.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+/* Compares the chained GHash with the open addressing OHash,
+ * for the pointer and integer keyed maps they are typically used for. */
+
+#define TESTCASE_SIZE 1000000
+
+#define INT_TO_PTR(_i) ((void *)(intptr_t)(_i))
+
+/* The same operations for both hashes, so timings are comparable. */
+#define HASH_BENCHMARK(_prefix, _hash, _keys, _keys_miss, _num)               \
+{                                                                             \
+	unsigned int _i;                                                          \
+	int _found = 0;                                                           \
+                                                                              \
+	TIMEIT_START(_prefix##_insert);                                           \
+	for (_i = 0; _i < _num; _i++) {                                           \
+		BLI_##_prefix##_insert(_hash, _keys[_i], INT_TO_PTR(_i));             \
+	}                                                                         \
+	TIMEIT_END(_prefix##_insert);                                             \
+                                                                              \
+	TIMEIT_START(_prefix##_lookup);                                           \
+	for (_i = 0; _i < _num; _i++) {                                           \
+		_found += BLI_##_prefix##_lookup(_hash, _keys[_i]) == INT_TO_PTR(_i); \
+	}                                                                         \
+	TIMEIT_END(_prefix##_lookup);                                             \
+	EXPECT_EQ(_num, _found);                                                  \
+                                                                              \
+	TIMEIT_START(_prefix##_lookup_miss);                                      \
+	for (_i = 0; _i < _num; _i++) {                                           \
+		_found -= BLI_##_prefix##_haskey(_hash, _keys_miss[_i]);              \
+	}                                                                         \
+	TIMEIT_END(_prefix##_lookup_miss);                                        \
+	EXPECT_EQ(_num, _found);                                                  \
+                                                                              \
+	TIMEIT_START(_prefix##_remove);                                           \
+	for (_i = 0; _i < _num; _i++) {                                           \
+		_found -= BLI_##_prefix##_remove(_hash, _keys[_i], NULL, NULL);       \
+	}                                                                         \
+	TIMEIT_END(_prefix##_remove);                                             \
+	EXPECT_EQ(0, _found);                                                     \
+} (void)0
+
+static void hash_performance_test(GHashHashFP hashfp, GHashCmpFP cmpfp,
+                                  void **keys, void **keys_miss, const unsigned int num)
+{
+	GHash *gh = BLI_ghash_new(hashfp, cmpfp, __func__);
+	OHash *oh = BLI_ohash_new(hashfp, cmpfp, __func__);
+
+	HASH_BENCHMARK(ghash, gh, keys, keys_miss, num);
+	HASH_BENCHMARK(ohash, oh, keys, keys_miss, num);
+
+	BLI_ghash_free(gh, NULL, NULL);
+	BLI_ohash_free(oh, NULL, NULL);
+}
+
+TEST(ohash, IntPerformance)
+{
+	void **keys = (void **)MEM_mallocN(sizeof(*keys) * TESTCASE_SIZE * 2, __func__);
+	RNG *rng = BLI_rng_new(0);
+	unsigned int i;
+
+	/* unique random keys, the first half is inserted, the second half is missing */
+	for (i = 0; i < TESTCASE_SIZE * 2; i++) {
+		keys[i] = INT_TO_PTR(i);
+	}
+	BLI_rng_shuffle_array(rng, keys, sizeof(*keys), TESTCASE_SIZE * 2);
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+	hash_performance_test(BLI_ghashutil_inthash_p, BLI_ghashutil_intcmp, keys, keys + TESTCASE_SIZE, TESTCASE_SIZE);
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	BLI_rng_free(rng);
+	MEM_freeN(keys);
+}
+
+TEST(ohash, PtrPerformance)
+{
+	void **keys = (void **)MEM_mallocN(sizeof(*keys) * TESTCASE_SIZE * 2, __func__);
+	float (*data)[4] = (float (*)[4])MEM_mallocN(sizeof(*data) * TESTCASE_SIZE * 2, __func__);
+	RNG *rng = BLI_rng_new(0);
+	unsigned int i;
+
+	/* pointers into an array, like element to element maps */
+	for (i = 0; i < TESTCASE_SIZE * 2; i++) {
+		keys[i] = data[i];
+	}
+	BLI_rng_shuffle_array(rng, keys, sizeof(*keys), TESTCASE_SIZE * 2);
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+	hash_performance_test(BLI_ghashutil_ptrhash, BLI_ghashutil_ptrcmp, keys, keys + TESTCASE_SIZE, TESTCASE_SIZE);
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	BLI_rng_free(rng);
+	MEM_freeN(data);
+	MEM_freeN(keys);
+}
@@ -0,0 +1,193 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_ghash.h"
+#include "BLI_ohash.h"
+#include "BLI_rand.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+#define TESTCASE_SIZE 10000
+
+#define INT_TO_PTR(_i) ((void *)(intptr_t)(_i))
+#define PTR_TO_INT(_p) ((int)(intptr_t)(_p))
+
+/* Insert tests, int keys, including zero which is stored as a NULL pointer. */
+TEST(ohash, InsertLookupInt)
+{
+	OHash *oh = BLI_ohash_int_new(__func__);
+	int i;
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		BLI_ohash_insert(oh, INT_TO_PTR(i), INT_TO_PTR(i * 2 + 1));
+	}
+
+	EXPECT_EQ(TESTCASE_SIZE, BLI_ohash_size(oh));
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		EXPECT_TRUE(BLI_ohash_haskey(oh, INT_TO_PTR(i)));
+		EXPECT_EQ(i * 2 + 1, PTR_TO_INT(BLI_ohash_lookup(oh, INT_TO_PTR(i))));
+	}
+	for (i = TESTCASE_SIZE; i < TESTCASE_SIZE * 2; i++) {
+		EXPECT_FALSE(BLI_ohash_haskey(oh, INT_TO_PTR(i)));
+		EXPECT_EQ(NULL, BLI_ohash_lookup(oh, INT_TO_PTR(i)));
+		EXPECT_EQ(INT_TO_PTR(-1), BLI_ohash_lookup_default(oh, INT_TO_PTR(i), INT_TO_PTR(-1)));
+	}
+
+	BLI_ohash_free(oh, NULL, NULL);
+}
+
+/* Pointer keys, all aligned the same way. */
+TEST(ohash, InsertLookupPtr)
+{
+	OHash *oh = BLI_ohash_ptr_new_ex(__func__, TESTCASE_SIZE);
+	double *data = (double *)MEM_mallocN(sizeof(*data) * TESTCASE_SIZE, __func__);
+	int i;
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		BLI_ohash_insert(oh, &data[i], INT_TO_PTR(i));
+	}
+
+	EXPECT_EQ(TESTCASE_SIZE, BLI_ohash_size(oh));
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		void **val_p = BLI_ohash_lookup_p(oh, &data[i]);
+		EXPECT_TRUE(val_p != NULL);
+		EXPECT_EQ(i, PTR_TO_INT(*val_p));
+	}
+
+	BLI_ohash_free(oh, NULL, NULL);
+	MEM_freeN(data);
+}
+
+/* String keys, using the comparison callback. */
+TEST(ohash, InsertLookupStr)
+{
+	OHash *oh = BLI_ohash_str_new(__func__);
+	char keys[TESTCASE_SIZE][16];
+	int i;
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		sprintf(keys[i], "key %d", i);
+		BLI_ohash_insert(oh, keys[i], INT_TO_PTR(i));
+	}
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		char key[16];
+		sprintf(key, "key %d", i);
+		EXPECT_EQ(i, PTR_TO_INT(BLI_ohash_lookup(oh, key)));
+	}
+	EXPECT_FALSE(BLI_ohash_haskey(oh, "key -1"));
+
+	BLI_ohash_free(oh, NULL, NULL);
+}
+
+/* Remove every other entry, the remaining ones must still be found after the shifting. */
+TEST(ohash, Remove)
+{
+	OHash *oh = BLI_ohash_int_new(__func__);
+	int i;
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		BLI_ohash_insert(oh, INT_TO_PTR(i), INT_TO_PTR(i));
+	}
+
+	for (i = 0; i < TESTCASE_SIZE; i += 2) {
+		EXPECT_TRUE(BLI_ohash_remove(oh, INT_TO_PTR(i), NULL, NULL));
+	}
+	EXPECT_FALSE(BLI_ohash_remove(oh, INT_TO_PTR(0), NULL, NULL));
+
+	EXPECT_EQ(TESTCASE_SIZE / 2, BLI_ohash_size(oh));
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		EXPECT_EQ((i % 2) == 1, BLI_ohash_haskey(oh, INT_TO_PTR(i)));
+	}
+
+	for (i = 1; i < TESTCASE_SIZE; i += 2) {
+		EXPECT_EQ(i, PTR_TO_INT(BLI_ohash_popkey(oh, INT_TO_PTR(i), NULL)));
+	}
+
+	EXPECT_EQ(0, BLI_ohash_size(oh));
+
+	BLI_ohash_free(oh, NULL, NULL);
+}
+
+/* Random inserts, removals and reinserts, checked against a GHash. */
+TEST(ohash, CompareGHash)
+{
+	OHash *oh = BLI_ohash_int_new(__func__);
+	GHash *gh = BLI_ghash_int_new(__func__);
+	RNG *rng = BLI_rng_new(0);
+	int i;
+
+	for (i = 0; i < TESTCASE_SIZE * 10; i++) {
+		const int key = BLI_rng_get_int(rng) % (TESTCASE_SIZE / 2);
+		const int val = BLI_rng_get_int(rng);
+
+		switch (BLI_rng_get_int(rng) % 3) {
+			case 0:
+				EXPECT_EQ(BLI_ghash_reinsert(gh, INT_TO_PTR(key), INT_TO_PTR(val), NULL, NULL),
+				          BLI_ohash_reinsert(oh, INT_TO_PTR(key), INT_TO_PTR(val), NULL, NULL));
+				break;
+			case 1:
+				EXPECT_EQ(BLI_ghash_remove(gh, INT_TO_PTR(key), NULL, NULL),
+				          BLI_ohash_remove(oh, INT_TO_PTR(key), NULL, NULL));
+				break;
+			case 2:
+				EXPECT_EQ(BLI_ghash_lookup(gh, INT_TO_PTR(key)),
+				          BLI_ohash_lookup(oh, INT_TO_PTR(key)));
+				break;
+		}
+	}
+
+	EXPECT_EQ(BLI_ghash_size(gh), BLI_ohash_size(oh));
+
+	{
+		OHashIterator ohi;
+		int count = 0;
+
+		OHASH_ITER (ohi, oh) {
+			void **val_p = BLI_ghash_lookup_p(gh, BLI_ohashIterator_getKey(&ohi));
+			EXPECT_TRUE(val_p != NULL);
+			if (val_p) {
+				EXPECT_EQ(*val_p, BLI_ohashIterator_getValue(&ohi));
+			}
+			count++;
+		}
+		EXPECT_EQ(BLI_ghash_size(gh), count);
+	}
+
+	BLI_rng_free(rng);
+	BLI_ghash_free(gh, NULL, NULL);
+	BLI_ohash_free(oh, NULL, NULL);
+}
+
+/* Clearing, and reuse afterwards. */
+TEST(ohash, Clear)
+{
+	OHash *oh = BLI_ohash_int_new(__func__);
+	OHashIterator ohi;
+	int i, count = 0;
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		BLI_ohash_insert(oh, INT_TO_PTR(i), INT_TO_PTR(i));
+	}
+
+	BLI_ohash_clear_ex(oh, NULL, NULL, 16);
+	EXPECT_EQ(0, BLI_ohash_size(oh));
+	EXPECT_FALSE(BLI_ohash_haskey(oh, INT_TO_PTR(1)));
+
+	OHASH_ITER (ohi, oh) {
+		count++;
+	}
+	EXPECT_EQ(0, count);
+
+	BLI_ohash_insert(oh, INT_TO_PTR(1), INT_TO_PTR(2));
+	EXPECT_EQ(2, PTR_TO_INT(BLI_ohash_lookup(oh, INT_TO_PTR(1))));
+
+	BLI_ohash_free(oh, NULL, NULL);
+}
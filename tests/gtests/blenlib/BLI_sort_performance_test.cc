@@ -0,0 +1,77 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_sort.h"
+#include "BLI_sort_utils.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+/* Sorting depth values with an index, as done for transparency sorting. */
+
+#define TESTCASE_SIZE 4000000
+
+static int cmp_float_r(const void *a, const void *b, void *UNUSED(thunk))
+{
+	return BLI_sortutil_cmp_float(a, b);
+}
+
+TEST(sort, FloatIndexPerformance)
+{
+	RNG *rng = BLI_rng_new(0);
+	SortIntByFloat *pairs = (SortIntByFloat *)MEM_mallocN(sizeof(*pairs) * TESTCASE_SIZE, __func__);
+	SortIntByFloat *pairs_orig = (SortIntByFloat *)MEM_mallocN(sizeof(*pairs) * TESTCASE_SIZE, __func__);
+	float *keys = (float *)MEM_mallocN(sizeof(*keys) * TESTCASE_SIZE, __func__);
+	int *index = (int *)MEM_mallocN(sizeof(*index) * TESTCASE_SIZE, __func__);
+	int i;
+
+	BLI_threadapi_init();
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		pairs_orig[i].sort_value = BLI_rng_get_float(rng) * 100.0f;
+		pairs_orig[i].data = i;
+	}
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	memcpy(pairs, pairs_orig, sizeof(*pairs) * TESTCASE_SIZE);
+	TIMEIT_START(qsort);
+	qsort(pairs, TESTCASE_SIZE, sizeof(*pairs), BLI_sortutil_cmp_float);
+	TIMEIT_END(qsort);
+
+	memcpy(pairs, pairs_orig, sizeof(*pairs) * TESTCASE_SIZE);
+	TIMEIT_START(mergesort);
+	BLI_mergesort_r(pairs, TESTCASE_SIZE, sizeof(*pairs), cmp_float_r, NULL);
+	TIMEIT_END(mergesort);
+
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		keys[i] = pairs_orig[i].sort_value;
+		index[i] = i;
+	}
+	TIMEIT_START(radixsort);
+	BLI_radixsort_float(keys, index, TESTCASE_SIZE);
+	TIMEIT_END(radixsort);
+
+	/* both are stable, so the results are identical */
+	for (i = 0; i < TESTCASE_SIZE; i++) {
+		EXPECT_EQ(pairs[i].data, index[i]);
+	}
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	MEM_freeN(pairs);
+	MEM_freeN(pairs_orig);
+	MEM_freeN(keys);
+	MEM_freeN(index);
+	BLI_rng_free(rng);
+
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,147 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_math.h"
+#include "BLI_rand.h"
+#include "BLI_sort.h"
+#include "BLI_sort_utils.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+}
+
+/* sizes below and above the threading thresholds */
+static const int sort_sizes[] = {0, 1, 2, 17, 1000, 100003};
+
+/* few distinct keys, so stability is tested */
+#define KEY_RANGE 64
+
+static int cmp_sort_int_by_int(const void *a_, const void *b_, void *UNUSED(thunk))
+{
+	const SortIntByInt *a = (const SortIntByInt *)a_;
+	const SortIntByInt *b = (const SortIntByInt *)b_;
+	return (a->sort_value > b->sort_value) - (a->sort_value < b->sort_value);
+}
+
+TEST(sort, MergeSortStable)
+{
+	RNG *rng = BLI_rng_new(0);
+	int s, i;
+
+	BLI_threadapi_init();
+
+	for (s = 0; s < (int)ARRAY_SIZE(sort_sizes); s++) {
+		const int n = sort_sizes[s];
+		SortIntByInt *data = (SortIntByInt *)MEM_mallocN(sizeof(*data) * (size_t)max_ii(n, 1), __func__);
+
+		for (i = 0; i < n; i++) {
+			data[i].sort_value = (int)(BLI_rng_get_uint(rng) % KEY_RANGE);
+			data[i].data = i;
+		}
+
+		BLI_mergesort_r(data, (size_t)n, sizeof(*data), cmp_sort_int_by_int, NULL);
+
+		for (i = 1; i < n; i++) {
+			EXPECT_LE(data[i - 1].sort_value, data[i].sort_value);
+			if (data[i - 1].sort_value == data[i].sort_value) {
+				EXPECT_LT(data[i - 1].data, data[i].data);
+			}
+		}
+
+		MEM_freeN(data);
+	}
+
+	BLI_rng_free(rng);
+
+	BLI_threadapi_exit();
+}
+
+TEST(sort, RadixSortInt)
+{
+	RNG *rng = BLI_rng_new(1);
+	int s, i;
+
+	BLI_threadapi_init();
+
+	for (s = 0; s < (int)ARRAY_SIZE(sort_sizes); s++) {
+		const int n = sort_sizes[s];
+		int *keys = (int *)MEM_mallocN(sizeof(*keys) * (size_t)max_ii(n, 1), __func__);
+		int *keys_orig = (int *)MEM_mallocN(sizeof(*keys) * (size_t)max_ii(n, 1), __func__);
+		int *index = (int *)MEM_mallocN(sizeof(*index) * (size_t)max_ii(n, 1), __func__);
+
+		for (i = 0; i < n; i++) {
+			/* mix of small and large, negative and positive keys */
+			keys[i] = (i % 2) ? (int)BLI_rng_get_uint(rng) : (int)(BLI_rng_get_uint(rng) % KEY_RANGE) - KEY_RANGE / 2;
+			keys_orig[i] = keys[i];
+			index[i] = i;
+		}
+
+		BLI_radixsort_int(keys, index, (size_t)n);
+
+		for (i = 0; i < n; i++) {
+			EXPECT_EQ(keys_orig[index[i]], keys[i]);
+		}
+		for (i = 1; i < n; i++) {
+			EXPECT_LE(keys[i - 1], keys[i]);
+			if (keys[i - 1] == keys[i]) {
+				EXPECT_LT(index[i - 1], index[i]);
+			}
+		}
+
+		MEM_freeN(keys);
+		MEM_freeN(keys_orig);
+		MEM_freeN(index);
+	}
+
+	BLI_rng_free(rng);
+
+	BLI_threadapi_exit();
+}
+
+TEST(sort, RadixSortFloat)
+{
+	RNG *rng = BLI_rng_new(2);
+	int s, i;
+
+	BLI_threadapi_init();
+
+	for (s = 0; s < (int)ARRAY_SIZE(sort_sizes); s++) {
+		const int n = sort_sizes[s];
+		float *keys = (float *)MEM_mallocN(sizeof(*keys) * (size_t)max_ii(n, 1), __func__);
+		float *keys_orig = (float *)MEM_mallocN(sizeof(*keys) * (size_t)max_ii(n, 1), __func__);
+		int *index = (int *)MEM_mallocN(sizeof(*index) * (size_t)max_ii(n, 1), __func__);
+
+		for (i = 0; i < n; i++) {
+			keys[i] = (BLI_rng_get_float(rng) - 0.5f) * ((i % 3) ? 1e6f : 1.0f);
+			keys_orig[i] = keys[i];
+			index[i] = i;
+		}
+
+		BLI_radixsort_float(keys, index, (size_t)n);
+
+		for (i = 0; i < n; i++) {
+			EXPECT_EQ(keys_orig[index[i]], keys[i]);
+		}
+		for (i = 1; i < n; i++) {
+			EXPECT_LE(keys[i - 1], keys[i]);
+		}
+
+		/* keys only */
+		memcpy(keys, keys_orig, sizeof(*keys) * (size_t)n);
+		BLI_radixsort_float(keys, NULL, (size_t)n);
+		for (i = 1; i < n; i++) {
+			EXPECT_LE(keys[i - 1], keys[i]);
+		}
+
+		MEM_freeN(keys);
+		MEM_freeN(keys_orig);
+		MEM_freeN(index);
+	}
+
+	BLI_rng_free(rng);
+
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,187 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+#include <string.h>
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_task.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+};
+
+#define NUM_ITEMS 10000
+
+typedef struct RangeSumChunk {
+	int sum;
+	int count;
+} RangeSumChunk;
+
+typedef struct RangeSumData {
+	int *data;
+	int sum;
+	int count;
+} RangeSumData;
+
+static void task_range_fill_cb(void *userdata, const int iter)
+{
+	int *data = (int *)userdata;
+	data[iter] += iter;
+}
+
+static void task_range_sum_cb(void *userdata, void *userdata_chunk, const int iter, const int UNUSED(thread_id))
+{
+	RangeSumData *range_data = (RangeSumData *)userdata;
+	RangeSumChunk *chunk = (RangeSumChunk *)userdata_chunk;
+
+	chunk->sum += range_data->data[iter];
+	chunk->count++;
+}
+
+static void task_range_sum_finalize(void *userdata, void *userdata_chunk)
+{
+	RangeSumData *range_data = (RangeSumData *)userdata;
+	RangeSumChunk *chunk = (RangeSumChunk *)userdata_chunk;
+
+	range_data->sum += chunk->sum;
+	range_data->count += chunk->count;
+}
+
+static void task_range_test_fill(const bool use_threading)
+{
+	int *data = (int *)MEM_callocN(sizeof(int) * NUM_ITEMS, __func__);
+	int i;
+
+	BLI_task_parallel_range(0, NUM_ITEMS, data, task_range_fill_cb, use_threading);
+
+	/* every index is visited exactly once */
+	for (i = 0; i < NUM_ITEMS; i++) {
+		EXPECT_EQ(i, data[i]);
+	}
+
+	MEM_freeN(data);
+}
+
+static void task_range_test_sum(const bool use_threading, const bool use_dynamic_scheduling)
+{
+	RangeSumData range_data;
+	RangeSumChunk chunk = {0, 0};
+	int i, expected_sum = 0;
+
+	range_data.data = (int *)MEM_mallocN(sizeof(int) * NUM_ITEMS, __func__);
+	range_data.sum = 0;
+	range_data.count = 0;
+
+	for (i = 0; i < NUM_ITEMS; i++) {
+		range_data.data[i] = i % 7;
+		expected_sum += i % 7;
+	}
+
+	BLI_task_parallel_range_ex(0, NUM_ITEMS, &range_data, &chunk, sizeof(chunk),
+	                           task_range_sum_cb, task_range_sum_finalize,
+	                           use_threading, use_dynamic_scheduling);
+
+	EXPECT_EQ(expected_sum, range_data.sum);
+	EXPECT_EQ(NUM_ITEMS, range_data.count);
+	/* the chunk passed in is only used as initial value */
+	EXPECT_EQ(0, chunk.sum);
+
+	MEM_freeN(range_data.data);
+}
+
+TEST(task, ParallelRangeSingleThread)
+{
+	BLI_threadapi_init();
+	task_range_test_fill(false);
+	task_range_test_sum(false, false);
+	BLI_threadapi_exit();
+}
+
+TEST(task, ParallelRange)
+{
+	BLI_threadapi_init();
+	task_range_test_fill(true);
+	task_range_test_sum(true, false);
+	BLI_threadapi_exit();
+}
+
+TEST(task, ParallelRangeDynamic)
+{
+	BLI_threadapi_init();
+	task_range_test_sum(true, true);
+	BLI_threadapi_exit();
+}
+
+TEST(task, ParallelRangeEmpty)
+{
+	BLI_threadapi_init();
+	BLI_task_parallel_range(5, 5, NULL, task_range_fill_cb, true);
+	BLI_threadapi_exit();
+}
+
+/* A task running on the worker pushes tasks of another pool below and on top
+ * of the ones it waits for, they have to be reached through the other tasks. */
+
+#define NUM_NESTED_TASKS 100
+
+typedef struct NestedPoolsData {
+	TaskScheduler *scheduler;
+	volatile bool started;
+	size_t done;
+} NestedPoolsData;
+
+static void task_nested_empty_cb(TaskPool *UNUSED(pool), void *UNUSED(taskdata), int UNUSED(threadid))
+{
+}
+
+static void task_nested_outer_cb(TaskPool *pool, void *UNUSED(taskdata), int UNUSED(threadid))
+{
+	NestedPoolsData *data = (NestedPoolsData *)BLI_task_pool_userdata(pool);
+	TaskPool *wait_pool = BLI_task_pool_create(data->scheduler, NULL);
+	TaskPool *other_pool = BLI_task_pool_create(data->scheduler, NULL);
+	int i;
+
+	data->started = true;
+
+	BLI_task_pool_push(other_pool, task_nested_empty_cb, NULL, false, TASK_PRIORITY_LOW);
+	for (i = 0; i < NUM_NESTED_TASKS; i++) {
+		BLI_task_pool_push(wait_pool, task_nested_empty_cb, NULL, false, TASK_PRIORITY_LOW);
+	}
+	BLI_task_pool_push(other_pool, task_nested_empty_cb, NULL, false, TASK_PRIORITY_LOW);
+
+	BLI_task_pool_work_and_wait(wait_pool);
+	data->done = BLI_task_pool_tasks_done(wait_pool);
+	BLI_task_pool_work_and_wait(other_pool);
+
+	BLI_task_pool_free(wait_pool);
+	BLI_task_pool_free(other_pool);
+}
+
+TEST(task, NestedPools)
+{
+	NestedPoolsData data;
+	TaskPool *pool;
+
+	BLI_threadapi_init();
+
+	/* a single worker, the main thread only waits for the outer task */
+	data.scheduler = BLI_task_scheduler_create(2);
+	data.started = false;
+	data.done = 0;
+
+	pool = BLI_task_pool_create(data.scheduler, &data);
+	BLI_task_pool_push(pool, task_nested_outer_cb, NULL, false, TASK_PRIORITY_LOW);
+	while (!data.started) {
+		PIL_sleep_ms(1);
+	}
+	BLI_task_pool_work_and_wait(pool);
+	BLI_task_pool_free(pool);
+
+	EXPECT_EQ((size_t)NUM_NESTED_TASKS, data.done);
+
+	BLI_task_scheduler_free(data.scheduler);
+	BLI_threadapi_exit();
+}
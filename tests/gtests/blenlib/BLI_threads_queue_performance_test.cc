@@ -0,0 +1,151 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time_utildefines.h"
+}
+
+/* Producers push numbered work items, consumers pop them until they get NULL
+ * after the queue is told not to wait anymore. Every item must arrive exactly once. */
+
+#define NUM_PRODUCERS 4
+#define NUM_CONSUMERS 4
+#define NUM_ITEMS_PER_PRODUCER 200000
+
+typedef struct QueueTestData {
+	ThreadQueue *thread_queue;
+	LockfreeQueue *lockfree_queue;
+	char *received;
+	int producer;
+} QueueTestData;
+
+typedef struct QueueTestThread {
+	QueueTestData *test_data;
+	int index;
+} QueueTestThread;
+
+static void *producer_cb(void *arg)
+{
+	QueueTestThread *thread = (QueueTestThread *)arg;
+	QueueTestData *test_data = thread->test_data;
+	const intptr_t offset = (intptr_t)thread->index * NUM_ITEMS_PER_PRODUCER;
+	intptr_t i;
+
+	for (i = 0; i < NUM_ITEMS_PER_PRODUCER; i++) {
+		/* +1 so no item is NULL */
+		void *work = (void *)(offset + i + 1);
+		if (test_data->thread_queue) {
+			BLI_thread_queue_push(test_data->thread_queue, work);
+		}
+		else {
+			BLI_lockfree_queue_push(test_data->lockfree_queue, work);
+		}
+	}
+
+	return NULL;
+}
+
+static void *consumer_cb(void *arg)
+{
+	QueueTestThread *thread = (QueueTestThread *)arg;
+	QueueTestData *test_data = thread->test_data;
+	void *work;
+
+	for (;;) {
+		if (test_data->thread_queue) {
+			work = BLI_thread_queue_pop(test_data->thread_queue);
+		}
+		else if (!BLI_lockfree_queue_pop(test_data->lockfree_queue, &work, -1)) {
+			work = NULL;
+		}
+
+		if (work == NULL) {
+			break;
+		}
+		test_data->received[(intptr_t)work - 1]++;
+	}
+
+	return NULL;
+}
+
+static void queue_test_run(QueueTestData *test_data)
+{
+	const int tot = NUM_PRODUCERS * NUM_ITEMS_PER_PRODUCER;
+	pthread_t producers[NUM_PRODUCERS], consumers[NUM_CONSUMERS];
+	QueueTestThread producer_data[NUM_PRODUCERS], consumer_data[NUM_CONSUMERS];
+	int i, errors = 0;
+
+	test_data->received = (char *)MEM_callocN((size_t)tot, __func__);
+
+	for (i = 0; i < NUM_CONSUMERS; i++) {
+		consumer_data[i].test_data = test_data;
+		consumer_data[i].index = i;
+		pthread_create(&consumers[i], NULL, consumer_cb, &consumer_data[i]);
+	}
+	for (i = 0; i < NUM_PRODUCERS; i++) {
+		producer_data[i].test_data = test_data;
+		producer_data[i].index = i;
+		pthread_create(&producers[i], NULL, producer_cb, &producer_data[i]);
+	}
+
+	for (i = 0; i < NUM_PRODUCERS; i++) {
+		pthread_join(producers[i], NULL);
+	}
+
+	/* consumers drain what is left, then stop */
+	if (test_data->thread_queue) {
+		BLI_thread_queue_wait_finish(test_data->thread_queue);
+		BLI_thread_queue_nowait(test_data->thread_queue);
+	}
+	else {
+		BLI_lockfree_queue_nowait(test_data->lockfree_queue);
+	}
+
+	for (i = 0; i < NUM_CONSUMERS; i++) {
+		pthread_join(consumers[i], NULL);
+	}
+
+	for (i = 0; i < tot; i++) {
+		if (test_data->received[i] != 1) {
+			errors++;
+		}
+	}
+	EXPECT_EQ(0, errors);
+
+	MEM_freeN(test_data->received);
+}
+
+TEST(threads, QueuePerformance)
+{
+	QueueTestData test_data = {NULL};
+
+	BLI_threadapi_init();
+
+	printf("\n========== STARTING %s ==========\n", __func__);
+
+	test_data.thread_queue = BLI_thread_queue_init();
+	TIMEIT_START(thread_queue);
+	queue_test_run(&test_data);
+	TIMEIT_END(thread_queue);
+	EXPECT_EQ(0, BLI_thread_queue_size(test_data.thread_queue));
+	BLI_thread_queue_free(test_data.thread_queue);
+	test_data.thread_queue = NULL;
+
+	/* small ring, so producers have to wait for space */
+	test_data.lockfree_queue = BLI_lockfree_queue_init(256);
+	TIMEIT_START(lockfree_queue);
+	queue_test_run(&test_data);
+	TIMEIT_END(lockfree_queue);
+	EXPECT_EQ(0, BLI_lockfree_queue_size(test_data.lockfree_queue));
+	BLI_lockfree_queue_free(test_data.lockfree_queue);
+
+	printf("========== ENDED %s ==========\n\n", __func__);
+
+	BLI_threadapi_exit();
+}
@@ -0,0 +1,370 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+extern "C" {
+#include "BLI_utildefines.h"
+#include "BLI_threads.h"
+
+#include "MEM_guardedalloc.h"
+
+#include "PIL_time.h"
+}
+
+/* ThreadQueue keeps up to 1024 items in its ring, more go to the overflow queue. */
+#define RING_SIZE 1024
+
+/* Work items are numbered from 1, so none of them is NULL. */
+#define WORK(i) ((void *)(intptr_t)(i))
+#define WORK_INDEX(work) ((intptr_t)(work))
+
+TEST(threads, LockfreeQueueOrder)
+{
+	LockfreeQueue *queue = BLI_lockfree_queue_init(5);
+	void *work;
+	intptr_t i;
+
+	/* rounded up to 8 */
+	for (i = 1; i <= 8; i++) {
+		EXPECT_TRUE(BLI_lockfree_queue_try_push(queue, WORK(i)));
+	}
+	EXPECT_FALSE(BLI_lockfree_queue_try_push(queue, WORK(i)));
+	EXPECT_EQ(8, BLI_lockfree_queue_size(queue));
+
+	for (i = 1; i <= 8; i++) {
+		EXPECT_TRUE(BLI_lockfree_queue_try_pop(queue, &work));
+		EXPECT_EQ(i, WORK_INDEX(work));
+	}
+	EXPECT_FALSE(BLI_lockfree_queue_try_pop(queue, &work));
+
+	/* times out when empty */
+	EXPECT_FALSE(BLI_lockfree_queue_pop(queue, &work, 10));
+
+	BLI_lockfree_queue_free(queue);
+}
+
+/* Push and pop a few items at a time, so the positions go around the ring many times
+ * and the cells get reused with every fill level. */
+TEST(threads, LockfreeQueueWraparound)
+{
+	LockfreeQueue *queue = BLI_lockfree_queue_init(4);
+	intptr_t push_index = 1, pop_index = 1;
+	void *work;
+	int round, i;
+
+	for (round = 0; round < 1000; round++) {
+		const int num = 1 + round % 4;
+
+		for (i = 0; i < num; i++) {
+			EXPECT_TRUE(BLI_lockfree_queue_try_push(queue, WORK(push_index++)));
+		}
+		if (num == 4) {
+			EXPECT_FALSE(BLI_lockfree_queue_try_push(queue, WORK(push_index)));
+		}
+		EXPECT_EQ(num, BLI_lockfree_queue_size(queue));
+
+		for (i = 0; i < num; i++) {
+			EXPECT_TRUE(BLI_lockfree_queue_try_pop(queue, &work));
+			EXPECT_EQ(pop_index++, WORK_INDEX(work));
+		}
+		EXPECT_FALSE(BLI_lockfree_queue_try_pop(queue, &work));
+	}
+
+	EXPECT_EQ(push_index, pop_index);
+	EXPECT_EQ(0, BLI_lockfree_queue_size(queue));
+
+	BLI_lockfree_queue_free(queue);
+}
+
+/* Fill the ring and the overflow, then drain it, several times with different amounts.
+ * The order must be kept while items move from the overflow into the ring. */
+TEST(threads, ThreadQueueOverflow)
+{
+	const int push_num[] = {RING_SIZE * 3, RING_SIZE / 2, RING_SIZE + 1, RING_SIZE * 2, 1};
+	const int pop_num[] = {RING_SIZE * 2, RING_SIZE, RING_SIZE + 2, RING_SIZE, RING_SIZE * 3 / 2};
+	ThreadQueue *queue = BLI_thread_queue_init();
+	intptr_t push_index = 1, pop_index = 1;
+	int round, i;
+
+	for (round = 0; round < (int)ARRAY_SIZE(push_num); round++) {
+		for (i = 0; i < push_num[round]; i++) {
+			BLI_thread_queue_push(queue, WORK(push_index++));
+		}
+		EXPECT_EQ(push_index - pop_index, BLI_thread_queue_size(queue));
+
+		for (i = 0; i < pop_num[round]; i++) {
+			EXPECT_EQ(pop_index++, WORK_INDEX(BLI_thread_queue_pop(queue)));
+		}
+		EXPECT_EQ(push_index - pop_index, BLI_thread_queue_size(queue));
+	}
+
+	EXPECT_EQ(push_index, pop_index);
+	EXPECT_EQ(NULL, BLI_thread_queue_pop_timeout(queue, 0));
+
+	BLI_thread_queue_free(queue);
+}
+
+/* Multiple producers and consumers */
+
+#define NUM_PRODUCERS 4
+#define NUM_CONSUMERS 4
+#define NUM_ITEMS_PER_PRODUCER 20000
+
+typedef struct QueueTestData {
+	ThreadQueue *thread_queue;
+	LockfreeQueue *lockfree_queue;
+	/* how often every item was popped */
+	char *received;
+	/* items of the same producer must be popped in order by every consumer */
+	int order_errors;
+	SpinLock lock;
+} QueueTestData;
+
+typedef struct QueueTestThread {
+	QueueTestData *test_data;
+	int index;
+} QueueTestThread;
+
+static void *producer_cb(void *arg)
+{
+	QueueTestThread *thread = (QueueTestThread *)arg;
+	QueueTestData *test_data = thread->test_data;
+	const intptr_t offset = (intptr_t)thread->index * NUM_ITEMS_PER_PRODUCER;
+	intptr_t i;
+
+	for (i = 0; i < NUM_ITEMS_PER_PRODUCER; i++) {
+		if (test_data->thread_queue) {
+			BLI_thread_queue_push(test_data->thread_queue, WORK(offset + i + 1));
+		}
+		else {
+			BLI_lockfree_queue_push(test_data->lockfree_queue, WORK(offset + i + 1));
+		}
+	}
+
+	return NULL;
+}
+
+static void *consumer_cb(void *arg)
+{
+	QueueTestThread *thread = (QueueTestThread *)arg;
+	QueueTestData *test_data = thread->test_data;
+	intptr_t last[NUM_PRODUCERS];
+	int order_errors = 0;
+	void *work;
+	int i;
+
+	for (i = 0; i < NUM_PRODUCERS; i++) {
+		last[i] = -1;
+	}
+
+	for (;;) {
+		intptr_t index;
+
+		if (test_data->thread_queue) {
+			work = BLI_thread_queue_pop(test_data->thread_queue);
+		}
+		else if (!BLI_lockfree_queue_pop(test_data->lockfree_queue, &work, -1)) {
+			work = NULL;
+		}
+
+		if (work == NULL) {
+			break;
+		}
+
+		index = WORK_INDEX(work) - 1;
+		test_data->received[index]++;
+
+		if (index <= last[index / NUM_ITEMS_PER_PRODUCER]) {
+			order_errors++;
+		}
+		last[index / NUM_ITEMS_PER_PRODUCER] = index;
+	}
+
+	BLI_spin_lock(&test_data->lock);
+	test_data->order_errors += order_errors;
+	BLI_spin_unlock(&test_data->lock);
+
+	return NULL;
+}
+
+static void queue_test_run(QueueTestData *test_data, const int num_producers, const int num_consumers)
+{
+	const int tot = num_producers * NUM_ITEMS_PER_PRODUCER;
+	pthread_t producers[NUM_PRODUCERS], consumers[NUM_CONSUMERS];
+	QueueTestThread producer_data[NUM_PRODUCERS], consumer_data[NUM_CONSUMERS];
+	int i, errors = 0;
+
+	test_data->received = (char *)MEM_callocN((size_t)tot, __func__);
+	test_data->order_errors = 0;
+	BLI_spin_init(&test_data->lock);
+
+	for (i = 0; i < num_consumers; i++) {
+		consumer_data[i].test_data = test_data;
+		consumer_data[i].index = i;
+		pthread_create(&consumers[i], NULL, consumer_cb, &consumer_data[i]);
+	}
+	for (i = 0; i < num_producers; i++) {
+		producer_data[i].test_data = test_data;
+		producer_data[i].index = i;
+		pthread_create(&producers[i], NULL, producer_cb, &producer_data[i]);
+	}
+
+	for (i = 0; i < num_producers; i++) {
+		pthread_join(producers[i], NULL);
+	}
+
+	/* consumers drain what is left, then stop */
+	if (test_data->thread_queue) {
+		BLI_thread_queue_wait_finish(test_data->thread_queue);
+		EXPECT_EQ(0, BLI_thread_queue_size(test_data->thread_queue));
+		BLI_thread_queue_nowait(test_data->thread_queue);
+	}
+	else {
+		BLI_lockfree_queue_nowait(test_data->lockfree_queue);
+	}
+
+	for (i = 0; i < num_consumers; i++) {
+		pthread_join(consumers[i], NULL);
+	}
+
+	for (i = 0; i < tot; i++) {
+		if (test_data->received[i] != 1) {
+			errors++;
+		}
+	}
+	EXPECT_EQ(0, errors);
+	EXPECT_EQ(0, test_data->order_errors);
+
+	BLI_spin_end(&test_data->lock);
+	MEM_freeN(test_data->received);
+}
+
+/* Producers usually get ahead of the consumers, so work also goes through the overflow. */
+TEST(threads, ThreadQueueProducersConsumers)
+{
+	QueueTestData test_data = {NULL};
+
+	BLI_threadapi_init();
+
+	/* nowait stops the consumers for good, use a new queue for every run */
+	test_data.thread_queue = BLI_thread_queue_init();
+	queue_test_run(&test_data, NUM_PRODUCERS, NUM_CONSUMERS);
+	BLI_thread_queue_free(test_data.thread_queue);
+
+	test_data.thread_queue = BLI_thread_queue_init();
+	queue_test_run(&test_data, 1, NUM_CONSUMERS);
+	BLI_thread_queue_free(test_data.thread_queue);
+
+	test_data.thread_queue = BLI_thread_queue_init();
+	queue_test_run(&test_data, NUM_PRODUCERS, 1);
+	BLI_thread_queue_free(test_data.thread_queue);
+
+	BLI_threadapi_exit();
+}
+
+/* A small ring, so producers wait for space and all cells are reused from many threads. */
+TEST(threads, LockfreeQueueProducersConsumers)
+{
+	QueueTestData test_data = {NULL};
+
+	BLI_threadapi_init();
+
+	test_data.lockfree_queue = BLI_lockfree_queue_init(16);
+	queue_test_run(&test_data, NUM_PRODUCERS, NUM_CONSUMERS);
+	EXPECT_EQ(0, BLI_lockfree_queue_size(test_data.lockfree_queue));
+	BLI_lockfree_queue_free(test_data.lockfree_queue);
+
+	BLI_threadapi_exit();
+}
+
+/* wait_finish returns only once all work is popped, including the overflow. */
+TEST(threads, ThreadQueueWaitFinish)
+{
+	QueueTestData test_data = {NULL};
+	pthread_t consumer;
+	QueueTestThread consumer_data;
+	const int tot = RING_SIZE + 100;
+	int i, errors = 0;
+
+	test_data.thread_queue = BLI_thread_queue_init();
+	test_data.received = (char *)MEM_callocN((size_t)tot, __func__);
+	BLI_spin_init(&test_data.lock);
+
+	/* fill the overflow before the consumer starts */
+	for (i = 0; i < tot; i++) {
+		BLI_thread_queue_push(test_data.thread_queue, WORK(i + 1));
+	}
+	EXPECT_EQ(tot, BLI_thread_queue_size(test_data.thread_queue));
+
+	consumer_data.test_data = &test_data;
+	consumer_data.index = 0;
+	pthread_create(&consumer, NULL, consumer_cb, &consumer_data);
+
+	BLI_thread_queue_wait_finish(test_data.thread_queue);
+	EXPECT_EQ(0, BLI_thread_queue_size(test_data.thread_queue));
+
+	/* the last item may still be recorded, wait until the consumer stops */
+	BLI_thread_queue_nowait(test_data.thread_queue);
+	pthread_join(consumer, NULL);
+
+	for (i = 0; i < tot; i++) {
+		if (test_data.received[i] != 1) {
+			errors++;
+		}
+	}
+	EXPECT_EQ(0, errors);
+	EXPECT_EQ(0, test_data.order_errors);
+
+	/* nothing to wait for on an empty queue */
+	BLI_thread_queue_wait_finish(test_data.thread_queue);
+
+	BLI_spin_end(&test_data.lock);
+	MEM_freeN(test_data.received);
+	BLI_thread_queue_free(test_data.thread_queue);
+}
+
+/* nowait releases consumers blocked on an empty queue, pops after it still return work. */
+TEST(threads, ThreadQueueNowait)
+{
+	ThreadQueue *queue = BLI_thread_queue_init();
+	QueueTestData test_data = {NULL};
+	pthread_t consumers[NUM_CONSUMERS];
+	QueueTestThread consumer_data[NUM_CONSUMERS];
+	int i;
+
+	test_data.thread_queue = queue;
+	test_data.received = (char *)MEM_callocN(1, __func__);
+	BLI_spin_init(&test_data.lock);
+
+	/* times out when empty */
+	EXPECT_EQ(NULL, BLI_thread_queue_pop_timeout(queue, 10));
+
+	for (i = 0; i < NUM_CONSUMERS; i++) {
+		consumer_data[i].test_data = &test_data;
+		consumer_data[i].index = i;
+		pthread_create(&consumers[i], NULL, consumer_cb, &consumer_data[i]);
+	}
+
+	/* let the consumers block */
+	PIL_sleep_ms(50);
+	BLI_thread_queue_nowait(queue);
+
+	for (i = 0; i < NUM_CONSUMERS; i++) {
+		pthread_join(consumers[i], NULL);
+	}
+	EXPECT_EQ(0, test_data.received[0]);
+
+	/* work pushed after nowait is still popped, then pops return right away */
+	for (i = 0; i < RING_SIZE + 10; i++) {
+		BLI_thread_queue_push(queue, WORK(i + 1));
+	}
+	for (i = 0; i < RING_SIZE + 10; i++) {
+		EXPECT_EQ(i + 1, WORK_INDEX(BLI_thread_queue_pop(queue)));
+	}
+	EXPECT_EQ(NULL, BLI_thread_queue_pop(queue));
+	EXPECT_EQ(0, BLI_thread_queue_size(queue));
+
+	BLI_spin_end(&test_data.lock);
+	MEM_freeN(test_data.received);
+	BLI_thread_queue_free(queue);
+}
@@ -0,0 +1,154 @@
+/* Apache License, Version 2.0 */
+
+#include "testing/testing.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "MEM_guardedalloc.h"
+
+/* Counters and caches of the lockfree allocator are per thread, make sure they
+ * still add up when blocks are allocated and freed from different threads. */
+
+#define NUM_THREADS 8
+#define NUM_BLOCKS 10000
+
+namespace {
+
+struct ThreadData {
+	void **blocks;
+	int offset;
+	bool use_calloc;
+	int errors;
+};
+
+void *AllocThread(void *arg)
+{
+	ThreadData *data = (ThreadData *)arg;
+
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		/* mix of small cached sizes and larger blocks */
+		const size_t len = (size_t)((i * 7) % 300);
+		unsigned char *block;
+
+		if (data->use_calloc) {
+			block = (unsigned char *)MEM_callocN(len + 1, "test");
+			for (size_t j = 0; j < len + 1; j++) {
+				if (block[j] != 0) {
+					data->errors++;
+					break;
+				}
+			}
+		}
+		else {
+			block = (unsigned char *)MEM_mallocN(len + 1, "test");
+		}
+		block[len] = (unsigned char)i;
+		data->blocks[data->offset + i] = block;
+	}
+
+	MEM_thread_exit();
+
+	return NULL;
+}
+
+void *FreeThread(void *arg)
+{
+	ThreadData *data = (ThreadData *)arg;
+
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		unsigned char *block = (unsigned char *)data->blocks[data->offset + i];
+		const size_t len = MEM_allocN_len(block);
+
+		if (len < (size_t)((i * 7) % 300) + 1 || block[(i * 7) % 300] != (unsigned char)i) {
+			data->errors++;
+		}
+		MEM_freeN(block);
+	}
+
+	MEM_thread_exit();
+
+	return NULL;
+}
+
+void RunThreads(void *(*func)(void *), ThreadData *data)
+{
+	pthread_t threads[NUM_THREADS];
+
+	for (int i = 0; i < NUM_THREADS; i++) {
+		pthread_create(&threads[i], NULL, func, &data[i]);
+	}
+	for (int i = 0; i < NUM_THREADS; i++) {
+		pthread_join(threads[i], NULL);
+	}
+}
+
+}  // namespace
+
+TEST(guardedalloc, LockfreeThreadCounters)
+{
+	const unsigned int totblock_prev = MEM_get_memory_blocks_in_use();
+	const uintptr_t mem_prev = MEM_get_memory_in_use();
+	void **blocks = (void **)MEM_mallocN(sizeof(void *) * NUM_THREADS * NUM_BLOCKS, "blocks");
+	ThreadData data[NUM_THREADS];
+
+	for (int round = 0; round < 2; round++) {
+		for (int i = 0; i < NUM_THREADS; i++) {
+			data[i].blocks = blocks;
+			data[i].offset = i * NUM_BLOCKS;
+			data[i].use_calloc = (round == 1);
+			data[i].errors = 0;
+		}
+		RunThreads(AllocThread, data);
+
+		EXPECT_EQ(totblock_prev + 1 + NUM_THREADS * NUM_BLOCKS, MEM_get_memory_blocks_in_use());
+		EXPECT_LE(mem_prev + NUM_THREADS * NUM_BLOCKS, MEM_get_memory_in_use());
+		EXPECT_LE(MEM_get_memory_in_use(), MEM_get_peak_memory());
+
+		/* free blocks allocated by another thread */
+		for (int i = 0; i < NUM_THREADS; i++) {
+			data[i].offset = ((i + 1) % NUM_THREADS) * NUM_BLOCKS;
+		}
+		RunThreads(FreeThread, data);
+
+		for (int i = 0; i < NUM_THREADS; i++) {
+			EXPECT_EQ(0, data[i].errors);
+		}
+		EXPECT_EQ(totblock_prev + 1, MEM_get_memory_blocks_in_use());
+	}
+
+	MEM_freeN(blocks);
+	EXPECT_EQ(totblock_prev, MEM_get_memory_blocks_in_use());
+	EXPECT_EQ(mem_prev, MEM_get_memory_in_use());
+}
+
+TEST(guardedalloc, LockfreeCache)
+{
+	const unsigned int totblock_prev = MEM_get_memory_blocks_in_use();
+	const uintptr_t mem_prev = MEM_get_memory_in_use();
+
+	for (size_t len = 1; len <= 300; len++) {
+		unsigned char *block = (unsigned char *)MEM_mallocN(len, "test");
+		int errors = 0;
+
+		memset(block, 255, len);
+		MEM_freeN(block);
+
+		/* freed blocks are cached, but not in use anymore */
+		EXPECT_EQ(totblock_prev, MEM_get_memory_blocks_in_use());
+		EXPECT_EQ(mem_prev, MEM_get_memory_in_use());
+
+		/* likely the same block again, which has to be cleared */
+		block = (unsigned char *)MEM_callocN(len, "test");
+		for (size_t j = 0; j < len; j++) {
+			errors += (block[j] != 0);
+		}
+		EXPECT_EQ(0, errors);
+		EXPECT_EQ(mem_prev + MEM_allocN_len(block), MEM_get_memory_in_use());
+		MEM_freeN(block);
+	}
+
+	MEM_exit();
+	EXPECT_EQ(totblock_prev, MEM_get_memory_blocks_in_use());
+	EXPECT_EQ(mem_prev, MEM_get_memory_in_use());
+}